@@ -0,0 +1,433 @@
+/*****************************************************************//**
+ * \file   AccessorConvert.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  accessor conversion kernels specialized per componentType, type and normalized flag
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "AccessorConvert.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace jcqt
+{
+	using gltf::AccessorType;
+
+	template<quint32 ComponentType> struct ComponentTraits;
+	template<> struct ComponentTraits<gltf::kByte> { using type = qint8; };
+	template<> struct ComponentTraits<gltf::kUnsignedByte> { using type = quint8; };
+	template<> struct ComponentTraits<gltf::kShort> { using type = qint16; };
+	template<> struct ComponentTraits<gltf::kUnsignedShort> { using type = quint16; };
+	template<> struct ComponentTraits<gltf::kUnsignedInt> { using type = quint32; };
+	template<> struct ComponentTraits<gltf::kFloat> { using type = float; };
+
+	// columns and rows of an element, vectors are a single column
+	template<AccessorType Type> struct TypeTraits;
+	template<> struct TypeTraits<AccessorType::Scalar> { static constexpr qsizetype kCols = 1, kRows = 1; };
+	template<> struct TypeTraits<AccessorType::Vec2> { static constexpr qsizetype kCols = 1, kRows = 2; };
+	template<> struct TypeTraits<AccessorType::Vec3> { static constexpr qsizetype kCols = 1, kRows = 3; };
+	template<> struct TypeTraits<AccessorType::Vec4> { static constexpr qsizetype kCols = 1, kRows = 4; };
+	template<> struct TypeTraits<AccessorType::Mat2> { static constexpr qsizetype kCols = 2, kRows = 2; };
+	template<> struct TypeTraits<AccessorType::Mat3> { static constexpr qsizetype kCols = 3, kRows = 3; };
+	template<> struct TypeTraits<AccessorType::Mat4> { static constexpr qsizetype kCols = 4, kRows = 4; };
+
+	// glTF only allows normalized byte and short components
+	template<typename C>
+	static constexpr bool kCanNormalize = std::is_integral_v<C> && sizeof ( C ) <= 2;
+
+	// normalization factors from the glTF specification, signed values are clamped to -1 afterwards
+	template<typename C>
+	static constexpr float kNormScale = std::is_same_v<C, qint8> ? 1.f / 127.f :
+		std::is_same_v<C, quint8> ? 1.f / 255.f :
+		std::is_same_v<C, qint16> ? 1.f / 32767.f :
+		std::is_same_v<C, quint16> ? 1.f / 65535.f : 1.f;
+
+	template<typename C, bool Normalized>
+	static inline float toFloat ( const uchar* p )
+	{
+		C c;
+		memcpy ( &c, p, sizeof ( C ) );
+
+		if constexpr ( Normalized && kCanNormalize<C> )
+		{
+			const float f = float ( c ) * kNormScale<C>;
+			if constexpr ( std::is_signed_v<C> )
+				return std::max ( f, -1.f );
+			else
+				return f;
+		}
+		else
+		{
+			return float ( c );
+		}
+	}
+
+#if defined(JCQT_SIMD_X86)
+	template<typename C>
+	JCQT_TARGET_AVX2 static inline __m256i widen8AVX2 ( const uchar* p )
+	{
+		if constexpr ( std::is_same_v<C, qint8> )
+			return _mm256_cvtepi8_epi32 ( _mm_loadl_epi64 ( reinterpret_cast<const __m128i*>( p ) ) );
+		else if constexpr ( std::is_same_v<C, quint8> )
+			return _mm256_cvtepu8_epi32 ( _mm_loadl_epi64 ( reinterpret_cast<const __m128i*>( p ) ) );
+		else if constexpr ( std::is_same_v<C, qint16> )
+			return _mm256_cvtepi16_epi32 ( _mm_loadu_si128 ( reinterpret_cast<const __m128i*>( p ) ) );
+		else
+			return _mm256_cvtepu16_epi32 ( _mm_loadu_si128 ( reinterpret_cast<const __m128i*>( p ) ) );
+	}
+
+	template<typename C>
+	JCQT_TARGET_SSE41 static inline __m128i widen4SSE41 ( const uchar* p )
+	{
+		if constexpr ( sizeof ( C ) == 1 )
+		{
+			qint32 bytes;
+			memcpy ( &bytes, p, sizeof ( bytes ) );
+			if constexpr ( std::is_signed_v<C> )
+				return _mm_cvtepi8_epi32 ( _mm_cvtsi32_si128 ( bytes ) );
+			else
+				return _mm_cvtepu8_epi32 ( _mm_cvtsi32_si128 ( bytes ) );
+		}
+		else if constexpr ( std::is_signed_v<C> )
+			return _mm_cvtepi16_epi32 ( _mm_loadl_epi64 ( reinterpret_cast<const __m128i*>( p ) ) );
+		else
+			return _mm_cvtepu16_epi32 ( _mm_loadl_epi64 ( reinterpret_cast<const __m128i*>( p ) ) );
+	}
+
+	// the SIMD loops return how many components they converted, the caller finishes the rest
+	template<typename C, bool Normalized>
+	JCQT_TARGET_AVX2 static qsizetype convertFlatAVX2 ( const uchar* src, qsizetype n, float* out )
+	{
+		const __m256 scale = _mm256_set1_ps ( kNormScale<C> );
+		const __m256 minusOne = _mm256_set1_ps ( -1.f );
+
+		qsizetype i = 0;
+		for ( ; i + 8 <= n; i += 8 )
+		{
+			__m256 v = _mm256_cvtepi32_ps ( widen8AVX2<C> ( src + i * qsizetype ( sizeof ( C ) ) ) );
+			if constexpr ( Normalized )
+			{
+				v = _mm256_mul_ps ( v, scale );
+				if constexpr ( std::is_signed_v<C> )
+					v = _mm256_max_ps ( v, minusOne );
+			}
+			_mm256_storeu_ps ( out + i, v );
+		}
+		return i;
+	}
+
+	template<typename C, bool Normalized>
+	JCQT_TARGET_SSE41 static qsizetype convertFlatSSE41 ( const uchar* src, qsizetype n, float* out )
+	{
+		const __m128 scale = _mm_set1_ps ( kNormScale<C> );
+		const __m128 minusOne = _mm_set1_ps ( -1.f );
+
+		qsizetype i = 0;
+		for ( ; i + 4 <= n; i += 4 )
+		{
+			__m128 v = _mm_cvtepi32_ps ( widen4SSE41<C> ( src + i * qsizetype ( sizeof ( C ) ) ) );
+			if constexpr ( Normalized )
+			{
+				v = _mm_mul_ps ( v, scale );
+				if constexpr ( std::is_signed_v<C> )
+					v = _mm_max_ps ( v, minusOne );
+			}
+			_mm_storeu_ps ( out + i, v );
+		}
+		return i;
+	}
+
+	template<typename C>
+	JCQT_TARGET_AVX2 static qsizetype widenIndicesAVX2 ( const uchar* src, qsizetype n, quint32* out )
+	{
+		qsizetype i = 0;
+		for ( ; i + 8 <= n; i += 8 )
+		{
+			_mm256_storeu_si256 ( reinterpret_cast<__m256i*>( out + i ), widen8AVX2<C> ( src + i * qsizetype ( sizeof ( C ) ) ) );
+		}
+		return i;
+	}
+
+	template<typename C>
+	JCQT_TARGET_SSE41 static qsizetype widenIndicesSSE41 ( const uchar* src, qsizetype n, quint32* out )
+	{
+		qsizetype i = 0;
+		for ( ; i + 4 <= n; i += 4 )
+		{
+			_mm_storeu_si128 ( reinterpret_cast<__m128i*>( out + i ), widen4SSE41<C> ( src + i * qsizetype ( sizeof ( C ) ) ) );
+		}
+		return i;
+	}
+
+	// float VEC1-3 to gpuvec4: a 16-byte load picks up the element plus a few bytes of the next one, which the blend replaces by (0, 0, 0, 1)
+	template<qsizetype Rows>
+	JCQT_TARGET_SSE41 static qsizetype expandFloatSSE41 ( const AccessorData& src, gpuvec4* out )
+	{
+		constexpr int kMask = ( 0xF << Rows ) & 0xF;
+		const __m128 fill = _mm_setr_ps ( 0.f, 0.f, 0.f, 1.f );
+
+		// only elements whose 16-byte load stays inside the accessor's bytes, the scalar loop handles the rest
+		const qsizetype accessorBytes = src.count_ > 0 ? ( src.count_ - 1 ) * src.stride_ + Rows * qsizetype ( sizeof ( float ) ) : 0;
+		const qsizetype n = accessorBytes >= 16 ? qMin ( ( accessorBytes - 16 ) / src.stride_ + 1, src.count_ ) : 0;
+		const uchar* p = src.data_;
+		qsizetype i = 0;
+		for ( ; i < n; i++, p += src.stride_ )
+		{
+			const __m128 v = _mm_blend_ps ( _mm_loadu_ps ( reinterpret_cast<const float*>( p ) ), fill, kMask );
+			_mm_storeu_ps ( reinterpret_cast<float*>( out + i ), v );
+		}
+		return i;
+	}
+#endif
+
+	// n tightly packed components. out is written with unaligned stores since packed gpuvec4 arrays end up here as well
+	template<typename C, bool Normalized>
+	static void convertFlat ( const uchar* src, qsizetype n, void* out )
+	{
+		if constexpr ( std::is_same_v<C, float> )
+		{
+			memcpy ( out, src, size_t ( n ) * sizeof ( float ) );
+		}
+		else
+		{
+			constexpr bool kNormalized = Normalized && kCanNormalize<C>;
+			float* dst = static_cast<float*>( out );
+			qsizetype i = 0;
+#if defined(JCQT_SIMD_X86)
+			if constexpr ( sizeof ( C ) <= 2 )
+			{
+				const simd::CpuFeatures& cpu = simd::cpuFeatures ();
+				if ( cpu.avx2_ )
+					i = convertFlatAVX2<C, kNormalized> ( src, n, dst );
+				else if ( cpu.sse41_ )
+					i = convertFlatSSE41<C, kNormalized> ( src, n, dst );
+			}
+#endif
+			for ( ; i < n; i++ )
+			{
+				const float f = toFloat<C, kNormalized> ( src + i * qsizetype ( sizeof ( C ) ) );
+				memcpy ( dst + i, &f, sizeof ( float ) );
+			}
+		}
+	}
+
+	template<quint32 ComponentType, AccessorType Type, bool Normalized>
+	static void convertToFloat ( const AccessorData& src, float* out )
+	{
+		using C = typename ComponentTraits<ComponentType>::type;
+		constexpr qsizetype kCols = TypeTraits<Type>::kCols;
+		constexpr qsizetype kRows = TypeTraits<Type>::kRows;
+		constexpr qsizetype kComponents = kCols * kRows;
+		// matrix columns start on 4-byte boundaries
+		constexpr qsizetype kColumnBytes = kCols > 1 ? ( kRows * qsizetype ( sizeof ( C ) ) + 3 ) & ~qsizetype ( 3 ) : kRows * qsizetype ( sizeof ( C ) );
+
+		if constexpr ( kColumnBytes == kRows * qsizetype ( sizeof ( C ) ) )
+		{
+			if ( src.stride_ == kComponents * qsizetype ( sizeof ( C ) ) )
+			{
+				convertFlat<C, Normalized> ( src.data_, src.count_ * kComponents, out );
+				return;
+			}
+		}
+
+		const uchar* p = src.data_;
+		for ( qsizetype i = 0; i < src.count_; i++, p += src.stride_, out += kComponents )
+		{
+			for ( qsizetype c = 0; c < kCols; c++ )
+			{
+				for ( qsizetype r = 0; r < kRows; r++ )
+				{
+					out [ c * kRows + r ] = toFloat<C, Normalized> ( p + c * kColumnBytes + r * qsizetype ( sizeof ( C ) ) );
+				}
+			}
+		}
+	}
+
+	template<quint32 ComponentType, AccessorType Type, bool Normalized>
+	static void convertToVec4 ( const AccessorData& src, gpuvec4* out )
+	{
+		using C = typename ComponentTraits<ComponentType>::type;
+		constexpr qsizetype kRows = TypeTraits<Type>::kRows;
+		static_assert( TypeTraits<Type>::kCols == 1, "only vectors convert to gpuvec4" );
+
+		if constexpr ( kRows == 4 )
+		{
+			if ( src.stride_ == 4 * qsizetype ( sizeof ( C ) ) )
+			{
+				convertFlat<C, Normalized> ( src.data_, src.count_ * 4, out );
+				return;
+			}
+		}
+
+		qsizetype i = 0;
+#if defined(JCQT_SIMD_X86)
+		if constexpr ( std::is_same_v<C, float> && kRows < 4 )
+		{
+			if ( simd::cpuFeatures ().sse41_ )
+				i = expandFloatSSE41<kRows> ( src, out );
+		}
+#endif
+		const uchar* p = src.data_ + i * src.stride_;
+		for ( ; i < src.count_; i++, p += src.stride_ )
+		{
+			float v [ 4 ] = { 0.f, 0.f, 0.f, 1.f };
+			for ( qsizetype r = 0; r < kRows; r++ )
+			{
+				v [ r ] = toFloat<C, Normalized> ( p + r * qsizetype ( sizeof ( C ) ) );
+			}
+			memcpy ( out + i, v, sizeof ( v ) );
+		}
+	}
+
+	template<typename C>
+	static void convertIndices ( const AccessorData& src, quint32* out )
+	{
+		if ( src.stride_ == qsizetype ( sizeof ( C ) ) )
+		{
+			if constexpr ( sizeof ( C ) == 4 )
+			{
+				memcpy ( out, src.data_, size_t ( src.count_ ) * sizeof ( quint32 ) );
+				return;
+			}
+			else
+			{
+				qsizetype i = 0;
+#if defined(JCQT_SIMD_X86)
+				const simd::CpuFeatures& cpu = simd::cpuFeatures ();
+				if ( cpu.avx2_ )
+					i = widenIndicesAVX2<C> ( src.data_, src.count_, out );
+				else if ( cpu.sse41_ )
+					i = widenIndicesSSE41<C> ( src.data_, src.count_, out );
+#endif
+				for ( ; i < src.count_; i++ )
+				{
+					C c;
+					memcpy ( &c, src.data_ + i * qsizetype ( sizeof ( C ) ), sizeof ( C ) );
+					out [ i ] = c;
+				}
+				return;
+			}
+		}
+
+		const uchar* p = src.data_;
+		for ( qsizetype i = 0; i < src.count_; i++, p += src.stride_ )
+		{
+			C c;
+			memcpy ( &c, p, sizeof ( C ) );
+			out [ i ] = c;
+		}
+	}
+
+	// one table per (componentType, normalized), indexed by AccessorType
+	template<quint32 ComponentType, bool Normalized>
+	static FloatConverter floatConverterFor ( AccessorType type )
+	{
+		static constexpr FloatConverter kTable [] = {
+			nullptr,
+			&convertToFloat<ComponentType, AccessorType::Scalar, Normalized>,
+			&convertToFloat<ComponentType, AccessorType::Vec2, Normalized>,
+			&convertToFloat<ComponentType, AccessorType::Vec3, Normalized>,
+			&convertToFloat<ComponentType, AccessorType::Vec4, Normalized>,
+			&convertToFloat<ComponentType, AccessorType::Mat2, Normalized>,
+			&convertToFloat<ComponentType, AccessorType::Mat3, Normalized>,
+			&convertToFloat<ComponentType, AccessorType::Mat4, Normalized>
+		};
+		return kTable [ qsizetype ( type ) ];
+	}
+
+	template<quint32 ComponentType, bool Normalized>
+	static Vec4Converter vec4ConverterFor ( AccessorType type )
+	{
+		static constexpr Vec4Converter kTable [] = {
+			nullptr,
+			&convertToVec4<ComponentType, AccessorType::Scalar, Normalized>,
+			&convertToVec4<ComponentType, AccessorType::Vec2, Normalized>,
+			&convertToVec4<ComponentType, AccessorType::Vec3, Normalized>,
+			&convertToVec4<ComponentType, AccessorType::Vec4, Normalized>
+		};
+		return type <= AccessorType::Vec4 ? kTable [ qsizetype ( type ) ] : nullptr;
+	}
+
+	FloatConverter floatConverter ( quint32 componentType, AccessorType type, bool normalized )
+	{
+		if ( type > AccessorType::Mat4 )
+			return nullptr;
+
+		switch ( componentType )
+		{
+		case gltf::kByte:
+			return normalized ? floatConverterFor<gltf::kByte, true> ( type ) : floatConverterFor<gltf::kByte, false> ( type );
+		case gltf::kUnsignedByte:
+			return normalized ? floatConverterFor<gltf::kUnsignedByte, true> ( type ) : floatConverterFor<gltf::kUnsignedByte, false> ( type );
+		case gltf::kShort:
+			return normalized ? floatConverterFor<gltf::kShort, true> ( type ) : floatConverterFor<gltf::kShort, false> ( type );
+		case gltf::kUnsignedShort:
+			return normalized ? floatConverterFor<gltf::kUnsignedShort, true> ( type ) : floatConverterFor<gltf::kUnsignedShort, false> ( type );
+		case gltf::kUnsignedInt:
+			return floatConverterFor<gltf::kUnsignedInt, false> ( type );
+		case gltf::kFloat:
+			return floatConverterFor<gltf::kFloat, false> ( type );
+		default:
+			return nullptr;
+		}
+	}
+
+	Vec4Converter vec4Converter ( quint32 componentType, AccessorType type, bool normalized )
+	{
+		if ( type > AccessorType::Mat4 )
+			return nullptr;
+
+		switch ( componentType )
+		{
+		case gltf::kByte:
+			return normalized ? vec4ConverterFor<gltf::kByte, true> ( type ) : vec4ConverterFor<gltf::kByte, false> ( type );
+		case gltf::kUnsignedByte:
+			return normalized ? vec4ConverterFor<gltf::kUnsignedByte, true> ( type ) : vec4ConverterFor<gltf::kUnsignedByte, false> ( type );
+		case gltf::kShort:
+			return normalized ? vec4ConverterFor<gltf::kShort, true> ( type ) : vec4ConverterFor<gltf::kShort, false> ( type );
+		case gltf::kUnsignedShort:
+			return normalized ? vec4ConverterFor<gltf::kUnsignedShort, true> ( type ) : vec4ConverterFor<gltf::kUnsignedShort, false> ( type );
+		case gltf::kUnsignedInt:
+			return vec4ConverterFor<gltf::kUnsignedInt, false> ( type );
+		case gltf::kFloat:
+			return vec4ConverterFor<gltf::kFloat, false> ( type );
+		default:
+			return nullptr;
+		}
+	}
+
+	IndexConverter indexConverter ( quint32 componentType )
+	{
+		switch ( componentType )
+		{
+		case gltf::kUnsignedByte: return &convertIndices<quint8>;
+		case gltf::kUnsignedShort: return &convertIndices<quint16>;
+		case gltf::kUnsignedInt: return &convertIndices<quint32>;
+		default: return nullptr;
+		}
+	}
+}
@@ -0,0 +1,57 @@
+/*****************************************************************//**
+ * \file   AccessorConvert.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  accessor conversion kernels specialized per componentType, type and normalized flag
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __ACCESSOR_CONVERT_H__
+#define __ACCESSOR_CONVERT_H__
+
+#include "AccessorView.h"
+#include "GLTFDocument.h"
+#include "vec4.h"
+
+namespace jcqt
+{
+	/*
+	*	Each (componentType, type, normalized) combination has its own template instantiation, so the component decoding and the
+	*	normalization are resolved at compile time. Look a kernel up once per accessor and run it over all of its elements. Contiguous
+	*	data is converted with SSE4.1/AVX2 when the CPU supports it.
+	*/
+
+	// Writes componentCount(type) floats per element to out. Matrix column padding is dropped, normalized integers map to [0,1] or [-1,1].
+	using FloatConverter = void ( * )( const AccessorData& src, float* out );
+	// Writes one gpuvec4 per element; missing components are taken from (0, 0, 0, 1). Only SCALAR to VEC4 accessors have one.
+	using Vec4Converter = void ( * )( const AccessorData& src, gpuvec4* out );
+	// Widens UNSIGNED_BYTE, UNSIGNED_SHORT and UNSIGNED_INT indices to 32 bit
+	using IndexConverter = void ( * )( const AccessorData& src, quint32* out );
+
+	// nullptr for combinations glTF does not allow (normalized UNSIGNED_INT or FLOAT is treated as not normalized)
+	FloatConverter floatConverter ( quint32 componentType, gltf::AccessorType type, bool normalized );
+	Vec4Converter vec4Converter ( quint32 componentType, gltf::AccessorType type, bool normalized );
+	IndexConverter indexConverter ( quint32 componentType );
+}
+
+#endif // !__ACCESSOR_CONVERT_H__
@@ -0,0 +1,182 @@
+/*****************************************************************//**
+ * \file   AccessorView.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  zero-copy typed views over the elements of a glTF accessor
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __ACCESSOR_VIEW_H__
+#define __ACCESSOR_VIEW_H__
+
+#include <QtGlobal>
+#include <QList>
+
+#include <cstring>
+#include <iterator>
+#include <span>
+#include <type_traits>
+
+namespace jcqt
+{
+	// An accessor resolved down to its buffer bytes: element i starts at data_ + i * stride_ and is elementSize_ bytes long
+	struct AccessorData
+	{
+		const uchar* data_ = nullptr;
+		qsizetype count_ = 0;
+		qsizetype stride_ = 0;
+		qsizetype elementSize_ = 0;
+	};
+
+	/*
+	*	Read-only view of count elements of type T spaced stride bytes apart, typically one attribute of an interleaved vertex buffer.
+	*	Nothing is copied, the view points straight into the loader's buffer storage and is invalidated with it. Elements are read with
+	*	memcpy so strided data does not have to be aligned for T. Tightly packed views (stride == sizeof(T)) can be handed out as a span
+	*	or copied with a single memcpy.
+	*/
+	template<typename T>
+	class AccessorView
+	{
+		static_assert( std::is_trivially_copyable_v<T>, "AccessorView elements are read with memcpy" );
+
+	public:
+		class const_iterator
+		{
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = T;
+			using difference_type = qsizetype;
+			using pointer = void;
+			using reference = T;
+
+			const_iterator () = default;
+			const_iterator ( const uchar* p, qsizetype stride ) : m_ptr ( p ), m_stride ( stride ) {}
+
+			T operator* () const
+			{
+				T v;
+				memcpy ( &v, m_ptr, sizeof ( T ) );
+				return v;
+			}
+
+			const_iterator& operator++ ()
+			{
+				m_ptr += m_stride;
+				return *this;
+			}
+
+			const_iterator operator++ ( int )
+			{
+				const_iterator it = *this;
+				m_ptr += m_stride;
+				return it;
+			}
+
+			bool operator== ( const const_iterator& other ) const { return m_ptr == other.m_ptr; }
+			bool operator!= ( const const_iterator& other ) const { return m_ptr != other.m_ptr; }
+
+		private:
+			const uchar* m_ptr = nullptr;
+			qsizetype m_stride = 0;
+		};
+
+		AccessorView () = default;
+
+		AccessorView ( const uchar* data, qsizetype count, qsizetype stride = qsizetype ( sizeof ( T ) ) ) :
+			m_data ( data ), m_count ( count ), m_stride ( stride )
+		{}
+
+		// The view stays empty when the accessor's element size does not match sizeof(T)
+		explicit AccessorView ( const AccessorData& accessor )
+		{
+			if ( accessor.data_ && accessor.elementSize_ == qsizetype ( sizeof ( T ) ) )
+			{
+				m_data = accessor.data_;
+				m_count = accessor.count_;
+				m_stride = accessor.stride_;
+			}
+		}
+
+		bool isEmpty () const { return m_count == 0; }
+		qsizetype size () const { return m_count; }
+		qsizetype count () const { return m_count; }
+		qsizetype stride () const { return m_stride; }
+		const uchar* data () const { return m_data; }
+
+		// true when the elements follow each other without gaps
+		bool isContiguous () const { return m_stride == qsizetype ( sizeof ( T ) ); }
+
+		T at ( qsizetype i ) const
+		{
+			Q_ASSERT ( i >= 0 && i < m_count );
+			T v;
+			memcpy ( &v, m_data + i * m_stride, sizeof ( T ) );
+			return v;
+		}
+
+		T operator[] ( qsizetype i ) const { return at ( i ); }
+
+		const_iterator begin () const { return const_iterator ( m_data, m_stride ); }
+		const_iterator end () const { return const_iterator ( m_data + m_count * m_stride, m_stride ); }
+
+		// Contiguous elements as a span; empty for strided views or when the data is not aligned for T
+		std::span<const T> span () const
+		{
+			if ( !isContiguous () || reinterpret_cast<quintptr>( m_data ) % alignof( T ) != 0 )
+				return {};
+
+			return std::span<const T> ( reinterpret_cast<const T*>( m_data ), size_t ( m_count ) );
+		}
+
+		// Copies every element to out, which needs room for size() elements
+		void copyTo ( T* out ) const
+		{
+			if ( isContiguous () )
+			{
+				if ( m_count > 0 )
+					memcpy ( out, m_data, size_t ( m_count ) * sizeof ( T ) );
+				return;
+			}
+
+			const uchar* src = m_data;
+			for ( qsizetype i = 0; i < m_count; i++, src += m_stride )
+			{
+				memcpy ( out + i, src, sizeof ( T ) );
+			}
+		}
+
+		QList<T> toList () const
+		{
+			QList<T> list ( m_count );
+			copyTo ( list.data () );
+			return list;
+		}
+
+	private:
+		const uchar* m_data = nullptr;
+		qsizetype m_count = 0;
+		qsizetype m_stride = 0;
+	};
+}
+
+#endif // !__ACCESSOR_VIEW_H__
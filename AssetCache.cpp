@@ -0,0 +1,735 @@
+/*****************************************************************//**
+ * \file   AssetCache.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  on-disk cache of built scenes and converted accessors, keyed by the content of the source glTF
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "AssetCache.h"
+#include "Hash.h"
+#include "Trace.h"
+
+#include <QColorSpace>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QRandomGenerator>
+
+#include <cstring>
+
+namespace jcqt
+{
+	// temporary files older than this belong to a writer that died before renaming them
+	static constexpr qint64 kStaleTemporarySecs = 3600;
+
+	static QStringList entryPattern ()
+	{
+		return { QStringLiteral ( "*.jcache" ) };
+	}
+
+	// The variable length sections are stored in native byte order, like the rest of a scene file
+	template<typename T>
+	static void appendValue ( QByteArray& out, T value )
+	{
+		out.append ( reinterpret_cast<const char*>( &value ), sizeof ( value ) );
+	}
+
+	static void appendString ( QByteArray& out, const QString& s )
+	{
+		const QByteArray utf8 = s.toUtf8 ();
+		appendValue ( out, quint32 ( utf8.size () ) );
+		out += utf8;
+	}
+
+	static void appendBytes ( QByteArray& out, QByteArrayView bytes )
+	{
+		appendValue ( out, quint32 ( bytes.size () ) );
+		out.append ( bytes.data (), bytes.size () );
+	}
+
+	template<typename T>
+	static void appendList ( QByteArray& out, const QList<T>& list )
+	{
+		appendValue ( out, quint32 ( list.size () ) );
+		out.append ( reinterpret_cast<const char*>( list.constData () ), list.size () * qsizetype ( sizeof ( T ) ) );
+	}
+
+	// Reads back what the append functions above wrote; ok_ turns false on the first read past the end and stays false
+	struct SectionReader
+	{
+		QByteArrayView bytes_;
+		qsizetype pos_ = 0;
+		bool ok_ = true;
+
+		template<typename T>
+		T read ()
+		{
+			T value {};
+			if ( !ok_ || pos_ + qsizetype ( sizeof ( T ) ) > bytes_.size () )
+			{
+				ok_ = false;
+				return value;
+			}
+			memcpy ( &value, bytes_.data () + pos_, sizeof ( T ) );
+			pos_ += sizeof ( T );
+			return value;
+		}
+
+		// element counts are checked against the bytes left, so a damaged count cannot trigger a huge allocation
+		quint32 readCount ( qsizetype minElementSize )
+		{
+			const quint32 count = read<quint32> ();
+			if ( ok_ && qint64 ( count ) * minElementSize > bytes_.size () - pos_ )
+				ok_ = false;
+			return ok_ ? count : 0;
+		}
+
+		QByteArrayView readBytes ()
+		{
+			const quint32 size = readCount ( 1 );
+			if ( !ok_ )
+				return QByteArrayView ();
+			const QByteArrayView bytes = bytes_.sliced ( pos_, size );
+			pos_ += size;
+			return bytes;
+		}
+
+		QString readString ()
+		{
+			return QString::fromUtf8 ( readBytes () );
+		}
+
+		template<typename T>
+		QList<T> readList ()
+		{
+			QList<T> list ( readCount ( sizeof ( T ) ) );
+			if ( !list.isEmpty () )
+			{
+				memcpy ( list.data (), bytes_.data () + pos_, list.size () * sizeof ( T ) );
+				pos_ += list.size () * qsizetype ( sizeof ( T ) );
+			}
+			return list;
+		}
+
+		template<typename T, size_t N>
+		void readArray ( T ( &values ) [ N ] )
+		{
+			for ( T& v : values )
+				v = read<T> ();
+		}
+	};
+
+	template<typename T, size_t N>
+	static void appendArray ( QByteArray& out, const T ( &values ) [ N ] )
+	{
+		for ( const T& v : values )
+			appendValue ( out, v );
+	}
+
+	/*
+	*	data: URI payloads that point into the JSON text are stored as a range of it, the loader keeps that text mapped on a hit as well.
+	*	Payloads parseDocument() had to copy (strings with escape sequences) are stored as bytes.
+	*/
+	static void appendUri ( QByteArray& out, const gltf::UriReference& ref, QByteArrayView json )
+	{
+		appendString ( out, ref.uri_ );
+		const QByteArrayView payload = ref.dataPayload ();
+		const quintptr begin = quintptr ( json.data () );
+		const quintptr at = quintptr ( payload.data () );
+		if ( ref.dataStorage_.isEmpty () && !payload.isEmpty () && at >= begin && at + quintptr ( payload.size () ) <= begin + quintptr ( json.size () ) )
+		{
+			appendValue ( out, qint64 ( at - begin ) );
+			appendValue ( out, qint64 ( payload.size () ) );
+		}
+		else
+		{
+			appendValue ( out, qint64 ( -1 ) );
+			appendBytes ( out, payload );
+		}
+	}
+
+	static void readUri ( SectionReader& in, gltf::UriReference& ref, QByteArrayView json )
+	{
+		ref.uri_ = in.readString ();
+		const qint64 offset = in.read<qint64> ();
+		if ( offset < 0 )
+		{
+			ref.dataStorage_ = in.readBytes ().toByteArray ();
+			return;
+		}
+
+		const qint64 size = in.read<qint64> ();
+		if ( size < 0 || offset > json.size () || size > json.size () - offset )
+			in.ok_ = false;
+		else
+			ref.dataView_ = json.sliced ( offset, size );
+	}
+
+	static void appendTextureInfo ( QByteArray& out, const gltf::TextureInfo& info )
+	{
+		appendValue ( out, info.index_ );
+		appendValue ( out, info.texCoord_ );
+		appendValue ( out, info.scale_ );
+	}
+
+	static void readTextureInfo ( SectionReader& in, gltf::TextureInfo& info )
+	{
+		info.index_ = in.read<qint32> ();
+		info.texCoord_ = in.read<qint32> ();
+		info.scale_ = in.read<float> ();
+	}
+
+	// The whole parsed document, in the order of the members of gltf::Document
+	static QByteArray encodeDocument ( const gltf::Document& doc, QByteArrayView json )
+	{
+		QByteArray out;
+		appendString ( out, doc.version_ );
+		appendValue ( out, doc.scene_ );
+
+		appendValue ( out, quint32 ( doc.scenes_.size () ) );
+		for ( const gltf::Scene& scene : doc.scenes_ )
+		{
+			appendList ( out, scene.nodes_ );
+			appendString ( out, scene.name_ );
+		}
+
+		appendValue ( out, quint32 ( doc.nodes_.size () ) );
+		for ( const gltf::Node& node : doc.nodes_ )
+		{
+			appendList ( out, node.children_ );
+			appendValue ( out, node.mesh_ );
+			appendValue ( out, node.camera_ );
+			appendValue ( out, node.skin_ );
+			appendValue ( out, quint32 ( node.hasMatrix_ ) );
+			appendArray ( out, node.matrix_ );
+			appendArray ( out, node.translation_ );
+			appendArray ( out, node.rotation_ );
+			appendArray ( out, node.scale_ );
+			appendList ( out, node.weights_ );
+			appendString ( out, node.name_ );
+		}
+
+		appendValue ( out, quint32 ( doc.meshes_.size () ) );
+		for ( const gltf::Mesh& mesh : doc.meshes_ )
+		{
+			appendValue ( out, quint32 ( mesh.primitives_.size () ) );
+			for ( const gltf::Primitive& primitive : mesh.primitives_ )
+			{
+				appendValue ( out, quint32 ( primitive.attributes_.size () ) );
+				for ( const gltf::Attribute& attribute : primitive.attributes_ )
+				{
+					appendString ( out, attribute.name_ );
+					appendValue ( out, attribute.accessor_ );
+				}
+				appendValue ( out, primitive.indices_ );
+				appendValue ( out, primitive.material_ );
+				appendValue ( out, primitive.mode_ );
+			}
+			appendList ( out, mesh.weights_ );
+			appendString ( out, mesh.name_ );
+		}
+
+		appendValue ( out, quint32 ( doc.accessors_.size () ) );
+		for ( const gltf::Accessor& accessor : doc.accessors_ )
+		{
+			appendValue ( out, accessor.bufferView_ );
+			appendValue ( out, accessor.byteOffset_ );
+			appendValue ( out, accessor.componentType_ );
+			appendValue ( out, quint32 ( accessor.normalized_ ) );
+			appendValue ( out, accessor.count_ );
+			appendValue ( out, quint32 ( accessor.type_ ) );
+			appendList ( out, accessor.min_ );
+			appendList ( out, accessor.max_ );
+			appendString ( out, accessor.name_ );
+		}
+
+		appendValue ( out, quint32 ( doc.bufferViews_.size () ) );
+		for ( const gltf::BufferView& view : doc.bufferViews_ )
+		{
+			appendValue ( out, view.buffer_ );
+			appendValue ( out, view.byteOffset_ );
+			appendValue ( out, view.byteLength_ );
+			appendValue ( out, view.byteStride_ );
+			appendValue ( out, view.target_ );
+			appendString ( out, view.name_ );
+		}
+
+		appendValue ( out, quint32 ( doc.buffers_.size () ) );
+		for ( const gltf::Buffer& buffer : doc.buffers_ )
+		{
+			appendUri ( out, buffer, json );
+			appendValue ( out, buffer.byteLength_ );
+			appendString ( out, buffer.name_ );
+		}
+
+		appendValue ( out, quint32 ( doc.materials_.size () ) );
+		for ( const gltf::Material& material : doc.materials_ )
+		{
+			appendArray ( out, material.baseColorFactor_ );
+			appendTextureInfo ( out, material.baseColorTexture_ );
+			appendValue ( out, material.metallicFactor_ );
+			appendValue ( out, material.roughnessFactor_ );
+			appendTextureInfo ( out, material.metallicRoughnessTexture_ );
+			appendTextureInfo ( out, material.normalTexture_ );
+			appendTextureInfo ( out, material.occlusionTexture_ );
+			appendTextureInfo ( out, material.emissiveTexture_ );
+			appendArray ( out, material.emissiveFactor_ );
+			appendValue ( out, quint32 ( material.alphaMode_ ) );
+			appendValue ( out, material.alphaCutoff_ );
+			appendValue ( out, quint32 ( material.doubleSided_ ) );
+			appendString ( out, material.name_ );
+		}
+
+		appendValue ( out, quint32 ( doc.images_.size () ) );
+		for ( const gltf::Image& image : doc.images_ )
+		{
+			appendUri ( out, image, json );
+			appendString ( out, image.mimeType_ );
+			appendValue ( out, image.bufferView_ );
+			appendString ( out, image.name_ );
+		}
+
+		appendValue ( out, quint32 ( doc.textures_.size () ) );
+		for ( const gltf::Texture& texture : doc.textures_ )
+		{
+			appendValue ( out, texture.sampler_ );
+			appendValue ( out, texture.source_ );
+			appendString ( out, texture.name_ );
+		}
+		return out;
+	}
+
+	static bool decodeDocument ( QByteArrayView bytes, QByteArrayView json, gltf::Document& doc )
+	{
+		SectionReader in { bytes };
+		doc.version_ = in.readString ();
+		doc.scene_ = in.read<qint32> ();
+
+		doc.scenes_.resize ( in.readCount ( 2 * sizeof ( quint32 ) ) );
+		for ( gltf::Scene& scene : doc.scenes_ )
+		{
+			scene.nodes_ = in.readList<qint32> ();
+			scene.name_ = in.readString ();
+		}
+
+		doc.nodes_.resize ( in.readCount ( 30 * sizeof ( quint32 ) ) );
+		for ( gltf::Node& node : doc.nodes_ )
+		{
+			node.children_ = in.readList<qint32> ();
+			node.mesh_ = in.read<qint32> ();
+			node.camera_ = in.read<qint32> ();
+			node.skin_ = in.read<qint32> ();
+			node.hasMatrix_ = in.read<quint32> () != 0;
+			in.readArray ( node.matrix_ );
+			in.readArray ( node.translation_ );
+			in.readArray ( node.rotation_ );
+			in.readArray ( node.scale_ );
+			node.weights_ = in.readList<float> ();
+			node.name_ = in.readString ();
+		}
+
+		doc.meshes_.resize ( in.readCount ( 3 * sizeof ( quint32 ) ) );
+		for ( gltf::Mesh& mesh : doc.meshes_ )
+		{
+			mesh.primitives_.resize ( in.readCount ( 4 * sizeof ( qint32 ) ) );
+			for ( gltf::Primitive& primitive : mesh.primitives_ )
+			{
+				primitive.attributes_.resize ( in.readCount ( 2 * sizeof ( quint32 ) ) );
+				for ( gltf::Attribute& attribute : primitive.attributes_ )
+				{
+					attribute.name_ = in.readString ();
+					attribute.accessor_ = in.read<qint32> ();
+				}
+				primitive.indices_ = in.read<qint32> ();
+				primitive.material_ = in.read<qint32> ();
+				primitive.mode_ = in.read<qint32> ();
+			}
+			mesh.weights_ = in.readList<float> ();
+			mesh.name_ = in.readString ();
+		}
+
+		doc.accessors_.resize ( in.readCount ( 9 * sizeof ( quint32 ) ) );
+		for ( gltf::Accessor& accessor : doc.accessors_ )
+		{
+			accessor.bufferView_ = in.read<qint32> ();
+			accessor.byteOffset_ = in.read<qint64> ();
+			accessor.componentType_ = in.read<quint32> ();
+			accessor.normalized_ = in.read<quint32> () != 0;
+			accessor.count_ = in.read<qint64> ();
+			const quint32 type = in.read<quint32> ();
+			if ( type > quint32 ( gltf::AccessorType::Mat4 ) )
+				in.ok_ = false;
+			accessor.type_ = gltf::AccessorType ( type );
+			accessor.min_ = in.readList<double> ();
+			accessor.max_ = in.readList<double> ();
+			accessor.name_ = in.readString ();
+		}
+
+		doc.bufferViews_.resize ( in.readCount ( 7 * sizeof ( quint32 ) ) );
+		for ( gltf::BufferView& view : doc.bufferViews_ )
+		{
+			view.buffer_ = in.read<qint32> ();
+			view.byteOffset_ = in.read<qint64> ();
+			view.byteLength_ = in.read<qint64> ();
+			view.byteStride_ = in.read<qint32> ();
+			view.target_ = in.read<qint32> ();
+			view.name_ = in.readString ();
+		}
+
+		doc.buffers_.resize ( in.readCount ( 6 * sizeof ( quint32 ) ) );
+		for ( gltf::Buffer& buffer : doc.buffers_ )
+		{
+			readUri ( in, buffer, json );
+			buffer.byteLength_ = in.read<qint64> ();
+			buffer.name_ = in.readString ();
+		}
+
+		doc.materials_.resize ( in.readCount ( 28 * sizeof ( quint32 ) ) );
+		for ( gltf::Material& material : doc.materials_ )
+		{
+			in.readArray ( material.baseColorFactor_ );
+			readTextureInfo ( in, material.baseColorTexture_ );
+			material.metallicFactor_ = in.read<float> ();
+			material.roughnessFactor_ = in.read<float> ();
+			readTextureInfo ( in, material.metallicRoughnessTexture_ );
+			readTextureInfo ( in, material.normalTexture_ );
+			readTextureInfo ( in, material.occlusionTexture_ );
+			readTextureInfo ( in, material.emissiveTexture_ );
+			in.readArray ( material.emissiveFactor_ );
+			const quint32 alphaMode = in.read<quint32> ();
+			if ( alphaMode > quint32 ( gltf::AlphaMode::Blend ) )
+				in.ok_ = false;
+			material.alphaMode_ = gltf::AlphaMode ( alphaMode );
+			material.alphaCutoff_ = in.read<float> ();
+			material.doubleSided_ = in.read<quint32> () != 0;
+			material.name_ = in.readString ();
+		}
+
+		doc.images_.resize ( in.readCount ( 6 * sizeof ( quint32 ) ) );
+		for ( gltf::Image& image : doc.images_ )
+		{
+			readUri ( in, image, json );
+			image.mimeType_ = in.readString ();
+			image.bufferView_ = in.read<qint32> ();
+			image.name_ = in.readString ();
+		}
+
+		doc.textures_.resize ( in.readCount ( 3 * sizeof ( quint32 ) ) );
+		for ( gltf::Texture& texture : doc.textures_ )
+		{
+			texture.sampler_ = in.read<qint32> ();
+			texture.source_ = in.read<qint32> ();
+			texture.name_ = in.readString ();
+		}
+		return in.ok_ && in.pos_ == bytes.size ();
+	}
+
+	/*
+	*	One row per image: format, size, bytesPerLine, the pixel range in the CacheImageData section and the ICC profile of its color space.
+	*	The pixels are stored as decoded, every image starting 16-byte aligned.
+	*/
+	static void encodeImages ( const QList<QImage>& images, QByteArray& table, QByteArray& pixels )
+	{
+		appendValue ( table, quint32 ( images.size () ) );
+		for ( const QImage& image : images )
+		{
+			appendValue ( table, quint32 ( image.format () ) );
+			appendValue ( table, qint32 ( image.width () ) );
+			appendValue ( table, qint32 ( image.height () ) );
+			appendValue ( table, qint64 ( image.bytesPerLine () ) );
+			appendValue ( table, quint64 ( pixels.size () ) );
+			appendValue ( table, quint64 ( image.sizeInBytes () ) );
+			appendBytes ( table, image.colorSpace ().iccProfile () );
+
+			pixels.append ( reinterpret_cast<const char*>( image.constBits () ), image.sizeInBytes () );
+			pixels.append ( ( 16 - pixels.size () % 16 ) % 16, '\0' );
+		}
+	}
+
+	static bool decodeImages ( QByteArrayView table, QByteArrayView pixels, QList<QImage>& images )
+	{
+		SectionReader in { table };
+		images.resize ( in.readCount ( 5 * sizeof ( quint64 ) ) );
+		for ( QImage& image : images )
+		{
+			const quint32 format = in.read<quint32> ();
+			const qint32 width = in.read<qint32> ();
+			const qint32 height = in.read<qint32> ();
+			const qint64 bytesPerLine = in.read<qint64> ();
+			const quint64 offset = in.read<quint64> ();
+			const quint64 size = in.read<quint64> ();
+			const QByteArrayView icc = in.readBytes ();
+			if ( !in.ok_ || format == quint32 ( QImage::Format_Invalid ) || format >= quint32 ( QImage::NImageFormats ) || width <= 0 || height <= 0 ||
+				bytesPerLine <= 0 || quint64 ( bytesPerLine ) * quint64 ( height ) != size || offset > quint64 ( pixels.size () ) ||
+				size > quint64 ( pixels.size () ) - offset )
+			{
+				return false;
+			}
+
+			// copied out of the mapping: a QImage handed out by the loader may outlive the entry
+			image = QImage ( reinterpret_cast<const uchar*>( pixels.data () + offset ), width, height, qsizetype ( bytesPerLine ),
+				QImage::Format ( format ) ).copy ();
+			if ( !icc.isEmpty () )
+				image.setColorSpace ( QColorSpace::fromIccProfile ( icc.toByteArray () ) );
+		}
+		return in.ok_ && in.pos_ == table.size ();
+	}
+
+	// size and hash64() of a file, mapped when possible
+	static bool hashFile ( const QString& filename, qint64& size, quint64& hash )
+	{
+		QFile f ( filename );
+		if ( !f.open ( QIODevice::ReadOnly ) )
+			return false;
+
+		size = f.size ();
+		uchar* mapped = ( size > 0 ) ? f.map ( 0, size ) : nullptr;
+		if ( mapped )
+		{
+			hash = hash64 ( mapped, size );
+			f.unmap ( mapped );
+			return true;
+		}
+
+		const QByteArray bytes = f.readAll ();
+		hash = hash64 ( bytes );
+		return bytes.size () == size;
+	}
+
+	AssetCache::AssetCache ( const QString& directory, qint64 maxBytes )
+		: m_directory ( directory ), m_maxBytes ( maxBytes )
+	{
+		if ( !QDir ().mkpath ( directory ) )
+			qWarning () << "Cannot create asset cache directory " << directory << Qt::endl;
+	}
+
+	const QString& AssetCache::directory () const
+	{
+		return m_directory;
+	}
+
+	qint64 AssetCache::maxBytes () const
+	{
+		return m_maxBytes;
+	}
+
+	void AssetCache::setMaxBytes ( qint64 maxBytes )
+	{
+		m_maxBytes = maxBytes;
+		if ( size () > m_maxBytes )
+			evict ();
+	}
+
+	quint64 AssetCache::key ( QByteArrayView source )
+	{
+		return hash64 ( source, ASSET_CACHE_VERSION );
+	}
+
+	QString AssetCache::entryPath ( quint64 key ) const
+	{
+		return QDir ( m_directory ).filePath ( QStringLiteral ( "%1.jcache" ).arg ( key, 16, 16, QLatin1Char ( '0' ) ) );
+	}
+
+	bool AssetCache::lookup ( quint64 key, const QString& sourceDir, SceneFile& entry )
+	{
+		JCQT_TRACE_SPAN ( span, "AssetCache::lookup" );
+		const QString path = entryPath ( key );
+		if ( !QFileInfo::exists ( path ) || !entry.open ( path, true ) )
+		{
+			m_misses++;
+			return false;
+		}
+
+		// the size is compared first, only files of the recorded size are hashed
+		SectionReader dependencies { entry.section ( SceneSectionId::CacheDependencies ) };
+		const quint32 count = dependencies.readCount ( 2 * sizeof ( quint64 ) + sizeof ( quint32 ) );
+		bool unchanged = dependencies.ok_;
+		for ( quint32 i = 0; unchanged && i < count; i++ )
+		{
+			const qint64 size = dependencies.read<qint64> ();
+			const quint64 hash = dependencies.read<quint64> ();
+			const QString filename = QDir ( sourceDir ).filePath ( dependencies.readString () );
+
+			qint64 currentSize = 0;
+			quint64 currentHash = 0;
+			unchanged = dependencies.ok_ && QFileInfo ( filename ).size () == size && hashFile ( filename, currentSize, currentHash ) &&
+				currentSize == size && currentHash == hash;
+		}
+
+		if ( !unchanged )
+		{
+			entry.close ();
+			m_misses++;
+			return false;
+		}
+
+		// most recently used now; a failure here only makes the entry look older to evict()
+		QFile touch ( path );
+		if ( touch.open ( QIODevice::ReadWrite ) )
+			touch.setFileTime ( QDateTime::currentDateTimeUtc (), QFileDevice::FileModificationTime );
+
+		JCQT_TRACE_COUNTS ( span, QFileInfo ( path ).size (), count );
+		m_hits++;
+		return true;
+	}
+
+	bool AssetCache::readContent ( const SceneFile& entry, QByteArrayView json, gltf::Document& document, QList<CachedAccessor>& accessors,
+		QList<QImage>& images )
+	{
+		if ( !decodeDocument ( entry.section ( SceneSectionId::CacheDocument ), json, document ) ||
+			!decodeImages ( entry.section ( SceneSectionId::CacheImages ), entry.section ( SceneSectionId::CacheImageData ), images ) ||
+			images.size () != document.images_.size () )
+		{
+			return false;
+		}
+
+		const QByteArrayView table = entry.section ( SceneSectionId::CacheAccessors );
+		if ( table.size () % sizeof ( CachedAccessor ) != 0 )
+			return false;
+
+		accessors.resize ( table.size () / qsizetype ( sizeof ( CachedAccessor ) ) );
+		if ( !accessors.isEmpty () )
+			memcpy ( accessors.data (), table.data (), table.size () );
+
+		const quint64 dataSize = quint64 ( entry.section ( SceneSectionId::CacheAccessorData ).size () );
+		for ( const CachedAccessor& accessor : accessors )
+		{
+			if ( accessor.offset_ > dataSize || accessor.size_ > dataSize - accessor.offset_ )
+				return false;
+		}
+		return true;
+	}
+
+	bool AssetCache::store ( quint64 key, const QString& sourceDir, const Scene& scene, const AssetCacheContent& content )
+	{
+		JCQT_TRACE_SPAN ( span, "AssetCache::store" );
+
+		// a rough size first, so an asset that could never fit is not written at all
+		qint64 estimate = content.accessorData_.size () + scene.hierarchy_.size () * qint64 ( 2 * sizeof ( gpumat4 ) + sizeof ( Hierarchy ) );
+		for ( const QImage& image : content.images_ )
+			estimate += image.sizeInBytes ();
+		if ( estimate > m_maxBytes )
+			return false;
+
+		// the dependencies are hashed now: if one changed since it was loaded, the entry misses next time instead of serving stale data
+		QByteArray dependencies;
+		appendValue ( dependencies, quint32 ( content.dependencies_.size () ) );
+		for ( const QString& dependency : content.dependencies_ )
+		{
+			qint64 size = 0;
+			quint64 hash = 0;
+			if ( !hashFile ( QDir ( sourceDir ).filePath ( dependency ), size, hash ) )
+				return false;
+			appendValue ( dependencies, size );
+			appendValue ( dependencies, hash );
+			appendString ( dependencies, dependency );
+		}
+
+		const QByteArray document = encodeDocument ( content.document_, content.json_ );
+		QByteArray images;
+		QByteArray imageData;
+		encodeImages ( content.images_, images, imageData );
+		const QList<SceneFileExtraSection> sections {
+			{ quint32 ( SceneSectionId::CacheDependencies ), dependencies },
+			{ quint32 ( SceneSectionId::CacheDocument ), document },
+			{ quint32 ( SceneSectionId::CacheAccessors ), QByteArrayView ( reinterpret_cast<const char*>( content.accessors_.constData () ),
+				content.accessors_.size () * qsizetype ( sizeof ( CachedAccessor ) ) ) },
+			{ quint32 ( SceneSectionId::CacheAccessorData ), content.accessorData_ },
+			{ quint32 ( SceneSectionId::CacheImages ), images },
+			{ quint32 ( SceneSectionId::CacheImageData ), imageData }
+		};
+
+		// written under a name no other writer uses, then renamed into place: readers see the whole entry or none
+		const QString path = entryPath ( key );
+		const QString temporary = path + QStringLiteral ( ".%1-%2.tmp" ).arg ( QCoreApplication::applicationPid () )
+			.arg ( QRandomGenerator::global ()->generate (), 8, 16, QLatin1Char ( '0' ) );
+		if ( !SceneFile::save ( temporary, scene, true, sections ) )
+		{
+			QFile::remove ( temporary );
+			return false;
+		}
+
+		/*
+		*	QFile::rename() does not replace an existing file. What is there is either a stale entry of the same source or the same entry
+		*	stored by another process a moment ago, both can go. Where it cannot be removed (mapped by a reader on Windows), ours is dropped.
+		*/
+		if ( !QFile::rename ( temporary, path ) && !( QFile::remove ( path ) && QFile::rename ( temporary, path ) ) )
+		{
+			QFile::remove ( temporary );
+			return false;
+		}
+
+		JCQT_TRACE_COUNTS ( span, QFileInfo ( path ).size (), content.accessors_.size () );
+		evict ();
+		return true;
+	}
+
+	void AssetCache::evict ()
+	{
+		// one evicting process at a time is enough, the others skip it
+		QLockFile lock ( QDir ( m_directory ).filePath ( QStringLiteral ( "evict.lock" ) ) );
+		if ( !lock.tryLock ( 0 ) )
+			return;
+
+		const QDir dir ( m_directory );
+		const QDateTime now = QDateTime::currentDateTimeUtc ();
+		for ( const QFileInfo& temporary : dir.entryInfoList ( { QStringLiteral ( "*.tmp" ) }, QDir::Files ) )
+		{
+			if ( temporary.lastModified ().secsTo ( now ) > kStaleTemporarySecs )
+				QFile::remove ( temporary.filePath () );
+		}
+
+		// least recently used first
+		const QFileInfoList entries = dir.entryInfoList ( entryPattern (), QDir::Files, QDir::Time | QDir::Reversed );
+		qint64 total = 0;
+		for ( const QFileInfo& entry : entries )
+			total += entry.size ();
+
+		for ( const QFileInfo& entry : entries )
+		{
+			if ( total <= m_maxBytes )
+				break;
+			if ( QFile::remove ( entry.filePath () ) )
+				total -= entry.size ();
+		}
+	}
+
+	void AssetCache::clear ()
+	{
+		for ( const QFileInfo& entry : QDir ( m_directory ).entryInfoList ( entryPattern (), QDir::Files ) )
+			QFile::remove ( entry.filePath () );
+	}
+
+	qint64 AssetCache::size () const
+	{
+		qint64 total = 0;
+		for ( const QFileInfo& entry : QDir ( m_directory ).entryInfoList ( entryPattern (), QDir::Files ) )
+			total += entry.size ();
+		return total;
+	}
+}
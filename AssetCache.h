@@ -0,0 +1,140 @@
+/*****************************************************************//**
+ * \file   AssetCache.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  on-disk cache of built scenes and converted accessors, keyed by the content of the source glTF
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __ASSET_CACHE_H__
+#define __ASSET_CACHE_H__
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QImage>
+
+#include <atomic>
+
+#include "GLTFDocument.h"
+#include "GLTFScene.h"
+#include "SceneFile.h"
+
+namespace jcqt
+{
+	// bumped whenever what GLTFLoader stores in an entry changes, older entries then simply miss
+	constexpr const quint32 ASSET_CACHE_VERSION = 2;
+
+	enum class CachedAccessorKind : quint32
+	{
+		// not converted (no bufferView or an unsupported type), reads fail as they would on the source
+		None = 0,
+		// componentCount(type_) floats per element, as readAccessor(QList<float>&) returns them
+		Float = 1,
+		// one quint32 per element, as readIndices() returns them
+		Index = 2
+	};
+
+	// One row of the CacheAccessors section
+	struct CachedAccessor
+	{
+		CachedAccessorKind kind_;
+		// gltf::AccessorType
+		quint32 type_;
+		quint32 componentType_;
+		quint32 normalized_;
+		qint64 count_;
+		// byte range in the CacheAccessorData section
+		quint64 offset_;
+		quint64 size_;
+	};
+
+	// What an entry holds besides the scene
+	struct AssetCacheContent
+	{
+		// external buffers and image files the source references, relative to the source's directory
+		QStringList dependencies_;
+		// the parsed document; its data: URI payloads are stored as ranges of json_ (the JSON text it was parsed from) where possible
+		gltf::Document document_;
+		QByteArrayView json_;
+		QList<CachedAccessor> accessors_;
+		QByteArray accessorData_;
+		// images [ i ] decoded from document_.images_ [ i ], stored uncompressed
+		QList<QImage> images_;
+	};
+
+	/*
+	*	Directory of preprocessed assets. An entry is a scene file (see SceneFile.h) named after the hash64() of the source .gltf/.glb bytes,
+	*	with extra sections for the parsed document, the converted accessors, the decoded images and the size and hash64() of every external
+	*	file the source uses; an entry whose external files changed is a miss. GLTFLoader::setAssetCache() uses it to skip parsing and
+	*	decoding on a hit.
+	*
+	*	Entries are written to a temporary file and renamed into place, so readers never see a partial entry, and they are opened with their
+	*	checksums verified. Several processes may share the directory: readers need no lock (an entry removed or replaced while mapped stays
+	*	readable on POSIX systems; on Windows removing it fails and it is tried again later), eviction is serialized by a QLockFile.
+	*	Every hit refreshes the entry's modification time, eviction removes the least recently used entries once the total exceeds maxBytes().
+	*/
+	class AssetCache
+	{
+	public:
+		explicit AssetCache ( const QString& directory, qint64 maxBytes = qint64 ( 1 ) << 30 );
+
+		const QString& directory () const;
+		qint64 maxBytes () const;
+		// Evicts right away if the cache is larger than the new limit
+		void setMaxBytes ( qint64 maxBytes );
+
+		// Key of a source: hash64() of its bytes, seeded with ASSET_CACHE_VERSION
+		static quint64 key ( QByteArrayView source );
+		QString entryPath ( quint64 key ) const;
+
+		// Opens the entry of key if it is intact and every dependency under sourceDir is unchanged
+		bool lookup ( quint64 key, const QString& sourceDir, SceneFile& entry );
+		// The document, accessor and image sections of an opened entry; json is the JSON text of the source, data: URIs point into it
+		static bool readContent ( const SceneFile& entry, QByteArrayView json, gltf::Document& document, QList<CachedAccessor>& accessors,
+			QList<QImage>& images );
+
+		// Writes the entry of key (replacing a stale one) and evicts; entries larger than maxBytes() are not stored
+		bool store ( quint64 key, const QString& sourceDir, const Scene& scene, const AssetCacheContent& content );
+
+		// Removes least recently used entries until the cache fits maxBytes(), and temporary files abandoned by crashed writers
+		void evict ();
+		void clear ();
+		// bytes of all entries
+		qint64 size () const;
+
+		// lookups of every loader using this cache, which may run on pool threads
+		qint64 hits () const { return m_hits.load (); }
+		qint64 misses () const { return m_misses.load (); }
+
+	private:
+		QString m_directory;
+		qint64 m_maxBytes;
+		std::atomic<qint64> m_hits { 0 };
+		std::atomic<qint64> m_misses { 0 };
+	};
+}
+
+#endif // !__ASSET_CACHE_H__
@@ -0,0 +1,261 @@
+/*****************************************************************//**
+ * \file   Base64.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "Base64.h"
+#include "simd.h"
+
+#include <array>
+
+namespace jcqt
+{
+	// 6-bit value of every base64 character, -1 for anything else
+	static constexpr std::array<qint8, 256> makeDecodeTable ()
+	{
+		std::array<qint8, 256> table {};
+		for ( qint32 i = 0; i < 256; i++ )
+			table [ i ] = -1;
+		for ( qint32 i = 0; i < 26; i++ )
+		{
+			table [ 'A' + i ] = qint8 ( i );
+			table [ 'a' + i ] = qint8 ( 26 + i );
+		}
+		for ( qint32 i = 0; i < 10; i++ )
+			table [ '0' + i ] = qint8 ( 52 + i );
+		table [ '+' ] = 62;
+		table [ '/' ] = 63;
+		return table;
+	}
+
+	static constexpr std::array<qint8, 256> kDecodeTable = makeDecodeTable ();
+
+	static qsizetype paddingLength ( QByteArrayView encoded )
+	{
+		qsizetype pad = 0;
+		while ( pad < 2 && pad < encoded.size () && encoded [ encoded.size () - 1 - pad ] == '=' )
+			pad++;
+		return pad;
+	}
+
+	qsizetype base64DecodedSize ( QByteArrayView encoded )
+	{
+		const qsizetype n = encoded.size ();
+		const qsizetype pad = paddingLength ( encoded );
+
+		if ( n % 4 == 0 )
+			return ( n / 4 ) * 3 - pad;
+
+		// unpadded input, a single trailing character can never be valid
+		if ( pad == 0 && n % 4 != 1 )
+			return ( n / 4 ) * 3 + ( n % 4 ) - 1;
+
+		return -1;
+	}
+
+	// decodes the unpadded characters in [src, end) to out
+	static qsizetype decodeScalarBody ( const uchar* src, const uchar* end, uchar* out )
+	{
+		uchar* const start = out;
+
+		while ( end - src >= 4 )
+		{
+			const qint32 a = kDecodeTable [ src [ 0 ] ];
+			const qint32 b = kDecodeTable [ src [ 1 ] ];
+			const qint32 c = kDecodeTable [ src [ 2 ] ];
+			const qint32 d = kDecodeTable [ src [ 3 ] ];
+			if ( ( a | b | c | d ) < 0 )
+				return -1;
+
+			const quint32 v = ( quint32 ( a ) << 18 ) | ( quint32 ( b ) << 12 ) | ( quint32 ( c ) << 6 ) | quint32 ( d );
+			out [ 0 ] = uchar ( v >> 16 );
+			out [ 1 ] = uchar ( v >> 8 );
+			out [ 2 ] = uchar ( v );
+			src += 4;
+			out += 3;
+		}
+
+		const qsizetype rest = end - src;
+		if ( rest == 1 )
+			return -1;
+
+		if ( rest >= 2 )
+		{
+			const qint32 a = kDecodeTable [ src [ 0 ] ];
+			const qint32 b = kDecodeTable [ src [ 1 ] ];
+			const qint32 c = ( rest == 3 ) ? kDecodeTable [ src [ 2 ] ] : 0;
+			if ( ( a | b | c ) < 0 )
+				return -1;
+
+			const quint32 v = ( quint32 ( a ) << 18 ) | ( quint32 ( b ) << 12 ) | ( quint32 ( c ) << 6 );
+			*out++ = uchar ( v >> 16 );
+			if ( rest == 3 )
+				*out++ = uchar ( v >> 8 );
+		}
+
+		return out - start;
+	}
+
+#if defined(JCQT_SIMD_X86)
+	/*
+	*	Vectorized decoding after Wojciech Mula and Daniel Lemire, "Faster Base64 Encoding and Decoding Using AVX2 Instructions" (2018).
+	*	The high and low nibble of every character index two small tables whose AND is non-zero exactly for characters outside the
+	*	base64 alphabet; a third lookup yields the offset that maps the character to its 6-bit value. maddubs/madd then pack four 6-bit
+	*	values into three bytes per 32-bit lane. Blocks containing anything else (padding, whitespace, garbage) are left to the scalar code.
+	*/
+	JCQT_TARGET_SSSE3 static qsizetype decodeSSSE3 ( const uchar*& src, const uchar* end, uchar*& out, const uchar* outEnd )
+	{
+		const __m128i lutLo = _mm_setr_epi8 ( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+		const __m128i lutHi = _mm_setr_epi8 ( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+		const __m128i lutRoll = _mm_setr_epi8 ( 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 );
+		const __m128i mask2F = _mm_set1_epi8 ( 0x2F );
+		const __m128i mergeAB = _mm_set1_epi32 ( 0x01400140 );
+		const __m128i mergeABC = _mm_set1_epi32 ( 0x00011000 );
+		const __m128i pack = _mm_setr_epi8 ( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+
+		qsizetype blocks = 0;
+
+		// every block reads 16 characters and stores 16 bytes of which 12 are valid
+		while ( end - src >= 16 && outEnd - out >= 16 )
+		{
+			__m128i str = _mm_loadu_si128 ( reinterpret_cast< const __m128i* >( src ) );
+
+			const __m128i hiNibbles = _mm_and_si128 ( _mm_srli_epi32 ( str, 4 ), mask2F );
+			const __m128i loNibbles = _mm_and_si128 ( str, mask2F );
+			const __m128i hi = _mm_shuffle_epi8 ( lutHi, hiNibbles );
+			const __m128i lo = _mm_shuffle_epi8 ( lutLo, loNibbles );
+
+			if ( _mm_movemask_epi8 ( _mm_cmpgt_epi8 ( _mm_and_si128 ( lo, hi ), _mm_setzero_si128 () ) ) != 0 )
+				break;
+
+			const __m128i eq2F = _mm_cmpeq_epi8 ( str, mask2F );
+			const __m128i roll = _mm_shuffle_epi8 ( lutRoll, _mm_add_epi8 ( eq2F, hiNibbles ) );
+			str = _mm_add_epi8 ( str, roll );
+
+			str = _mm_maddubs_epi16 ( str, mergeAB );
+			str = _mm_madd_epi16 ( str, mergeABC );
+			str = _mm_shuffle_epi8 ( str, pack );
+
+			_mm_storeu_si128 ( reinterpret_cast< __m128i* >( out ), str );
+			src += 16;
+			out += 12;
+			blocks++;
+		}
+
+		return blocks;
+	}
+
+	JCQT_TARGET_AVX2 static qsizetype decodeAVX2 ( const uchar*& src, const uchar* end, uchar*& out, const uchar* outEnd )
+	{
+		const __m256i lutLo = _mm256_setr_epi8 (
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+		const __m256i lutHi = _mm256_setr_epi8 (
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+		const __m256i lutRoll = _mm256_setr_epi8 (
+			0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+			0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 );
+		const __m256i mask2F = _mm256_set1_epi8 ( 0x2F );
+		const __m256i mergeAB = _mm256_set1_epi32 ( 0x01400140 );
+		const __m256i mergeABC = _mm256_set1_epi32 ( 0x00011000 );
+		const __m256i pack = _mm256_setr_epi8 (
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+		// moves the 12 valid bytes of the upper lane next to those of the lower lane
+		const __m256i packLanes = _mm256_setr_epi32 ( 0, 1, 2, 4, 5, 6, -1, -1 );
+
+		qsizetype blocks = 0;
+
+		// every block reads 32 characters and stores 32 bytes of which 24 are valid
+		while ( end - src >= 32 && outEnd - out >= 32 )
+		{
+			__m256i str = _mm256_loadu_si256 ( reinterpret_cast< const __m256i* >( src ) );
+
+			const __m256i hiNibbles = _mm256_and_si256 ( _mm256_srli_epi32 ( str, 4 ), mask2F );
+			const __m256i loNibbles = _mm256_and_si256 ( str, mask2F );
+			const __m256i hi = _mm256_shuffle_epi8 ( lutHi, hiNibbles );
+			const __m256i lo = _mm256_shuffle_epi8 ( lutLo, loNibbles );
+
+			if ( !_mm256_testz_si256 ( lo, hi ) )
+				break;
+
+			const __m256i eq2F = _mm256_cmpeq_epi8 ( str, mask2F );
+			const __m256i roll = _mm256_shuffle_epi8 ( lutRoll, _mm256_add_epi8 ( eq2F, hiNibbles ) );
+			str = _mm256_add_epi8 ( str, roll );
+
+			str = _mm256_maddubs_epi16 ( str, mergeAB );
+			str = _mm256_madd_epi16 ( str, mergeABC );
+			str = _mm256_shuffle_epi8 ( str, pack );
+			str = _mm256_permutevar8x32_epi32 ( str, packLanes );
+
+			_mm256_storeu_si256 ( reinterpret_cast< __m256i* >( out ), str );
+			src += 32;
+			out += 24;
+			blocks++;
+		}
+
+		return blocks;
+	}
+#endif
+
+	qsizetype base64DecodeScalar ( QByteArrayView encoded, uchar* out )
+	{
+		if ( base64DecodedSize ( encoded ) < 0 )
+			return -1;
+
+		const uchar* src = reinterpret_cast< const uchar* >( encoded.data () );
+		const uchar* end = src + encoded.size () - paddingLength ( encoded );
+		return decodeScalarBody ( src, end, out );
+	}
+
+	qsizetype base64Decode ( QByteArrayView encoded, uchar* out )
+	{
+		const qsizetype decodedSize = base64DecodedSize ( encoded );
+		if ( decodedSize < 0 )
+			return -1;
+
+		const uchar* src = reinterpret_cast< const uchar* >( encoded.data () );
+		// the SIMD loops never see the padding, so a '=' inside a block always means malformed input
+		const uchar* end = src + encoded.size () - paddingLength ( encoded );
+		uchar* dst = out;
+
+#if defined(JCQT_SIMD_X86)
+		const simd::CpuFeatures& cpu = simd::cpuFeatures ();
+		if ( cpu.avx2_ )
+			decodeAVX2 ( src, end, dst, out + decodedSize );
+		if ( cpu.ssse3_ )
+			decodeSSSE3 ( src, end, dst, out + decodedSize );
+#endif
+
+		// whatever the vector loops left over (the tail, or a block they rejected) goes through the table decoder
+		const qsizetype tail = decodeScalarBody ( src, end, dst );
+		if ( tail < 0 )
+			return -1;
+
+		return ( dst - out ) + tail;
+	}
+}
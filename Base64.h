@@ -0,0 +1,59 @@
+/*****************************************************************//**
+ * \file   Base64.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  vectorized base64 decoding for data: URI buffers
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __BASE64_H__
+#define __BASE64_H__
+
+#include <QByteArrayView>
+
+namespace jcqt
+{
+	/**
+	 * base64DecodedSize
+	 * \brief number of bytes the standard (RFC 4648) base64 text decodes to, taking '=' padding into account.
+	 *
+	 * \param encoded
+	 * \return decoded size, or -1 if the length cannot be valid base64
+	 */
+	qsizetype base64DecodedSize ( QByteArrayView encoded );
+
+	/**
+	 * base64Decode
+	 * \brief decodes encoded straight into out using AVX2 or SSSE3 when the CPU has them and a scalar loop otherwise.
+	 *
+	 * \param encoded base64 text, no whitespace allowed
+	 * \param out destination with room for base64DecodedSize(encoded) bytes
+	 * \return number of bytes written, or -1 for malformed input
+	 */
+	qsizetype base64Decode ( QByteArrayView encoded, uchar* out );
+
+	// Reference implementation used for the tail of the input and on CPUs without SIMD support
+	qsizetype base64DecodeScalar ( QByteArrayView encoded, uchar* out );
+}
+
+#endif // !__BASE64_H__
@@ -0,0 +1,137 @@
+/*****************************************************************//**
+ * \file   ComponentArray.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  dense per-node component storage
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __COMPONENT_ARRAY_H__
+#define __COMPONENT_ARRAY_H__
+
+#include <QtGlobal>
+#include <QList>
+
+#include <algorithm>
+
+namespace jcqt
+{
+	/*
+	*	One qint32 component value per scene node, stored densely and indexed by the node itself (-1 = the node has no such component).
+	*	Replaces QHash<quint32, quint32> for components nearly every node has (meshes, materials, names): a lookup is a bounds check and
+	*	an array read, storage is 4 bytes per node, and the array is written to and read from a scene file as it is.
+	*
+	*	The array may be shorter than the scene: nodes past size() simply have no value, so addNode() does not need to touch it.
+	*/
+	class ComponentArray
+	{
+	public:
+		static constexpr qint32 kNone = -1;
+
+		ComponentArray () = default;
+		explicit ComponentArray ( qsizetype nodeCount ) : m_values ( nodeCount, kNone ) {}
+
+		// number of nodes covered, not the number of values
+		qsizetype size () const { return m_values.size (); }
+		// number of nodes that have a value, O(size)
+		qsizetype count () const { return std::count_if ( m_values.cbegin (), m_values.cend (), [] ( qint32 v ) { return v != kNone; } ); }
+		bool isEmpty () const { return count () == 0; }
+		// bytes held by the storage
+		qsizetype memoryUsage () const { return m_values.capacity () * qsizetype ( sizeof ( qint32 ) ); }
+
+		// new nodes get no value
+		void resize ( qsizetype nodeCount ) { m_values.resize ( nodeCount, kNone ); }
+		void reserve ( qsizetype nodeCount ) { m_values.reserve ( nodeCount ); }
+		void clear () { m_values.clear (); }
+
+		bool contains ( qint32 node ) const
+		{
+			return node >= 0 && node < m_values.size () && m_values [ node ] != kNone;
+		}
+
+		qint32 value ( qint32 node, qint32 defaultValue = kNone ) const
+		{
+			const qint32 v = ( node >= 0 && node < m_values.size () ) ? m_values [ node ] : kNone;
+			return ( v != kNone ) ? v : defaultValue;
+		}
+
+		void insert ( qint32 node, qint32 value )
+		{
+			Q_ASSERT ( node >= 0 && value != kNone );
+			if ( node >= m_values.size () )
+				m_values.resize ( node + 1, kNone );
+			m_values [ node ] = value;
+		}
+
+		void remove ( qint32 node )
+		{
+			if ( node >= 0 && node < m_values.size () )
+				m_values [ node ] = kNone;
+		}
+
+		// raw access for serialization, size() elements
+		const qint32* constData () const { return m_values.constData (); }
+		qint32* data () { return m_values.data (); }
+
+		// Copies the values of other to nodes nodeOffset.., adding valueOffset to each one (used when merging scenes)
+		void append ( const ComponentArray& other, qint32 nodeOffset, qint32 valueOffset )
+		{
+			m_values.resize ( nodeOffset, kNone );
+			m_values.reserve ( nodeOffset + other.size () );
+			for ( qint32 v : other.m_values )
+				m_values.append ( v != kNone ? v + valueOffset : kNone );
+		}
+
+		// Moves the value of node i to newIndices[i] (dropped if -1); the result covers nodeCount nodes
+		void remap ( const QList<qint32>& newIndices, qsizetype nodeCount )
+		{
+			QList<qint32> values ( nodeCount, kNone );
+			const qsizetype n = std::min ( m_values.size (), newIndices.size () );
+			for ( qsizetype i = 0; i < n; i++ )
+			{
+				if ( m_values [ i ] != kNone && newIndices [ i ] != -1 )
+					values [ newIndices [ i ] ] = m_values [ i ];
+			}
+			m_values = std::move ( values );
+		}
+
+		// Equal if every node has the same value; nodes past the end of the shorter array compare as kNone
+		friend bool operator== ( const ComponentArray& a, const ComponentArray& b )
+		{
+			const ComponentArray& shorter = a.size () <= b.size () ? a : b;
+			const ComponentArray& longer = a.size () <= b.size () ? b : a;
+			return std::equal ( shorter.m_values.cbegin (), shorter.m_values.cend (), longer.m_values.cbegin () ) &&
+				std::all_of ( longer.m_values.cbegin () + shorter.size (), longer.m_values.cend (), [] ( qint32 v ) { return v == kNone; } );
+		}
+
+		friend bool operator!= ( const ComponentArray& a, const ComponentArray& b )
+		{
+			return !( a == b );
+		}
+
+	private:
+		QList<qint32> m_values;
+	};
+}
+
+#endif // !__COMPONENT_ARRAY_H__
@@ -0,0 +1,706 @@
+/*****************************************************************//**
+ * \file   GLTFDocument.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "GLTFDocument.h"
+#include "JsonSaxParser.h"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <string_view>
+
+namespace jcqt
+{
+	namespace gltf
+	{
+		qint32 componentCount ( AccessorType type )
+		{
+			switch ( type )
+			{
+			case AccessorType::Scalar: return 1;
+			case AccessorType::Vec2: return 2;
+			case AccessorType::Vec3: return 3;
+			case AccessorType::Vec4: return 4;
+			case AccessorType::Mat2: return 4;
+			case AccessorType::Mat3: return 9;
+			case AccessorType::Mat4: return 16;
+			default: return 0;
+			}
+		}
+
+		qint32 componentSize ( quint32 componentType )
+		{
+			switch ( componentType )
+			{
+			case kByte:
+			case kUnsignedByte: return 1;
+			case kShort:
+			case kUnsignedShort: return 2;
+			case kUnsignedInt:
+			case kFloat: return 4;
+			default: return 0;
+			}
+		}
+
+		qint32 elementSize ( AccessorType type, quint32 componentType )
+		{
+			const qint32 size = componentSize ( componentType );
+			switch ( type )
+			{
+			// matrix columns start on 4-byte boundaries, e.g. a MAT3 of unsigned bytes takes 12 bytes rather than 9
+			case AccessorType::Mat2: return 2 * ( ( 2 * size + 3 ) & ~3 );
+			case AccessorType::Mat3: return 3 * ( ( 3 * size + 3 ) & ~3 );
+			case AccessorType::Mat4: return 4 * ( ( 4 * size + 3 ) & ~3 );
+			default: return componentCount ( type ) * size;
+			}
+		}
+
+		namespace
+		{
+			// Every property name the builder understands. Anything else (extensions, extras, cameras, ...) maps to Unknown and is skipped.
+			enum class Key : quint8
+			{
+				None, Element, Attribute, Unknown,
+				Accessors, AlphaCutoff, AlphaMode, Asset, Attributes, BaseColorFactor, BaseColorTexture, Buffer, BufferView, BufferViews, Buffers,
+				ByteLength, ByteOffset, ByteStride, Camera, Children, ComponentType, Count, DoubleSided, EmissiveFactor, EmissiveTexture, Images,
+				Index, Indices, Material, Materials, Matrix, Max, Mesh, Meshes, MetallicFactor, MetallicRoughnessTexture, MimeType, Min, Mode,
+				Name, Nodes, NormalTexture, Normalized, OcclusionTexture, PbrMetallicRoughness, Primitives, Rotation, RoughnessFactor, Sampler,
+				Scale, Scene, Scenes, Skin, Source, Strength, Target, TexCoord, Textures, Translation, Type, Uri, Version, Weights
+			};
+
+			struct KeyName
+			{
+				std::string_view name_;
+				Key key_;
+			};
+
+			// sorted by name for binary search
+			constexpr KeyName kKeyNames [] = {
+				{ "accessors", Key::Accessors },
+				{ "alphaCutoff", Key::AlphaCutoff },
+				{ "alphaMode", Key::AlphaMode },
+				{ "asset", Key::Asset },
+				{ "attributes", Key::Attributes },
+				{ "baseColorFactor", Key::BaseColorFactor },
+				{ "baseColorTexture", Key::BaseColorTexture },
+				{ "buffer", Key::Buffer },
+				{ "bufferView", Key::BufferView },
+				{ "bufferViews", Key::BufferViews },
+				{ "buffers", Key::Buffers },
+				{ "byteLength", Key::ByteLength },
+				{ "byteOffset", Key::ByteOffset },
+				{ "byteStride", Key::ByteStride },
+				{ "camera", Key::Camera },
+				{ "children", Key::Children },
+				{ "componentType", Key::ComponentType },
+				{ "count", Key::Count },
+				{ "doubleSided", Key::DoubleSided },
+				{ "emissiveFactor", Key::EmissiveFactor },
+				{ "emissiveTexture", Key::EmissiveTexture },
+				{ "images", Key::Images },
+				{ "index", Key::Index },
+				{ "indices", Key::Indices },
+				{ "material", Key::Material },
+				{ "materials", Key::Materials },
+				{ "matrix", Key::Matrix },
+				{ "max", Key::Max },
+				{ "mesh", Key::Mesh },
+				{ "meshes", Key::Meshes },
+				{ "metallicFactor", Key::MetallicFactor },
+				{ "metallicRoughnessTexture", Key::MetallicRoughnessTexture },
+				{ "mimeType", Key::MimeType },
+				{ "min", Key::Min },
+				{ "mode", Key::Mode },
+				{ "name", Key::Name },
+				{ "nodes", Key::Nodes },
+				{ "normalTexture", Key::NormalTexture },
+				{ "normalized", Key::Normalized },
+				{ "occlusionTexture", Key::OcclusionTexture },
+				{ "pbrMetallicRoughness", Key::PbrMetallicRoughness },
+				{ "primitives", Key::Primitives },
+				{ "rotation", Key::Rotation },
+				{ "roughnessFactor", Key::RoughnessFactor },
+				{ "sampler", Key::Sampler },
+				{ "scale", Key::Scale },
+				{ "scene", Key::Scene },
+				{ "scenes", Key::Scenes },
+				{ "skin", Key::Skin },
+				{ "source", Key::Source },
+				{ "strength", Key::Strength },
+				{ "target", Key::Target },
+				{ "texCoord", Key::TexCoord },
+				{ "textures", Key::Textures },
+				{ "translation", Key::Translation },
+				{ "type", Key::Type },
+				{ "uri", Key::Uri },
+				{ "version", Key::Version },
+				{ "weights", Key::Weights },
+			};
+
+			Key lookupKey ( QByteArrayView name )
+			{
+				const std::string_view s ( name.data (), size_t ( name.size () ) );
+				const KeyName* end = std::end ( kKeyNames );
+				const KeyName* it = std::lower_bound ( std::begin ( kKeyNames ), end, s, [] ( const KeyName& k, std::string_view v ) { return k.name_ < v; } );
+				return ( it != end && it->name_ == s ) ? it->key_ : Key::Unknown;
+			}
+
+			AccessorType lookupAccessorType ( QByteArrayView name )
+			{
+				const std::string_view s ( name.data (), size_t ( name.size () ) );
+				if ( s == "SCALAR" ) return AccessorType::Scalar;
+				if ( s == "VEC2" ) return AccessorType::Vec2;
+				if ( s == "VEC3" ) return AccessorType::Vec3;
+				if ( s == "VEC4" ) return AccessorType::Vec4;
+				if ( s == "MAT2" ) return AccessorType::Mat2;
+				if ( s == "MAT3" ) return AccessorType::Mat3;
+				if ( s == "MAT4" ) return AccessorType::Mat4;
+				return AccessorType::Unknown;
+			}
+
+			AlphaMode lookupAlphaMode ( QByteArrayView name )
+			{
+				const std::string_view s ( name.data (), size_t ( name.size () ) );
+				if ( s == "MASK" ) return AlphaMode::Mask;
+				if ( s == "BLEND" ) return AlphaMode::Blend;
+				return AlphaMode::Opaque;
+			}
+
+			// A scalar JSON value as delivered by the SAX parser
+			struct Value
+			{
+				double number_ = 0.0;
+				QByteArrayView string_;
+				bool boolean_ = false;
+				bool isNumber_ = false;
+				bool isString_ = false;
+
+				// numbers outside the target type are invalid (-1), converting them would be undefined
+				qint32 toInt () const { return isNumber_ && number_ > -2147483649.0 && number_ < 2147483648.0 ? qint32 ( number_ ) : -1; }
+				qint64 toInt64 () const
+				{
+					if ( !isNumber_ )
+						return 0;
+					return number_ >= -9223372036854775808.0 && number_ < 9223372036854775808.0 ? qint64 ( number_ ) : -1;
+				}
+				float toFloat () const { return float ( number_ ); }
+				QString toString () const { return QString::fromUtf8 ( string_.data (), string_.size () ); }
+			};
+
+			class DocumentBuilder : public JsonSaxHandler
+			{
+			public:
+				DocumentBuilder ( Document& doc, QByteArrayView json, const ParseProgress& progress ) : m_doc ( doc ), m_json ( json ), m_progress ( progress ) {}
+
+				bool startObject () override { return startContainer ( false ); }
+				bool startArray () override { return startContainer ( true ); }
+				bool endObject () override { return endContainer (); }
+				bool endArray () override { return endContainer (); }
+
+				bool key ( QByteArrayView name ) override
+				{
+					if ( m_skipDepth >= 0 )
+						return true;
+
+					// Attribute semantics (POSITION, TEXCOORD_0, ...) are the keys of meshes[].primitives[].attributes
+					if ( m_stack.size () == 6 && m_stack.last ().slot_ == Key::Attributes )
+					{
+						m_pendingKey = Key::Attribute;
+						m_attributeName = QString::fromUtf8 ( name.data (), name.size () );
+						return true;
+					}
+
+					m_pendingKey = lookupKey ( name );
+					return true;
+				}
+
+				bool string ( QByteArrayView value ) override
+				{
+					Value v;
+					v.string_ = value;
+					v.isString_ = true;
+					return scalar ( v );
+				}
+
+				bool number ( double value ) override
+				{
+					Value v;
+					v.number_ = value;
+					v.isNumber_ = true;
+					return scalar ( v );
+				}
+
+				bool boolean ( bool value ) override
+				{
+					Value v;
+					v.boolean_ = value;
+					return scalar ( v );
+				}
+
+				bool null () override
+				{
+					return scalar ( Value () );
+				}
+
+				bool progress ( qsizetype offset ) override
+				{
+					return !m_progress || m_progress ( offset );
+				}
+
+			private:
+				// Paths deeper than this never carry data the builder is interested in
+				static constexpr qint32 kMaxPath = 8;
+
+				struct Frame
+				{
+					// key under which this container sits in its parent (Element for array items)
+					Key slot_;
+					bool isArray_;
+					// number of items seen so far when this is an array
+					qint32 count_;
+				};
+
+				// key of the next value in the innermost container, consuming the array index if that container is an array
+				Key nextSlot ( qint32& index )
+				{
+					index = -1;
+					if ( m_stack.isEmpty () )
+						return Key::None;
+
+					Frame& top = m_stack.last ();
+					if ( top.isArray_ )
+					{
+						index = top.count_++;
+						return Key::Element;
+					}
+					return m_pendingKey;
+				}
+
+				// path from the root object to the value in slot, e.g. nodes[3].translation[1] -> { Nodes, Element, Translation, Element }
+				qint32 buildPath ( Key slot, Key* path ) const
+				{
+					const qint32 n = qint32 ( m_stack.size () );
+					if ( n > kMaxPath )
+						return -1;
+					for ( qint32 i = 1; i < n; i++ )
+						path [ i - 1 ] = m_stack [ i ].slot_;
+					path [ n - 1 ] = slot;
+					return n;
+				}
+
+				bool startContainer ( bool isArray )
+				{
+					qint32 index = -1;
+					const Key slot = nextSlot ( index );
+
+					if ( m_skipDepth < 0 )
+					{
+						if ( slot == Key::Unknown )
+						{
+							m_skipDepth = qint32 ( m_stack.size () );
+						}
+						else if ( !isArray )
+						{
+							Key path [ kMaxPath ];
+							const qint32 n = buildPath ( slot, path );
+							if ( n > 0 )
+								objectStarted ( path, n );
+						}
+					}
+
+					m_stack.append ( Frame { slot, isArray, 0 } );
+					return true;
+				}
+
+				bool endContainer ()
+				{
+					m_stack.removeLast ();
+					if ( m_skipDepth == qint32 ( m_stack.size () ) )
+						m_skipDepth = -1;
+					return true;
+				}
+
+				// New items of the top-level arrays are appended as soon as their object starts; every value below then fills last()
+				void objectStarted ( const Key* path, qint32 n )
+				{
+					if ( n == 2 && path [ 1 ] == Key::Element )
+					{
+						switch ( path [ 0 ] )
+						{
+						case Key::Scenes: m_doc.scenes_.append ( Scene () ); break;
+						case Key::Nodes: m_doc.nodes_.append ( Node () ); break;
+						case Key::Meshes: m_doc.meshes_.append ( Mesh () ); break;
+						case Key::Accessors: m_doc.accessors_.append ( Accessor () ); break;
+						case Key::BufferViews: m_doc.bufferViews_.append ( BufferView () ); break;
+						case Key::Buffers: m_doc.buffers_.append ( Buffer () ); break;
+						case Key::Materials: m_doc.materials_.append ( Material () ); break;
+						case Key::Images: m_doc.images_.append ( Image () ); break;
+						case Key::Textures: m_doc.textures_.append ( Texture () ); break;
+						default: break;
+						}
+					}
+					else if ( n == 4 && path [ 0 ] == Key::Meshes && path [ 2 ] == Key::Primitives && path [ 3 ] == Key::Element && !m_doc.meshes_.isEmpty () )
+					{
+						m_doc.meshes_.last ().primitives_.append ( Primitive () );
+					}
+				}
+
+				bool scalar ( const Value& v )
+				{
+					qint32 index = -1;
+					const Key slot = nextSlot ( index );
+					if ( m_skipDepth >= 0 || slot == Key::Unknown )
+						return true;
+
+					Key path [ kMaxPath ];
+					const qint32 n = buildPath ( slot, path );
+					if ( n < 1 )
+						return true;
+
+					// data: URIs can be hundreds of megabytes, keep them as views instead of converting them to QString
+					if ( n == 3 && path [ 2 ] == Key::Uri && v.isString_ )
+					{
+						if ( path [ 0 ] == Key::Buffers && !m_doc.buffers_.isEmpty () )
+							setUri ( m_doc.buffers_.last (), v.string_ );
+						else if ( path [ 0 ] == Key::Images && !m_doc.images_.isEmpty () )
+							setUri ( m_doc.images_.last (), v.string_ );
+						return true;
+					}
+
+					switch ( path [ 0 ] )
+					{
+					case Key::Scene:
+						if ( n == 1 )
+							m_doc.scene_ = v.toInt ();
+						break;
+					case Key::Asset:
+						if ( n == 2 && path [ 1 ] == Key::Version )
+							m_doc.version_ = v.toString ();
+						break;
+					case Key::Scenes:
+						if ( n >= 3 && !m_doc.scenes_.isEmpty () )
+							sceneValue ( m_doc.scenes_.last (), path, n, index, v );
+						break;
+					case Key::Nodes:
+						if ( n >= 3 && !m_doc.nodes_.isEmpty () )
+							nodeValue ( m_doc.nodes_.last (), path, n, index, v );
+						break;
+					case Key::Meshes:
+						if ( n >= 3 && !m_doc.meshes_.isEmpty () )
+							meshValue ( m_doc.meshes_.last (), path, n, index, v );
+						break;
+					case Key::Accessors:
+						if ( n >= 3 && !m_doc.accessors_.isEmpty () )
+							accessorValue ( m_doc.accessors_.last (), path, n, v );
+						break;
+					case Key::BufferViews:
+						if ( n == 3 && !m_doc.bufferViews_.isEmpty () )
+							bufferViewValue ( m_doc.bufferViews_.last (), path [ 2 ], v );
+						break;
+					case Key::Buffers:
+						if ( n == 3 && !m_doc.buffers_.isEmpty () )
+							bufferValue ( m_doc.buffers_.last (), path [ 2 ], v );
+						break;
+					case Key::Materials:
+						if ( n >= 3 && !m_doc.materials_.isEmpty () )
+							materialValue ( m_doc.materials_.last (), path, n, index, v );
+						break;
+					case Key::Images:
+						if ( n == 3 && !m_doc.images_.isEmpty () )
+							imageValue ( m_doc.images_.last (), path [ 2 ], v );
+						break;
+					case Key::Textures:
+						if ( n == 3 && !m_doc.textures_.isEmpty () )
+							textureValue ( m_doc.textures_.last (), path [ 2 ], v );
+						break;
+					default:
+						break;
+					}
+
+					return true;
+				}
+
+				void setUri ( UriReference& ref, QByteArrayView value ) const
+				{
+					const std::string_view s ( value.data (), size_t ( value.size () ) );
+					const size_t comma = s.find ( ',' );
+
+					if ( s.substr ( 0, 5 ) != "data:" || comma == std::string_view::npos )
+					{
+						ref.uri_ = QString::fromUtf8 ( value.data (), value.size () );
+						return;
+					}
+
+					ref.uri_ = QString::fromUtf8 ( value.data (), qsizetype ( comma + 1 ) );
+
+					// unescaped strings are handed out as views into the source text, anything else lives in the parser's scratch buffer
+					const QByteArrayView payload = value.sliced ( qsizetype ( comma + 1 ) );
+					if ( payload.data () >= m_json.data () && payload.data () + payload.size () <= m_json.data () + m_json.size () )
+						ref.dataView_ = payload;
+					else
+						ref.dataStorage_ = payload.toByteArray ();
+				}
+
+				static void sceneValue ( Scene& scene, const Key* path, qint32 n, qint32 index, const Value& v )
+				{
+					if ( n == 3 && path [ 2 ] == Key::Name )
+						scene.name_ = v.toString ();
+					else if ( n == 4 && path [ 2 ] == Key::Nodes && index >= 0 )
+						scene.nodes_.append ( v.toInt () );
+				}
+
+				static void nodeValue ( Node& node, const Key* path, qint32 n, qint32 index, const Value& v )
+				{
+					if ( n == 3 )
+					{
+						switch ( path [ 2 ] )
+						{
+						case Key::Mesh: node.mesh_ = v.toInt (); break;
+						case Key::Camera: node.camera_ = v.toInt (); break;
+						case Key::Skin: node.skin_ = v.toInt (); break;
+						case Key::Name: node.name_ = v.toString (); break;
+						default: break;
+						}
+						return;
+					}
+
+					if ( n != 4 || index < 0 )
+						return;
+
+					switch ( path [ 2 ] )
+					{
+					case Key::Children: node.children_.append ( v.toInt () ); break;
+					case Key::Matrix:
+						if ( index < 16 )
+						{
+							node.matrix_ [ index ] = v.toFloat ();
+							node.hasMatrix_ = true;
+						}
+						break;
+					case Key::Translation: if ( index < 3 ) node.translation_ [ index ] = v.toFloat (); break;
+					case Key::Rotation: if ( index < 4 ) node.rotation_ [ index ] = v.toFloat (); break;
+					case Key::Scale: if ( index < 3 ) node.scale_ [ index ] = v.toFloat (); break;
+					case Key::Weights: node.weights_.append ( v.toFloat () ); break;
+					default: break;
+					}
+				}
+
+				void meshValue ( Mesh& mesh, const Key* path, qint32 n, qint32 index, const Value& v )
+				{
+					if ( n == 3 && path [ 2 ] == Key::Name )
+					{
+						mesh.name_ = v.toString ();
+						return;
+					}
+
+					if ( n == 4 && path [ 2 ] == Key::Weights && index >= 0 )
+					{
+						mesh.weights_.append ( v.toFloat () );
+						return;
+					}
+
+					// meshes[i].primitives[j].*
+					if ( n < 5 || path [ 2 ] != Key::Primitives || mesh.primitives_.isEmpty () )
+						return;
+
+					Primitive& primitive = mesh.primitives_.last ();
+					if ( n == 5 )
+					{
+						switch ( path [ 4 ] )
+						{
+						case Key::Indices: primitive.indices_ = v.toInt (); break;
+						case Key::Material: primitive.material_ = v.toInt (); break;
+						case Key::Mode: primitive.mode_ = v.toInt (); break;
+						default: break;
+						}
+					}
+					else if ( n == 6 && path [ 4 ] == Key::Attributes && path [ 5 ] == Key::Attribute )
+					{
+						primitive.attributes_.append ( Attribute { m_attributeName, v.toInt () } );
+					}
+				}
+
+				static void accessorValue ( Accessor& accessor, const Key* path, qint32 n, const Value& v )
+				{
+					if ( n == 4 )
+					{
+						if ( path [ 2 ] == Key::Min )
+							accessor.min_.append ( v.number_ );
+						else if ( path [ 2 ] == Key::Max )
+							accessor.max_.append ( v.number_ );
+						return;
+					}
+
+					if ( n != 3 )
+						return;
+
+					switch ( path [ 2 ] )
+					{
+					case Key::BufferView: accessor.bufferView_ = v.toInt (); break;
+					case Key::ByteOffset: accessor.byteOffset_ = v.toInt64 (); break;
+					case Key::ComponentType: accessor.componentType_ = quint32 ( v.toInt () ); break;
+					case Key::Normalized: accessor.normalized_ = v.boolean_; break;
+					case Key::Count: accessor.count_ = v.toInt64 (); break;
+					case Key::Type: accessor.type_ = lookupAccessorType ( v.string_ ); break;
+					case Key::Name: accessor.name_ = v.toString (); break;
+					default: break;
+					}
+				}
+
+				static void bufferViewValue ( BufferView& view, Key key, const Value& v )
+				{
+					switch ( key )
+					{
+					case Key::Buffer: view.buffer_ = v.toInt (); break;
+					case Key::ByteOffset: view.byteOffset_ = v.toInt64 (); break;
+					case Key::ByteLength: view.byteLength_ = v.toInt64 (); break;
+					case Key::ByteStride: view.byteStride_ = v.toInt (); break;
+					case Key::Target: view.target_ = v.toInt (); break;
+					case Key::Name: view.name_ = v.toString (); break;
+					default: break;
+					}
+				}
+
+				static void bufferValue ( Buffer& buffer, Key key, const Value& v )
+				{
+					switch ( key )
+					{
+					case Key::ByteLength: buffer.byteLength_ = v.toInt64 (); break;
+					case Key::Name: buffer.name_ = v.toString (); break;
+					default: break;
+					}
+				}
+
+				static void textureInfoValue ( TextureInfo& info, Key key, const Value& v )
+				{
+					switch ( key )
+					{
+					case Key::Index: info.index_ = v.toInt (); break;
+					case Key::TexCoord: info.texCoord_ = v.toInt (); break;
+					case Key::Scale:
+					case Key::Strength: info.scale_ = v.toFloat (); break;
+					default: break;
+					}
+				}
+
+				static void materialValue ( Material& material, const Key* path, qint32 n, qint32 index, const Value& v )
+				{
+					if ( n == 3 )
+					{
+						switch ( path [ 2 ] )
+						{
+						case Key::Name: material.name_ = v.toString (); break;
+						case Key::AlphaMode: material.alphaMode_ = lookupAlphaMode ( v.string_ ); break;
+						case Key::AlphaCutoff: material.alphaCutoff_ = v.toFloat (); break;
+						case Key::DoubleSided: material.doubleSided_ = v.boolean_; break;
+						default: break;
+						}
+						return;
+					}
+
+					if ( n == 4 )
+					{
+						switch ( path [ 2 ] )
+						{
+						case Key::EmissiveFactor: if ( index >= 0 && index < 3 ) material.emissiveFactor_ [ index ] = v.toFloat (); break;
+						case Key::NormalTexture: textureInfoValue ( material.normalTexture_, path [ 3 ], v ); break;
+						case Key::OcclusionTexture: textureInfoValue ( material.occlusionTexture_, path [ 3 ], v ); break;
+						case Key::EmissiveTexture: textureInfoValue ( material.emissiveTexture_, path [ 3 ], v ); break;
+						case Key::PbrMetallicRoughness:
+							if ( path [ 3 ] == Key::MetallicFactor )
+								material.metallicFactor_ = v.toFloat ();
+							else if ( path [ 3 ] == Key::RoughnessFactor )
+								material.roughnessFactor_ = v.toFloat ();
+							break;
+						default: break;
+						}
+						return;
+					}
+
+					if ( n == 5 && path [ 2 ] == Key::PbrMetallicRoughness )
+					{
+						switch ( path [ 3 ] )
+						{
+						case Key::BaseColorFactor: if ( index >= 0 && index < 4 ) material.baseColorFactor_ [ index ] = v.toFloat (); break;
+						case Key::BaseColorTexture: textureInfoValue ( material.baseColorTexture_, path [ 4 ], v ); break;
+						case Key::MetallicRoughnessTexture: textureInfoValue ( material.metallicRoughnessTexture_, path [ 4 ], v ); break;
+						default: break;
+						}
+					}
+				}
+
+				static void imageValue ( Image& image, Key key, const Value& v )
+				{
+					switch ( key )
+					{
+					case Key::MimeType: image.mimeType_ = v.toString (); break;
+					case Key::BufferView: image.bufferView_ = v.toInt (); break;
+					case Key::Name: image.name_ = v.toString (); break;
+					default: break;
+					}
+				}
+
+				static void textureValue ( Texture& texture, Key key, const Value& v )
+				{
+					switch ( key )
+					{
+					case Key::Sampler: texture.sampler_ = v.toInt (); break;
+					case Key::Source: texture.source_ = v.toInt (); break;
+					case Key::Name: texture.name_ = v.toString (); break;
+					default: break;
+					}
+				}
+
+				Document& m_doc;
+				QByteArrayView m_json;
+				const ParseProgress& m_progress;
+				QVarLengthArray<Frame, 16> m_stack;
+				Key m_pendingKey = Key::None;
+				QString m_attributeName;
+				// stack size at which an unknown subtree (extensions, extras, ...) started, or -1
+				qint32 m_skipDepth = -1;
+			};
+		}
+
+		bool parseDocument ( QByteArrayView json, Document& doc, QString* errorString, const ParseProgress& progress )
+		{
+			doc = Document ();
+
+			DocumentBuilder builder ( doc, json, progress );
+			JsonSaxParser parser;
+			if ( !parser.parse ( json, builder ) )
+			{
+				if ( errorString )
+					*errorString = parser.errorString () + QStringLiteral ( " at offset " ) + QString::number ( parser.errorOffset () );
+				return false;
+			}
+
+			return true;
+		}
+	}
+}
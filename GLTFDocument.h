@@ -0,0 +1,250 @@
+/*****************************************************************//**
+ * \file   GLTFDocument.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  typed glTF 2.0 document filled straight from the JSON byte stream
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __GLTF_DOCUMENT_H__
+#define __GLTF_DOCUMENT_H__
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QString>
+
+#include <functional>
+
+namespace jcqt
+{
+	namespace gltf
+	{
+		// accessor.componentType values
+		enum ComponentType : quint32
+		{
+			kByte = 5120,
+			kUnsignedByte = 5121,
+			kShort = 5122,
+			kUnsignedShort = 5123,
+			kUnsignedInt = 5125,
+			kFloat = 5126
+		};
+
+		// accessor.type values
+		enum class AccessorType : quint8
+		{
+			Unknown,
+			Scalar,
+			Vec2,
+			Vec3,
+			Vec4,
+			Mat2,
+			Mat3,
+			Mat4
+		};
+
+		enum class AlphaMode : quint8
+		{
+			Opaque,
+			Mask,
+			Blend
+		};
+
+		/*
+		*	The uri property of buffers and images. For data: URIs uri_ only keeps the header up to and including the comma, the encoded payload is
+		*	referenced in place: it points into the JSON text given to parseDocument() unless the string held escape sequences and had to be copied.
+		*/
+		struct UriReference
+		{
+			QString uri_;
+			QByteArrayView dataView_;
+			QByteArray dataStorage_;
+
+			bool isDataUri () const { return uri_.startsWith ( QStringLiteral ( "data:" ) ); }
+			QByteArrayView dataPayload () const { return dataStorage_.isEmpty () ? dataView_ : QByteArrayView ( dataStorage_ ); }
+		};
+
+		struct Buffer : UriReference
+		{
+			qint64 byteLength_ = 0;
+			QString name_;
+		};
+
+		struct BufferView
+		{
+			qint32 buffer_ = -1;
+			qint64 byteOffset_ = 0;
+			qint64 byteLength_ = 0;
+			// 0 means tightly packed
+			qint32 byteStride_ = 0;
+			qint32 target_ = 0;
+			QString name_;
+		};
+
+		struct Accessor
+		{
+			qint32 bufferView_ = -1;
+			qint64 byteOffset_ = 0;
+			quint32 componentType_ = 0;
+			bool normalized_ = false;
+			qint64 count_ = 0;
+			AccessorType type_ = AccessorType::Unknown;
+			QList<double> min_;
+			QList<double> max_;
+			QString name_;
+		};
+
+		struct Attribute
+		{
+			QString name_;
+			qint32 accessor_ = -1;
+		};
+
+		struct Primitive
+		{
+			QList<Attribute> attributes_;
+			qint32 indices_ = -1;
+			qint32 material_ = -1;
+			// TRIANGLES
+			qint32 mode_ = 4;
+
+			// accessor index for a named attribute (e.g. "POSITION") or -1
+			qint32 attribute ( const QString& name ) const
+			{
+				for ( const Attribute& a : attributes_ )
+				{
+					if ( a.name_ == name )
+						return a.accessor_;
+				}
+				return -1;
+			}
+		};
+
+		struct Mesh
+		{
+			QList<Primitive> primitives_;
+			QList<float> weights_;
+			QString name_;
+		};
+
+		struct Node
+		{
+			QList<qint32> children_;
+			qint32 mesh_ = -1;
+			qint32 camera_ = -1;
+			qint32 skin_ = -1;
+
+			// a node either has a column major matrix or a TRS decomposition
+			bool hasMatrix_ = false;
+			float matrix_ [ 16 ] = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+			float translation_ [ 3 ] = { 0.f, 0.f, 0.f };
+			// quaternion (x, y, z, w)
+			float rotation_ [ 4 ] = { 0.f, 0.f, 0.f, 1.f };
+			float scale_ [ 3 ] = { 1.f, 1.f, 1.f };
+
+			QList<float> weights_;
+			QString name_;
+		};
+
+		struct TextureInfo
+		{
+			qint32 index_ = -1;
+			qint32 texCoord_ = 0;
+			// normalTexture.scale or occlusionTexture.strength
+			float scale_ = 1.f;
+		};
+
+		struct Material
+		{
+			float baseColorFactor_ [ 4 ] = { 1.f, 1.f, 1.f, 1.f };
+			TextureInfo baseColorTexture_;
+			float metallicFactor_ = 1.f;
+			float roughnessFactor_ = 1.f;
+			TextureInfo metallicRoughnessTexture_;
+			TextureInfo normalTexture_;
+			TextureInfo occlusionTexture_;
+			TextureInfo emissiveTexture_;
+			float emissiveFactor_ [ 3 ] = { 0.f, 0.f, 0.f };
+			AlphaMode alphaMode_ = AlphaMode::Opaque;
+			float alphaCutoff_ = 0.5f;
+			bool doubleSided_ = false;
+			QString name_;
+		};
+
+		struct Image : UriReference
+		{
+			QString mimeType_;
+			qint32 bufferView_ = -1;
+			QString name_;
+		};
+
+		struct Texture
+		{
+			qint32 sampler_ = -1;
+			qint32 source_ = -1;
+			QString name_;
+		};
+
+		struct Scene
+		{
+			QList<qint32> nodes_;
+			QString name_;
+		};
+
+		struct Document
+		{
+			QString version_;
+			qint32 scene_ = -1;
+
+			QList<Scene> scenes_;
+			QList<Node> nodes_;
+			QList<Mesh> meshes_;
+			QList<Accessor> accessors_;
+			QList<BufferView> bufferViews_;
+			QList<Buffer> buffers_;
+			QList<Material> materials_;
+			QList<Image> images_;
+			QList<Texture> textures_;
+		};
+
+		// number of components of an accessor type (1 for SCALAR ... 16 for MAT4), 0 for Unknown
+		qint32 componentCount ( AccessorType type );
+		// size in bytes of a single component, 0 for an invalid componentType
+		qint32 componentSize ( quint32 componentType );
+		// size in bytes of one accessor element including the 4-byte column padding of byte and short matrices, 0 if either argument is invalid
+		qint32 elementSize ( AccessorType type, quint32 componentType );
+
+		// Receives the number of bytes parsed so far about every megabyte; returning false aborts the parse
+		using ParseProgress = std::function<bool ( qsizetype bytesParsed )>;
+
+		/*
+		*	Fills doc from the UTF-8 encoded glTF JSON in json using JsonSaxParser, without building an intermediate QJsonDocument.
+		*	Unknown properties, extensions and extras are skipped. On failure errorString (if given) receives the reason and the byte offset.
+		*	Data URI payloads keep referring to json, which therefore has to outlive doc.
+		*/
+		bool parseDocument ( QByteArrayView json, Document& doc, QString* errorString = nullptr, const ParseProgress& progress = {} );
+	}
+}
+
+#endif // !__GLTF_DOCUMENT_H__
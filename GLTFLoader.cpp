@@ -1,110 +1,1167 @@
 #include "GLTFLoader.h"
+#include "Base64.h"
+#include "AccessorConvert.h"
+#include "Trace.h"
+#include "GLTFSceneBuilder.h"
 
+#include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QUrl>
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace
+{
+	// GLB container layout, see https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#binary-gltf-layout
+	constexpr quint32 kGLBMagic = 0x46546C67;		// "glTF"
+	constexpr quint32 kGLBVersion = 2;
+	constexpr quint32 kGLBChunkJSON = 0x4E4F534A;	// "JSON"
+	constexpr quint32 kGLBChunkBIN = 0x004E4942;	// "BIN\0"
+	constexpr qsizetype kGLBHeaderSize = 12;
+	constexpr qsizetype kGLBChunkHeaderSize = 8;
+
+	inline quint32 readU32 ( QByteArrayView bytes, qsizetype offset )
+	{
+		return qFromLittleEndian<quint32> ( bytes.data () + offset );
+	}
+}
 
 GLTFLoader::GLTFLoader(QObject *parent)
 	: QObject(parent)
 {}
 
 GLTFLoader::~GLTFLoader()
-{}
+{
+	// abandon a load that is still running, clear() waits for its tasks to wind down
+	cancel ();
+	clear ();
+}
+
+void GLTFLoader::clear ()
+{
+	// resource tasks still reference the document and the storage below
+	waitForFinished ();
+	m_loadId++;
+
+	m_canceled = false;
+	m_resourceFailed = false;
+	m_outstanding = 0;
+	m_bytesParsed = 0;
+	m_buffersLoaded = 0;
+	m_imagesDecoded = 0;
+	m_errorString.clear ();
+
+	m_gltf = jcqt::gltf::Document ();
+	m_json = QByteArrayView ();
+	m_document = QJsonDocument ();
+	m_documentParsed = false;
+	m_buffers.clear ();
+	m_bufferStorage.clear ();
+	m_bufferStatus.reset ();
+	m_images.clear ();
+	m_imageStatus.reset ();
+	m_imagesForBuffer.clear ();
+	m_externalFiles.clear ();
+	m_binChunk = QByteArrayView ();
+	m_fileView = QByteArrayView ();
+	m_fileData.clear ();
+	m_cacheEntry.reset ();
+	m_cachedAccessors.clear ();
+	m_cachedAccessorData = QByteArrayView ();
+	m_cacheKey = 0;
+	m_fromCache = false;
+
+	if ( m_mappedData )
+	{
+		m_file.unmap ( m_mappedData );
+		m_mappedData = nullptr;
+	}
+
+	if ( m_file.isOpen () )
+	{
+		m_file.close ();
+	}
+}
 
 bool GLTFLoader::loadGLTF ( const QString& filename )
 {
-	// check the extension is gltf first
+	JCQT_TRACE_SPAN ( span, "GLTFLoader::loadGLTF" );
+	clear ();
+	m_outstanding = 1;
+
+	if ( !openFile ( filename ) )
+	{
+		setError ( QStringLiteral ( "Failed to open or parse %1" ).arg ( filename ) );
+		completeResource ();
+		return false;
+	}
+
+	if ( !m_fromCache )
+		startResources ( filename );
+	completeResource ();
+	const bool ok = waitForFinished ();
+	JCQT_TRACE_COUNTS ( span, m_fileView.size (), m_gltf.buffers_.size () );
+	return ok;
+}
+
+bool GLTFLoader::loadGLTFAsync ( const QString& filename )
+{
+	if ( !hasGLTFExtension ( filename ) )
+	{
+		qWarning () << "Filename must use 'gltf' or 'glb' extension" << Qt::endl;
+		return false;
+	}
+
+	clear ();
+	m_outstanding = 1;
+
+	// mapping and parsing run on the pool as well, the resource tasks are submitted from there as soon as the JSON is parsed
+	submitTask ( [this, filename] () {
+		JCQT_TRACE_SPAN ( span, "GLTFLoader::openFile" );
+		if ( !m_canceled && openFile ( filename ) )
+		{
+			if ( !m_fromCache )
+				startResources ( filename );
+		}
+		else
+		{
+			setError ( QStringLiteral ( "Failed to open or parse %1" ).arg ( filename ) );
+		}
+		completeResource ();
+	} );
+
+	return true;
+}
+
+void GLTFLoader::cancel ()
+{
+	m_canceled = true;
+}
+
+bool GLTFLoader::isLoading () const
+{
+	return m_activeTasks.load () > 0;
+}
+
+bool GLTFLoader::waitForFinished ()
+{
+	if ( m_activeTasks.load () > 0 )
+	{
+		JCQT_TRACE_SPAN ( span, "GLTFLoader::waitForFinished" );
+		// the calling thread helps with the queued work instead of idling
+		jcqt::WorkStealingPool::globalInstance ().waitUntil ( [this] () { return m_activeTasks.load () == 0; } );
+	}
+
+	return !m_resourceFailed && !m_canceled;
+}
+
+QString GLTFLoader::errorString () const
+{
+	QMutexLocker locker ( &m_errorMutex );
+	return m_errorString;
+}
+
+bool GLTFLoader::hasGLTFExtension ( const QString& filename )
+{
+	const QString ext = QFileInfo ( filename ).suffix ();
+	return ext.compare ( "gltf", Qt::CaseInsensitive ) == 0 || ext.compare ( "glb", Qt::CaseInsensitive ) == 0;
+}
+
+bool GLTFLoader::openFile ( const QString& filename )
+{
+	// check the extension is gltf or glb first
 	QFileInfo fi ( filename );
 	QString ext = fi.suffix ();
-	if ( ext.compare ( "gltf" ) != 0 )
+	if ( ext.compare ( "glb", Qt::CaseInsensitive ) == 0 )
+	{
+		return openGLB ( filename );
+	}
+
+	if ( ext.compare ( "gltf", Qt::CaseInsensitive ) != 0 )
+	{
+		qWarning () << "Filename must use 'gltf' or 'glb' extension" << Qt::endl;
+		return false;
+	}
+
+	if ( !mapFile ( filename ) )
+	{
+		return false;
+	}
+
+	if ( openCacheEntry ( filename, m_fileView ) )
+	{
+		return true;
+	}
+
+	return parseJson ( m_fileView, filename );
+}
+
+bool GLTFLoader::loadGLB ( const QString& filename )
+{
+	JCQT_TRACE_SPAN ( span, "GLTFLoader::loadGLB" );
+	clear ();
+	m_outstanding = 1;
+
+	if ( !openGLB ( filename ) )
+	{
+		setError ( QStringLiteral ( "Failed to open or parse %1" ).arg ( filename ) );
+		completeResource ();
+		return false;
+	}
+
+	if ( !m_fromCache )
+		startResources ( filename );
+	completeResource ();
+	const bool ok = waitForFinished ();
+	JCQT_TRACE_COUNTS ( span, m_fileView.size (), m_gltf.buffers_.size () );
+	return ok;
+}
+
+bool GLTFLoader::openGLB ( const QString& filename )
+{
+	if ( !mapFile ( filename ) )
+	{
+		return false;
+	}
+
+	const QByteArrayView bytes = m_fileView;
+
+	// 12-byte header: magic, version, total length
+	if ( bytes.size () < kGLBHeaderSize + kGLBChunkHeaderSize )
+	{
+		qWarning () << "File " << filename << " is too small to be a GLB container" << Qt::endl;
+		return false;
+	}
+
+	if ( readU32 ( bytes, 0 ) != kGLBMagic )
+	{
+		qWarning () << "File " << filename << " has an invalid GLB magic number" << Qt::endl;
+		return false;
+	}
+
+	const quint32 version = readU32 ( bytes, 4 );
+	if ( version != kGLBVersion )
 	{
-		qWarning () << "Filename must use 'gltf' extension" << Qt::endl;
+		qWarning () << "Unsupported GLB container version " << version << " in " << filename << Qt::endl;
 		return false;
 	}
 
-	QFile loadFile ( filename );
+	const quint32 length = readU32 ( bytes, 8 );
+	if ( qsizetype ( length ) > bytes.size () )
+	{
+		qWarning () << "GLB header of " << filename << " declares " << length << " bytes but the file has only " << bytes.size () << Qt::endl;
+		return false;
+	}
 
-	if ( !loadFile.open ( QIODevice::ReadOnly ) )
+	/*
+	*	Walk the chunk table. The first chunk must be JSON, an optional BIN chunk may follow and any other chunk types must be ignored.
+	*	Chunks start on 4-byte boundaries and may not run past the length declared in the header.
+	*/
+	QByteArrayView jsonChunk;
+	qsizetype offset = kGLBHeaderSize;
+	qint32 chunkIndex = 0;
+	while ( offset + kGLBChunkHeaderSize <= qsizetype ( length ) )
+	{
+		const quint32 chunkLength = readU32 ( bytes, offset );
+		const quint32 chunkType = readU32 ( bytes, offset + 4 );
+		const qsizetype chunkStart = offset + kGLBChunkHeaderSize;
+
+		if ( chunkStart + qsizetype ( chunkLength ) > qsizetype ( length ) )
+		{
+			qWarning () << "GLB chunk " << chunkIndex << " of " << filename << " runs past the end of the container" << Qt::endl;
+			return false;
+		}
+
+		const QByteArrayView chunk = bytes.sliced ( chunkStart, chunkLength );
+
+		if ( chunkIndex == 0 )
+		{
+			if ( chunkType != kGLBChunkJSON )
+			{
+				qWarning () << "The first GLB chunk of " << filename << " is not a JSON chunk" << Qt::endl;
+				return false;
+			}
+			jsonChunk = chunk;
+		}
+		else if ( chunkIndex == 1 && chunkType == kGLBChunkBIN )
+		{
+			m_binChunk = chunk;
+		}
+
+		// chunks are padded to 4 bytes
+		offset = chunkStart + ( ( chunkLength + 3 ) & ~quint32 ( 3 ) );
+		chunkIndex++;
+	}
+
+	if ( jsonChunk.isNull () )
+	{
+		qWarning () << "GLB container " << filename << " has no JSON chunk" << Qt::endl;
+		return false;
+	}
+
+	if ( openCacheEntry ( filename, jsonChunk ) )
+	{
+		return true;
+	}
+
+	return parseJson ( jsonChunk, filename );
+}
+
+bool GLTFLoader::mapFile ( const QString& filename )
+{
+	JCQT_TRACE_SPAN ( span, "GLTFLoader::mapFile" );
+	m_file.setFileName ( filename );
+
+	if ( !m_file.open ( QIODevice::ReadOnly ) )
 	{
 		qWarning () << "Couldn't open " << filename << Qt::endl;
 		return false;
 	}
 
-	QByteArray data = loadFile.readAll ();
+	const qint64 fileSize = m_file.size ();
+	if ( fileSize > 0 )
+	{
+		m_mappedData = m_file.map ( 0, fileSize );
+	}
+
+	if ( m_mappedData )
+	{
+		m_fileView = QByteArrayView ( m_mappedData, fileSize );
+	}
+	else
+	{
+		// Not every file engine can map (e.g. compressed Qt resources), fall back to reading the whole file.
+		m_fileData = m_file.readAll ();
+		m_fileView = QByteArrayView ( m_fileData );
+	}
+
+	// the mapping stays valid after the file handle is closed
+	m_file.close ();
+	JCQT_TRACE_COUNTS ( span, m_fileView.size (), 1 );
+	return true;
+}
+
+bool GLTFLoader::parseJson ( QByteArrayView json, const QString& filename )
+{
+	JCQT_TRACE_SPAN ( span, "gltf::parseDocument" );
+	QString errParse;
+
+	// progress ticks double as cancellation points
+	const jcqt::gltf::ParseProgress progress = [this] ( qsizetype bytesParsed ) {
+		m_bytesParsed = bytesParsed;
+		emitProgress ();
+		return !m_canceled.load ();
+	};
+
+	// The streaming parser fills the typed document straight from the mapped bytes, no QJsonDocument DOM is built here
+	if ( !jcqt::gltf::parseDocument ( json, m_gltf, &errParse, progress ) )
+	{
+		qWarning () << "Failed to parse JSON document from " << filename << Qt::endl << "JsonParseError: " << errParse << Qt::endl;
+		return false;
+	}
+
+	m_json = json;
+	m_bytesParsed = json.size ();
+	JCQT_TRACE_COUNTS ( span, json.size (), m_gltf.nodes_.size () + m_gltf.accessors_.size () );
+	emitProgress ();
+	return true;
+}
+
+const QJsonDocument& GLTFLoader::jsonDocument () const
+{
+	if ( !m_documentParsed )
+	{
+		// fromRawData() wraps the mapped bytes without copying them
+		m_document = QJsonDocument::fromJson ( QByteArray::fromRawData ( m_json.data (), m_json.size () ) );
+		m_documentParsed = true;
+	}
+
+	return m_document;
+}
+
+void GLTFLoader::startResources ( const QString& filename )
+{
+	const qsizetype bufferCount = m_gltf.buffers_.size ();
+	const qsizetype imageCount = m_gltf.images_.size ();
+
+	m_baseDir = QFileInfo ( filename ).absolutePath ();
+	m_buffers.resize ( bufferCount );
+	m_bufferStorage.resize ( bufferCount );
+	m_images.resize ( imageCount );
+	m_imagesForBuffer.resize ( bufferCount );
+	m_externalFiles.resize ( size_t ( bufferCount ) );
+	m_bufferStatus.reset ( new std::atomic<quint8> [ size_t ( bufferCount ) ] );
+	m_imageStatus.reset ( new std::atomic<quint8> [ size_t ( imageCount ) ] );
+
+	/*
+	*	Discover everything first: GLB buffers are resolved right here, data: URIs and external files become pool tasks. Images stored in a
+	*	bufferView are chained to their buffer's task so they are decoded as soon as those bytes arrive. All bookkeeping is done before the
+	*	first task is submitted, the tasks only touch their own slots afterwards.
+	*/
+	QList<qint32> bufferTasks;
+	for ( qsizetype i = 0; i < bufferCount; i++ )
+	{
+		const jcqt::gltf::Buffer& buffer = m_gltf.buffers_ [ i ];
+		m_bufferStatus [ i ] = kPending;
+
+		if ( !buffer.uri_.isEmpty () )
+		{
+			if ( !buffer.isDataUri () )
+				m_externalFiles [ i ] = std::make_unique<QFile> ( resolveUri ( buffer.uri_ ) );
+			bufferTasks.append ( qint32 ( i ) );
+			continue;
+		}
+
+		if ( resolveBinChunk ( i ) )
+		{
+			m_bufferStatus [ i ] = kReady;
+			m_buffersLoaded++;
+			emit bufferReady ( qint32 ( i ) );
+		}
+		else
+		{
+			m_bufferStatus [ i ] = kFailed;
+			setError ( QStringLiteral ( "Failed to resolve buffer %1" ).arg ( i ) );
+		}
+	}
+
+	QList<qint32> imageTasks;
+	for ( qsizetype i = 0; i < imageCount; i++ )
+	{
+		const jcqt::gltf::Image& image = m_gltf.images_ [ i ];
+		m_imageStatus [ i ] = kPending;
+
+		const qint32 buffer = image.bufferView_ >= 0 && image.bufferView_ < m_gltf.bufferViews_.size () ? m_gltf.bufferViews_ [ image.bufferView_ ].buffer_ : -1;
+		if ( buffer >= 0 && buffer < bufferCount && m_bufferStatus [ buffer ] == kPending )
+		{
+			m_imagesForBuffer [ buffer ].append ( qint32 ( i ) );
+			m_outstanding++;
+		}
+		else
+		{
+			imageTasks.append ( qint32 ( i ) );
+		}
+	}
+
+	m_outstanding += qint32 ( imageTasks.size () + bufferTasks.size () );
+
+	for ( qint32 image : imageTasks )
+	{
+		submitTask ( [this, image] () { decodeImage ( image ); } );
+	}
+
+	for ( qint32 buffer : bufferTasks )
+	{
+		submitTask ( [this, buffer] () { loadBuffer ( buffer ); } );
+	}
+}
+
+void GLTFLoader::submitTask ( std::function<void ()> task )
+{
+	m_activeTasks++;
+	jcqt::WorkStealingPool::globalInstance ().submit ( [this, task = std::move ( task )] () {
+		task ();
+		// last access to this: clear() and the destructor only wait for m_activeTasks
+		m_activeTasks--;
+	} );
+}
+
+void GLTFLoader::completeResource ()
+{
+	if ( m_outstanding.fetch_sub ( 1 ) != 1 )
+		return;
+
+	if ( !m_canceled && !m_resourceFailed && m_cache && !m_fromCache )
+		storeInCache ();
+
+	/*
+	*	The last resource usually completes inside a pool task that still counts in m_activeTasks. The outcome is posted to the loader's
+	*	thread and emitted there once every task has retired, so receivers see isLoading() false and may clear() or delete the loader.
+	*/
+	const quint32 load = m_loadId.load ();
+	QMetaObject::invokeMethod ( this, [this, load] () { emitOutcome ( load ); }, Qt::QueuedConnection );
+}
+
+void GLTFLoader::emitOutcome ( quint32 load )
+{
+	// clear() (or the next load) dropped the load this was posted for
+	if ( load != m_loadId.load () )
+		return;
+
+	waitForFinished ();
+	if ( m_canceled )
+		emit loadCanceled ();
+	else if ( m_resourceFailed )
+		emit loadFailed ( errorString () );
+	else
+		emit loadFinished ();
+}
+
+void GLTFLoader::setError ( const QString& error )
+{
+	// a canceled load is not a failed one
+	if ( m_canceled )
+		return;
+
+	QMutexLocker locker ( &m_errorMutex );
+	if ( m_errorString.isEmpty () )
+		m_errorString = error;
+	m_resourceFailed = true;
+}
+
+void GLTFLoader::emitProgress ()
+{
+	emit progressChanged ( m_bytesParsed.load (), m_buffersLoaded.load (), m_imagesDecoded.load () );
+}
+
+QString GLTFLoader::resolveUri ( const QString& uri ) const
+{
+	// relative URIs are percent-encoded and relative to the .gltf file
+	return QDir ( m_baseDir ).filePath ( QUrl::fromPercentEncoding ( uri.toUtf8 () ) );
+}
+
+bool GLTFLoader::resolveBinChunk ( qsizetype index )
+{
+	const jcqt::gltf::Buffer& buffer = m_gltf.buffers_ [ index ];
+
+	// A buffer without an uri refers to the BIN chunk of the GLB container, which may be padded by up to 3 bytes
+	if ( index != 0 || m_binChunk.isNull () )
+	{
+		qWarning () << "Buffer " << index << " has no uri and there is no GLB BIN chunk to back it" << Qt::endl;
+		return false;
+	}
+
+	if ( buffer.byteLength_ < 0 || buffer.byteLength_ > m_binChunk.size () )
+	{
+		qWarning () << "Buffer " << index << " declares " << buffer.byteLength_ << " bytes but the BIN chunk has only " << m_binChunk.size () << Qt::endl;
+		return false;
+	}
+
+	m_buffers [ index ] = m_binChunk.first ( buffer.byteLength_ );
+	return true;
+}
+
+void GLTFLoader::loadBuffer ( qint32 index )
+{
+	const bool ok = !m_canceled && ( m_gltf.buffers_ [ index ].isDataUri () ? decodeDataUri ( index ) : readExternalBuffer ( index ) );
+	m_bufferStatus [ index ] = ok ? kReady : kFailed;
+
+	if ( ok )
+	{
+		m_buffersLoaded++;
+		emit bufferReady ( index );
+		emitProgress ();
+	}
+	else
+	{
+		setError ( QStringLiteral ( "Failed to load buffer %1" ).arg ( index ) );
+	}
+
+	// images waiting on this buffer are decoded right away, on this worker if nobody steals them
+	for ( qint32 image : m_imagesForBuffer [ index ] )
+	{
+		if ( ok )
+		{
+			submitTask ( [this, image] () { decodeImage ( image ); } );
+		}
+		else
+		{
+			m_imageStatus [ image ] = kFailed;
+			completeResource ();
+		}
+	}
+
+	completeResource ();
+}
+
+bool GLTFLoader::readExternalBuffer ( qsizetype index )
+{
+	JCQT_TRACE_SPAN_INDEX ( span, "GLTFLoader::readExternalBuffer", qint32 ( index ) );
+	const jcqt::gltf::Buffer& buffer = m_gltf.buffers_ [ index ];
+	QFile& file = *m_externalFiles [ index ];
+
+	if ( !file.open ( QIODevice::ReadOnly ) )
+	{
+		qWarning () << "Couldn't open " << file.fileName () << " for buffer " << index << Qt::endl;
+		return false;
+	}
+
+	if ( buffer.byteLength_ < 0 || buffer.byteLength_ > file.size () )
+	{
+		qWarning () << "Buffer " << index << " declares " << buffer.byteLength_ << " bytes but " << file.fileName () << " has only " << file.size () << Qt::endl;
+		return false;
+	}
+
+	// map like the main file, the mapping lives as long as m_externalFiles[index]
+	uchar* mapped = buffer.byteLength_ > 0 ? file.map ( 0, buffer.byteLength_ ) : nullptr;
+	if ( mapped )
+	{
+		m_buffers [ index ] = QByteArrayView ( mapped, buffer.byteLength_ );
+	}
+	else
+	{
+		m_bufferStorage [ index ] = file.read ( buffer.byteLength_ );
+		m_buffers [ index ] = QByteArrayView ( m_bufferStorage [ index ] );
+	}
+
+	file.close ();
+	JCQT_TRACE_COUNTS ( span, m_buffers [ index ].size (), 1 );
+	return m_buffers [ index ].size () == buffer.byteLength_;
+}
+
+bool GLTFLoader::decodeDataUri ( qsizetype index )
+{
+	JCQT_TRACE_SPAN_INDEX ( span, "base64Decode buffer", qint32 ( index ) );
+	const jcqt::gltf::Buffer& buffer = m_gltf.buffers_ [ index ];
+
+	if ( !buffer.uri_.endsWith ( QStringLiteral ( ";base64," ) ) )
+	{
+		qWarning () << "Buffer " << index << " uses an unsupported data URI encoding " << buffer.uri_ << Qt::endl;
+		return false;
+	}
+
+	const QByteArrayView payload = buffer.dataPayload ();
+	const qsizetype decodedSize = jcqt::base64DecodedSize ( payload );
+	if ( decodedSize < buffer.byteLength_ || buffer.byteLength_ < 0 )
+	{
+		qWarning () << "Buffer " << index << " declares " << buffer.byteLength_ << " bytes but its data URI holds " << decodedSize << Qt::endl;
+		return false;
+	}
+
+	// decode straight into the buffer's storage, there is no intermediate QByteArray::fromBase64() copy
+	QByteArray& storage = m_bufferStorage [ index ];
+	storage = QByteArray ( decodedSize, Qt::Uninitialized );
+	uchar* out = reinterpret_cast<uchar*>( storage.data () );
 
-	QJsonParseError errParse;
+	// slices of whole 4-character groups, so cancel() does not have to wait for a buffer of several hundred megabytes
+	constexpr qsizetype kSlice = 4 << 20;
+	qsizetype written = 0;
+	for ( qsizetype offset = 0; offset < payload.size (); offset += kSlice )
+	{
+		if ( m_canceled )
+		{
+			storage.clear ();
+			return false;
+		}
 
-	m_document = QJsonDocument::fromJson ( data, &errParse );
+		const qsizetype n = jcqt::base64Decode ( payload.sliced ( offset, qMin ( kSlice, payload.size () - offset ) ), out + written );
+		if ( n < 0 )
+		{
+			written = -1;
+			break;
+		}
+		written += n;
+	}
 
-	if ( m_document.isNull () )
+	if ( written != decodedSize )
 	{
-		qWarning () << "Failed to parse JSON document from " << filename << Qt::endl << "JsonParseError: " << errParse.errorString () << Qt::endl;
+		qWarning () << "Buffer " << index << " has a malformed base64 data URI" << Qt::endl;
+		storage.clear ();
 		return false;
 	}
 
+	m_buffers [ index ] = QByteArrayView ( storage ).first ( buffer.byteLength_ );
+	// bytes decoded, base64 characters read
+	JCQT_TRACE_COUNTS ( span, written, payload.size () );
+	return true;
+}
+
+void GLTFLoader::decodeImage ( qint32 index )
+{
+	JCQT_TRACE_SPAN_INDEX ( span, "GLTFLoader::decodeImage", index );
+	const jcqt::gltf::Image& image = m_gltf.images_ [ index ];
+
+	if ( m_canceled )
+	{
+		m_imageStatus [ index ] = kFailed;
+		completeResource ();
+		return;
+	}
+
+	// a format hint skips QImageReader's content sniffing
+	const char* format = nullptr;
+	if ( image.mimeType_ == QLatin1String ( "image/png" ) )
+		format = "PNG";
+	else if ( image.mimeType_ == QLatin1String ( "image/jpeg" ) )
+		format = "JPG";
+
+	QImage decoded;
+	if ( image.bufferView_ >= 0 )
+	{
+		const QByteArrayView bytes = bufferViewData ( image.bufferView_ );
+		decoded.loadFromData ( bytes, format );
+	}
+	else if ( image.isDataUri () )
+	{
+		const QByteArrayView payload = image.dataPayload ();
+		const qsizetype decodedSize = jcqt::base64DecodedSize ( payload );
+		if ( image.uri_.endsWith ( QStringLiteral ( ";base64," ) ) && decodedSize >= 0 )
+		{
+			QByteArray bytes ( decodedSize, Qt::Uninitialized );
+			if ( jcqt::base64Decode ( payload, reinterpret_cast<uchar*>( bytes.data () ) ) == decodedSize )
+				decoded.loadFromData ( bytes, format );
+		}
+	}
+	else if ( !image.uri_.isEmpty () )
+	{
+		decoded.load ( resolveUri ( image.uri_ ), format );
+	}
+
+	// decoded bytes and pixels
+	JCQT_TRACE_COUNTS ( span, decoded.sizeInBytes (), qint64 ( decoded.width () ) * decoded.height () );
+
+	if ( decoded.isNull () )
+	{
+		qWarning () << "Failed to decode image " << index << " " << image.name_ << Qt::endl;
+		m_imageStatus [ index ] = kFailed;
+		setError ( QStringLiteral ( "Failed to decode image %1" ).arg ( index ) );
+	}
+	else
+	{
+		m_images [ index ] = std::move ( decoded );
+		m_imageStatus [ index ] = kReady;
+		m_imagesDecoded++;
+		emit imageReady ( index );
+		emitProgress ();
+	}
+
+	completeResource ();
+}
+
+bool GLTFLoader::isBufferReady ( qint32 buffer ) const
+{
+	return buffer >= 0 && buffer < m_buffers.size () && m_bufferStatus [ buffer ] == kReady;
+}
+
+bool GLTFLoader::waitForBuffer ( qint32 buffer ) const
+{
+	if ( buffer < 0 || buffer >= m_buffers.size () )
+		return false;
+
+	jcqt::WorkStealingPool::globalInstance ().waitUntil ( [this, buffer] () { return m_bufferStatus [ buffer ] != kPending; } );
+	return m_bufferStatus [ buffer ] == kReady;
+}
+
+QImage GLTFLoader::image ( qint32 image ) const
+{
+	if ( image < 0 || image >= m_images.size () || m_imageStatus [ image ] != kReady )
+		return QImage ();
+
+	return m_images [ image ];
+}
+
+bool GLTFLoader::isBinary () const
+{
+	return !m_binChunk.isNull ();
+}
+
+QByteArrayView GLTFLoader::binaryChunk () const
+{
+	return m_binChunk;
+}
+
+QByteArrayView GLTFLoader::bufferData ( qint32 buffer ) const
+{
+	if ( !isBufferReady ( buffer ) )
+		return QByteArrayView ();
+
+	return m_buffers [ buffer ];
+}
+
+QByteArrayView GLTFLoader::bufferViewData ( qint32 bufferView ) const
+{
+	if ( bufferView < 0 || bufferView >= m_gltf.bufferViews_.size () )
+		return QByteArrayView ();
+
+	const jcqt::gltf::BufferView& view = m_gltf.bufferViews_ [ bufferView ];
+	const QByteArrayView buffer = bufferData ( view.buffer_ );
+
+	if ( view.byteOffset_ < 0 || view.byteLength_ < 0 || view.byteOffset_ + view.byteLength_ > buffer.size () )
+		return QByteArrayView ();
+
+	return buffer.sliced ( view.byteOffset_, view.byteLength_ );
+}
+
+jcqt::AccessorData GLTFLoader::accessorData ( qint32 accessor ) const
+{
+	if ( accessor < 0 || accessor >= m_gltf.accessors_.size () )
+		return jcqt::AccessorData ();
+
+	// the buffers are not loaded on a cache hit
+	const jcqt::gltf::Accessor& acc = m_gltf.accessors_ [ accessor ];
+	if ( m_fromCache || acc.bufferView_ < 0 || acc.bufferView_ >= m_gltf.bufferViews_.size () )
+		return jcqt::AccessorData ();
+
+	const qsizetype elementSize = jcqt::gltf::elementSize ( acc.type_, acc.componentType_ );
+	const qsizetype byteStride = m_gltf.bufferViews_ [ acc.bufferView_ ].byteStride_;
+	const qsizetype stride = byteStride > 0 ? byteStride : elementSize;
+	const QByteArrayView view = bufferViewData ( acc.bufferView_ );
+
+	if ( elementSize == 0 || stride < elementSize || acc.count_ < 0 || acc.byteOffset_ < 0 )
+	{
+		qWarning () << "Accessor " << accessor << " has an invalid type, componentType, count or byteStride" << Qt::endl;
+		return jcqt::AccessorData ();
+	}
+
+	// the last element only needs elementSize bytes, not a full stride
+	if ( acc.count_ > 0 && acc.byteOffset_ + stride * ( acc.count_ - 1 ) + elementSize > view.size () )
+	{
+		qWarning () << "Accessor " << accessor << " runs past the end of bufferView " << acc.bufferView_ << Qt::endl;
+		return jcqt::AccessorData ();
+	}
+
+	jcqt::AccessorData data;
+	data.data_ = reinterpret_cast<const uchar*>( view.data () ) + acc.byteOffset_;
+	data.count_ = acc.count_;
+	data.stride_ = stride;
+	data.elementSize_ = elementSize;
+	return data;
+}
+
+bool GLTFLoader::readAccessor ( qint32 accessor, QList<float>& out ) const
+{
+	JCQT_TRACE_SPAN_INDEX ( span, "GLTFLoader::readAccessor float", accessor );
+	if ( m_fromCache )
+		return readCachedAccessor ( accessor, out );
+
+	const jcqt::AccessorData data = accessorData ( accessor );
+	if ( !data.data_ )
+		return false;
+
+	const jcqt::gltf::Accessor& acc = m_gltf.accessors_ [ accessor ];
+	const jcqt::FloatConverter convert = jcqt::floatConverter ( acc.componentType_, acc.type_, acc.normalized_ );
+	if ( !convert )
+		return false;
+
+	out.resize ( data.count_ * jcqt::gltf::componentCount ( acc.type_ ) );
+	convert ( data, out.data () );
+	JCQT_TRACE_COUNTS ( span, out.size () * qsizetype ( sizeof ( float ) ), data.count_ );
+	return true;
+}
+
+bool GLTFLoader::readAccessor ( qint32 accessor, QList<jcqt::gpuvec4>& out ) const
+{
+	JCQT_TRACE_SPAN_INDEX ( span, "GLTFLoader::readAccessor gpuvec4", accessor );
+	if ( m_fromCache )
+	{
+		// the cache holds the float conversion, padding it gives what vec4Converter() would have written
+		const jcqt::CachedAccessor* cached = cachedAccessor ( accessor );
+		const jcqt::gltf::AccessorType type = cached ? jcqt::gltf::AccessorType ( cached->type_ ) : jcqt::gltf::AccessorType::Unknown;
+		QList<float> values;
+		if ( type < jcqt::gltf::AccessorType::Scalar || type > jcqt::gltf::AccessorType::Vec4 || !readCachedAccessor ( accessor, values ) )
+			return false;
+
+		const qint32 components = jcqt::gltf::componentCount ( type );
+		out.resize ( cached->count_ );
+		for ( qsizetype i = 0; i < out.size (); i++ )
+		{
+			float v [ 4 ] = { 0.f, 0.f, 0.f, 1.f };
+			for ( qint32 c = 0; c < components; c++ )
+				v [ c ] = values [ i * components + c ];
+			out [ i ] = jcqt::gpuvec4 ( v [ 0 ], v [ 1 ], v [ 2 ], v [ 3 ] );
+		}
+		return true;
+	}
+
+	const jcqt::AccessorData data = accessorData ( accessor );
+	if ( !data.data_ )
+		return false;
+
+	const jcqt::gltf::Accessor& acc = m_gltf.accessors_ [ accessor ];
+	const jcqt::Vec4Converter convert = jcqt::vec4Converter ( acc.componentType_, acc.type_, acc.normalized_ );
+	if ( !convert )
+	{
+		qWarning () << "Accessor " << accessor << " is not a SCALAR or VEC type and cannot be read as gpuvec4" << Qt::endl;
+		return false;
+	}
+
+	out.resize ( data.count_ );
+	convert ( data, out.data () );
+	JCQT_TRACE_COUNTS ( span, out.size () * qsizetype ( sizeof ( jcqt::gpuvec4 ) ), data.count_ );
+	return true;
+}
+
+bool GLTFLoader::readIndices ( qint32 accessor, QList<quint32>& out ) const
+{
+	JCQT_TRACE_SPAN_INDEX ( span, "GLTFLoader::readIndices", accessor );
+	if ( m_fromCache )
+		return readCachedIndices ( accessor, out );
+
+	const jcqt::AccessorData data = accessorData ( accessor );
+	if ( !data.data_ )
+		return false;
+
+	const jcqt::gltf::Accessor& acc = m_gltf.accessors_ [ accessor ];
+	const jcqt::IndexConverter convert = jcqt::indexConverter ( acc.componentType_ );
+	if ( acc.type_ != jcqt::gltf::AccessorType::Scalar || !convert )
+	{
+		qWarning () << "Accessor " << accessor << " does not hold unsigned integer indices" << Qt::endl;
+		return false;
+	}
+
+	out.resize ( data.count_ );
+	convert ( data, out.data () );
+	JCQT_TRACE_COUNTS ( span, out.size () * qsizetype ( sizeof ( quint32 ) ), data.count_ );
+	return true;
+}
+
+const jcqt::gltf::Document& GLTFLoader::document () const
+{
+	return m_gltf;
+}
+
+void GLTFLoader::setAssetCache ( jcqt::AssetCache* cache )
+{
+	m_cache = cache;
+}
+
+jcqt::AssetCache* GLTFLoader::assetCache () const
+{
+	return m_cache;
+}
+
+bool GLTFLoader::isFromCache () const
+{
+	return m_fromCache;
+}
+
+bool GLTFLoader::buildScene ( jcqt::Scene& scene ) const
+{
+	if ( m_fromCache )
+		return m_cacheEntry->load ( scene );
+
+	return jcqt::buildScene ( m_gltf, scene );
+}
+
+bool GLTFLoader::openCacheEntry ( const QString& filename, QByteArrayView json )
+{
+	if ( !m_cache )
+		return false;
+
+	JCQT_TRACE_SPAN ( span, "GLTFLoader::openCacheEntry" );
+	// the key covers the whole file (the BIN chunk of a .glb too), the entry itself checks the external buffers
+	m_baseDir = QFileInfo ( filename ).absolutePath ();
+	m_cacheKey = jcqt::AssetCache::key ( m_fileView );
+
+	std::unique_ptr<jcqt::SceneFile> entry = std::make_unique<jcqt::SceneFile> ();
+	if ( !m_cache->lookup ( m_cacheKey, m_baseDir, *entry ) )
+		return false;
+
+	QList<QImage> images;
+	if ( !jcqt::AssetCache::readContent ( *entry, json, m_gltf, m_cachedAccessors, images ) )
+	{
+		qWarning () << "Asset cache entry " << m_cache->entryPath ( m_cacheKey ) << " is malformed, loading " << filename << " instead" << Qt::endl;
+		m_gltf = jcqt::gltf::Document ();
+		m_cachedAccessors.clear ();
+		return false;
+	}
+
+	// the decoded images, ready as if their tasks had run
+	m_images = std::move ( images );
+	m_imageStatus.reset ( new std::atomic<quint8> [ size_t ( m_images.size () ) ] );
+	for ( qsizetype i = 0; i < m_images.size (); i++ )
+		m_imageStatus [ i ] = kReady;
+	m_imagesDecoded = qint32 ( m_images.size () );
+
+	m_cachedAccessorData = entry->section ( jcqt::SceneSectionId::CacheAccessorData );
+	m_cacheEntry = std::move ( entry );
+	// the lazy QJsonDocument still works on a hit
+	m_json = json;
+	m_fromCache = true;
+	JCQT_TRACE_COUNTS ( span, m_fileView.size (), m_cachedAccessors.size () );
+	return true;
+}
+
+void GLTFLoader::storeInCache ()
+{
+	JCQT_TRACE_SPAN ( span, "GLTFLoader::storeInCache" );
+	jcqt::Scene scene;
+	if ( !jcqt::buildScene ( m_gltf, scene ) )
+		return;
+
+	jcqt::AssetCacheContent content;
+	// the external buffers and image files decide whether an entry is still valid
+	for ( const jcqt::gltf::Buffer& buffer : m_gltf.buffers_ )
+	{
+		if ( !buffer.uri_.isEmpty () && !buffer.isDataUri () )
+			content.dependencies_.append ( QDir ( m_baseDir ).relativeFilePath ( resolveUri ( buffer.uri_ ) ) );
+	}
+	for ( const jcqt::gltf::Image& image : m_gltf.images_ )
+	{
+		if ( image.bufferView_ < 0 && !image.uri_.isEmpty () && !image.isDataUri () )
+			content.dependencies_.append ( QDir ( m_baseDir ).relativeFilePath ( resolveUri ( image.uri_ ) ) );
+	}
+
+	content.document_ = m_gltf;
+	content.json_ = m_json;
+	content.images_ = m_images;
+	content.accessors_.resize ( m_gltf.accessors_.size () );
+
+	QList<float> values;
+	QList<quint32> indices;
+	for ( qsizetype i = 0; i < m_gltf.accessors_.size (); i++ )
+	{
+		const jcqt::gltf::Accessor& acc = m_gltf.accessors_ [ i ];
+		jcqt::CachedAccessor& cached = content.accessors_ [ i ];
+		cached = { jcqt::CachedAccessorKind::None, quint32 ( acc.type_ ), acc.componentType_, quint32 ( acc.normalized_ ), acc.count_, 0, 0 };
+
+		// everything readIndices() accepts is kept as indices, readAccessor(float) can be answered from those exactly
+		QByteArrayView bytes;
+		if ( acc.type_ == jcqt::gltf::AccessorType::Scalar && jcqt::indexConverter ( acc.componentType_ ) )
+		{
+			if ( !readIndices ( qint32 ( i ), indices ) )
+				continue;
+			cached.kind_ = jcqt::CachedAccessorKind::Index;
+			bytes = QByteArrayView ( reinterpret_cast<const char*>( indices.constData () ), indices.size () * qsizetype ( sizeof ( quint32 ) ) );
+		}
+		else
+		{
+			if ( !readAccessor ( qint32 ( i ), values ) )
+				continue;
+			cached.kind_ = jcqt::CachedAccessorKind::Float;
+			bytes = QByteArrayView ( reinterpret_cast<const char*>( values.constData () ), values.size () * qsizetype ( sizeof ( float ) ) );
+		}
+
+		cached.offset_ = quint64 ( content.accessorData_.size () );
+		cached.size_ = quint64 ( bytes.size () );
+		content.accessorData_.append ( bytes );
+		// every accessor starts 16-byte aligned, like the sections of the entry
+		content.accessorData_.append ( ( 16 - content.accessorData_.size () % 16 ) % 16, '\0' );
+	}
+
+	// a failed store only costs the next load its hit
+	m_cache->store ( m_cacheKey, m_baseDir, scene, content );
+	JCQT_TRACE_COUNTS ( span, content.accessorData_.size (), content.accessors_.size () );
+}
+
+const jcqt::CachedAccessor* GLTFLoader::cachedAccessor ( qint32 accessor ) const
+{
+	if ( !m_fromCache || accessor < 0 || accessor >= m_cachedAccessors.size () )
+		return nullptr;
+
+	const jcqt::CachedAccessor& cached = m_cachedAccessors [ accessor ];
+	const quint64 elementSize = cached.kind_ == jcqt::CachedAccessorKind::Float ? jcqt::gltf::componentCount ( jcqt::gltf::AccessorType ( cached.type_ ) ) * sizeof ( float ) :
+		cached.kind_ == jcqt::CachedAccessorKind::Index ? sizeof ( quint32 ) : 0;
+	if ( elementSize == 0 || cached.count_ < 0 || cached.size_ != quint64 ( cached.count_ ) * elementSize )
+		return nullptr;
+
+	return &cached;
+}
+
+bool GLTFLoader::readCachedAccessor ( qint32 accessor, QList<float>& out ) const
+{
+	const jcqt::CachedAccessor* cached = cachedAccessor ( accessor );
+	if ( !cached )
+		return false;
+
+	const QByteArrayView bytes = m_cachedAccessorData.sliced ( qsizetype ( cached->offset_ ), qsizetype ( cached->size_ ) );
+	if ( cached->kind_ == jcqt::CachedAccessorKind::Float )
+	{
+		out.resize ( bytes.size () / qsizetype ( sizeof ( float ) ) );
+		if ( !out.isEmpty () )
+			memcpy ( out.data (), bytes.data (), bytes.size () );
+		return true;
+	}
+
+	// the scale floatConverter() applies to normalized unsigned bytes and shorts
+	const float scale = !cached->normalized_ ? 1.f :
+		cached->componentType_ == jcqt::gltf::kUnsignedByte ? 1.f / 255.f :
+		cached->componentType_ == jcqt::gltf::kUnsignedShort ? 1.f / 65535.f : 1.f;
+	const quint32* indices = reinterpret_cast<const quint32*>( bytes.data () );
+	out.resize ( cached->count_ );
+	for ( qsizetype i = 0; i < out.size (); i++ )
+		out [ i ] = float ( indices [ i ] ) * scale;
+	return true;
+}
+
+bool GLTFLoader::readCachedIndices ( qint32 accessor, QList<quint32>& out ) const
+{
+	const jcqt::CachedAccessor* cached = cachedAccessor ( accessor );
+	if ( !cached )
+		return false;
+
+	if ( cached->kind_ != jcqt::CachedAccessorKind::Index )
+	{
+		qWarning () << "Accessor " << accessor << " does not hold unsigned integer indices" << Qt::endl;
+		return false;
+	}
+
+	out.resize ( cached->count_ );
+	if ( !out.isEmpty () )
+		memcpy ( out.data (), m_cachedAccessorData.data () + cached->offset_, cached->size_ );
 	return true;
 }
 
 bool GLTFLoader::isJsonArray ()
 {
-	if ( m_document.isNull () )
+	const QJsonDocument& doc = jsonDocument ();
+	if ( doc.isNull () )
 		return false;
 
-	return m_document.isArray ();	
+	return doc.isArray ();	
 }
 
 bool GLTFLoader::isJsonObject ()
 {
-	if ( m_document.isNull () )
+	const QJsonDocument& doc = jsonDocument ();
+	if ( doc.isNull () )
 		return false;
 
-	return m_document.isObject ();
+	return doc.isObject ();
 }
 
 QJsonArray GLTFLoader::jsonArray () const
 {
-	if ( m_document.isNull () )
+	const QJsonDocument& doc = jsonDocument ();
+	if ( doc.isNull () )
 		return QJsonArray ();
 
-	return m_document.array ();
+	return doc.array ();
 }
 
 QJsonObject GLTFLoader::jsonObject () const
 {
-	if ( m_document.isNull () )
+	const QJsonDocument& doc = jsonDocument ();
+	if ( doc.isNull () )
 		return QJsonObject ();
 
-	return m_document.object ();
+	return doc.object ();
 }
 
 void GLTFLoader::printJsonDocument (int maxDepth) const
 {
 	qDebug () << "Attempting to print JSON document" << Qt::endl;
 
-	if ( m_document.isNull () )
+	const QJsonDocument& doc = jsonDocument ();
+
+	if ( doc.isNull () )
 	{
 		qDebug () << "Document is NULL" << Qt::endl;
 		return;
 	}		
 
-	if ( m_document.isEmpty () )
+	if ( doc.isEmpty () )
 	{
 		qDebug () << "Document is EMPTY" << Qt::endl;
 		return;
 	}
 
-	if ( m_document.isObject () )
+	if ( doc.isObject () )
 	{
 		qDebug () << "JSON OBJECT: " << Qt::endl;
-		printJsonObject ( m_document.object (), maxDepth );
+		printJsonObject ( doc.object (), maxDepth );
 		return;
 	}
 
-	if ( m_document.isArray () )
+	if ( doc.isArray () )
 	{
 		qDebug () << "JSON ARRAY: " << Qt::endl;
-		printJsonArray ( m_document.array (), maxDepth );
+		printJsonArray ( doc.array (), maxDepth );
 		return;
 	}		
 }
@@ -31,7 +31,24 @@ SOFTWARE.
 
 
 #include <QObject>
+#include <QFile>
+#include <QList>
+#include <QByteArray>
+#include <QByteArrayView>
 #include <QJsonDocument>
+#include <QImage>
+#include <QMutex>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "GLTFDocument.h"
+#include "AccessorView.h"
+#include "AssetCache.h"
+#include "vec4.h"
+#include "WorkStealingPool.h"
 
 class GLTFLoader : public QObject
 {
@@ -41,7 +58,89 @@ public:
 	GLTFLoader ( QObject* parent = nullptr );
 	~GLTFLoader ();
 
+	/*
+	*	Loads either a .gltf (JSON) or a .glb (binary container) file. The file is memory mapped whenever possible. After the JSON is parsed
+	*	every external buffer, data: URI and image is read and decoded on the shared WorkStealingPool; the call returns once all of them are done.
+	*/
 	bool loadGLTF ( const QString& filename );
+	// Loads a .glb container: validates the 12-byte header and the chunk table, parses the JSON chunk in place and keeps the BIN chunk mapped.
+	bool loadGLB ( const QString& filename );
+
+	/*
+	*	Same as loadGLTF() but returns right away; mapping and parsing run on the pool too. The outcome is reported by exactly one of
+	*	loadFinished(), loadFailed() or loadCanceled(), emitted from the event loop of the loader's thread once every pool task of the load
+	*	has retired: receivers see isLoading() false and may clear() or delete the loader. clear() drops an outcome not delivered yet.
+	*	Until then only document() parts announced by bufferReady()/imageReady(), which are emitted from pool threads, may be used.
+	*	Returns false only for a filename without a gltf/glb extension.
+	*/
+	bool loadGLTFAsync ( const QString& filename );
+	// Cooperative: tasks that have not started are skipped, JSON parsing and base64 decoding stop at their next checkpoint
+	void cancel ();
+	bool isLoading () const;
+	// Helps the pool until the current load has finished, returns whether it succeeded
+	bool waitForFinished ();
+	// First error of the last load
+	QString errorString () const;
+
+	// Releases the parsed document and the file mapping, waiting for a running load first. Every view handed out by this loader becomes invalid.
+	void clear ();
+
+	bool isBinary () const;
+	// The BIN chunk of a .glb file (empty for .gltf files). The view points straight into the file mapping.
+	QByteArrayView binaryChunk () const;
+	// Storage backing buffers[buffer] and bufferViews[bufferView]; an empty view is returned for unresolved or invalid indices.
+	QByteArrayView bufferData ( qint32 buffer ) const;
+	QByteArrayView bufferViewData ( qint32 bufferView ) const;
+
+	// A buffer (and every bufferView into it) is usable as soon as its own load task finishes, independent of the other resources
+	bool isBufferReady ( qint32 buffer ) const;
+	// Helps the pool until buffers[buffer] finished loading, returns false if it failed
+	bool waitForBuffer ( qint32 buffer ) const;
+
+	// Decoded images[image], a null QImage if it failed or is not decoded yet
+	QImage image ( qint32 image ) const;
+
+	/*
+	*	Resolves accessors[accessor] -> bufferView -> buffer and checks that every element lies inside the bufferView. Accessors without a
+	*	bufferView (sparse or all zeros) and invalid ones resolve to an empty AccessorData.
+	*/
+	jcqt::AccessorData accessorData ( qint32 accessor ) const;
+
+	// Typed view of an accessor, e.g. accessorView<quint16>( primitive.indices_ ). Empty if sizeof(T) differs from the accessor's element size.
+	template<typename T>
+	jcqt::AccessorView<T> accessorView ( qint32 accessor ) const
+	{
+		return jcqt::AccessorView<T> ( accessorData ( accessor ) );
+	}
+
+	/*
+	*	Convert a whole accessor with the kernel specialized for its componentType, type and normalized flag (see AccessorConvert.h).
+	*	readAccessor(float) writes componentCount(type) floats per element, readAccessor(gpuvec4) pads vectors with (0, 0, 0, 1) and
+	*	readIndices widens unsigned byte/short/int indices to 32 bit.
+	*/
+	bool readAccessor ( qint32 accessor, QList<float>& out ) const;
+	bool readAccessor ( qint32 accessor, QList<jcqt::gpuvec4>& out ) const;
+	bool readIndices ( qint32 accessor, QList<quint32>& out ) const;
+
+	// Typed glTF document filled by the streaming parser while loading
+	const jcqt::gltf::Document& document () const;
+
+	/*
+	*	Loads look the file up in cache first (nullptr turns that off, the loader does not take ownership). A hit maps the cached entry
+	*	instead of parsing the JSON, loading the buffers and decoding the images; a miss loads as usual and stores an entry once every
+	*	resource is done. document(), image(), buildScene() and the read functions above return the same on a hit, only the raw buffer
+	*	storage is not loaded: bufferData(), bufferViewData() and accessorData() are empty. An entry is a miss once the file itself or one
+	*	of its external buffers or image files changed.
+	*/
+	void setAssetCache ( jcqt::AssetCache* cache );
+	jcqt::AssetCache* assetCache () const;
+	// Whether the last load was served from the asset cache
+	bool isFromCache () const;
+	// jcqt::buildScene() of the loaded document, copied straight out of the cache entry on a hit
+	bool buildScene ( jcqt::Scene& scene ) const;
+
+	// The QJsonDocument accessors below build the DOM lazily on first use, loading itself never creates it
+
 	bool isJsonArray ();
 	bool isJsonObject ();
 	QJsonArray jsonArray () const;
@@ -51,8 +150,101 @@ public:
 	void printJsonArray ( const QJsonArray& arr, int maxDepth = 8 ) const;
 	void printJsonDocument (int maxDepth = 8) const;
 
+signals:
+	// bytes of JSON parsed so far, buffers loaded and images decoded
+	void progressChanged ( qint64 bytesParsed, qint32 buffersLoaded, qint32 imagesDecoded );
+	void bufferReady ( qint32 buffer );
+	void imageReady ( qint32 image );
+	void loadFinished ();
+	void loadFailed ( const QString& error );
+	void loadCanceled ();
+
 private:
-	QJsonDocument m_document;
+	bool mapFile ( const QString& filename );
+	bool parseJson ( QByteArrayView json, const QString& filename );
+	static bool hasGLTFExtension ( const QString& filename );
+	bool openFile ( const QString& filename );
+	bool openGLB ( const QString& filename );
+	void startResources ( const QString& filename );
+	void submitTask ( std::function<void ()> task );
+	// called once per finished resource (and once for the JSON), the last call posts the outcome
+	void completeResource ();
+	// emits the outcome of load on the loader's thread unless clear() ran since
+	void emitOutcome ( quint32 load );
+	void setError ( const QString& error );
+	void emitProgress ();
+	QString resolveUri ( const QString& uri ) const;
+	bool resolveBinChunk ( qsizetype index );
+	// pool tasks
+	void loadBuffer ( qint32 index );
+	bool readExternalBuffer ( qsizetype index );
+	bool decodeDataUri ( qsizetype index );
+	void decodeImage ( qint32 index );
+	const QJsonDocument& jsonDocument () const;
+	// asset cache
+	bool openCacheEntry ( const QString& filename, QByteArrayView json );
+	void storeInCache ();
+	const jcqt::CachedAccessor* cachedAccessor ( qint32 accessor ) const;
+	bool readCachedAccessor ( qint32 accessor, QList<float>& out ) const;
+	bool readCachedIndices ( qint32 accessor, QList<quint32>& out ) const;
+
+	jcqt::gltf::Document m_gltf;
+
+	// JSON text of the loaded file (the whole .gltf or the GLB JSON chunk) and the DOM built from it on demand
+	QByteArrayView m_json;
+	mutable QJsonDocument m_document;
+	mutable bool m_documentParsed = false;
+
+	// file backing the loaded document, either memory mapped or (as a fallback) read into m_fileData
+	QFile m_file;
+	uchar* m_mappedData = nullptr;
+	QByteArray m_fileData;
+	QByteArrayView m_fileView;
+
+	// BIN chunk of a .glb file
+	QByteArrayView m_binChunk;
+
+	// resolved storage for each entry of the 'buffers' array
+	QList<QByteArrayView> m_buffers;
+	// decoded bytes of buffers given as base64 data: URIs (or external files that could not be mapped), empty for every other buffer
+	QList<QByteArray> m_bufferStorage;
+	// external .bin files, mapped by the buffer tasks
+	std::vector<std::unique_ptr<QFile>> m_externalFiles;
+	QList<QImage> m_images;
+	// images stored in a bufferView, decoded once that buffer's task is done
+	QList<QList<qint32>> m_imagesForBuffer;
+
+	// the pool tasks only write the slots of their own buffer or image, publishing them through these flags
+	enum ResourceStatus : quint8
+	{
+		kPending,
+		kReady,
+		kFailed
+	};
+	std::unique_ptr<std::atomic<quint8>[]> m_bufferStatus;
+	std::unique_ptr<std::atomic<quint8>[]> m_imageStatus;
+	// resources not finished yet (plus one for the JSON while it is parsed) and pool tasks still referencing this loader
+	std::atomic<qint32> m_outstanding { 0 };
+	std::atomic<qint32> m_activeTasks { 0 };
+	std::atomic<bool> m_resourceFailed { false };
+	std::atomic<bool> m_canceled { false };
+	// bumped by clear(), tells a posted outcome whether its load is still the current one
+	std::atomic<quint32> m_loadId { 0 };
+	std::atomic<qint64> m_bytesParsed { 0 };
+	std::atomic<qint32> m_buffersLoaded { 0 };
+	std::atomic<qint32> m_imagesDecoded { 0 };
+	mutable QMutex m_errorMutex;
+	QString m_errorString;
+	// directory relative URIs are resolved against
+	QString m_baseDir;
+
+	// on a cache hit the entry stays mapped, the converted accessors are read from m_cachedAccessorData inside it
+	jcqt::AssetCache* m_cache = nullptr;
+	std::unique_ptr<jcqt::SceneFile> m_cacheEntry;
+	QList<jcqt::CachedAccessor> m_cachedAccessors;
+	QByteArrayView m_cachedAccessorData;
+	quint64 m_cacheKey = 0;
+	bool m_fromCache = false;
 };
 
 
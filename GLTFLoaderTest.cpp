@@ -28,7 +28,119 @@ SOFTWARE.
  *********************************************************************/
 
 #include <QTest>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QVector3D>
+#include <QVector4D>
+#include <QQuaternion>
+#include <QColor>
+#include <QImage>
+#include <QTemporaryDir>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include "GLTFLoader.h"
+#include "GLTFDocument.h"
+#include "Base64.h"
+#include "AccessorView.h"
+#include "AccessorConvert.h"
+#include "WorkStealingPool.h"
+#include "GLTFScene.h"
+#include "GLTFSceneBuilder.h"
+#include "SceneFile.h"
+#include "SceneTraversal.h"
+#include "TransformSnapshots.h"
+#include "SceneGenerator.h"
+#include "Trace.h"
+#include "Hash.h"
+#include "AssetCache.h"
+#include "vec4.h"
+#include "ReferenceImplementations.h"
+
+#include <numeric>
+#include <thread>
+
+// Random tree of count nodes below a single root, no deeper than maxLevel, with random translations as local transforms
+static void makeRandomScene ( jcqt::Scene& scene, qint32 count, quint32 seed, qint32 maxLevel = jcqt::MAX_NODE_LEVEL - 1 )
+{
+	QRandomGenerator rng ( seed );
+	scene = jcqt::Scene ();
+	jcqt::addNode ( scene, -1, 0 );
+	for ( qint32 i = 1; i < count; i++ )
+	{
+		qint32 parent = qint32 ( rng.bounded ( i ) );
+		while ( scene.hierarchy_ [ parent ].level_ >= maxLevel )
+			parent = scene.hierarchy_ [ parent ].parent_;
+		jcqt::addNode ( scene, parent, scene.hierarchy_ [ parent ].level_ + 1 );
+	}
+
+	for ( jcqt::gpumat4& m : scene.localTransforms_ )
+	{
+		QMatrix4x4 t;
+		t.translate ( float ( rng.generateDouble () ), float ( rng.generateDouble () ), float ( rng.generateDouble () ) );
+		m = jcqt::gpumat4 ( t );
+	}
+	scene.globalTransforms_ = scene.localTransforms_;
+}
+
+// Random unit quaternion (x, y, z, w)
+static jcqt::gpuvec4 randomRotation ( QRandomGenerator& rng )
+{
+	QVector4D q ( float ( rng.generateDouble () * 2.0 - 1.0 ), float ( rng.generateDouble () * 2.0 - 1.0 ),
+		float ( rng.generateDouble () * 2.0 - 1.0 ), float ( rng.generateDouble () * 2.0 - 1.0 ) );
+	return jcqt::gpuvec4 ( q.normalized () );
+}
+
+static bool mat4FuzzyCompare ( const jcqt::gpumat4& a, const jcqt::gpumat4& b, float tolerance = 1e-4f )
+{
+	for ( int k = 0; k < 16; k++ )
+	{
+		if ( qAbs ( a.data_ [ k ] - b.data_ [ k ] ) > tolerance )
+			return false;
+	}
+	return true;
+}
+
+// The split TRS arrays cover every node and each local transform is what its TRS composes to
+static bool splitTRSConsistent ( const jcqt::Scene& scene )
+{
+	const qsizetype count = scene.hierarchy_.size ();
+	if ( !scene.splitTRS_ || scene.translations_.size () != count || scene.rotations_.size () != count || scene.scales_.size () != count )
+		return false;
+
+	for ( qsizetype i = 0; i < count; i++ )
+	{
+		jcqt::gpumat4 m;
+		jcqt::composeTRS ( scene.translations_ [ i ], scene.rotations_ [ i ], scene.scales_ [ i ], m );
+		if ( !mat4FuzzyCompare ( m, scene.localTransforms_ [ i ] ) )
+			return false;
+	}
+	return true;
+}
+
+// Same hierarchy, components and names, transforms equal up to tolerance
+static bool sameScene ( const jcqt::Scene& a, const jcqt::Scene& b, float tolerance = 1e-4f )
+{
+	const qsizetype count = a.hierarchy_.size ();
+	if ( b.hierarchy_.size () != count || memcmp ( a.hierarchy_.constData (), b.hierarchy_.constData (), count * sizeof ( jcqt::Hierarchy ) ) != 0 )
+		return false;
+	if ( a.materialNames_ != b.materialNames_ )
+		return false;
+
+	for ( qint32 i = 0; i < count; i++ )
+	{
+		if ( a.meshes_.value ( i ) != b.meshes_.value ( i ) || a.materialForNode_.value ( i ) != b.materialForNode_.value ( i ) ||
+			jcqt::getNodeName ( a, i ) != jcqt::getNodeName ( b, i ) )
+			return false;
+		if ( !mat4FuzzyCompare ( a.localTransforms_ [ i ], b.localTransforms_ [ i ], tolerance ) ||
+			!mat4FuzzyCompare ( a.globalTransforms_ [ i ], b.globalTransforms_ [ i ], tolerance ) )
+			return false;
+	}
+	return true;
+}
 
 class GLTFLoaderTest : public QObject
 {
@@ -57,6 +169,2044 @@ private slots:
 		QVERIFY ( loadSuccess );
 	}
 
+	void testLoadGLB ()
+	{
+		QString testFilename = ":/test/test.glb";
+		GLTFLoader loader;
+		bool loadSuccess = loader.loadGLTF ( testFilename );
+		QVERIFY ( loadSuccess );
+		QVERIFY ( loader.isBinary () );
+		QVERIFY ( loader.isJsonObject () );
+
+		// the BIN chunk is padded to 4 bytes, the buffer covers exactly byteLength bytes of it
+		QCOMPARE ( loader.binaryChunk ().size (), qsizetype ( 44 ) );
+		QCOMPARE ( loader.bufferData ( 0 ).size (), qsizetype ( 44 ) );
+		QVERIFY ( loader.bufferData ( 0 ).data () == loader.binaryChunk ().data () );
+
+		// bufferView 0 holds the three unsigned short indices 0, 1, 2
+		QByteArrayView indices = loader.bufferViewData ( 0 );
+		QCOMPARE ( indices.size (), qsizetype ( 6 ) );
+		const quint16* idx = reinterpret_cast< const quint16* >( indices.data () );
+		QCOMPARE ( idx [ 0 ], quint16 ( 0 ) );
+		QCOMPARE ( idx [ 1 ], quint16 ( 1 ) );
+		QCOMPARE ( idx [ 2 ], quint16 ( 2 ) );
+
+		// bufferView 1 starts 8 bytes into the BIN chunk
+		QByteArrayView positions = loader.bufferViewData ( 1 );
+		QCOMPARE ( positions.size (), qsizetype ( 36 ) );
+		QVERIFY ( positions.data () == loader.binaryChunk ().data () + 8 );
+
+		QVERIFY ( loader.bufferViewData ( 2 ).isEmpty () );
+	}
+
+	void testDataUriBuffer ()
+	{
+		GLTFLoader loader;
+		QVERIFY ( loader.loadGLTF ( ":/test/test.gltf" ) );
+		QVERIFY ( !loader.isBinary () );
+
+		// the parser keeps only the data URI header, the payload is decoded straight into the loader's buffer storage
+		const jcqt::gltf::Buffer& buffer = loader.document ().buffers_ [ 0 ];
+		QCOMPARE ( buffer.uri_, QString ( "data:application/octet-stream;base64," ) );
+		QCOMPARE ( buffer.dataPayload ().size (), qsizetype ( 60 ) );
+		QCOMPARE ( loader.bufferData ( 0 ).size (), qsizetype ( 44 ) );
+
+		QByteArrayView indices = loader.bufferViewData ( 0 );
+		QCOMPARE ( indices.size (), qsizetype ( 6 ) );
+		const quint16* idx = reinterpret_cast< const quint16* >( indices.data () );
+		QCOMPARE ( idx [ 0 ], quint16 ( 0 ) );
+		QCOMPARE ( idx [ 1 ], quint16 ( 1 ) );
+		QCOMPARE ( idx [ 2 ], quint16 ( 2 ) );
+
+		// same bytes as the BIN chunk of the equivalent GLB
+		GLTFLoader glb;
+		QVERIFY ( glb.loadGLTF ( ":/test/test.glb" ) );
+		QVERIFY ( loader.bufferData ( 0 ) == glb.bufferData ( 0 ) );
+	}
+
+	void testWorkStealingPool ()
+	{
+		jcqt::WorkStealingPool pool ( 4 );
+		QCOMPARE ( pool.threadCount (), 4 );
+
+		// tasks that fan out from inside the pool end up on the submitting worker's deque and get stolen from there
+		std::atomic<int> counter { 0 };
+		for ( int i = 0; i < 64; i++ )
+		{
+			pool.submit ( [&pool, &counter] () {
+				for ( int j = 0; j < 100; j++ )
+				{
+					pool.submit ( [&counter] () { counter++; } );
+				}
+				counter++;
+			} );
+		}
+		pool.waitForDone ();
+		QCOMPARE ( counter.load (), 64 * 101 );
+
+		// waiting from inside a task helps instead of blocking a worker
+		std::atomic<bool> innerDone { false };
+		pool.submit ( [&pool, &innerDone] () {
+			std::atomic<bool> flag { false };
+			pool.submit ( [&flag] () { flag = true; } );
+			pool.waitUntil ( [&flag] () { return flag.load (); } );
+			innerDone = true;
+		} );
+		pool.waitForDone ();
+		QVERIFY ( innerDone.load () );
+	}
+
+	void testExternalResources ()
+	{
+		GLTFLoader loader;
+		QVERIFY ( loader.loadGLTF ( ":/test/test_external.gltf" ) );
+		QVERIFY ( !loader.isBinary () );
+
+		// test.bin holds the same geometry as test.glb, followed by a PNG referenced through bufferView 2
+		QVERIFY ( loader.isBufferReady ( 0 ) );
+		QVERIFY ( loader.waitForBuffer ( 0 ) );
+		QCOMPARE ( loader.bufferData ( 0 ).size (), qsizetype ( 121 ) );
+		QList<quint32> indices;
+		QVERIFY ( loader.readIndices ( 0, indices ) );
+		QCOMPARE ( indices, QList<quint32> ( { 0, 1, 2 } ) );
+
+		// external file, data: URI and bufferView images
+		QCOMPARE ( loader.image ( 0 ).size (), QSize ( 2, 2 ) );
+		QCOMPARE ( loader.image ( 0 ).pixelColor ( 1, 1 ), QColor ( Qt::red ) );
+		QCOMPARE ( loader.image ( 1 ).size (), QSize ( 4, 2 ) );
+		QCOMPARE ( loader.image ( 1 ).pixelColor ( 3, 0 ), QColor ( Qt::green ) );
+		QCOMPARE ( loader.image ( 2 ).size (), QSize ( 1, 3 ) );
+		QCOMPARE ( loader.image ( 2 ).pixelColor ( 0, 2 ), QColor ( Qt::blue ) );
+		QVERIFY ( loader.image ( 3 ).isNull () );
+
+		// reloading waits for and releases everything of the previous file
+		QVERIFY ( loader.loadGLTF ( ":/test/test.gltf" ) );
+		QVERIFY ( loader.image ( 0 ).isNull () );
+		QCOMPARE ( loader.bufferData ( 0 ).size (), qsizetype ( 44 ) );
+	}
+
+	void testLoadAsync ()
+	{
+		GLTFLoader loader;
+
+		// the test object lives in the main thread, so these connections are queued from the pool threads
+		int finished = 0;
+		int failed = 0;
+		int buffersReady = 0;
+		int imagesReady = 0;
+		qint64 bytesParsed = 0;
+		connect ( &loader, &GLTFLoader::loadFinished, this, [&finished] () { finished++; } );
+		connect ( &loader, &GLTFLoader::loadFailed, this, [&failed] ( const QString& ) { failed++; } );
+		connect ( &loader, &GLTFLoader::bufferReady, this, [&buffersReady] ( qint32 ) { buffersReady++; } );
+		connect ( &loader, &GLTFLoader::imageReady, this, [&imagesReady] ( qint32 ) { imagesReady++; } );
+		connect ( &loader, &GLTFLoader::progressChanged, this, [&bytesParsed] ( qint64 bytes, qint32, qint32 ) { bytesParsed = qMax ( bytesParsed, bytes ); } );
+
+		QVERIFY ( loader.loadGLTFAsync ( ":/test/test_external.gltf" ) );
+		QTRY_COMPARE ( finished, 1 );
+		QVERIFY ( !loader.isLoading () );
+		QCOMPARE ( failed, 0 );
+		QCOMPARE ( buffersReady, 1 );
+		QCOMPARE ( imagesReady, 3 );
+		QVERIFY ( bytesParsed > 0 );
+		QCOMPARE ( loader.image ( 2 ).size (), QSize ( 1, 3 ) );
+
+		QVERIFY ( !loader.loadGLTFAsync ( ":/test/test.txt" ) );
+		QVERIFY ( loader.loadGLTFAsync ( ":/test/missing.gltf" ) );
+		QVERIFY ( !loader.waitForFinished () );
+		QVERIFY ( !loader.errorString ().isEmpty () );
+		QTRY_COMPARE ( failed, 1 );
+
+		// the outcome arrives after the last task retired, a direct receiver may clear() the loader
+		bool loadingInReceiver = true;
+		connect ( &loader, &GLTFLoader::loadFinished, &loader, [&loader, &loadingInReceiver] () {
+			loadingInReceiver = loader.isLoading ();
+			loader.clear ();
+		}, Qt::DirectConnection );
+		QVERIFY ( loader.loadGLTFAsync ( ":/test/test.gltf" ) );
+		QTRY_COMPARE ( finished, 2 );
+		QVERIFY ( !loadingInReceiver );
+		QVERIFY ( loader.document ().meshes_.isEmpty () );
+	}
+
+	void testCancelLoad ()
+	{
+		// a few large data: URI buffers, enough JSON for several progress checkpoints
+		QTemporaryDir dir;
+		QVERIFY ( dir.isValid () );
+		const QString filename = dir.filePath ( "large.gltf" );
+		{
+			QFile file ( filename );
+			QVERIFY ( file.open ( QIODevice::WriteOnly ) );
+			const QByteArray payload = QByteArray ( 16 << 20, '\x5a' ).toBase64 ();
+			file.write ( "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[" );
+			for ( int i = 0; i < 4; i++ )
+			{
+				file.write ( i > 0 ? ",{\"byteLength\":16777216,\"uri\":\"data:application/octet-stream;base64," : "{\"byteLength\":16777216,\"uri\":\"data:application/octet-stream;base64," );
+				file.write ( payload );
+				file.write ( "\"}" );
+			}
+			file.write ( "]}" );
+		}
+
+		GLTFLoader loader;
+		int finished = 0;
+		int canceled = 0;
+		connect ( &loader, &GLTFLoader::loadFinished, this, [&finished] () { finished++; } );
+		connect ( &loader, &GLTFLoader::loadCanceled, this, [&canceled] () { canceled++; } );
+
+		// cancel from the first progress report, deterministically in the middle of parsing
+		connect ( &loader, &GLTFLoader::progressChanged, &loader, [&loader] () { loader.cancel (); }, Qt::DirectConnection );
+
+		QVERIFY ( loader.loadGLTFAsync ( filename ) );
+		QVERIFY ( !loader.waitForFinished () );
+		QTRY_COMPARE ( canceled, 1 );
+		QCOMPARE ( finished, 0 );
+		QVERIFY ( !loader.isBufferReady ( 0 ) );
+		QVERIFY ( loader.errorString ().isEmpty () );
+
+		// the same file loads fine without the cancel
+		disconnect ( &loader, &GLTFLoader::progressChanged, &loader, nullptr );
+		QVERIFY ( loader.loadGLTF ( filename ) );
+		QCOMPARE ( loader.bufferData ( 3 ).size (), qsizetype ( 16 << 20 ) );
+		QCOMPARE ( loader.bufferData ( 3 ) [ 12345 ], '\x5a' );
+	}
+
+	void testAccessorView ()
+	{
+		GLTFLoader loader;
+		QVERIFY ( loader.loadGLTF ( ":/test/test.glb" ) );
+
+		// tightly packed indices collapse to a span over the BIN chunk
+		jcqt::AccessorView<quint16> indices = loader.accessorView<quint16> ( 0 );
+		QCOMPARE ( indices.size (), qsizetype ( 3 ) );
+		QVERIFY ( indices.isContiguous () );
+		QCOMPARE ( indices.span ().size (), size_t ( 3 ) );
+		QVERIFY ( reinterpret_cast<const char*>( indices.span ().data () ) == loader.binaryChunk ().data () );
+		QCOMPARE ( indices.toList (), QList<quint16> ( { 0, 1, 2 } ) );
+
+		jcqt::AccessorView<QVector3D> positions = loader.accessorView<QVector3D> ( 1 );
+		QCOMPARE ( positions.size (), qsizetype ( 3 ) );
+		QCOMPARE ( positions [ 1 ], QVector3D ( 1.f, 0.f, 0.f ) );
+		QCOMPARE ( positions [ 2 ], QVector3D ( 0.f, 1.f, 0.f ) );
+
+		// element size mismatches and invalid indices give empty views
+		QVERIFY ( loader.accessorView<quint32> ( 0 ).isEmpty () );
+		QVERIFY ( loader.accessorView<quint16> ( 7 ).isEmpty () );
+
+		// interleaved position (vec4) + uv (vec2) vertices, 24 bytes apart
+		struct Vertex
+		{
+			float pos [ 4 ];
+			float uv [ 2 ];
+		};
+		Vertex vertices [ 5 ];
+		for ( int i = 0; i < 5; i++ )
+		{
+			vertices [ i ] = { { float ( i ), 2.f * i, 3.f * i, 1.f }, { 0.5f, 0.25f } };
+		}
+
+		jcqt::AccessorView<jcqt::gpuvec4> interleaved ( reinterpret_cast<const uchar*>( vertices ), 5, qsizetype ( sizeof ( Vertex ) ) );
+		QVERIFY ( !interleaved.isContiguous () );
+		QVERIFY ( interleaved.span ().empty () );
+
+		int i = 0;
+		for ( const jcqt::gpuvec4 v : interleaved )
+		{
+			QCOMPARE ( v.y, 2.f * i );
+			QCOMPARE ( v.w, 1.f );
+			i++;
+		}
+		QCOMPARE ( i, 5 );
+
+		jcqt::gpuvec4 packed [ 5 ];
+		interleaved.copyTo ( packed );
+		QCOMPARE ( packed [ 4 ].z, 12.f );
+	}
+
+	void testAccessorConvert ()
+	{
+		using jcqt::gltf::AccessorType;
+		const qsizetype count = 37;
+
+		for ( quint32 componentType : kComponentTypes )
+		{
+			for ( int t = int ( AccessorType::Scalar ); t <= int ( AccessorType::Mat4 ); t++ )
+			{
+				const AccessorType type = AccessorType ( t );
+				const qsizetype elementSize = jcqt::gltf::elementSize ( type, componentType );
+				const qsizetype components = jcqt::gltf::componentCount ( type );
+
+				for ( bool normalized : { false, true } )
+				{
+					// tightly packed and interleaved with 4 bytes of other data after each element
+					for ( qsizetype stride : { elementSize, elementSize + 4 } )
+					{
+						const QByteArray bytes = makeAccessorBytes ( componentType, count, stride, componentType * 16 + t );
+						const jcqt::AccessorData src { reinterpret_cast<const uchar*>( bytes.constData () ), count, stride, elementSize };
+						const QByteArray label = QByteArray::number ( componentType ) + ' ' + kTypeNames [ t ] + ( normalized ? " normalized" : "" ) + " stride " + QByteArray::number ( stride );
+
+						QList<float> expected ( count * components );
+						referenceConvertToFloat ( src, componentType, type, normalized, expected.data () );
+
+						const jcqt::FloatConverter toFloat = jcqt::floatConverter ( componentType, type, normalized );
+						QVERIFY2 ( toFloat, label.constData () );
+						QList<float> actual ( count * components );
+						toFloat ( src, actual.data () );
+						QVERIFY2 ( actual == expected, label.constData () );
+
+						const jcqt::Vec4Converter toVec4 = jcqt::vec4Converter ( componentType, type, normalized );
+						QCOMPARE ( toVec4 != nullptr, type <= AccessorType::Vec4 );
+						if ( toVec4 )
+						{
+							QList<jcqt::gpuvec4> vec ( count );
+							toVec4 ( src, vec.data () );
+							for ( qsizetype i = 0; i < count; i++ )
+							{
+								const float padded [ 4 ] = {
+									expected [ i * components ],
+									components > 1 ? expected [ i * components + 1 ] : 0.f,
+									components > 2 ? expected [ i * components + 2 ] : 0.f,
+									components > 3 ? expected [ i * components + 3 ] : 1.f };
+								QVERIFY2 ( memcmp ( &vec [ i ], padded, sizeof ( padded ) ) == 0, label.constData () );
+							}
+						}
+
+						const jcqt::IndexConverter toIndices = jcqt::indexConverter ( componentType );
+						if ( toIndices && type == AccessorType::Scalar && !normalized )
+						{
+							QList<quint32> indices ( count );
+							toIndices ( src, indices.data () );
+							for ( qsizetype i = 0; i < count; i++ )
+								QCOMPARE ( float ( indices [ i ] ), expected [ i ] );
+						}
+					}
+				}
+			}
+		}
+
+		QVERIFY ( !jcqt::floatConverter ( 5124, AccessorType::Vec3, false ) );
+		QVERIFY ( !jcqt::indexConverter ( jcqt::gltf::kFloat ) );
+
+		GLTFLoader loader;
+		QVERIFY ( loader.loadGLTF ( ":/test/test.glb" ) );
+		QList<quint32> indices;
+		QVERIFY ( loader.readIndices ( 0, indices ) );
+		QCOMPARE ( indices, QList<quint32> ( { 0, 1, 2 } ) );
+		QList<jcqt::gpuvec4> positions;
+		QVERIFY ( loader.readAccessor ( 1, positions ) );
+		QCOMPARE ( positions.size (), qsizetype ( 3 ) );
+		QCOMPARE ( positions [ 1 ].x, 1.f );
+		QCOMPARE ( positions [ 2 ].w, 1.f );
+	}
+
+	void testBase64Decode ()
+	{
+		QRandomGenerator rng ( 1234 );
+
+		// sizes around the 16 and 32 byte SIMD block boundaries as well as larger random ones
+		for ( qsizetype size = 0; size < 300; size++ )
+		{
+			QByteArray raw ( size, Qt::Uninitialized );
+			for ( char& c : raw )
+				c = char ( rng.bounded ( 256 ) );
+
+			const QByteArray encoded = raw.toBase64 ();
+			const qsizetype decodedSize = jcqt::base64DecodedSize ( encoded );
+			QCOMPARE ( decodedSize, size );
+
+			QByteArray decoded ( decodedSize, Qt::Uninitialized );
+			QCOMPARE ( jcqt::base64Decode ( encoded, reinterpret_cast<uchar*>( decoded.data () ) ), size );
+			QCOMPARE ( decoded, raw );
+
+			// glTF exporters sometimes leave out the padding
+			QByteArray unpadded = encoded;
+			while ( unpadded.endsWith ( '=' ) )
+				unpadded.chop ( 1 );
+			QCOMPARE ( jcqt::base64DecodedSize ( unpadded ), size );
+			QCOMPARE ( jcqt::base64Decode ( unpadded, reinterpret_cast<uchar*>( decoded.data () ) ), size );
+			QCOMPARE ( decoded, raw );
+
+			// a single invalid character anywhere must be rejected, including inside a SIMD block
+			if ( !encoded.isEmpty () )
+			{
+				QByteArray invalid = encoded;
+				invalid [ rng.bounded ( int ( unpadded.size () ) ) ] = '*';
+				QCOMPARE ( jcqt::base64Decode ( invalid, reinterpret_cast<uchar*>( decoded.data () ) ), qsizetype ( -1 ) );
+			}
+		}
+
+		uchar out [ 4 ];
+		QCOMPARE ( jcqt::base64DecodedSize ( "abcde" ), qsizetype ( -1 ) );
+		QCOMPARE ( jcqt::base64Decode ( "ab=c", out ), qsizetype ( -1 ) );
+	}
+
+	void testParseDocument ()
+	{
+		GLTFLoader loader;
+		QVERIFY ( loader.loadGLTF ( ":/test/test.gltf" ) );
+
+		const jcqt::gltf::Document& doc = loader.document ();
+		QCOMPARE ( doc.version_, QString ( "2.0" ) );
+		QCOMPARE ( doc.scene_, 0 );
+		QCOMPARE ( doc.scenes_.size (), qsizetype ( 1 ) );
+		QCOMPARE ( doc.nodes_.size (), qsizetype ( 1 ) );
+		QCOMPARE ( doc.nodes_ [ 0 ].mesh_, 0 );
+		QCOMPARE ( doc.meshes_.size (), qsizetype ( 1 ) );
+		QCOMPARE ( doc.meshes_ [ 0 ].primitives_.size (), qsizetype ( 1 ) );
+		QCOMPARE ( doc.meshes_ [ 0 ].primitives_ [ 0 ].attribute ( "POSITION" ), 1 );
+		QCOMPARE ( doc.meshes_ [ 0 ].primitives_ [ 0 ].indices_, 0 );
+		QCOMPARE ( doc.buffers_.size (), qsizetype ( 1 ) );
+		QCOMPARE ( doc.buffers_ [ 0 ].byteLength_, qint64 ( 44 ) );
+		QVERIFY ( doc.buffers_ [ 0 ].uri_.startsWith ( "data:application/octet-stream;base64," ) );
+		QCOMPARE ( doc.bufferViews_.size (), qsizetype ( 2 ) );
+		QCOMPARE ( doc.bufferViews_ [ 1 ].byteOffset_, qint64 ( 8 ) );
+		QCOMPARE ( doc.bufferViews_ [ 1 ].target_, 34962 );
+		QCOMPARE ( doc.accessors_.size (), qsizetype ( 2 ) );
+		QCOMPARE ( doc.accessors_ [ 0 ].componentType_, quint32 ( jcqt::gltf::kUnsignedShort ) );
+		QVERIFY ( doc.accessors_ [ 1 ].type_ == jcqt::gltf::AccessorType::Vec3 );
+		QCOMPARE ( doc.accessors_ [ 1 ].max_, QList<double> ( { 1.0, 1.0, 0.0 } ) );
+
+		// escapes, unknown subtrees and nested TRS arrays
+		jcqt::gltf::Document large;
+		QString error;
+		QVERIFY2 ( jcqt::gltf::parseDocument ( makeLargeGLTFJson ( 7 ), large, &error ), qPrintable ( error ) );
+		QCOMPARE ( large.nodes_.size (), qsizetype ( 7 ) );
+		QCOMPARE ( large.nodes_ [ 2 ].children_, QList<qint32> ( { 5, 6 } ) );
+		QCOMPARE ( large.nodes_ [ 3 ].translation_ [ 0 ], 1.5f );
+		QCOMPARE ( large.nodes_ [ 3 ].name_, QString ( "node_3" ) );
+		QCOMPARE ( large.accessors_.size (), qsizetype ( 14 ) );
+		QCOMPARE ( large.materials_ [ 3 ].baseColorFactor_ [ 2 ], 0.25f );
+		QCOMPARE ( large.materials_ [ 3 ].roughnessFactor_, 0.9f );
+
+		jcqt::gltf::Document escaped;
+		QVERIFY ( jcqt::gltf::parseDocument ( "{\"nodes\":[{\"name\":\"a\\\"b\\u00e9\"}]}", escaped ) );
+		QCOMPARE ( escaped.nodes_ [ 0 ].name_, QString::fromUtf8 ( "a\"b\xc3\xa9" ) );
+
+		jcqt::gltf::Document broken;
+		QVERIFY ( !jcqt::gltf::parseDocument ( "{\"nodes\":[{\"mesh\":1,}]}", broken, &error ) );
+		qDebug () << "Expected parse failure: " << error;
+
+		// numbers outside the JSON grammar fail, out of range indices are invalid instead of wrapping around
+		for ( const char* json : { "{\"scene\":.5}", "{\"scene\":01.5}", "{\"scene\":1.}", "{\"scene\":-}", "{\"scene\":1e}", "{\"scene\":+1}" } )
+			QVERIFY2 ( !jcqt::gltf::parseDocument ( json, broken ), json );
+		jcqt::gltf::Document huge;
+		QVERIFY ( jcqt::gltf::parseDocument ( "{\"nodes\":[{\"mesh\":1e20,\"camera\":-3e9,\"skin\":2.5e2}],\"buffers\":[{\"byteLength\":1e300}]}", huge ) );
+		QCOMPARE ( huge.nodes_ [ 0 ].mesh_, -1 );
+		QCOMPARE ( huge.nodes_ [ 0 ].camera_, -1 );
+		QCOMPARE ( huge.nodes_ [ 0 ].skin_, 250 );
+		QCOMPARE ( huge.buffers_ [ 0 ].byteLength_, qint64 ( -1 ) );
+	}
+
+	void testBuildScene ()
+	{
+		// two scene roots, TRS and matrix nodes, a mesh with a material
+		const QByteArray json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"name\":\"main\",\"nodes\":[0,4]}],\"nodes\":["
+			"{\"name\":\"a\",\"translation\":[1,2,3],\"children\":[1,2]},"
+			"{\"name\":\"b\",\"scale\":[2,2,2],\"mesh\":0},"
+			"{\"matrix\":[1,0,0,0,0,1,0,0,0,0,1,0,0,0,5,1],\"children\":[3]},"
+			"{\"name\":\"d\",\"rotation\":[0,0,0.70710678,0.70710678],\"translation\":[1,0,0]},"
+			"{}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"material\":1}]}],"
+			"\"materials\":[{\"name\":\"m0\"},{\"name\":\"m1\"}]}";
+
+		jcqt::gltf::Document doc;
+		QVERIFY ( jcqt::gltf::parseDocument ( json, doc ) );
+
+		jcqt::Scene scene;
+		QVERIFY ( jcqt::buildScene ( doc, scene ) );
+		QVERIFY ( !jcqt::buildScene ( doc, scene, 3 ) );
+		QVERIFY ( jcqt::buildScene ( doc, scene, 0 ) );
+
+		// breadth-first: root, a, (node 4), b, (node 2), d
+		QCOMPARE ( scene.hierarchy_.size (), qsizetype ( 6 ) );
+		QCOMPARE ( scene.localTransforms_.size (), qsizetype ( 6 ) );
+		QCOMPARE ( scene.globalTransforms_.size (), qsizetype ( 6 ) );
+
+		QCOMPARE ( scene.hierarchy_ [ 0 ].firstChild_, 1 );
+		QCOMPARE ( scene.hierarchy_ [ 1 ].nextSibling_, 2 );
+		QCOMPARE ( scene.hierarchy_ [ 1 ].lastSibling_, 2 );
+		QCOMPARE ( scene.hierarchy_ [ 2 ].nextSibling_, -1 );
+		QCOMPARE ( scene.hierarchy_ [ 1 ].firstChild_, 3 );
+		QCOMPARE ( scene.hierarchy_ [ 3 ].nextSibling_, 4 );
+		QCOMPARE ( scene.hierarchy_ [ 4 ].firstChild_, 5 );
+		QCOMPARE ( scene.hierarchy_ [ 5 ].parent_, 4 );
+
+		const qint32 levels [] = { 0, 1, 1, 2, 2, 3 };
+		for ( qint32 i = 0; i < 6; i++ )
+			QCOMPARE ( scene.hierarchy_ [ i ].level_, levels [ i ] );
+
+		QCOMPARE ( jcqt::getNodeName ( scene, 0 ), QString ( "main" ) );
+		QCOMPARE ( jcqt::getNodeName ( scene, 5 ), QString ( "d" ) );
+		QVERIFY ( jcqt::getNodeName ( scene, 2 ).isEmpty () );
+		QCOMPARE ( jcqt::findNodeByName ( scene, "b" ), 3 );
+
+		QCOMPARE ( scene.meshes_.value ( 3, 99 ), 0 );
+		QCOMPARE ( scene.materialForNode_.value ( 3, 99 ), 1 );
+		QVERIFY ( !scene.meshes_.contains ( 1 ) );
+		QCOMPARE ( scene.materialNames_, QStringList ( { "m0", "m1" } ) );
+
+		// b: translated by a, scaled by itself
+		QCOMPARE ( scene.globalTransforms_ [ 3 ]( 0, 0 ), 2.f );
+		QCOMPARE ( scene.globalTransforms_ [ 3 ]( 3, 2 ), 3.f );
+
+		// d: a * matrix * T(1,0,0) * Rz(90)
+		const jcqt::gpumat4& d = scene.globalTransforms_ [ 5 ];
+		QCOMPARE ( d ( 3, 0 ), 2.f );
+		QCOMPARE ( d ( 3, 1 ), 2.f );
+		QCOMPARE ( d ( 3, 2 ), 8.f );
+		QVERIFY ( qAbs ( d ( 0, 1 ) - 1.f ) < 1e-5f );
+		QVERIFY ( qAbs ( d ( 1, 0 ) + 1.f ) < 1e-5f );
+		QVERIFY ( qAbs ( d ( 0, 0 ) ) < 1e-5f );
+	}
+
+	void testMat4Multiply ()
+	{
+		const QList<jcqt::gpumat4> a = makeRandomMatrices ( 64, 11 );
+		const QList<jcqt::gpumat4> b = makeRandomMatrices ( 64, 12 );
+		QList<qint32> parents ( 64 );
+		for ( qint32 i = 0; i < 64; i++ )
+			parents [ i ] = ( i * 7 ) % 64;
+
+		QList<jcqt::gpumat4> batch ( 64 );
+		QList<jcqt::gpumat4> indexed ( 64 );
+		jcqt::mat4MultiplyBatch ( a.constData (), b.constData (), batch.data (), 64 );
+		jcqt::mat4MultiplyIndexed ( a.constData (), parents.constData (), b.constData (), indexed.data (), 64 );
+
+		for ( qint32 i = 0; i < 64; i++ )
+		{
+			const jcqt::gpumat4 expected = multiplyQMatrix4x4 ( a [ i ], b [ i ] );
+			const jcqt::gpumat4 expectedIndexed = multiplyQMatrix4x4 ( a [ parents [ i ] ], b [ i ] );
+			const jcqt::gpumat4 product = a [ i ] * b [ i ];
+
+			// in place on either operand
+			jcqt::gpumat4 left = a [ i ];
+			jcqt::mat4Multiply ( left, b [ i ], left );
+			jcqt::gpumat4 right = b [ i ];
+			jcqt::mat4Multiply ( a [ i ], right, right );
+
+			for ( qint32 k = 0; k < 16; k++ )
+			{
+				QVERIFY ( qAbs ( product.data_ [ k ] - expected.data_ [ k ] ) < 1e-4f );
+				QVERIFY ( qAbs ( batch [ i ].data_ [ k ] - expected.data_ [ k ] ) < 1e-4f );
+				QVERIFY ( qAbs ( indexed [ i ].data_ [ k ] - expectedIndexed.data_ [ k ] ) < 1e-4f );
+				QCOMPARE ( left.data_ [ k ], product.data_ [ k ] );
+				QCOMPARE ( right.data_ [ k ], product.data_ [ k ] );
+			}
+		}
+
+		const QVector4D v ( 1.f, -2.f, 3.f, 1.f );
+		const jcqt::gpuvec4 t = jcqt::mat4Transform ( a [ 0 ], jcqt::gpuvec4 ( v ) );
+		const QVector4D expected = QMatrix4x4 ( a [ 0 ].data_ ).transposed () * v;
+		QVERIFY ( qAbs ( t.x - expected.x () ) < 1e-4f );
+		QVERIFY ( qAbs ( t.y - expected.y () ) < 1e-4f );
+		QVERIFY ( qAbs ( t.z - expected.z () ) < 1e-4f );
+		QVERIFY ( qAbs ( t.w - expected.w () ) < 1e-4f );
+	}
+
+	void testParallelGlobalTransforms ()
+	{
+		jcqt::Scene serial;
+		makeRandomScene ( serial, 20000, 31 );
+		jcqt::Scene parallel = serial;
+
+		jcqt::markAsChanged ( serial, 0 );
+		jcqt::recalculateGlobalTransforms ( serial );
+
+		// a low threshold so nearly every level is split across the pool
+		jcqt::markAsChanged ( parallel, 0 );
+		jcqt::recalculateGlobalTransformsParallel ( parallel, 64 );
+
+		QCOMPARE ( parallel.globalTransforms_.size (), serial.globalTransforms_.size () );
+		QVERIFY ( memcmp ( parallel.globalTransforms_.constData (), serial.globalTransforms_.constData (), serial.globalTransforms_.size () * sizeof ( jcqt::gpumat4 ) ) == 0 );
+		for ( const QList<qint32>& level : parallel.changedAtThisFrame_ )
+			QVERIFY ( level.isEmpty () );
+	}
+
+	void testMarkAsChanged ()
+	{
+		// a chain deeper than MAX_NODE_LEVEL, every node translated by one unit along x
+		jcqt::Scene chain;
+		QMatrix4x4 step;
+		step.translate ( 1.f, 0.f, 0.f );
+		for ( qint32 i = 0; i < 100; i++ )
+			jcqt::addNode ( chain, i - 1, i );
+		for ( jcqt::gpumat4& m : chain.localTransforms_ )
+			m = jcqt::gpumat4 ( step );
+
+		jcqt::markAsChanged ( chain, 0 );
+		QCOMPARE ( chain.changedAtThisFrame_.size (), qsizetype ( 100 ) );
+		jcqt::recalculateGlobalTransforms ( chain );
+		QCOMPARE ( chain.globalTransforms_ [ 99 ]( 3, 0 ), 100.f );
+		QCOMPARE ( chain.dirty_.count ( true ), qsizetype ( 0 ) );
+
+		// only a deep node changed, the levels above it have nothing queued
+		QMatrix4x4 lift;
+		lift.translate ( 0.f, 5.f, 0.f );
+		chain.localTransforms_ [ 50 ] = jcqt::gpumat4 ( lift );
+		jcqt::markAsChanged ( chain, 50 );
+		jcqt::recalculateGlobalTransforms ( chain );
+		QCOMPARE ( chain.globalTransforms_ [ 99 ]( 3, 0 ), 99.f );
+		QCOMPARE ( chain.globalTransforms_ [ 99 ]( 3, 1 ), 5.f );
+
+		// overlapping edits queue every node exactly once
+		jcqt::Scene scene;
+		makeRandomScene ( scene, 5000, 41 );
+		QRandomGenerator rng ( 42 );
+		for ( qint32 i = 0; i < 500; i++ )
+			jcqt::markAsChanged ( scene, qint32 ( rng.bounded ( 5000 ) ) );
+		jcqt::markAsChanged ( scene, 0 );
+		for ( qint32 i = 0; i < 500; i++ )
+			jcqt::markAsChanged ( scene, qint32 ( rng.bounded ( 5000 ) ) );
+
+		QBitArray seen ( 5000 );
+		qsizetype queued = 0;
+		for ( const QList<qint32>& level : scene.changedAtThisFrame_ )
+		{
+			for ( qint32 c : level )
+			{
+				QVERIFY ( !seen.testBit ( c ) );
+				seen.setBit ( c );
+				queued++;
+			}
+		}
+		QCOMPARE ( queued, qsizetype ( 5000 ) );
+
+		// a child added below a queued node is queued as well
+		const qint32 child = jcqt::addNode ( scene, 7, scene.hierarchy_ [ 7 ].level_ + 1 );
+		QVERIFY ( scene.dirty_.testBit ( child ) );
+		QVERIFY ( scene.changedAtThisFrame_ [ scene.hierarchy_ [ child ].level_ ].contains ( child ) );
+	}
+
+	void testReorderScene ()
+	{
+		jcqt::Scene scene;
+		makeRandomScene ( scene, 3000, 51 );
+		for ( qint32 i = 0; i < 3000; i += 3 )
+			scene.meshes_.insert ( i, i * 10 );
+		jcqt::markAsChanged ( scene, 0 );
+		jcqt::recalculateGlobalTransforms ( scene );
+
+		jcqt::Scene reordered = scene;
+		jcqt::markAsChanged ( reordered, 17 );
+		const QList<qint32> newIndices = jcqt::reorderSceneBreadthFirst ( reordered );
+		QCOMPARE ( newIndices.size (), qsizetype ( 3000 ) );
+		QVERIFY ( reordered.dirty_.testBit ( newIndices [ 17 ] ) );
+
+		for ( qint32 i = 0; i < 3000; i++ )
+		{
+			const jcqt::Hierarchy& h = reordered.hierarchy_ [ i ];
+			const qint32 oldParent = scene.hierarchy_ [ i ].parent_;
+
+			// levels never decrease, parents come first, siblings are adjacent
+			if ( i > 0 )
+				QVERIFY ( h.level_ >= reordered.hierarchy_ [ i - 1 ].level_ );
+			QVERIFY ( h.parent_ < i );
+			if ( h.nextSibling_ != -1 )
+				QCOMPARE ( h.nextSibling_, i + 1 );
+
+			QCOMPARE ( reordered.hierarchy_ [ newIndices [ i ] ].parent_, oldParent == -1 ? -1 : newIndices [ oldParent ] );
+			QCOMPARE ( reordered.meshes_.value ( newIndices [ i ], 99999 ), scene.meshes_.value ( i, 99999 ) );
+			QVERIFY ( memcmp ( &reordered.localTransforms_ [ newIndices [ i ] ], &scene.localTransforms_ [ i ], sizeof ( jcqt::gpumat4 ) ) == 0 );
+		}
+
+		// the linear sweep reproduces the per-level results
+		reordered.globalTransforms_.fill ( jcqt::gpumat4 ( QMatrix4x4 () ) );
+		jcqt::recalculateAllGlobalTransforms ( reordered );
+		QCOMPARE ( reordered.dirty_.count ( true ), qsizetype ( 0 ) );
+		for ( qint32 i = 0; i < 3000; i++ )
+			QVERIFY ( memcmp ( &reordered.globalTransforms_ [ newIndices [ i ] ], &scene.globalTransforms_ [ i ], sizeof ( jcqt::gpumat4 ) ) == 0 );
+	}
+
+	void testSceneFile ()
+	{
+		jcqt::Scene scene;
+		makeRandomScene ( scene, 1000, 61 );
+		for ( qint32 i = 0; i < 1000; i++ )
+		{
+			scene.meshes_.insert ( i, i / 2 );
+			if ( i % 3 == 0 )
+				scene.materialForNode_.insert ( i, i % 7 );
+			if ( i % 5 == 0 )
+				jcqt::setNodeName ( scene, i, QString ( "node_%1" ).arg ( i ) );
+		}
+		scene.materialNames_ = { "stone", QString::fromUtf8 ( "m\xc3\xa9tal" ) };
+		jcqt::markAsChanged ( scene, 0 );
+		jcqt::recalculateGlobalTransforms ( scene );
+
+		QTemporaryDir dir;
+		QVERIFY ( dir.isValid () );
+		const QString filename = dir.filePath ( "scene.bin" );
+		jcqt::saveScene ( filename, scene );
+		QVERIFY ( jcqt::SceneFile::isSceneFile ( filename ) );
+
+		// in place: the arrays point into the mapping
+		jcqt::SceneFile file;
+		QVERIFY ( file.open ( filename, true ) );
+		QVERIFY ( file.hasChecksums () );
+		QCOMPARE ( file.nodeCount (), 1000 );
+		QVERIFY ( quintptr ( file.localTransforms () ) % quintptr ( jcqt::SCENE_FILE_ALIGNMENT ) == 0 );
+		QVERIFY ( memcmp ( file.globalTransforms (), scene.globalTransforms_.constData (), 1000 * sizeof ( jcqt::gpumat4 ) ) == 0 );
+		QVERIFY ( memcmp ( file.hierarchy (), scene.hierarchy_.constData (), 1000 * sizeof ( jcqt::Hierarchy ) ) == 0 );
+		file.close ();
+
+		jcqt::Scene loaded;
+		jcqt::loadScene ( filename, loaded );
+		QCOMPARE ( loaded.hierarchy_.size (), qsizetype ( 1000 ) );
+		QVERIFY ( memcmp ( loaded.localTransforms_.constData (), scene.localTransforms_.constData (), 1000 * sizeof ( jcqt::gpumat4 ) ) == 0 );
+		QCOMPARE ( loaded.meshes_, scene.meshes_ );
+		QCOMPARE ( loaded.materialForNode_, scene.materialForNode_ );
+		QCOMPARE ( loaded.nameForNode_, scene.nameForNode_ );
+		QCOMPARE ( loaded.names_, scene.names_ );
+		QCOMPARE ( loaded.materialNames_, scene.materialNames_ );
+		QCOMPARE ( jcqt::findNodeByName ( loaded, "node_35" ), 35 );
+
+		// a flipped byte is caught by the checksums, but only when asked to verify them
+		{
+			QFile f ( filename );
+			QVERIFY ( f.open ( QIODevice::ReadWrite ) );
+			QVERIFY ( f.seek ( f.size () / 2 ) );
+			char c = 0;
+			QVERIFY ( f.getChar ( &c ) );
+			QVERIFY ( f.seek ( f.size () / 2 ) );
+			QVERIFY ( f.putChar ( char ( c ^ 0x40 ) ) );
+		}
+		QVERIFY ( file.open ( filename, false ) );
+		QVERIFY ( !file.open ( filename, true ) );
+		file.close ();
+
+		// without checksums bad values are caught by range checks: a broken name index is rebuilt, a broken hierarchy fails the load
+		const QString unchecked = dir.filePath ( "unchecked.bin" );
+		jcqt::Scene broken = scene;
+		broken.nextNodeWithName_ [ 0 ] = 1 << 30;
+		broken.firstNodeForName_ [ 0 ] = -7;
+		broken.nameLookup_.fill ( 0 );
+		jcqt::saveScene ( unchecked, broken, false );
+		jcqt::Scene repaired;
+		jcqt::loadScene ( unchecked, repaired );
+		QCOMPARE ( repaired.hierarchy_.size (), qsizetype ( 1000 ) );
+		QCOMPARE ( jcqt::findNodeByName ( repaired, "node_35" ), 35 );
+		QCOMPARE ( jcqt::findNodesByName ( repaired, "node_0" ), QList<qint32> { 0 } );
+
+		broken = scene;
+		broken.hierarchy_ [ 5 ].nextSibling_ = 1000;
+		jcqt::saveScene ( unchecked, broken, false );
+		QVERIFY ( file.open ( unchecked ) );
+		jcqt::Scene rejected;
+		QVERIFY ( !file.load ( rejected ) );
+		QVERIFY ( rejected.hierarchy_.isEmpty () );
+		file.close ();
+
+		// the unversioned layout of older saveScene() calls, node count written twice
+		const QString legacyName = dir.filePath ( "legacy.bin" );
+		{
+			QFile f ( legacyName );
+			QVERIFY ( f.open ( QIODevice::WriteOnly ) );
+			const quint32 sz = 1000;
+			f.write ( ( const char* ) &sz, sizeof ( sz ) );
+			f.write ( ( const char* ) &sz, sizeof ( sz ) );
+			f.write ( ( const char* ) scene.localTransforms_.constData (), 1000 * sizeof ( jcqt::gpumat4 ) );
+			f.write ( ( const char* ) scene.globalTransforms_.constData (), 1000 * sizeof ( jcqt::gpumat4 ) );
+			f.write ( ( const char* ) scene.hierarchy_.constData (), 1000 * sizeof ( jcqt::Hierarchy ) );
+			const quint32 pairs [] = { 4, 3, 1, 5, 7 };
+			f.write ( ( const char* ) pairs, sizeof ( pairs ) );
+			const quint32 noMeshes = 0;
+			f.write ( ( const char* ) &noMeshes, sizeof ( noMeshes ) );
+		}
+		QVERIFY ( !jcqt::SceneFile::isSceneFile ( legacyName ) );
+		jcqt::Scene legacy;
+		jcqt::loadScene ( legacyName, legacy );
+		QCOMPARE ( legacy.hierarchy_.size (), qsizetype ( 1000 ) );
+		QVERIFY ( memcmp ( legacy.localTransforms_.constData (), scene.localTransforms_.constData (), 1000 * sizeof ( jcqt::gpumat4 ) ) == 0 );
+		QCOMPARE ( legacy.materialForNode_.value ( 3 ), 1 );
+		QCOMPARE ( legacy.materialForNode_.value ( 5 ), 7 );
+	}
+
+	void testHash64 ()
+	{
+		// reference XXH64 values
+		QCOMPARE ( jcqt::hash64 ( QByteArrayView () ), Q_UINT64_C ( 0xEF46DB3751D8E999 ) );
+		QCOMPARE ( jcqt::hash64 ( QByteArrayView ( "abc" ) ), Q_UINT64_C ( 0x44BC2CF5AD770999 ) );
+
+		QByteArray bytes ( 768, Qt::Uninitialized );
+		for ( qint32 i = 0; i < bytes.size (); i++ )
+			bytes [ i ] = char ( i & 0xff );
+		QCOMPARE ( jcqt::hash64 ( bytes, 7 ), Q_UINT64_C ( 0xB1E10F6C5294CD6B ) );
+	}
+
+	void testComponentArray ()
+	{
+		jcqt::ComponentArray a;
+		QVERIFY ( a.isEmpty () );
+		a.insert ( 5, 50 );
+		a.insert ( 2, 20 );
+		QCOMPARE ( a.size (), qsizetype ( 6 ) );
+		QCOMPARE ( a.count (), qsizetype ( 2 ) );
+		QVERIFY ( a.contains ( 5 ) );
+		QVERIFY ( !a.contains ( 3 ) );
+		QVERIFY ( !a.contains ( 100 ) );
+		QCOMPARE ( a.value ( 2 ), 20 );
+		QCOMPARE ( a.value ( 3, 99 ), 99 );
+		QCOMPARE ( a.value ( -1, 99 ), 99 );
+
+		// trailing nodes without a value do not make arrays different
+		jcqt::ComponentArray b = a;
+		b.resize ( 100 );
+		QVERIFY ( a == b );
+		b.insert ( 80, 1 );
+		QVERIFY ( a != b );
+		b.remove ( 80 );
+		QVERIFY ( a == b );
+
+		jcqt::ComponentArray merged;
+		merged.insert ( 0, 7 );
+		merged.append ( a, 10, 1000 );
+		QCOMPARE ( merged.size (), qsizetype ( 16 ) );
+		QCOMPARE ( merged.value ( 0 ), 7 );
+		QCOMPARE ( merged.value ( 15 ), 1050 );
+		QCOMPARE ( merged.value ( 12 ), 1020 );
+		QCOMPARE ( merged.count (), qsizetype ( 3 ) );
+
+		// node 2 is dropped, node 5 moves to 0
+		QList<qint32> newIndices ( 6, -1 );
+		newIndices [ 5 ] = 0;
+		newIndices [ 4 ] = 1;
+		a.remap ( newIndices, 2 );
+		QCOMPARE ( a.size (), qsizetype ( 2 ) );
+		QCOMPARE ( a.value ( 0 ), 50 );
+		QVERIFY ( !a.contains ( 1 ) );
+		QCOMPARE ( a.count (), qsizetype ( 1 ) );
+	}
+
+	void testMergeDeleteComponents ()
+	{
+		jcqt::Scene parts [ 2 ];
+		for ( qint32 k = 0; k < 2; k++ )
+		{
+			makeRandomScene ( parts [ k ], 500, 71 + k );
+			for ( qint32 i = 0; i < 500; i += 2 )
+				parts [ k ].meshes_.insert ( i, i );
+			jcqt::setNodeName ( parts [ k ], 7, QString ( "part%1" ).arg ( k ) );
+		}
+
+		jcqt::Scene scene;
+		jcqt::mergeScenes ( scene, { &parts [ 0 ], &parts [ 1 ] }, {}, { 500, 500 } );
+		QCOMPARE ( scene.hierarchy_.size (), qsizetype ( 1001 ) );
+		QCOMPARE ( scene.meshes_.count (), qsizetype ( 500 ) );
+		QCOMPARE ( scene.meshes_.value ( 1 + 4 ), 4 );
+		QCOMPARE ( scene.meshes_.value ( 501 + 4 ), 504 );
+		QVERIFY ( !scene.meshes_.contains ( 501 + 3 ) );
+		QCOMPARE ( jcqt::getNodeName ( scene, 501 + 7 ), QString ( "part1" ) );
+
+		// drop some leaves of the first part, every surviving node keeps its components
+		QList<quint32> leaves;
+		for ( qint32 i = 2; i < 501 && leaves.size () < 20; i++ )
+		{
+			if ( scene.hierarchy_ [ i ].firstChild_ == -1 && i != 1 + 7 )
+				leaves.append ( i );
+		}
+		const jcqt::Scene before = scene;
+		jcqt::deleteSceneNodes ( scene, leaves );
+		QCOMPARE ( scene.hierarchy_.size (), qsizetype ( 1001 - leaves.size () ) );
+		QCOMPARE ( scene.meshes_.size (), scene.hierarchy_.size () );
+
+		qint32 removed = 0;
+		for ( qint32 i = 0; i < 1001; i++ )
+		{
+			if ( removed < leaves.size () && leaves [ removed ] == quint32 ( i ) )
+			{
+				removed++;
+				continue;
+			}
+			QCOMPARE ( scene.meshes_.value ( i - removed ), before.meshes_.value ( i ) );
+			QCOMPARE ( scene.nameForNode_.value ( i - removed ), before.nameForNode_.value ( i ) );
+		}
+		QCOMPARE ( jcqt::findNodeByName ( scene, "part1" ), 501 + 7 - qint32 ( leaves.size () ) );
+		QCOMPARE ( jcqt::findNodeByName ( scene, "part0" ), 1 + 7 - qint32 ( std::count_if ( leaves.begin (), leaves.end (), [] ( quint32 l ) { return l < 8; } ) ) );
+	}
+
+	void testNameIndex ()
+	{
+		jcqt::Scene scene;
+		makeRandomScene ( scene, 200, 91 );
+		for ( qint32 i = 0; i < 200; i++ )
+			jcqt::setNodeName ( scene, i, QString ( "group%1" ).arg ( i % 10 ) );
+		QCOMPARE ( scene.names_.size (), qsizetype ( 10 ) );
+		QCOMPARE ( jcqt::findNodeByName ( scene, "group3" ), 3 );
+		QCOMPARE ( jcqt::findNodeByName ( scene, "missing" ), -1 );
+		QCOMPARE ( jcqt::findNodesByName ( scene, "group9" ).size (), qsizetype ( 20 ) );
+
+		// renaming moves the node between lists and keeps them ascending
+		jcqt::setNodeName ( scene, 3, "special" );
+		jcqt::setNodeName ( scene, 150, "special" );
+		jcqt::setNodeName ( scene, 42, "special" );
+		QCOMPARE ( jcqt::findNodeByName ( scene, "group3" ), 13 );
+		QCOMPARE ( jcqt::findNodesByName ( scene, "special" ), QList<qint32> ( { 3, 42, 150 } ) );
+		QCOMPARE ( jcqt::findNodesByName ( scene, "group0" ).size (), qsizetype ( 19 ) );
+		QCOMPARE ( jcqt::getNodeName ( scene, 42 ), QString ( "special" ) );
+
+		// a merged scene interns the shared names once
+		jcqt::Scene merged;
+		jcqt::mergeScenes ( merged, { &scene, &scene }, {}, { 0, 0 } );
+		QCOMPARE ( merged.names_.size (), qsizetype ( 12 ) );
+		QCOMPARE ( jcqt::findNodesByName ( merged, "special" ), QList<qint32> ( { 4, 43, 151, 204, 243, 351 } ) );
+
+		// deleting the first copy shifts the second one down
+		QList<quint32> firstCopy ( 200 );
+		std::iota ( firstCopy.begin (), firstCopy.end (), 1u );
+		jcqt::deleteSceneNodes ( merged, firstCopy );
+		QCOMPARE ( merged.hierarchy_.size (), qsizetype ( 201 ) );
+		QCOMPARE ( jcqt::findNodesByName ( merged, "special" ), QList<qint32> ( { 4, 43, 151 } ) );
+		QCOMPARE ( jcqt::findNodeByName ( merged, "NewRoot" ), 0 );
+
+		// the index is saved along with the names and used as it is
+		QTemporaryDir dir;
+		const QString filename = dir.filePath ( "names.bin" );
+		jcqt::saveScene ( filename, scene );
+		jcqt::SceneFile file;
+		QVERIFY ( file.open ( filename, true ) );
+		QVERIFY ( !file.section ( jcqt::SceneSectionId::NameLookup ).isEmpty () );
+		jcqt::Scene loaded;
+		QVERIFY ( file.load ( loaded ) );
+		QCOMPARE ( loaded.nameLookup_, scene.nameLookup_ );
+		QCOMPARE ( loaded.firstNodeForName_, scene.firstNodeForName_ );
+		QCOMPARE ( jcqt::findNodesByName ( loaded, "special" ), QList<qint32> ( { 3, 42, 150 } ) );
+
+		// names_ filled directly: lookups fall back to a scan until the index is rebuilt, which merges the duplicates
+		jcqt::Scene raw;
+		makeRandomScene ( raw, 4, 92 );
+		raw.names_ = { "a", "b", "a" };
+		raw.nameForNode_.insert ( 1, 2 );
+		raw.nameForNode_.insert ( 2, 1 );
+		raw.nameForNode_.insert ( 3, 0 );
+		QCOMPARE ( jcqt::findNodeByName ( raw, "a" ), 1 );
+		jcqt::rebuildNameIndex ( raw );
+		QCOMPARE ( raw.names_, QStringList ( { "a", "b" } ) );
+		QCOMPARE ( jcqt::findNodesByName ( raw, "a" ), QList<qint32> ( { 1, 3 } ) );
+
+		// names_ shrunk behind the index's back: nothing reads past it, and interning a name rebuilds the index first
+		jcqt::Scene shrunk = scene;
+		shrunk.names_.resize ( 2 );
+		QCOMPARE ( jcqt::findNameId ( shrunk, "special" ), -1 );
+		QCOMPARE ( jcqt::findNameId ( shrunk, shrunk.names_ [ 1 ] ), 1 );
+		QVERIFY ( jcqt::getNodeName ( shrunk, 42 ).isEmpty () );
+		const qint32 id = jcqt::internName ( shrunk, "special" );
+		QCOMPARE ( shrunk.names_.size (), qsizetype ( 3 ) );
+		QCOMPARE ( jcqt::findNameId ( shrunk, "special" ), id );
+		QVERIFY ( jcqt::findNodesByName ( shrunk, "special" ).isEmpty () );
+	}
+
+	void testDeleteSceneNodes ()
+	{
+		for ( quint32 seed = 0; seed < 8; seed++ )
+		{
+			jcqt::Scene scene;
+			makeRandomScene ( scene, 2000, 101 + seed );
+			// a few more roots chained as siblings, as merged scene roots are
+			qint32 previousRoot = 0;
+			for ( qint32 r = 0; r < 3; r++ )
+			{
+				const qint32 root = jcqt::addNode ( scene, -1, 0 );
+				scene.hierarchy_ [ previousRoot ].nextSibling_ = root;
+				previousRoot = root;
+				jcqt::addNode ( scene, root, 1 );
+			}
+			for ( qint32 i = 0; i < scene.hierarchy_.size (); i += 3 )
+				scene.meshes_.insert ( i, i );
+			for ( qint32 i = 0; i < scene.hierarchy_.size (); i += 7 )
+				jcqt::setNodeName ( scene, i, QString ( "n%1" ).arg ( i % 40 ) );
+
+			// unsorted, with duplicates and nodes inside subtrees that are deleted anyway
+			QRandomGenerator rng ( 201 + seed );
+			QList<quint32> request;
+			for ( qint32 k = 0; k < 25; k++ )
+				request.append ( 1 + rng.bounded ( quint32 ( scene.hierarchy_.size () - 1 ) ) );
+			request.append ( request [ 3 ] );
+
+			jcqt::Scene expected = scene;
+			referenceDeleteSceneNodes ( expected, closeUnderSubtrees ( scene, request ) );
+			jcqt::Scene actual = scene;
+			jcqt::deleteSceneNodes ( actual, request );
+
+			QCOMPARE ( actual.hierarchy_.size (), expected.hierarchy_.size () );
+			QCOMPARE ( actual.localTransforms_.size (), expected.hierarchy_.size () );
+			QVERIFY ( memcmp ( actual.localTransforms_.constData (), expected.localTransforms_.constData (), actual.localTransforms_.size () * sizeof ( jcqt::gpumat4 ) ) == 0 );
+			QVERIFY ( memcmp ( actual.globalTransforms_.constData (), expected.globalTransforms_.constData (), actual.globalTransforms_.size () * sizeof ( jcqt::gpumat4 ) ) == 0 );
+			QCOMPARE ( actual.meshes_, expected.meshes_ );
+
+			for ( qint32 i = 0; i < actual.hierarchy_.size (); i++ )
+			{
+				const jcqt::Hierarchy& a = actual.hierarchy_ [ i ];
+				const jcqt::Hierarchy& e = expected.hierarchy_ [ i ];
+				QCOMPARE ( a.parent_, e.parent_ );
+				QCOMPARE ( a.firstChild_, e.firstChild_ );
+				QCOMPARE ( a.nextSibling_, e.nextSibling_ );
+				QCOMPARE ( a.level_, ( a.parent_ == -1 ) ? 0 : actual.hierarchy_ [ a.parent_ ].level_ + 1 );
+				QCOMPARE ( jcqt::getNodeName ( actual, i ), jcqt::getNodeName ( expected, i ) );
+
+				// the first child caches the last one
+				if ( a.firstChild_ != -1 )
+				{
+					qint32 last = a.firstChild_;
+					while ( actual.hierarchy_ [ last ].nextSibling_ != -1 )
+						last = actual.hierarchy_ [ last ].nextSibling_;
+					QCOMPARE ( actual.hierarchy_ [ a.firstChild_ ].lastSibling_, last );
+				}
+			}
+
+			// the result is a valid scene
+			jcqt::markAsChanged ( actual, 0 );
+			jcqt::recalculateGlobalTransforms ( actual );
+			QCOMPARE ( actual.dirty_.count ( true ), qsizetype ( 0 ) );
+		}
+	}
+
+	void testMergeScenes ()
+	{
+		// enough nodes for the parallel copy, with an empty scene in the middle
+		constexpr qint32 kScenes = 100;
+		QList<jcqt::Scene> parts ( kScenes );
+		QList<jcqt::Scene*> pointers;
+		QList<jcqt::gpumat4> rootTransforms;
+		QList<quint32> meshCounts;
+		jcqt::Scene empty;
+		for ( qint32 k = 0; k < kScenes; k++ )
+		{
+			makeRandomScene ( parts [ k ], 1000, 301 + k );
+			for ( qint32 i = 0; i < 1000; i += 2 )
+				parts [ k ].meshes_.insert ( i, i % 10 );
+			jcqt::setNodeName ( parts [ k ], 500, QString ( "prefab%1" ).arg ( k ) );
+			jcqt::setNodeName ( parts [ k ], 501, "shared" );
+			pointers.append ( &parts [ k ] );
+
+			QMatrix4x4 t;
+			t.translate ( float ( k ), 0.f, 0.f );
+			rootTransforms.append ( jcqt::gpumat4 ( t ) );
+			meshCounts.append ( 10 );
+
+			if ( k == kScenes / 2 )
+			{
+				pointers.append ( &empty );
+				rootTransforms.append ( jcqt::gpumat4 ( t ) );
+				meshCounts.append ( 0 );
+			}
+		}
+
+		jcqt::Scene merged;
+		jcqt::mergeScenes ( merged, pointers, rootTransforms, meshCounts );
+		QCOMPARE ( merged.hierarchy_.size (), qsizetype ( 1 + kScenes * 1000 ) );
+		QCOMPARE ( merged.names_.size (), qsizetype ( 2 + kScenes ) );
+
+		// the old roots are the new root's children, in order, and the first one caches the last
+		QList<qint32> roots;
+		for ( qint32 r = merged.hierarchy_ [ 0 ].firstChild_; r != -1; r = merged.hierarchy_ [ r ].nextSibling_ )
+			roots.append ( r );
+		QCOMPARE ( roots.size (), qsizetype ( kScenes ) );
+		QCOMPARE ( merged.hierarchy_ [ roots.first () ].lastSibling_, roots.last () );
+
+		for ( qint32 k = 0; k < kScenes; k++ )
+		{
+			const qint32 offs = 1 + k * 1000;
+			QCOMPARE ( roots [ k ], offs );
+			QCOMPARE ( merged.hierarchy_ [ offs ].parent_, 0 );
+			QCOMPARE ( jcqt::findNodeByName ( merged, QString ( "prefab%1" ).arg ( k ) ), offs + 500 );
+
+			// the empty scene sits after kScenes / 2 in the input lists
+			jcqt::gpumat4 root;
+			jcqt::mat4Multiply ( rootTransforms [ k <= kScenes / 2 ? k : k + 1 ], parts [ k ].localTransforms_ [ 0 ], root );
+			QVERIFY ( memcmp ( &merged.localTransforms_ [ offs ], &root, sizeof ( jcqt::gpumat4 ) ) == 0 );
+
+			for ( qint32 i = 1; i < 1000; i += 37 )
+			{
+				const jcqt::Hierarchy& src = parts [ k ].hierarchy_ [ i ];
+				const jcqt::Hierarchy& dst = merged.hierarchy_ [ offs + i ];
+				QCOMPARE ( dst.parent_, src.parent_ + offs );
+				QCOMPARE ( dst.firstChild_, src.firstChild_ == -1 ? -1 : src.firstChild_ + offs );
+				QCOMPARE ( dst.level_, src.level_ + 1 );
+				QCOMPARE ( merged.meshes_.value ( offs + i ), parts [ k ].meshes_.contains ( i ) ? parts [ k ].meshes_.value ( i ) + k * 10 : -1 );
+				QVERIFY ( memcmp ( &merged.localTransforms_ [ offs + i ], &parts [ k ].localTransforms_ [ i ], sizeof ( jcqt::gpumat4 ) ) == 0 );
+			}
+		}
+		QCOMPARE ( jcqt::findNodesByName ( merged, "shared" ).size (), qsizetype ( kScenes ) );
+	}
+
+	void testAddNodes ()
+	{
+		jcqt::Scene single;
+		makeRandomScene ( single, 300, 401 );
+		jcqt::Scene batch = single;
+
+		// parents among the existing nodes and the batch itself
+		QRandomGenerator rng ( 402 );
+		QList<qint32> parents;
+		QList<qint32> levels;
+		QList<jcqt::gpumat4> locals;
+		for ( qint32 i = 0; i < 2000; i++ )
+		{
+			const qint32 parent = ( i % 500 == 0 ) ? -1 : ( i == 1 ) ? 0 : qint32 ( rng.bounded ( 300 + i ) );
+			parents.append ( parent );
+			levels.append ( parent == -1 ? 0 : single.hierarchy_ [ parent ].level_ + 1 );
+			jcqt::addNode ( single, parent, levels.last () );
+
+			QMatrix4x4 t;
+			t.translate ( float ( i ), 1.f, 2.f );
+			locals.append ( jcqt::gpumat4 ( t ) );
+			single.localTransforms_.last () = locals.last ();
+		}
+
+		// a child list without the cached tail is walked once
+		const qint32 fc = batch.hierarchy_ [ 0 ].firstChild_;
+		batch.hierarchy_ [ fc ].lastSibling_ = -1;
+
+		const jcqt::NodeRange range = jcqt::addNodes ( batch, parents, levels, locals );
+		QCOMPARE ( range.begin_, 300 );
+		QCOMPARE ( range.end_, 2300 );
+		QCOMPARE ( batch.hierarchy_.size (), single.hierarchy_.size () );
+		QCOMPARE ( batch.globalTransforms_.size (), single.hierarchy_.size () );
+		QVERIFY ( memcmp ( batch.localTransforms_.constData (), single.localTransforms_.constData (), single.localTransforms_.size () * sizeof ( jcqt::gpumat4 ) ) == 0 );
+		for ( qint32 i = 0; i < single.hierarchy_.size (); i++ )
+		{
+			const jcqt::Hierarchy& a = batch.hierarchy_ [ i ];
+			const jcqt::Hierarchy& e = single.hierarchy_ [ i ];
+			QCOMPARE ( a.parent_, e.parent_ );
+			QCOMPARE ( a.firstChild_, e.firstChild_ );
+			QCOMPARE ( a.nextSibling_, e.nextSibling_ );
+			QCOMPARE ( a.level_, e.level_ );
+			if ( a.firstChild_ != -1 )
+				QCOMPARE ( batch.hierarchy_ [ a.firstChild_ ].lastSibling_, single.hierarchy_ [ e.firstChild_ ].lastSibling_ );
+		}
+
+		// nodes added below a queued parent are queued with it, identity transforms by default
+		jcqt::markAsChanged ( batch, 5 );
+		const jcqt::NodeRange more = jcqt::addNodes ( batch, { 5, 2300 }, { batch.hierarchy_ [ 5 ].level_ + 1, batch.hierarchy_ [ 5 ].level_ + 2 } );
+		QVERIFY ( batch.dirty_.testBit ( more.begin_ ) );
+		QVERIFY ( batch.dirty_.testBit ( more.begin_ + 1 ) );
+		const jcqt::gpumat4 identity ( ( QMatrix4x4 () ) );
+		QVERIFY ( memcmp ( &batch.localTransforms_ [ more.begin_ ], &identity, sizeof ( jcqt::gpumat4 ) ) == 0 );
+		const qint32 one = jcqt::addNode ( batch, 5, batch.hierarchy_ [ 5 ].level_ + 1 );
+		QVERIFY ( memcmp ( &batch.localTransforms_ [ one ], &identity, sizeof ( jcqt::gpumat4 ) ) == 0 );
+	}
+
+	void testSceneTraversal ()
+	{
+		jcqt::Scene scene;
+		makeRandomScene ( scene, 2000, 501 );
+		jcqt::addNode ( scene, -1, 0 );
+		jcqt::addNode ( scene, 2000, 1 );
+
+		jcqt::SceneTraversal traversal ( scene );
+		QVERIFY ( traversal.isValid ( scene ) );
+		QCOMPARE ( traversal.size (), qsizetype ( 2002 ) );
+
+		// a subtree is exactly the node and the nodes whose parent chain reaches it
+		QRandomGenerator rng ( 502 );
+		for ( qint32 k = 0; k < 200; k++ )
+		{
+			const qint32 a = qint32 ( rng.bounded ( 2002 ) );
+			const qint32 b = qint32 ( rng.bounded ( 2002 ) );
+			bool ancestor = false;
+			for ( qint32 p = scene.hierarchy_ [ b ].parent_; p != -1 && !ancestor; p = scene.hierarchy_ [ p ].parent_ )
+				ancestor = ( p == a );
+			QCOMPARE ( traversal.isAncestor ( a, b ), ancestor );
+			QCOMPARE ( jcqt::getNodeLevel ( scene, b ), scene.hierarchy_ [ b ].level_ );
+
+			qint32 expectedSize = 0;
+			for ( qint32 n = 0; n < 2002; n++ )
+			{
+				if ( n == a || traversal.isAncestor ( a, n ) )
+					expectedSize++;
+			}
+			QCOMPARE ( traversal.subtreeSize ( a ), expectedSize );
+			QCOMPARE ( qint32 ( traversal.descendants ( a ).size () ), expectedSize - 1 );
+			QCOMPARE ( traversal.subtree ( a ) [ 0 ], a );
+			for ( qint32 d : traversal.descendants ( a ) )
+				QVERIFY ( traversal.isAncestor ( a, d ) );
+		}
+
+		// pre-order: each node is followed by its first child, children in sibling order
+		for ( qint32 n = 0; n < 2002; n++ )
+		{
+			const qint32 c = scene.hierarchy_ [ n ].firstChild_;
+			if ( c != -1 )
+				QCOMPARE ( traversal.position ( c ), traversal.position ( n ) + 1 );
+			const qint32 s = scene.hierarchy_ [ n ].nextSibling_;
+			if ( s != -1 )
+				QCOMPARE ( traversal.position ( s ), traversal.position ( n ) + traversal.subtreeSize ( n ) );
+		}
+
+		// breadth-first order agrees with the one reorderSceneBreadthFirst() lays out
+		const QList<qint32> bfs = traversal.breadthFirst ( scene );
+		jcqt::Scene reordered = scene;
+		const QList<qint32> newIndices = jcqt::reorderSceneBreadthFirst ( reordered );
+		for ( qint32 i = 0; i < bfs.size (); i++ )
+			QCOMPARE ( newIndices [ bfs [ i ] ], i );
+		QCOMPARE ( traversal.breadthFirst ( scene, 2000 ), QList<qint32> ( { 2000, 2001 } ) );
+
+		// nodes added one by one keep the index current
+		for ( qint32 k = 0; k < 300; k++ )
+		{
+			const qint32 parent = ( k % 100 == 0 ) ? -1 : qint32 ( rng.bounded ( qint32 ( scene.hierarchy_.size () ) ) );
+			const qint32 node = jcqt::addNode ( scene, parent, parent == -1 ? 0 : scene.hierarchy_ [ parent ].level_ + 1 );
+			traversal.nodeAdded ( scene, node );
+		}
+		const jcqt::SceneTraversal rebuilt ( scene );
+		QVERIFY ( std::equal ( traversal.order ().begin (), traversal.order ().end (), rebuilt.order ().begin (), rebuilt.order ().end () ) );
+		for ( qint32 n = 0; n < scene.hierarchy_.size (); n++ )
+			QCOMPARE ( traversal.subtreeSize ( n ), rebuilt.subtreeSize ( n ) );
+	}
+
+	void testSplitTRS ()
+	{
+		QRandomGenerator rng ( 601 );
+
+		// composeTRS() is T * R * S as QMatrix4x4 builds it, and decomposeTRS() inverts it, negative scales included
+		for ( int i = 0; i < 100; i++ )
+		{
+			const jcqt::gpuvec3 t ( float ( rng.generateDouble () * 20.0 - 10.0 ), float ( rng.generateDouble () ), float ( rng.generateDouble () ) );
+			const jcqt::gpuvec4 r = randomRotation ( rng );
+			const jcqt::gpuvec3 s ( float ( rng.generateDouble () * 4.0 - 2.0 ), float ( rng.generateDouble () + 0.5 ), float ( rng.generateDouble () + 0.1 ) );
+
+			QMatrix4x4 q;
+			q.translate ( t.x, t.y, t.z );
+			q.rotate ( QQuaternion ( r.w, r.x, r.y, r.z ) );
+			q.scale ( s.x, s.y, s.z );
+
+			jcqt::gpumat4 m;
+			jcqt::composeTRS ( t, r, s, m );
+			QVERIFY ( mat4FuzzyCompare ( m, jcqt::gpumat4 ( q ) ) );
+
+			jcqt::gpuvec3 dt, ds;
+			jcqt::gpuvec4 dr;
+			jcqt::decomposeTRS ( m, dt, dr, ds );
+			jcqt::gpumat4 back;
+			jcqt::composeTRS ( dt, dr, ds, back );
+			QVERIFY ( mat4FuzzyCompare ( back, m ) );
+		}
+
+		// the SIMD batch agrees with the scalar composition, over an index list that is not a multiple of four and not in order
+		{
+			const qint32 count = 103;
+			QList<jcqt::gpuvec3> translations ( count ), scales ( count );
+			QList<jcqt::gpuvec4> rotations ( count );
+			QList<qint32> nodes;
+			for ( qint32 i = 0; i < count; i++ )
+			{
+				translations [ i ] = jcqt::gpuvec3 ( float ( i ), float ( rng.generateDouble () ), -float ( i ) );
+				rotations [ i ] = randomRotation ( rng );
+				scales [ i ] = jcqt::gpuvec3 ( float ( rng.generateDouble () + 0.5 ), 1.0f, float ( rng.generateDouble () * 3.0 ) );
+				if ( i % 3 != 1 )
+					nodes.append ( count - 1 - i );
+			}
+
+			QList<jcqt::gpumat4> batch ( count, jcqt::gpumat4 ( QMatrix4x4 () ) );
+			jcqt::composeTRSBatch ( translations.constData (), rotations.constData (), scales.constData (), nodes.constData (), batch.data (), nodes.size () );
+			for ( qint32 i = 0; i < count; i++ )
+			{
+				jcqt::gpumat4 expected = jcqt::gpumat4 ( QMatrix4x4 () );
+				if ( nodes.contains ( i ) )
+					jcqt::composeTRS ( translations [ i ], rotations [ i ], scales [ i ], expected );
+				QVERIFY ( mat4FuzzyCompare ( batch [ i ], expected, 1e-6f ) );
+			}
+		}
+
+		// TRS edits reach the global transforms exactly like the same matrices written by hand
+		jcqt::Scene scene;
+		makeRandomScene ( scene, 2000, 602 );
+		jcqt::recalculateAllGlobalTransforms ( scene );
+		jcqt::Scene reference = scene;
+
+		jcqt::enableSplitTRS ( scene );
+		QVERIFY ( splitTRSConsistent ( scene ) );
+
+		for ( int i = 0; i < 200; i++ )
+		{
+			const qint32 node = qint32 ( rng.bounded ( 2000 ) );
+			const jcqt::gpuvec3 t ( float ( rng.generateDouble () ), float ( rng.generateDouble () ), float ( rng.generateDouble () ) );
+			const jcqt::gpuvec4 r = randomRotation ( rng );
+			const jcqt::gpuvec3 s ( float ( rng.generateDouble () + 0.5 ) );
+
+			// alternate between the single-component setters and the full one
+			if ( i % 2 == 0 )
+			{
+				jcqt::setNodeTRS ( scene, node, t, r, s );
+			}
+			else
+			{
+				jcqt::setNodeTranslation ( scene, node, t );
+				jcqt::setNodeRotation ( scene, node, r );
+				jcqt::setNodeScale ( scene, node, s );
+			}
+
+			jcqt::composeTRS ( t, r, s, reference.localTransforms_ [ node ] );
+			jcqt::markAsChanged ( reference, node );
+		}
+
+		QVERIFY ( !scene.trsChanged_.isEmpty () );
+		jcqt::recalculateGlobalTransformsParallel ( scene, 16 );
+		jcqt::recalculateGlobalTransforms ( reference );
+		QVERIFY ( scene.trsChanged_.isEmpty () );
+		QVERIFY ( splitTRSConsistent ( scene ) );
+		for ( qint32 i = 0; i < 2000; i++ )
+			QVERIFY ( mat4FuzzyCompare ( scene.globalTransforms_ [ i ], reference.globalTransforms_ [ i ], 1e-3f ) );
+
+		// the storage follows every structural edit, pending edits included
+		jcqt::addNode ( scene, 0, 1 );
+		jcqt::addNodes ( scene, { 5, 2000 }, { scene.hierarchy_ [ 5 ].level_ + 1, 2 } );
+		QMatrix4x4 turned;
+		turned.rotate ( 30.0f, 0.0f, 1.0f, 0.0f );
+		turned.scale ( 2.0f );
+		const jcqt::NodeRange added = jcqt::addNodes ( scene, { 2001 }, { scene.hierarchy_ [ 2001 ].level_ + 1 }, { jcqt::gpumat4 ( turned ) } );
+		QCOMPARE ( added.end_, 2004 );
+		QVERIFY ( splitTRSConsistent ( scene ) );
+
+		jcqt::setNodeTranslation ( scene, 1500, jcqt::gpuvec3 ( 5.0f ) );
+		jcqt::deleteSceneNodes ( scene, { 3, 17, 2001 } );
+		QVERIFY ( splitTRSConsistent ( scene ) );
+
+		jcqt::setNodeScale ( scene, 100, jcqt::gpuvec3 ( 2.0f ) );
+		jcqt::reorderSceneBreadthFirst ( scene );
+		QVERIFY ( splitTRSConsistent ( scene ) );
+
+		jcqt::Scene other;
+		makeRandomScene ( other, 300, 603 );
+		jcqt::enableSplitTRS ( other );
+		jcqt::setNodeRotation ( other, 10, randomRotation ( rng ) );
+		QMatrix4x4 shift;
+		shift.translate ( 1.0f, 2.0f, 3.0f );
+		jcqt::Scene merged;
+		jcqt::mergeScenes ( merged, { &scene, &other }, { jcqt::gpumat4 ( shift ) }, {} );
+		QVERIFY ( splitTRSConsistent ( merged ) );
+
+		// a part without the storage turns it off for the merged scene
+		jcqt::disableSplitTRS ( other );
+		jcqt::mergeScenes ( merged, { &scene, &other }, {}, {} );
+		QVERIFY ( !merged.splitTRS_ );
+		QVERIFY ( merged.translations_.isEmpty () );
+	}
+
+	void testTransformSnapshots ()
+	{
+		jcqt::Scene scene;
+		makeRandomScene ( scene, 5000, 701 );
+		jcqt::TransformSnapshots snapshots;
+
+		// nothing published yet
+		jcqt::TransformSnapshot snapshot = snapshots.acquire ();
+		QCOMPARE ( snapshot.frame_, quint64 ( 0 ) );
+		QCOMPARE ( snapshot.count_, qsizetype ( 0 ) );
+
+		jcqt::markAsChanged ( scene, 0 );
+		QCOMPARE ( snapshots.update ( scene ), quint64 ( 1 ) );
+		snapshot = snapshots.acquire ();
+		QCOMPARE ( snapshot.frame_, quint64 ( 1 ) );
+		QCOMPARE ( snapshot.count_, scene.globalTransforms_.size () );
+		QVERIFY ( memcmp ( snapshot.transforms_, scene.globalTransforms_.constData (), 5000 * sizeof ( jcqt::gpumat4 ) ) == 0 );
+
+		// the held frame stays put while the writer runs ahead, then the reader jumps to the newest one
+		const jcqt::gpumat4 frameOne = snapshot.transforms_ [ 4999 ];
+		QRandomGenerator rng ( 702 );
+		for ( int frame = 2; frame <= 6; frame++ )
+		{
+			for ( int k = 0; k < 20; k++ )
+			{
+				const qint32 node = qint32 ( rng.bounded ( 5000 ) );
+				scene.localTransforms_ [ node ].data_ [ 13 ] += 1.0f;
+				jcqt::markAsChanged ( scene, node );
+			}
+			scene.localTransforms_ [ 4999 ].data_ [ 14 ] += 1.0f;
+			jcqt::markAsChanged ( scene, 4999 );
+			snapshots.update ( scene );
+			QVERIFY ( memcmp ( &snapshot.transforms_ [ 4999 ], &frameOne, sizeof ( frameOne ) ) == 0 );
+		}
+
+		snapshot = snapshots.acquire ();
+		QCOMPARE ( snapshot.frame_, quint64 ( 6 ) );
+		QVERIFY ( memcmp ( snapshot.transforms_, scene.globalTransforms_.constData (), 5000 * sizeof ( jcqt::gpumat4 ) ) == 0 );
+
+		// appended nodes show up without being marked, moved ones after markAllChanged()
+		jcqt::addNode ( scene, 0, 1 );
+		jcqt::markAsChanged ( scene, 5000 );
+		snapshots.update ( scene );
+		snapshot = snapshots.acquire ();
+		QCOMPARE ( snapshot.count_, qsizetype ( 5001 ) );
+		QVERIFY ( memcmp ( snapshot.transforms_, scene.globalTransforms_.constData (), 5001 * sizeof ( jcqt::gpumat4 ) ) == 0 );
+
+		jcqt::reorderSceneBreadthFirst ( scene );
+		snapshots.markAllChanged ();
+		snapshots.publish ( scene );
+		snapshot = snapshots.acquire ();
+		QVERIFY ( memcmp ( snapshot.transforms_, scene.globalTransforms_.constData (), 5001 * sizeof ( jcqt::gpumat4 ) ) == 0 );
+
+		/*
+		*	A writer thread touches every fifth page per frame, the page number decides which, and tags the matrices with the frame number.
+		*	Every snapshot the reader gets must be exactly one frame: each page holds the last frame up to it that touched the page.
+		*/
+		const qint32 pageSize = jcqt::TransformSnapshots::PAGE_SIZE;
+		const qint32 nodeCount = pageSize * 37 + 11;
+		auto expected = [] ( qint64 frame, qint64 page ) {
+			const qint64 touched = frame - ( ( ( frame - page ) % 5 ) + 5 ) % 5;
+			return touched >= 1 ? float ( touched ) : 0.0f;
+		};
+
+		jcqt::Scene tagged;
+		tagged.globalTransforms_ = QList<jcqt::gpumat4> ( nodeCount, jcqt::gpumat4 ( QMatrix4x4 () ) );
+		for ( jcqt::gpumat4& m : tagged.globalTransforms_ )
+			m.data_ [ 12 ] = 0.0f;
+
+		jcqt::TransformSnapshots concurrent;
+		std::atomic<bool> done { false };
+		qint64 torn = 0;
+		bool ordered = true;
+		std::thread reader ( [&] () {
+			quint64 last = 0;
+			while ( !done.load () )
+			{
+				const jcqt::TransformSnapshot s = concurrent.acquire ();
+				ordered = ordered && s.frame_ >= last;
+				last = s.frame_;
+				if ( s.count_ == 0 )
+					continue;
+
+				for ( qsizetype i = 0; i < s.count_; i++ )
+				{
+					if ( s.transforms_ [ i ].data_ [ 12 ] != expected ( qint64 ( s.frame_ ), i / pageSize ) )
+					{
+						torn++;
+						break;
+					}
+				}
+			}
+		} );
+
+		for ( qint64 frame = 1; frame <= 5000; frame++ )
+		{
+			for ( qint32 i = 0; i < nodeCount; i++ )
+			{
+				if ( ( i / pageSize ) % 5 == frame % 5 )
+				{
+					tagged.globalTransforms_ [ i ].data_ [ 12 ] = float ( frame );
+					concurrent.markChanged ( i );
+				}
+			}
+			concurrent.publish ( tagged );
+		}
+		done = true;
+		reader.join ();
+
+		QVERIFY ( ordered );
+		QCOMPARE ( torn, qint64 ( 0 ) );
+		QCOMPARE ( concurrent.acquire ().frame_, quint64 ( 5000 ) );
+	}
+
+	void testSyntheticGLTF ()
+	{
+		jcqt::SyntheticSceneOptions options;
+		options.seed_ = 23;
+		options.nodeCount_ = 500;
+		options.animationChannels_ = 6;
+
+		// same options, same bytes
+		const jcqt::SyntheticGLTF gltf = jcqt::generateSyntheticGLTF ( options );
+		const jcqt::SyntheticGLTF again = jcqt::generateSyntheticGLTF ( options );
+		QCOMPARE ( gltf.json_, again.json_ );
+		QCOMPARE ( gltf.binary_, again.binary_ );
+
+		jcqt::SyntheticSceneOptions reseeded = options;
+		reseeded.seed_ = 24;
+		QVERIFY ( jcqt::generateSyntheticGLTF ( reseeded ).json_ != gltf.json_ );
+
+		jcqt::gltf::Document doc;
+		QString error;
+		QVERIFY2 ( jcqt::gltf::parseDocument ( gltf.json_, doc, &error ), qPrintable ( error ) );
+		QCOMPARE ( doc.nodes_.size (), qsizetype ( 500 ) );
+		QCOMPARE ( doc.meshes_.size (), qsizetype ( 16 ) );
+		QCOMPARE ( doc.materials_.size (), qsizetype ( 8 ) );
+
+		// the Scene generated directly is the one built from the document
+		jcqt::Scene built;
+		QVERIFY ( jcqt::buildScene ( doc, built ) );
+		jcqt::Scene generated;
+		jcqt::generateSyntheticScene ( generated, options );
+		QCOMPARE ( generated.hierarchy_.size (), qsizetype ( 501 ) );
+		QVERIFY ( sameScene ( generated, built ) );
+		QCOMPARE ( jcqt::findNodeByName ( generated, "node_0" ), 1 );
+
+		// the vertex data comes from its own stream: bigger meshes, same tree
+		jcqt::SyntheticSceneOptions bigger = options;
+		bigger.verticesPerMesh_ = 100000;
+		bigger.interleaved_ = true;
+		jcqt::Scene biggerScene;
+		jcqt::generateSyntheticScene ( biggerScene, bigger );
+		QVERIFY ( sameScene ( biggerScene, generated, 0.0f ) );
+
+		// every storage loads, with buffer 0 holding the generated bytes
+		QTemporaryDir dir;
+		QVERIFY ( dir.isValid () );
+		const struct
+		{
+			jcqt::SyntheticBufferStorage storage_;
+			const char* filename_;
+		} storages [] = {
+			{ jcqt::SyntheticBufferStorage::External, "external.gltf" },
+			{ jcqt::SyntheticBufferStorage::Embedded, "embedded.gltf" },
+			{ jcqt::SyntheticBufferStorage::GLB, "binary.glb" }
+		};
+		for ( const auto& s : storages )
+		{
+			jcqt::SyntheticSceneOptions stored = bigger;
+			// past 65536 vertices the indices are 32 bit
+			stored.meshCount_ = 2;
+			stored.verticesPerMesh_ = 70000;
+			stored.storage_ = s.storage_;
+			const QString filename = dir.filePath ( s.filename_ );
+			QVERIFY ( jcqt::writeSyntheticGLTF ( filename, stored ) );
+
+			GLTFLoader loader;
+			QVERIFY2 ( loader.loadGLTF ( filename ), s.filename_ );
+			QCOMPARE ( loader.isBinary (), s.storage_ == jcqt::SyntheticBufferStorage::GLB );
+			QCOMPARE ( loader.document ().nodes_.size (), qsizetype ( 500 ) );
+
+			const QByteArray expected = jcqt::generateSyntheticGLTF ( stored ).binary_;
+			QVERIFY ( loader.bufferData ( 0 ).size () >= expected.size () );
+			QVERIFY ( loader.bufferData ( 0 ).first ( expected.size () ) == QByteArrayView ( expected ) );
+		}
+	}
+
+	void testSyntheticPresets ()
+	{
+		// a rig far deeper than MAX_NODE_LEVEL
+		jcqt::Scene rig;
+		jcqt::generateSyntheticScene ( rig, jcqt::SyntheticSceneOptions::deepRig ( 2000 ) );
+		qint32 deepest = 0;
+		for ( const jcqt::Hierarchy& h : rig.hierarchy_ )
+			deepest = qMax ( deepest, h.level_ );
+		QCOMPARE ( deepest, 256 );
+		QVERIFY ( deepest > jcqt::MAX_NODE_LEVEL );
+
+		jcqt::gltf::Document doc;
+		QVERIFY ( jcqt::gltf::parseDocument ( jcqt::generateSyntheticGLTF ( jcqt::SyntheticSceneOptions::deepRig ( 2000 ) ).json_, doc ) );
+		jcqt::Scene built;
+		QVERIFY ( jcqt::buildScene ( doc, built ) );
+		QVERIFY ( sameScene ( rig, built, 1e-3f ) );
+
+		// recalculation past MAX_NODE_LEVEL
+		jcqt::Scene moved = rig;
+		QMatrix4x4 t;
+		t.translate ( 1.0f, 2.0f, 3.0f );
+		moved.localTransforms_ [ 1 ] = jcqt::gpumat4 ( t );
+		jcqt::markAsChanged ( moved, 1 );
+		jcqt::recalculateGlobalTransforms ( moved );
+		jcqt::Scene reference = moved;
+		jcqt::recalculateAllGlobalTransforms ( reference );
+		for ( qsizetype i = 0; i < moved.globalTransforms_.size (); i++ )
+			QVERIFY ( mat4FuzzyCompare ( moved.globalTransforms_ [ i ], reference.globalTransforms_ [ i ], 1e-3f ) );
+
+		// a thousand children under each district
+		jcqt::Scene city;
+		jcqt::generateSyntheticScene ( city, jcqt::SyntheticSceneOptions::wideCity ( 5000 ) );
+		qint32 children = 0;
+		for ( qint32 c = city.hierarchy_ [ 2 ].firstChild_; c != -1; c = city.hierarchy_ [ c ].nextSibling_ )
+			children++;
+		QCOMPARE ( children, 1000 );
+
+		// a single buffer of 16 meshes in a data: URI
+		const jcqt::SyntheticGLTF embedded = jcqt::generateSyntheticGLTF ( jcqt::SyntheticSceneOptions::hugeEmbeddedBuffers ( 10000 ) );
+		QVERIFY ( embedded.binary_.size () > 16 * 10000 * 32 );
+		QVERIFY ( embedded.json_.contains ( "data:application/octet-stream;base64," ) );
+	}
+
+	void testTrace ()
+	{
+		auto named = [] ( const QList<jcqt::trace::SpanRecord>& spans, const char* name )
+		{
+			QList<jcqt::trace::SpanRecord> found;
+			for ( const jcqt::trace::SpanRecord& span : spans )
+			{
+				if ( strcmp ( span.name_, name ) == 0 )
+					found.append ( span );
+			}
+			return found;
+		};
+
+		// nothing is recorded before start ()
+		jcqt::trace::clear ();
+		{
+			jcqt::trace::Span idle ( "idle" );
+		}
+		QVERIFY ( jcqt::trace::spans ().isEmpty () );
+
+		// spans nest on the calling thread and keep their index and counts
+		jcqt::trace::start ();
+		QVERIFY ( jcqt::trace::isRecording () );
+		{
+			jcqt::trace::Span outer ( "outer" );
+			for ( qint32 i = 0; i < 3; i++ )
+			{
+				jcqt::trace::Span inner ( "inner", i );
+				inner.setCounts ( 16 * i, i );
+			}
+			outer.setCounts ( 48, 3 );
+		}
+
+		// every other thread gets its own id
+		std::thread thread ( [] ()
+		{
+			jcqt::trace::Span span ( "worker", 7 );
+		} );
+		thread.join ();
+
+		// a span open at stop () still ends up in the trace, one started afterwards does not
+		{
+			jcqt::trace::Span open ( "open" );
+			jcqt::trace::stop ();
+			jcqt::trace::Span late ( "late" );
+		}
+		QVERIFY ( !jcqt::trace::isRecording () );
+
+		const QList<jcqt::trace::SpanRecord> spans = jcqt::trace::spans ();
+		QCOMPARE ( spans.size (), qsizetype ( 6 ) );
+		const QList<jcqt::trace::SpanRecord> outer = named ( spans, "outer" );
+		const QList<jcqt::trace::SpanRecord> inner = named ( spans, "inner" );
+		const QList<jcqt::trace::SpanRecord> worker = named ( spans, "worker" );
+		QCOMPARE ( outer.size (), qsizetype ( 1 ) );
+		QCOMPARE ( outer [ 0 ].index_, -1 );
+		QCOMPARE ( outer [ 0 ].bytes_, qint64 ( 48 ) );
+		QCOMPARE ( outer [ 0 ].items_, qint64 ( 3 ) );
+		QVERIFY ( outer [ 0 ].start_ >= 0 );
+		QCOMPARE ( inner.size (), qsizetype ( 3 ) );
+		for ( qsizetype i = 0; i < inner.size (); i++ )
+		{
+			QCOMPARE ( inner [ i ].index_, qint32 ( i ) );
+			QCOMPARE ( inner [ i ].bytes_, qint64 ( 16 * i ) );
+			QCOMPARE ( inner [ i ].items_, qint64 ( i ) );
+			QCOMPARE ( inner [ i ].thread_, outer [ 0 ].thread_ );
+			QVERIFY ( inner [ i ].start_ >= outer [ 0 ].start_ );
+			QVERIFY ( inner [ i ].start_ + inner [ i ].duration_ <= outer [ 0 ].start_ + outer [ 0 ].duration_ );
+		}
+		QCOMPARE ( worker.size (), qsizetype ( 1 ) );
+		QCOMPARE ( worker [ 0 ].index_, 7 );
+		QCOMPARE ( worker [ 0 ].bytes_, qint64 ( -1 ) );
+		QVERIFY ( worker [ 0 ].thread_ != outer [ 0 ].thread_ );
+		QCOMPARE ( named ( spans, "open" ).size (), qsizetype ( 1 ) );
+		QVERIFY ( named ( spans, "late" ).isEmpty () );
+
+		// valid trace-event JSON: one "X" event per span with its arguments, and a name for each of the two threads
+		const QJsonDocument json = QJsonDocument::fromJson ( jcqt::trace::chromeTraceJson () );
+		QVERIFY ( json.isObject () );
+		const QJsonArray events = json.object () [ "traceEvents" ].toArray ();
+		qsizetype complete = 0;
+		qsizetype threadNames = 0;
+		for ( const QJsonValue& value : events )
+		{
+			const QJsonObject event = value.toObject ();
+			const QString phase = event [ "ph" ].toString ();
+			QVERIFY ( phase == "X" || phase == "M" );
+			if ( phase == "M" )
+			{
+				threadNames++;
+				QVERIFY ( !event [ "args" ].toObject () [ "name" ].toString ().isEmpty () );
+				continue;
+			}
+
+			complete++;
+			const QJsonObject args = event [ "args" ].toObject ();
+			if ( event [ "name" ].toString () == "worker" )
+			{
+				QCOMPARE ( event [ "tid" ].toInt (), worker [ 0 ].thread_ );
+				QCOMPARE ( args [ "index" ].toInt (), 7 );
+				QVERIFY ( !args.contains ( "bytes" ) );
+			}
+			else if ( event [ "name" ].toString () == "outer" )
+			{
+				QCOMPARE ( event [ "tid" ].toInt (), outer [ 0 ].thread_ );
+				QCOMPARE ( args [ "bytes" ].toInt (), 48 );
+				QCOMPARE ( args [ "items" ].toInt (), 3 );
+				QVERIFY ( !args.contains ( "index" ) );
+			}
+		}
+		QCOMPARE ( complete, spans.size () );
+		QCOMPARE ( threadNames, qsizetype ( 2 ) );
+
+		QTemporaryDir dir;
+		QVERIFY ( dir.isValid () );
+		const QString path = dir.filePath ( "trace.json" );
+		QVERIFY ( jcqt::trace::writeChromeTrace ( path ) );
+		QFile file ( path );
+		QVERIFY ( file.open ( QIODeviceBase::ReadOnly ) );
+		QCOMPARE ( file.readAll (), jcqt::trace::chromeTraceJson () );
+		file.close ();
+
+		// start () discards the previous trace, clear () empties it
+		jcqt::trace::start ();
+		QVERIFY ( jcqt::trace::spans ().isEmpty () );
+		{
+			jcqt::trace::Span again ( "again" );
+		}
+		jcqt::trace::stop ();
+		QCOMPARE ( jcqt::trace::spans ().size (), qsizetype ( 1 ) );
+		jcqt::trace::clear ();
+		QVERIFY ( jcqt::trace::spans ().isEmpty () );
+	}
+
+	// the spans the JCQT_TRACE_* macros put into the loader and the scene updates
+	void testTracedLoad ()
+	{
+#if !defined(JCQT_TRACE)
+		QSKIP ( "trace spans are compiled in with JCQT_TRACE only" );
+#else
+		jcqt::Scene rig;
+		jcqt::generateSyntheticScene ( rig, jcqt::SyntheticSceneOptions::deepRig ( 300 ) );
+
+		jcqt::trace::start ();
+		GLTFLoader loader;
+		QVERIFY ( loader.loadGLTF ( ":/test/test.gltf" ) );
+		jcqt::markAsChanged ( rig, 1 );
+		jcqt::recalculateGlobalTransforms ( rig );
+		jcqt::trace::stop ();
+
+		const QList<jcqt::trace::SpanRecord> spans = jcqt::trace::spans ();
+		auto named = [&spans] ( const char* name )
+		{
+			QList<jcqt::trace::SpanRecord> found;
+			for ( const jcqt::trace::SpanRecord& span : spans )
+			{
+				if ( strcmp ( span.name_, name ) == 0 )
+					found.append ( span );
+			}
+			return found;
+		};
+
+		// every loader stage, with its byte counts
+		const QList<jcqt::trace::SpanRecord> load = named ( "GLTFLoader::loadGLTF" );
+		QCOMPARE ( load.size (), qsizetype ( 1 ) );
+		QVERIFY ( load [ 0 ].bytes_ > 0 );
+		QCOMPARE ( named ( "GLTFLoader::mapFile" ).size (), qsizetype ( 1 ) );
+		QCOMPARE ( named ( "gltf::parseDocument" ).size (), qsizetype ( 1 ) );
+		QCOMPARE ( named ( "gltf::parseDocument" ) [ 0 ].bytes_, load [ 0 ].bytes_ );
+
+		const QList<jcqt::trace::SpanRecord> base64 = named ( "base64Decode buffer" );
+		QCOMPARE ( base64.size (), qsizetype ( 1 ) );
+		QCOMPARE ( base64 [ 0 ].index_, 0 );
+		QCOMPARE ( base64 [ 0 ].bytes_, qint64 ( 44 ) );
+		QCOMPARE ( base64 [ 0 ].items_, qint64 ( 60 ) );
+
+		// one span per changed level, nested in the whole update on the same thread
+		const QList<jcqt::trace::SpanRecord> recalculate = named ( "recalculateGlobalTransforms" );
+		const QList<jcqt::trace::SpanRecord> levels = named ( "recalculateGlobalTransforms level" );
+		QCOMPARE ( recalculate.size (), qsizetype ( 1 ) );
+		QCOMPARE ( recalculate [ 0 ].items_, qint64 ( 256 ) );
+		QCOMPARE ( levels.size (), qsizetype ( 256 ) );
+		for ( qsizetype i = 0; i < levels.size (); i++ )
+		{
+			QCOMPARE ( levels [ i ].index_, qint32 ( i + 1 ) );
+			QCOMPARE ( levels [ i ].items_, qint64 ( 1 ) );
+			QCOMPARE ( levels [ i ].thread_, recalculate [ 0 ].thread_ );
+			QVERIFY ( levels [ i ].start_ >= recalculate [ 0 ].start_ );
+			QVERIFY ( levels [ i ].start_ + levels [ i ].duration_ <= recalculate [ 0 ].start_ + recalculate [ 0 ].duration_ );
+		}
+
+		// valid trace-event JSON with a name for every thread
+		const QJsonDocument json = QJsonDocument::fromJson ( jcqt::trace::chromeTraceJson () );
+		const QJsonArray events = json.object () [ "traceEvents" ].toArray ();
+		qsizetype complete = 0;
+		for ( const QJsonValue& event : events )
+		{
+			const QString phase = event.toObject () [ "ph" ].toString ();
+			QVERIFY ( phase == "X" || phase == "M" );
+			complete += ( phase == "X" );
+		}
+		QCOMPARE ( complete, spans.size () );
+
+		// nothing is recorded once stopped
+		GLTFLoader again;
+		QVERIFY ( again.loadGLTF ( ":/test/test.gltf" ) );
+		QCOMPARE ( jcqt::trace::spans ().size (), spans.size () );
+		jcqt::trace::clear ();
+		QVERIFY ( jcqt::trace::spans ().isEmpty () );
+#endif
+	}
+
+	void testAssetCache ()
+	{
+		QTemporaryDir dir;
+		QVERIFY ( dir.isValid () );
+		jcqt::AssetCache cache ( dir.filePath ( "cache" ) );
+
+		jcqt::SyntheticSceneOptions options;
+		options.seed_ = 25;
+		options.nodeCount_ = 300;
+		options.meshCount_ = 4;
+		options.verticesPerMesh_ = 200;
+		options.indicesPerMesh_ = 600;
+		const QString filename = dir.filePath ( "cached.gltf" );
+		QVERIFY ( jcqt::writeSyntheticGLTF ( filename, options ) );
+
+		auto entryOf = [&cache] ( const QString& file )
+		{
+			QFile f ( file );
+			return f.open ( QIODevice::ReadOnly ) ? cache.entryPath ( jcqt::AssetCache::key ( f.readAll () ) ) : QString ();
+		};
+
+		// the first load misses and stores an entry, the second is served from it
+		GLTFLoader cold;
+		cold.setAssetCache ( &cache );
+		QVERIFY ( cold.loadGLTF ( filename ) );
+		QVERIFY ( !cold.isFromCache () );
+		QVERIFY ( QFileInfo::exists ( entryOf ( filename ) ) );
+
+		GLTFLoader warm;
+		warm.setAssetCache ( &cache );
+		QVERIFY ( warm.loadGLTF ( filename ) );
+		QVERIFY ( warm.isFromCache () );
+		QCOMPARE ( cache.misses (), qint64 ( 1 ) );
+		QCOMPARE ( cache.hits (), qint64 ( 1 ) );
+
+		// same scene, meshes and accessor data as the full load
+		jcqt::Scene coldScene;
+		jcqt::Scene warmScene;
+		QVERIFY ( cold.buildScene ( coldScene ) );
+		QVERIFY ( warm.buildScene ( warmScene ) );
+		QVERIFY ( sameScene ( coldScene, warmScene, 0.0f ) );
+
+		const jcqt::gltf::Document& coldDoc = cold.document ();
+		const jcqt::gltf::Document& warmDoc = warm.document ();
+		QCOMPARE ( warmDoc.meshes_.size (), coldDoc.meshes_.size () );
+		QCOMPARE ( warmDoc.accessors_.size (), coldDoc.accessors_.size () );
+		for ( qsizetype m = 0; m < coldDoc.meshes_.size (); m++ )
+		{
+			QCOMPARE ( warmDoc.meshes_ [ m ].name_, coldDoc.meshes_ [ m ].name_ );
+			QCOMPARE ( warmDoc.meshes_ [ m ].primitives_.size (), coldDoc.meshes_ [ m ].primitives_.size () );
+			for ( qsizetype p = 0; p < coldDoc.meshes_ [ m ].primitives_.size (); p++ )
+			{
+				const jcqt::gltf::Primitive& a = coldDoc.meshes_ [ m ].primitives_ [ p ];
+				const jcqt::gltf::Primitive& b = warmDoc.meshes_ [ m ].primitives_ [ p ];
+				QCOMPARE ( b.attributes_.size (), a.attributes_.size () );
+				for ( qsizetype i = 0; i < a.attributes_.size (); i++ )
+				{
+					QCOMPARE ( b.attributes_ [ i ].name_, a.attributes_ [ i ].name_ );
+					QCOMPARE ( b.attributes_ [ i ].accessor_, a.attributes_ [ i ].accessor_ );
+				}
+				QCOMPARE ( b.indices_, a.indices_ );
+				QCOMPARE ( b.material_, a.material_ );
+				QCOMPARE ( b.mode_, a.mode_ );
+
+				QList<quint32> coldIndices;
+				QList<quint32> warmIndices;
+				QVERIFY ( cold.readIndices ( a.indices_, coldIndices ) );
+				QVERIFY ( warm.readIndices ( b.indices_, warmIndices ) );
+				QCOMPARE ( warmIndices, coldIndices );
+			}
+		}
+
+		for ( qint32 i = 0; i < coldDoc.accessors_.size (); i++ )
+		{
+			QCOMPARE ( warmDoc.accessors_ [ i ].type_, coldDoc.accessors_ [ i ].type_ );
+			QCOMPARE ( warmDoc.accessors_ [ i ].count_, coldDoc.accessors_ [ i ].count_ );
+
+			QList<float> coldValues;
+			QList<float> warmValues;
+			QCOMPARE ( warm.readAccessor ( i, warmValues ), cold.readAccessor ( i, coldValues ) );
+			QCOMPARE ( warmValues, coldValues );
+
+			QList<jcqt::gpuvec4> coldVectors;
+			QList<jcqt::gpuvec4> warmVectors;
+			QCOMPARE ( warm.readAccessor ( i, warmVectors ), cold.readAccessor ( i, coldVectors ) );
+			QCOMPARE ( warmVectors.size (), coldVectors.size () );
+			QVERIFY ( memcmp ( warmVectors.constData (), coldVectors.constData (), coldVectors.size () * sizeof ( jcqt::gpuvec4 ) ) == 0 );
+		}
+
+		// the rest of the document as well
+		QCOMPARE ( warmDoc.version_, coldDoc.version_ );
+		QCOMPARE ( warmDoc.scene_, coldDoc.scene_ );
+		QCOMPARE ( warmDoc.scenes_.size (), coldDoc.scenes_.size () );
+		for ( qsizetype i = 0; i < coldDoc.scenes_.size (); i++ )
+			QCOMPARE ( warmDoc.scenes_ [ i ].nodes_, coldDoc.scenes_ [ i ].nodes_ );
+		QCOMPARE ( warmDoc.nodes_.size (), coldDoc.nodes_.size () );
+		for ( qsizetype i = 0; i < coldDoc.nodes_.size (); i++ )
+		{
+			const jcqt::gltf::Node& a = coldDoc.nodes_ [ i ];
+			const jcqt::gltf::Node& b = warmDoc.nodes_ [ i ];
+			QCOMPARE ( b.children_, a.children_ );
+			QCOMPARE ( b.mesh_, a.mesh_ );
+			QCOMPARE ( b.hasMatrix_, a.hasMatrix_ );
+			QVERIFY ( memcmp ( b.matrix_, a.matrix_, sizeof ( a.matrix_ ) ) == 0 );
+			QVERIFY ( memcmp ( b.translation_, a.translation_, sizeof ( a.translation_ ) ) == 0 );
+			QVERIFY ( memcmp ( b.rotation_, a.rotation_, sizeof ( a.rotation_ ) ) == 0 );
+			QVERIFY ( memcmp ( b.scale_, a.scale_, sizeof ( a.scale_ ) ) == 0 );
+			QCOMPARE ( b.name_, a.name_ );
+		}
+		QCOMPARE ( warmDoc.materials_.size (), coldDoc.materials_.size () );
+		for ( qsizetype i = 0; i < coldDoc.materials_.size (); i++ )
+		{
+			QCOMPARE ( warmDoc.materials_ [ i ].name_, coldDoc.materials_ [ i ].name_ );
+			QVERIFY ( memcmp ( warmDoc.materials_ [ i ].baseColorFactor_, coldDoc.materials_ [ i ].baseColorFactor_, 4 * sizeof ( float ) ) == 0 );
+			QCOMPARE ( warmDoc.materials_ [ i ].alphaMode_, coldDoc.materials_ [ i ].alphaMode_ );
+		}
+		QCOMPARE ( warmDoc.bufferViews_.size (), coldDoc.bufferViews_.size () );
+		QCOMPARE ( warmDoc.buffers_.size (), coldDoc.buffers_.size () );
+		for ( qsizetype i = 0; i < coldDoc.accessors_.size (); i++ )
+		{
+			QCOMPARE ( warmDoc.accessors_ [ i ].bufferView_, coldDoc.accessors_ [ i ].bufferView_ );
+			QCOMPARE ( warmDoc.accessors_ [ i ].min_, coldDoc.accessors_ [ i ].min_ );
+			QCOMPARE ( warmDoc.accessors_ [ i ].max_, coldDoc.accessors_ [ i ].max_ );
+		}
+
+		// images come decoded out of the entry: from a file, a data: URI and a bufferView
+		const QString imageDir = dir.filePath ( "images" );
+		QVERIFY ( QDir ().mkpath ( imageDir ) );
+		for ( const char* name : { "test_external.gltf", "test.bin", "test.png" } )
+		{
+			// copies of resources are read-only
+			const QString copy = QDir ( imageDir ).filePath ( name );
+			QVERIFY ( QFile::copy ( QStringLiteral ( ":/test/%1" ).arg ( name ), copy ) );
+			QVERIFY ( QFile::setPermissions ( copy, QFileDevice::ReadOwner | QFileDevice::WriteOwner ) );
+		}
+		const QString textured = QDir ( imageDir ).filePath ( "test_external.gltf" );
+		GLTFLoader imagesCold;
+		imagesCold.setAssetCache ( &cache );
+		QVERIFY ( imagesCold.loadGLTF ( textured ) );
+		GLTFLoader imagesWarm;
+		imagesWarm.setAssetCache ( &cache );
+		QVERIFY ( imagesWarm.loadGLTF ( textured ) );
+		QVERIFY ( imagesWarm.isFromCache () );
+		QCOMPARE ( imagesWarm.document ().images_.size (), qsizetype ( 3 ) );
+		for ( qint32 i = 0; i < 3; i++ )
+		{
+			const jcqt::gltf::Image& a = imagesCold.document ().images_ [ i ];
+			const jcqt::gltf::Image& b = imagesWarm.document ().images_ [ i ];
+			QCOMPARE ( b.uri_, a.uri_ );
+			QCOMPARE ( b.dataPayload ().toByteArray (), a.dataPayload ().toByteArray () );
+			QCOMPARE ( b.mimeType_, a.mimeType_ );
+			QCOMPARE ( b.bufferView_, a.bufferView_ );
+			QVERIFY ( !imagesWarm.image ( i ).isNull () );
+			QCOMPARE ( imagesWarm.image ( i ), imagesCold.image ( i ) );
+		}
+		QVERIFY ( imagesWarm.bufferData ( 0 ).isEmpty () );
+		QVERIFY ( imagesWarm.accessorData ( 0 ).data_ == nullptr );
+
+		// an edited image file is a miss
+		QImage edited = imagesCold.image ( 0 );
+		edited.invertPixels ();
+		QVERIFY ( QFile::remove ( QDir ( imageDir ).filePath ( "test.png" ) ) );
+		QVERIFY ( edited.save ( QDir ( imageDir ).filePath ( "test.png" ) ) );
+		GLTFLoader imagesChanged;
+		imagesChanged.setAssetCache ( &cache );
+		QVERIFY ( imagesChanged.loadGLTF ( textured ) );
+		QVERIFY ( !imagesChanged.isFromCache () );
+		QCOMPARE ( imagesChanged.image ( 0 ).pixel ( 0, 0 ), edited.pixel ( 0, 0 ) );
+
+		// a changed external buffer is a miss, and the load that follows replaces the stale entry
+		QFile bin ( dir.filePath ( "cached.bin" ) );
+		QVERIFY ( bin.open ( QIODevice::ReadWrite ) );
+		QByteArray bytes = bin.readAll ();
+		bytes [ 0 ] = char ( bytes [ 0 ] ^ 1 );
+		QVERIFY ( bin.seek ( 0 ) && bin.write ( bytes ) == bytes.size () );
+		bin.close ();
+
+		GLTFLoader changed;
+		changed.setAssetCache ( &cache );
+		QVERIFY ( changed.loadGLTF ( filename ) );
+		QVERIFY ( !changed.isFromCache () );
+		GLTFLoader rewarmed;
+		rewarmed.setAssetCache ( &cache );
+		QVERIFY ( rewarmed.loadGLTF ( filename ) );
+		QVERIFY ( rewarmed.isFromCache () );
+
+		// .glb files are cached the same way
+		jcqt::SyntheticSceneOptions binary = options;
+		binary.storage_ = jcqt::SyntheticBufferStorage::GLB;
+		const QString glb = dir.filePath ( "cached.glb" );
+		QVERIFY ( jcqt::writeSyntheticGLTF ( glb, binary ) );
+		GLTFLoader glbCold;
+		glbCold.setAssetCache ( &cache );
+		QVERIFY ( glbCold.loadGLTF ( glb ) );
+		GLTFLoader glbWarm;
+		glbWarm.setAssetCache ( &cache );
+		QVERIFY ( glbWarm.loadGLTF ( glb ) );
+		QVERIFY ( glbWarm.isFromCache () );
+		QVERIFY ( glbWarm.isBinary () );
+		jcqt::Scene glbScene;
+		QVERIFY ( glbWarm.buildScene ( glbScene ) );
+		QVERIFY ( sameScene ( glbScene, coldScene, 0.0f ) );
+		glbWarm.clear ();
+
+		// a damaged entry fails its checksums and is a miss
+		QFile entry ( entryOf ( glb ) );
+		QVERIFY ( entry.open ( QIODevice::ReadWrite ) );
+		QVERIFY ( entry.seek ( entry.size () - 1 ) );
+		char last = 0;
+		QVERIFY ( entry.getChar ( &last ) );
+		QVERIFY ( entry.seek ( entry.size () - 1 ) && entry.putChar ( char ( last ^ 0x55 ) ) );
+		entry.close ();
+		GLTFLoader damaged;
+		damaged.setAssetCache ( &cache );
+		QVERIFY ( damaged.loadGLTF ( glb ) );
+		QVERIFY ( !damaged.isFromCache () );
+
+		// least recently used entries go first: a hit makes the oldest entry the newest
+		jcqt::AssetCache small ( dir.filePath ( "small" ) );
+		QStringList files;
+		for ( quint32 seed = 1; seed <= 3; seed++ )
+		{
+			jcqt::SyntheticSceneOptions o = binary;
+			o.seed_ = seed;
+			files.append ( dir.filePath ( QStringLiteral ( "evict%1.glb" ).arg ( seed ) ) );
+			QVERIFY ( jcqt::writeSyntheticGLTF ( files.last (), o ) );
+			GLTFLoader loader;
+			loader.setAssetCache ( &small );
+			QVERIFY ( loader.loadGLTF ( files.last () ) );
+		}
+
+		const QDateTime now = QDateTime::currentDateTimeUtc ();
+		auto entryIn = [&small] ( const QString& file )
+		{
+			QFile f ( file );
+			return f.open ( QIODevice::ReadOnly ) ? small.entryPath ( jcqt::AssetCache::key ( f.readAll () ) ) : QString ();
+		};
+		for ( qsizetype i = 0; i < files.size (); i++ )
+		{
+			QFile f ( entryIn ( files [ i ] ) );
+			QVERIFY ( f.open ( QIODevice::ReadWrite ) );
+			QVERIFY ( f.setFileTime ( now.addSecs ( 100 * ( i - 3 ) ), QFileDevice::FileModificationTime ) );
+		}
+
+		GLTFLoader touch;
+		touch.setAssetCache ( &small );
+		QVERIFY ( touch.loadGLTF ( files [ 0 ] ) );
+		QVERIFY ( touch.isFromCache () );
+		touch.clear ();
+
+		small.setMaxBytes ( small.size () - 1 );
+		QVERIFY ( QFileInfo::exists ( entryIn ( files [ 0 ] ) ) );
+		QVERIFY ( !QFileInfo::exists ( entryIn ( files [ 1 ] ) ) );
+		QVERIFY ( QFileInfo::exists ( entryIn ( files [ 2 ] ) ) );
+		QVERIFY ( small.size () <= small.maxBytes () );
+
+		// loaders on several threads sharing one directory through their own AssetCache, as separate processes would
+		const QString shared = dir.filePath ( "shared" );
+		const QStringList sources { filename, glb };
+		std::atomic<qint32> failures { 0 };
+		std::vector<std::thread> threads;
+		for ( qint32 t = 0; t < 8; t++ )
+		{
+			threads.emplace_back ( [&, t] () {
+				jcqt::AssetCache threadCache ( shared );
+				for ( qint32 i = 0; i < 4; i++ )
+				{
+					GLTFLoader loader;
+					loader.setAssetCache ( &threadCache );
+					jcqt::Scene scene;
+					if ( !loader.loadGLTF ( sources [ ( t + i ) % 2 ] ) || !loader.buildScene ( scene ) || !sameScene ( scene, coldScene, 0.0f ) )
+						failures++;
+				}
+			} );
+		}
+		for ( std::thread& thread : threads )
+			thread.join ();
+		QCOMPARE ( failures.load (), 0 );
+		QCOMPARE ( QDir ( shared ).entryList ( { "*.jcache" }, QDir::Files ).size (), qsizetype ( 2 ) );
+		QVERIFY ( QDir ( shared ).entryList ( { "*.tmp" }, QDir::Files ).isEmpty () );
+	}
+
 	void cleanupTestCase ()
 	{
 		qDebug ( "GLTFLoaderTest cleanupTestCase" );
@@ -27,44 +27,22 @@ SOFTWARE.
  * \date   September 2022
  *********************************************************************/
 #include "GLTFScene.h"
+#include "SceneFile.h"
+#include "Hash.h"
+#include "WorkStealingPool.h"
+#include "Trace.h"
 
 #include <QFile>
+#include <QVarLengthArray>
 #include <q20algorithm.h>
 
+#include <algorithm>
+#include <numeric>
+
 namespace jcqt
 {
 	static constexpr qsizetype kSizeMat4 = 16 * sizeof ( float );
 
-	static void saveStringList ( QFile* f, const QStringList& lines )
-	{
-		quint32 sz = ( quint32 ) lines.size ();
-		qint32 bytesWritten = f->write ( ( const char* ) &sz, sizeof ( quint32 ) );
-
-		if ( bytesWritten < 0 )
-		{
-			qDebug () << "WRITE operation returned -1. Failed to save StringList to file." << Qt::endl;
-			return;
-		}
-
-		for ( const QString& s : lines )
-		{
-			sz = ( quint32 ) s.length ();
-			bytesWritten = f->write ( ( const char* ) &sz, sizeof ( quint32 ) );
-			if ( bytesWritten < 0 )
-			{
-				qDebug () << "WRITE operation returned -1. Failed to save StringList to file." << Qt::endl;
-				return;
-			}
-
-			bytesWritten = f->write ( s.toStdString ().c_str (), sz + 1 );
-			if ( bytesWritten < 0 )
-			{
-				qDebug () << "WRITE operation returned -1. Failed to save StringList to file." << Qt::endl;
-				return;
-			}
-		}
-	}
-
 	static void loadStringList ( QFile* f, QStringList& lines )
 	{
 		{
@@ -102,11 +80,18 @@ namespace jcqt
 	{
 		qint32 node = ( qint32 ) scene.hierarchy_.size ();
 		{
-			// TODO: resize aux arrays (local/global etc.)
-			scene.localTransforms_.append ( gpumat4() );
+			// the new node starts out as the identity, as with addNodes()
+			scene.localTransforms_.append ( gpumat4 ( QMatrix4x4 () ) );
 			scene.globalTransforms_.append ( gpumat4 () );
 		}
 
+		if ( scene.splitTRS_ )
+		{
+			scene.translations_.append ( gpuvec3 ( 0.0f ) );
+			scene.rotations_.append ( gpuvec4 ( 0.0f, 0.0f, 0.0f, 1.0f ) );
+			scene.scales_.append ( gpuvec3 ( 1.0f ) );
+		}
+
 		scene.hierarchy_.append ( Hierarchy {
 			.parent_ = parent, 
 			.lastSibling_ = -1
@@ -147,46 +132,422 @@ namespace jcqt
 		scene.hierarchy_ [ node ].level_ = level;
 		scene.hierarchy_ [ node ].nextSibling_ = -1;
 		scene.hierarchy_ [ node ].firstChild_ = -1;
+
+		// a node added below a queued parent is queued too, markAsChanged() on the parent would skip it otherwise
+		if ( parent > -1 && parent < scene.dirty_.size () && scene.dirty_.testBit ( parent ) )
+		{
+			markAsChanged ( scene, node );
+		}
+
 		return node;
 	}
 
-	void markAsChanged ( Scene& scene, qint32 node )
+	NodeRange addNodes ( Scene& scene, const QList<qint32>& parents, const QList<qint32>& levels, const QList<gpumat4>& localTransforms )
 	{
-		// First, the node itself is marked as changed
-		qint32 level = scene.hierarchy_ [ node ].level_;
-		scene.changedAtThisFrame_ [ level ].append ( node );
+		const qint32 first = ( qint32 ) scene.hierarchy_.size ();
+		const qint32 count = ( qint32 ) parents.size ();
+		Q_ASSERT ( levels.size () == count && ( localTransforms.isEmpty () || localTransforms.size () == count ) );
+
+		// every array grows exactly once
+		scene.hierarchy_.resize ( first + count );
+		scene.globalTransforms_.resize ( first + count );
+		if ( localTransforms.isEmpty () )
+			scene.localTransforms_.resize ( first + count, gpumat4 ( QMatrix4x4 () ) );
+		else
+			scene.localTransforms_.append ( localTransforms );
+
+		if ( scene.splitTRS_ )
+		{
+			scene.translations_.resize ( first + count, gpuvec3 ( 0.0f ) );
+			scene.rotations_.resize ( first + count, gpuvec4 ( 0.0f, 0.0f, 0.0f, 1.0f ) );
+			scene.scales_.resize ( first + count, gpuvec3 ( 1.0f ) );
+			for ( qint32 i = 0; i < localTransforms.size (); i++ )
+				decomposeTRS ( localTransforms [ i ], scene.translations_ [ first + i ], scene.rotations_ [ first + i ], scene.scales_ [ first + i ] );
+		}
+
+		Hierarchy* h = scene.hierarchy_.data ();
+		for ( qint32 i = 0; i < count; i++ )
+		{
+			const qint32 node = first + i;
+			const qint32 parent = parents [ i ];
+			Q_ASSERT ( parent < node );
+
+			h [ node ] = Hierarchy { .parent_ = parent, .firstChild_ = -1, .nextSibling_ = -1, .lastSibling_ = -1, .level_ = levels [ i ] };
+			if ( parent < 0 )
+				continue;
+
+			// the parent's first child caches the tail of the list, so appending never walks it (at most once, if the cache is missing)
+			const qint32 s = h [ parent ].firstChild_;
+			if ( s == -1 )
+			{
+				h [ parent ].firstChild_ = node;
+				h [ node ].lastSibling_ = node;
+			}
+			else
+			{
+				qint32 tail = h [ s ].lastSibling_;
+				if ( tail < 0 )
+				{
+					for ( tail = s; h [ tail ].nextSibling_ != -1; tail = h [ tail ].nextSibling_ );
+				}
+				h [ tail ].nextSibling_ = node;
+				h [ s ].lastSibling_ = node;
+			}
+		}
 
-		// start from the first child and advance to the next sibling, descending into the hierarchy.
-		for ( qint32 s = scene.hierarchy_ [ node ].firstChild_; s != -1; s = scene.hierarchy_ [ s ].nextSibling_ )
+		// as in addNode(), nodes added below a queued parent are queued too; parents precede children, so this also covers nodes of the batch
+		if ( !scene.dirty_.isEmpty () )
 		{
-			markAsChanged ( scene, s );
+			for ( qint32 node = first; node < first + count; node++ )
+			{
+				const qint32 parent = h [ node ].parent_;
+				if ( parent > -1 && parent < scene.dirty_.size () && scene.dirty_.testBit ( parent ) )
+					markAsChanged ( scene, node );
+			}
 		}
+
+		return NodeRange { .begin_ = first, .end_ = first + count };
 	}
 
-	qint32 findNodeByName ( const Scene& scene, const QString& name )
+	void markAsChanged ( Scene& scene, qint32 node )
 	{
-		// Extremely simple linear search without any hierarchreference
-		// To support DFS/BFS searches separate travertsal routines are needed
-		for ( quint32 i = 0; i < scene.localTransforms_.size (); i++ )
+		if ( scene.dirty_.size () < scene.hierarchy_.size () )
+			scene.dirty_.resize ( scene.hierarchy_.size () );
+
+		// the whole subtree was queued together with this node
+		if ( scene.dirty_.testBit ( node ) )
+			return;
+
+		// explicit stack instead of recursion, so the depth of the hierarchy is not limited by the call stack
+		QVarLengthArray<qint32, 64> stack;
+		stack.append ( node );
+		scene.dirty_.setBit ( node );
+
+		while ( !stack.isEmpty () )
 		{
-			if ( scene.nameForNode_.contains ( i ) )
+			const qint32 n = stack.last ();
+			stack.removeLast ();
+
+			// First, the node itself is marked as changed
+			const qint32 level = scene.hierarchy_ [ n ].level_;
+			if ( level >= scene.changedAtThisFrame_.size () )
+				scene.changedAtThisFrame_.resize ( level + 1 );
+			scene.changedAtThisFrame_ [ level ].append ( n );
+
+			// start from the first child and advance to the next sibling; a dirty child already brought its subtree along
+			for ( qint32 s = scene.hierarchy_ [ n ].firstChild_; s != -1; s = scene.hierarchy_ [ s ].nextSibling_ )
 			{
-				qint32 strID = scene.nameForNode_.value ( i );				
-				if ( strID > -1 )
+				if ( !scene.dirty_.testBit ( s ) )
 				{
-					if ( scene.names_ [ strID ] == name )
-						return ( qint32 ) i;
+					scene.dirty_.setBit ( s );
+					stack.append ( s );
 				}
 			}
 		}
+	}
+
+	void enableSplitTRS ( Scene& scene )
+	{
+		// edits that are still pending would be lost by the decomposition
+		composeDirtyLocalTransforms ( scene );
+
+		const qsizetype count = scene.localTransforms_.size ();
+		scene.translations_.resize ( count );
+		scene.rotations_.resize ( count );
+		scene.scales_.resize ( count );
+		for ( qsizetype i = 0; i < count; i++ )
+			decomposeTRS ( scene.localTransforms_ [ i ], scene.translations_ [ i ], scene.rotations_ [ i ], scene.scales_ [ i ] );
+
+		scene.splitTRS_ = true;
+	}
+
+	void disableSplitTRS ( Scene& scene )
+	{
+		composeDirtyLocalTransforms ( scene );
+
+		scene.splitTRS_ = false;
+		scene.translations_.clear ();
+		scene.rotations_.clear ();
+		scene.scales_.clear ();
+		scene.trsDirty_.clear ();
+	}
+
+	// queues node for composition once, and its subtree for the global update
+	static void markTRSChanged ( Scene& scene, qint32 node )
+	{
+		Q_ASSERT ( scene.splitTRS_ );
+
+		if ( scene.trsDirty_.size () < scene.hierarchy_.size () )
+			scene.trsDirty_.resize ( scene.hierarchy_.size () );
+
+		if ( !scene.trsDirty_.testBit ( node ) )
+		{
+			scene.trsDirty_.setBit ( node );
+			scene.trsChanged_.append ( node );
+		}
+
+		markAsChanged ( scene, node );
+	}
+
+	void setNodeTRS ( Scene& scene, qint32 node, const gpuvec3& translation, const gpuvec4& rotation, const gpuvec3& scale )
+	{
+		scene.translations_ [ node ] = translation;
+		scene.rotations_ [ node ] = rotation;
+		scene.scales_ [ node ] = scale;
+		markTRSChanged ( scene, node );
+	}
+
+	void setNodeTranslation ( Scene& scene, qint32 node, const gpuvec3& translation )
+	{
+		scene.translations_ [ node ] = translation;
+		markTRSChanged ( scene, node );
+	}
+
+	void setNodeRotation ( Scene& scene, qint32 node, const gpuvec4& rotation )
+	{
+		scene.rotations_ [ node ] = rotation;
+		markTRSChanged ( scene, node );
+	}
+
+	void setNodeScale ( Scene& scene, qint32 node, const gpuvec3& scale )
+	{
+		scene.scales_ [ node ] = scale;
+		markTRSChanged ( scene, node );
+	}
+
+	// queued nodes are distinct, so large queues are split across the pool like the levels in propagateGlobalTransforms()
+	static void composeQueuedTRS ( Scene& scene, qint32 minParallelNodes )
+	{
+		const qsizetype count = scene.trsChanged_.size ();
+		if ( count == 0 )
+			return;
+
+		JCQT_TRACE_SPAN ( span, "composeTRS" );
+		JCQT_TRACE_COUNTS ( span, -1, count );
+
+		const gpuvec3* translations = scene.translations_.constData ();
+		const gpuvec4* rotations = scene.rotations_.constData ();
+		const gpuvec3* scales = scene.scales_.constData ();
+		const qint32* nodes = scene.trsChanged_.constData ();
+		gpumat4* local = scene.localTransforms_.data ();
+
+		if ( minParallelNodes > 0 && count >= minParallelNodes )
+		{
+			WorkStealingPool::globalInstance ().parallelFor ( count, minParallelNodes / 4, [=] ( qsizetype begin, qsizetype end ) {
+				composeTRSBatch ( translations, rotations, scales, nodes + begin, local, end - begin );
+			} );
+		}
+		else
+		{
+			composeTRSBatch ( translations, rotations, scales, nodes, local, count );
+		}
+
+		for ( qint32 n : scene.trsChanged_ )
+			scene.trsDirty_.clearBit ( n );
+		scene.trsChanged_.clear ();
+	}
+
+	void composeDirtyLocalTransforms ( Scene& scene )
+	{
+		composeQueuedTRS ( scene, 0 );
+	}
+
+	static quint64 nameHash ( const QString& name )
+	{
+		return hash64 ( name.constData (), name.size () * qsizetype ( sizeof ( QChar ) ) );
+	}
+
+	// Puts names[id] into the first free slot of its probe sequence; lookup must have a free slot
+	static void insertNameSlot ( QList<qint32>& lookup, const QStringList& names, qint32 id )
+	{
+		const quint64 mask = quint64 ( lookup.size () - 1 );
+		quint64 slot = nameHash ( names [ id ] ) & mask;
+		while ( lookup [ slot ] != -1 )
+			slot = ( slot + 1 ) & mask;
+		lookup [ slot ] = id;
+	}
+
+	// Whether the index covers names_ (it does not if names_ was filled directly)
+	static bool nameIndexValid ( const Scene& scene )
+	{
+		return scene.firstNodeForName_.size () == scene.names_.size () && scene.nextNodeWithName_.size () >= scene.nameForNode_.size () &&
+			scene.nameLookup_.size () >= 2 * scene.names_.size ();
+	}
+
+	// findNameId() and internName() for an index known to be valid; rebuildNameIndex() uses them while it refills the index
+	static qint32 findNameIdInIndex ( const Scene& scene, const QString& name )
+	{
+		if ( scene.nameLookup_.isEmpty () )
+			return -1;
+
+		// the table is at most half full, so the probe ends on an empty slot
+		const quint64 mask = quint64 ( scene.nameLookup_.size () - 1 );
+		for ( quint64 slot = nameHash ( name ) & mask; ; slot = ( slot + 1 ) & mask )
+		{
+			const qint32 id = scene.nameLookup_ [ slot ];
+			if ( id == -1 )
+				return -1;
+			if ( scene.names_ [ id ] == name )
+				return id;
+		}
+	}
+
+	static qint32 internNameInIndex ( Scene& scene, const QString& name )
+	{
+		const qint32 existing = findNameIdInIndex ( scene, name );
+		if ( existing != -1 )
+			return existing;
+
+		const qint32 id = ( qint32 ) scene.names_.size ();
+		scene.names_.append ( name );
+		scene.firstNodeForName_.append ( -1 );
+
+		if ( 2 * scene.names_.size () > scene.nameLookup_.size () )
+		{
+			// grow and rehash everything, keeping the table at most half full
+			qsizetype capacity = qMax ( scene.nameLookup_.size (), qsizetype ( 16 ) );
+			while ( capacity < 4 * scene.names_.size () )
+				capacity *= 2;
+			scene.nameLookup_ = QList<qint32> ( capacity, -1 );
+			for ( qint32 i = 0; i <= id; i++ )
+				insertNameSlot ( scene.nameLookup_, scene.names_, i );
+		}
+		else
+		{
+			insertNameSlot ( scene.nameLookup_, scene.names_, id );
+		}
+
+		return id;
+	}
+
+	qint32 findNameId ( const Scene& scene, const QString& name )
+	{
+		// names_ was filled directly and the index is stale: its ids could point past names_
+		if ( !nameIndexValid ( scene ) )
+			return ( qint32 ) scene.names_.indexOf ( name );
+
+		return findNameIdInIndex ( scene, name );
+	}
+
+	qint32 internName ( Scene& scene, const QString& name )
+	{
+		if ( !nameIndexValid ( scene ) )
+			rebuildNameIndex ( scene );
+
+		return internNameInIndex ( scene, name );
+	}
+
+	void rebuildNameIndex ( Scene& scene )
+	{
+		// intern the old entries in order, so a scene without duplicates keeps its name ids
+		const QStringList names = std::move ( scene.names_ );
+		scene.names_ = QStringList ();
+		scene.nameLookup_.clear ();
+		scene.firstNodeForName_.clear ();
+
+		QList<qint32> newIds ( names.size () );
+		for ( qsizetype i = 0; i < names.size (); i++ )
+			newIds [ i ] = internNameInIndex ( scene, names [ i ] );
+
+		const qint32 nodeCount = ( qint32 ) scene.nameForNode_.size ();
+		qint32* ids = scene.nameForNode_.data ();
+		scene.nextNodeWithName_ = QList<qint32> ( nodeCount, -1 );
+
+		// walking backwards and pushing at the front leaves every list in ascending order
+		for ( qint32 n = nodeCount - 1; n >= 0; n-- )
+		{
+			if ( ids [ n ] == -1 )
+				continue;
+			if ( ids [ n ] < 0 || ids [ n ] >= names.size () )
+			{
+				ids [ n ] = -1;
+				continue;
+			}
+
+			ids [ n ] = newIds [ ids [ n ] ];
+			scene.nextNodeWithName_ [ n ] = scene.firstNodeForName_ [ ids [ n ] ];
+			scene.firstNodeForName_ [ ids [ n ] ] = n;
+		}
+	}
+
+	void setNodeName ( Scene& scene, qint32 node, const QString& name )
+	{
+		if ( !nameIndexValid ( scene ) )
+			rebuildNameIndex ( scene );
+
+		QList<qint32>& next = scene.nextNodeWithName_;
+
+		// unlink the node from its old name
+		const qint32 oldId = scene.nameForNode_.value ( node );
+		if ( oldId != -1 )
+		{
+			qint32* link = &scene.firstNodeForName_ [ oldId ];
+			while ( *link != node )
+				link = &next [ *link ];
+			*link = next [ node ];
+			next [ node ] = -1;
+		}
+
+		const qint32 id = internNameInIndex ( scene, name );
+		scene.nameForNode_.insert ( node, id );
+		if ( next.size () < scene.nameForNode_.size () )
+			next.resize ( scene.nameForNode_.size (), -1 );
+
+		// link it in ascending order, so findNodeByName() returns the lowest node as the old linear search did
+		qint32* link = &scene.firstNodeForName_ [ id ];
+		while ( *link != -1 && *link < node )
+			link = &next [ *link ];
+		next [ node ] = *link;
+		*link = node;
+	}
+
+	qint32 findNodeByName ( const Scene& scene, const QString& name )
+	{
+		if ( nameIndexValid ( scene ) )
+		{
+			const qint32 id = findNameIdInIndex ( scene, name );
+			return ( id != -1 ) ? scene.firstNodeForName_ [ id ] : -1;
+		}
+
+		// names_ was filled directly and the index is stale: fall back to the linear search
+		for ( qint32 i = 0; i < scene.nameForNode_.size (); i++ )
+		{
+			qint32 strID = scene.nameForNode_.value ( i );
+			if ( strID > -1 && strID < scene.names_.size () )
+			{
+				if ( scene.names_ [ strID ] == name )
+					return ( qint32 ) i;
+			}
+		}
 
 		return -1;
 	}
 
+	QList<qint32> findNodesByName ( const Scene& scene, const QString& name )
+	{
+		QList<qint32> nodes;
+		if ( !nameIndexValid ( scene ) )
+		{
+			for ( qint32 i = 0; i < scene.nameForNode_.size (); i++ )
+			{
+				const qint32 strID = scene.nameForNode_.value ( i );
+				if ( strID > -1 && strID < scene.names_.size () && scene.names_ [ strID ] == name )
+					nodes.append ( i );
+			}
+			return nodes;
+		}
+
+		const qint32 id = findNameIdInIndex ( scene, name );
+		for ( qint32 n = ( id != -1 ) ? scene.firstNodeForName_ [ id ] : -1; n != -1; n = scene.nextNodeWithName_ [ n ] )
+			nodes.append ( n );
+		return nodes;
+	}
+
 	qint32 getNodeLevel ( const Scene& scene, qint32 n )
 	{
+		// count the nodes on the path from n up to its root
 		qint32 level = -1;
-		for ( qint32 p = 0; p != -1; p = scene.hierarchy_ [ p ].parent_, level++ );
+		for ( qint32 p = n; p != -1; p = scene.hierarchy_ [ p ].parent_, level++ );
 		return level;
 	}
 
@@ -235,51 +596,101 @@ namespace jcqt
 		return static_cast<float>(qmp.determinant ());
 	}
 
-	// CPU version of global transforms update []
-	void recalculateGlobalTransforms ( Scene& scene )
+	// global = parentGlobal * local for nodes [begin, end) of one level's changed list
+	static void updateGlobalTransforms ( const Hierarchy* hierarchy, const gpumat4* local, gpumat4* global, const qint32* nodes, qsizetype begin, qsizetype end )
 	{
-		// Start from the root layer of the list of changed scene nodes, supposing we have only one root node. This is because root node global transforms coincide with their local transforms. The changed nodes list is then cleared.
-		if ( !scene.changedAtThisFrame_ [ 0 ].empty () )
+		for ( qsizetype k = begin; k < end; k++ )
 		{
-			qint32 c = scene.changedAtThisFrame_ [ 0 ][ 0 ];
-			scene.globalTransforms_ [ c ] = scene.localTransforms_ [ c ];
-			scene.changedAtThisFrame_ [ 0 ].clear ();
+			const qint32 c = nodes [ k ];
+			mat4Multiply ( global [ hierarchy [ c ].parent_ ], local [ c ], global [ c ] );
 		}
+	}
+
+	static void propagateGlobalTransforms ( Scene& scene, qint32 minParallelNodes )
+	{
+		JCQT_TRACE_SPAN ( span, "recalculateGlobalTransforms" );
+#if defined(JCQT_TRACE)
+		qsizetype updated = scene.changedAtThisFrame_ [ 0 ].size ();
+#endif
+
+		// local matrices of nodes edited through the TRS setters are brought up to date first
+		composeQueuedTRS ( scene, minParallelNodes );
+
+		// changedAtThisFrame_ may also have been filled by hand
+		if ( scene.dirty_.size () < scene.hierarchy_.size () )
+			scene.dirty_.resize ( scene.hierarchy_.size () );
+
+		// raw pointers, so the workers below never touch the QList detach machinery
+		const Hierarchy* hierarchy = scene.hierarchy_.constData ();
+		const gpumat4* local = scene.localTransforms_.constData ();
+		gpumat4* global = scene.globalTransforms_.data ();
+
+		// Start from the root layer of the list of changed scene nodes. Root global transforms coincide with their local transforms.
+		for ( qint32 c : scene.changedAtThisFrame_ [ 0 ] )
+		{
+			global [ c ] = local [ c ];
+			scene.dirty_.clearBit ( c );
+		}
+		scene.changedAtThisFrame_ [ 0 ].clear ();
 
 		/*
-		*	For all the lower levels, we must ensure that we have parents so that the loops are linear and there are no conditions inside.
-		*	We will start from level 1 because the root level is already being handled. The exit condition is the emptiness of the list at the current level.
-		*	We will avoid descending deeper than our list allows.
+		*	Every lower level only reads parents that are final by now. A level may be empty (e.g. only a deep node was marked), so all buckets
+		*	are visited instead of stopping at the first empty one.
 		*/
 
-		for ( qint32 i = 1; i < MAX_NODE_LEVEL && ( !scene.changedAtThisFrame_ [ i ].empty () ); i++ )
+		for ( qint32 i = 1; i < scene.changedAtThisFrame_.size (); i++ )
 		{
 			// Iterate all the changed nodes at this level. For each of the iterated nodes, we fetch the parent transform and multiply it by the local node transform.
-			for ( const qint32& c : scene.changedAtThisFrame_ [ i ] )
+			// Nodes of one level only read their parents' finished transforms, so a large level is split across the pool.
+			const QList<qint32>& changed = scene.changedAtThisFrame_ [ i ];
+			if ( changed.isEmpty () )
+				continue;
+
+			// one span per level, so a spike can be pinned on the level (and the threads) that caused it
+			JCQT_TRACE_SPAN_INDEX ( levelSpan, "recalculateGlobalTransforms level", i );
+			JCQT_TRACE_COUNTS ( levelSpan, -1, changed.size () );
+#if defined(JCQT_TRACE)
+			updated += changed.size ();
+#endif
+
+			if ( minParallelNodes > 0 && changed.size () >= minParallelNodes )
 			{
-				qint32 p = scene.hierarchy_ [ c ].parent_;
-
-				// TODO: probably need a more efficient approach here
-//				const gpumat4& mp = scene.globalTransforms_ [ p ];
-//				const gpumat4& mc = scene.localTransforms_ [ c ];
-//				QMatrix4x4 qmp ( mp ( 0, 0 ), mp ( 1, 0 ), mp ( 2, 0 ), mp ( 3, 0 ), mp ( 0, 1 ), mp ( 1, 1 ), mp ( 2, 1 ), mp ( 3, 1 ), mp ( 0, 2 ), mp ( 1, 2 ), mp ( 2, 2 ), mp ( 3, 2 ), mp ( 0, 3 ), mp ( 1, 3 ), mp ( 2, 3 ), mp ( 3, 3 ) );
-//				QMatrix4x4 qmc ( mc ( 0, 0 ), mc ( 1, 0 ), mc ( 2, 0 ), mc ( 3, 0 ), mc ( 0, 1 ), mc ( 1, 1 ), mc ( 2, 1 ), mc ( 3, 1 ), mc ( 0, 2 ), mc ( 1, 2 ), mc ( 2, 2 ), mc ( 3, 2 ), mc ( 0, 3 ), mc ( 1, 3 ), mc ( 2, 3 ), mc ( 3, 3 ) );
-//				scene.globalTransforms_ [ c ] = scene.globalTransforms_ [ p ] * scene.localTransforms_ [ c ];
-
-				QMatrix4x4 qmp = gpumat4ToQMatrix4x4 ( scene.globalTransforms_ [ p ] );
-				QMatrix4x4 qmc = gpumat4ToQMatrix4x4 ( scene.localTransforms_ [ c ] );
-
-				scene.globalTransforms_ [ c ] = gpumat4 ( qmp * qmc );
+				const qint32* nodes = changed.constData ();
+				WorkStealingPool::globalInstance ().parallelFor ( changed.size (), minParallelNodes / 4, [=] ( qsizetype begin, qsizetype end ) {
+					updateGlobalTransforms ( hierarchy, local, global, nodes, begin, end );
+				} );
 			}
+			else
+			{
+				updateGlobalTransforms ( hierarchy, local, global, changed.constData (), 0, changed.size () );
+			}
+
+			// neighbouring bits share bytes, so they are cleared here rather than by the workers
+			for ( qint32 c : changed )
+				scene.dirty_.clearBit ( c );
 
 			// Clear the list for this level once we're done.
 			scene.changedAtThisFrame_ [ i ].clear ();
 		}
 
+		JCQT_TRACE_COUNTS ( span, -1, updated );
+
 		/* Since we start from the root layer of the scen graph tree, all the changed layers below the root acquire a valid global transformation for thier parents, and we do not have to recalculate any of the global transformations multiple times. */
 	}
 
-	void loadMap ( QFile* f, QHash<quint32, quint32>& hashMap )
+	// CPU version of global transforms update []
+	void recalculateGlobalTransforms ( Scene& scene )
+	{
+		propagateGlobalTransforms ( scene, 0 );
+	}
+
+	void recalculateGlobalTransformsParallel ( Scene& scene, qint32 minParallelNodes )
+	{
+		propagateGlobalTransforms ( scene, qMax ( minParallelNodes, 1 ) );
+	}
+
+	// The unversioned layout stored components as {node, value} pairs
+	void loadMap ( QFile* f, ComponentArray& components )
 	{
 		QList<quint32> ms;
 
@@ -302,15 +713,27 @@ namespace jcqt
 			return;
 		}
 
-		/* Convert the array into our hash table */
+		/* Scatter the pairs into the component array */
 		for ( qint32 i = 0; i < ( sz / 2 ); i++ )
 		{
-			hashMap [ ms [ i * 2 + 0 ] ] = ms [ i * 2 + 1 ];
+			components.insert ( ( qint32 ) ms [ i * 2 + 0 ], ( qint32 ) ms [ i * 2 + 1 ] );
 		}
 	}
 
-	void loadScene ( const QString& filename, Scene& scene )
+	void loadScene ( const QString& filename, Scene& scene, bool verifyChecksums )
 	{
+		// versioned files are mapped, validated and copied out one array at a time
+		if ( SceneFile::isSceneFile ( filename ) )
+		{
+			SceneFile file;
+			if ( !file.open ( filename, verifyChecksums ) || !file.load ( scene ) )
+			{
+				qDebug () << "Failed to load Scene from " << filename << Qt::endl;
+			}
+			return;
+		}
+
+		// unversioned layout of older saveScene() calls
 		QFile f ( filename );
 		f.open ( QIODeviceBase::ReadOnly );
 
@@ -320,6 +743,20 @@ namespace jcqt
 			return;
 		}
 
+		// pending changes refer to the previous contents
+		scene.changedAtThisFrame_ = QList<QList<qint32>> ( MAX_NODE_LEVEL );
+		scene.dirty_.clear ();
+		scene.meshes_.clear ();
+		scene.materialForNode_.clear ();
+		scene.nameForNode_.clear ();
+		// the file holds matrices only
+		scene.splitTRS_ = false;
+		scene.translations_.clear ();
+		scene.rotations_.clear ();
+		scene.scales_.clear ();
+		scene.trsChanged_.clear ();
+		scene.trsDirty_.clear ();
+
 		quint32 sz;
 		quint64 bytesRead = f.read ( ( char* ) &sz, sizeof ( sz ) );
 		if ( bytesRead < 0 )
@@ -328,6 +765,13 @@ namespace jcqt
 			return;
 		}
 
+		// those older saveScene() calls wrote the node count twice; as the first float of a transform the count would be a denormal
+		quint32 repeated = 0;
+		if ( sz > 0 && f.peek ( ( char* ) &repeated, sizeof ( repeated ) ) == sizeof ( repeated ) && repeated == sz )
+		{
+			f.skip ( sizeof ( repeated ) );
+		}
+
 		scene.hierarchy_.resize ( sz );
 		scene.globalTransforms_.resize ( sz );
 		scene.localTransforms_.resize ( sz );
@@ -365,93 +809,14 @@ namespace jcqt
 		}
 
 		f.close ();		
-	}
-
-	void saveMap ( QFile* f, const QHash<quint32, quint32>& hashMap )
-	{
-		/* temporary storage structure */
-		QList<quint32> ms;
-		ms.reserve ( hashMap.size () * 2 );
 
-		/* copy the elements ouf our map to our temporary storage */
-		for ( QHash<quint32, quint32>::const_iterator it = hashMap.cbegin (), end = hashMap.cend (); it != end; ++it )
-		{
-			ms.append ( it.key () );
-			ms.append ( it.value () );
-		}
-
-		/* write the number of {key,value} pairs to our file then write the data */
-		const quint32 sz = static_cast< quint32 >( ms.size () );
-		
-		qint64 bytesWritten = f->write ( ( const char* ) &sz, sizeof ( sz ) );
-		if ( bytesWritten < 0 )
-		{
-			qDebug () << "WRITE operation returned -1. Failed to save StringList to file." << Qt::endl;
-			return;
-		}
-		
-		bytesWritten = f->write ( ( const char* ) ms.data (), sizeof ( quint32 ) * ms.size () );
+		// older files may repeat names and carry no index
+		rebuildNameIndex ( scene );
 	}
 
-	void saveScene ( const QString& filename, const Scene& scene )
+	void saveScene ( const QString& filename, const Scene& scene, bool withChecksums )
 	{
-		/* At the beginning of the file, we must write the count of scene nodes. */
-		QFile f(filename);
-
-		if ( !f.open ( QIODeviceBase::WriteOnly ) )
-		{
-			qDebug () << "Failed to open " << filename << "! Cannot save scene." << Qt::endl;
-			return;
-		}
-
-		const quint32 sz = ( quint32 ) scene.hierarchy_.size ();
-		qint64 bytesWritten = f.write ( ( const char* ) &sz, sizeof ( sz ) );
-		if ( bytesWritten < 0 )
-		{
-			qDebug () << "WRITE operation returned -1. Failed to save Scene to file." << Qt::endl;
-			return;
-		}
-
-		bytesWritten = f.write ( ( const char* ) &sz, sizeof ( sz ) );
-		if ( bytesWritten < 0 )
-		{
-			qDebug () << "WRITE operation returned -1. Failed to save Scene to file." << Qt::endl;
-			return;
-		}
-
-		bytesWritten = f.write ( ( const char* ) scene.localTransforms_.constData (), kSizeMat4 * sz );
-		if ( bytesWritten < 0 )
-		{
-			qDebug () << "WRITE operation returned -1. Failed to save Scene to file." << Qt::endl;
-			return;
-		}
-
-		bytesWritten = f.write ( ( const char* ) scene.globalTransforms_.constData (), kSizeMat4 * sz );
-		if ( bytesWritten < 0 )
-		{
-			qDebug () << "WRITE operation returned -1. Failed to save Scene to file." << Qt::endl;
-			return;
-		}
-
-		bytesWritten = f.write ( ( const char* ) scene.hierarchy_.constData(), sizeof(Hierarchy) * sz);
-		if ( bytesWritten < 0 )
-		{
-			qDebug () << "WRITE operation returned -1. Failed to save Scene to file." << Qt::endl;
-			return;
-		}
-
-		// Mesh for node [index to some list of buffers]
-		saveMap ( &f, scene.materialForNode_ );
-		saveMap ( &f, scene.meshes_ );
-
-		if ( !scene.names_.empty () && !scene.nameForNode_.empty () )
-		{
-			saveMap ( &f, scene.nameForNode_ );
-			saveStringList ( &f, scene.names_ );
-			saveStringList ( &f, scene.materialNames_ );
-		}
-
-		f.close ();
+		SceneFile::save ( filename, scene, withChecksums );
 	}
 
 	//bool mat4IsIdentity ( const gpumat4& m )
@@ -515,8 +880,11 @@ namespace jcqt
 
 	void printChagedNodes ( const Scene& scene )
 	{
-		for ( qint32 i = 0; i < MAX_NODE_LEVEL && ( !scene.changedAtThisFrame_ [ i ].empty () ); i++ )
+		for ( qint32 i = 0; i < scene.changedAtThisFrame_.size (); i++ )
 		{
+			if ( scene.changedAtThisFrame_ [ i ].empty () )
+				continue;
+
 			qDebug () << "Changed at level(" << i << "):" << Qt::endl;
 
 			for ( const qint32& c : scene.changedAtThisFrame_ [ i ] )
@@ -553,9 +921,9 @@ namespace jcqt
 		{
 			QByteArray name = "";
 			QByteArray extra = "";
-			if ( scene.nameForNode_.contains ( i ) )
+			if ( scene.nameForNode_.contains ( ( qint32 ) i ) )
 			{
-				qint32 strID = scene.nameForNode_.value ( i );
+				qint32 strID = scene.nameForNode_.value ( ( qint32 ) i );
 				name = scene.names_ [ strID ].toLocal8Bit();
 			}
 
@@ -583,272 +951,503 @@ namespace jcqt
 		f.close ();
 	}
 
-	template <typename T>
-	inline void mergeLists ( QList<T>& l1, const QList<T>& l2 )
+	// Copies count component values to dst, adding valueOffset to the present ones; nodes past the end of src get none
+	static void copyComponents ( const ComponentArray& src, qint32* dst, qint32 count, qint32 valueOffset )
 	{
-		l1.insert ( l1.end (), l2.begin (), l2.end () );
+		const qint32 n = qMin ( count, ( qint32 ) src.size () );
+		const qint32* values = src.constData ();
+		for ( qint32 i = 0; i < n; i++ )
+		{
+			dst [ i ] = ( values [ i ] != ComponentArray::kNone ) ? values [ i ] + valueOffset : ComponentArray::kNone;
+		}
 	}
 
-	// Shift all hierarchy components in the nodes
-	static void shiftNodes ( Scene& scene, qint32 startOffset, qint32 nodeCount, qint32 shiftAmount )
+	/*
+	*	Sizes are known up front, so every destination array is allocated once and each sub-scene copies (and shifts) its own block. The
+	*	blocks do not overlap, which lets large merges copy the sub-scenes in parallel.
+	*/
+	void mergeScenes ( Scene& scene, const QList<Scene*>& scenes, const QList<gpumat4>& rootTransforms, const QList<quint32>& meshCounts, bool mergeMeshes, bool mergeMaterials )
 	{
-		auto shiftNode = [shiftAmount] ( Hierarchy& node )
-		{
-			if ( node.parent_ > -1 )
-				node.parent_ += shiftAmount;
-			if ( node.firstChild_ > -1 )
-				node.firstChild_ += shiftAmount;
-			if ( node.nextSibling_ > -1 )
-				node.nextSibling_ += shiftAmount;
-			if ( node.lastSibling_ > -1 )
-				node.lastSibling_ += shiftAmount;
-		};
+		JCQT_TRACE_SPAN ( span, "mergeScenes" );
+		const qsizetype sceneCount = scenes.size ();
 
-		for ( qint32 i = 0; i < nodeCount; i++ )
+		// the parts' local matrices are copied, so their pending TRS edits are composed first; the TRS storage survives if every part has it
+		bool splitTRS = sceneCount > 0;
+		for ( Scene* s : scenes )
 		{
-			shiftNode ( scene.hierarchy_ [ i + startOffset ] );
+			composeDirtyLocalTransforms ( *s );
+			splitTRS = splitTRS && s->splitTRS_;
 		}
-	}
 
-	// Add the items from otherMap shifting indices and values along the way
-	static void mergeMaps ( QHash<quint32, quint32>& m, const QHash<quint32, quint32>& otherMap, qint32 indexOffset, qint32 itemOffset )
-	{
-		QHashIterator<quint32, quint32> i ( otherMap );
-		while ( i.hasNext () )
+		// 1) Prefix sums: where each sub-scene's nodes, names, meshes and materials start (node 0 and name 0 are the new root's)
+		QList<qint32> nodeOffsets ( sceneCount + 1 );
+		QList<qint32> nameOffsets ( sceneCount + 1 );
+		QList<qint32> meshOffsets ( sceneCount + 1 );
+		QList<qint32> materialOffsets ( sceneCount + 1 );
+		nodeOffsets [ 0 ] = 1;
+		nameOffsets [ 0 ] = 1;
+		meshOffsets [ 0 ] = 0;
+		materialOffsets [ 0 ] = 0;
+		for ( qsizetype k = 0; k < sceneCount; k++ )
 		{
-			i.next ();
-			m.insert ( i.key () + indexOffset, i.value () + itemOffset );
+			const Scene* s = scenes [ k ];
+			nodeOffsets [ k + 1 ] = nodeOffsets [ k ] + ( qint32 ) s->hierarchy_.size ();
+			nameOffsets [ k + 1 ] = nameOffsets [ k ] + ( qint32 ) s->names_.size ();
+			meshOffsets [ k + 1 ] = meshOffsets [ k ] + ( ( mergeMeshes && k < meshCounts.size () ) ? ( qint32 ) meshCounts [ k ] : 0 );
+			materialOffsets [ k + 1 ] = materialOffsets [ k ] + ( mergeMaterials ? ( qint32 ) s->materialNames_.size () : 0 );
 		}
-	}
 
-	void mergeScenes ( Scene& scene, const QList<Scene*>& scenes, const QList<gpumat4>& rootTransforms, const QList<quint32>& meshCounts, bool mergeMeshes, bool mergeMaterials )
-	{
-		// Create the new root node
-		scene.hierarchy_ = {
+		// the old roots become siblings below the new root, skipping empty sub-scenes
+		QList<qint32> nextRoot ( sceneCount );
+		qint32 firstRoot = -1;
+		qint32 lastRoot = -1;
+		for ( qsizetype k = sceneCount - 1; k >= 0; k-- )
+		{
+			nextRoot [ k ] = firstRoot;
+			if ( nodeOffsets [ k + 1 ] > nodeOffsets [ k ] )
 			{
-				.parent_ = -1,
-				.firstChild_ = 1,
-				.nextSibling_ = -1,
-				.lastSibling_ = -1,
-				.level_ = 0
+				firstRoot = nodeOffsets [ k ];
+				if ( lastRoot == -1 )
+					lastRoot = firstRoot;
 			}
-		};
+		}
 
-		scene.nameForNode_ [ 0 ] = 0;
-		scene.names_ = { "NewRoot" };
+		// 2) Every destination array is allocated exactly once
+		const qint32 nodeCount = nodeOffsets [ sceneCount ];
+
+		scene.changedAtThisFrame_ = QList<QList<qint32>> ( MAX_NODE_LEVEL );
+		scene.dirty_.clear ();
+		scene.hierarchy_ = QList<Hierarchy> ( nodeCount );
+		scene.localTransforms_ = QList<gpumat4> ( nodeCount );
+		scene.globalTransforms_ = QList<gpumat4> ( nodeCount );
+		scene.meshes_ = ComponentArray ( nodeCount );
+		scene.materialForNode_ = ComponentArray ( nodeCount );
+		scene.nameForNode_ = ComponentArray ( nodeCount );
+		scene.names_ = QStringList ( nameOffsets [ sceneCount ] );
+
+		scene.splitTRS_ = splitTRS;
+		scene.translations_ = splitTRS ? QList<gpuvec3> ( nodeCount ) : QList<gpuvec3> ();
+		scene.rotations_ = splitTRS ? QList<gpuvec4> ( nodeCount ) : QList<gpuvec4> ();
+		scene.scales_ = splitTRS ? QList<gpuvec3> ( nodeCount ) : QList<gpuvec3> ();
+		scene.trsChanged_.clear ();
+		scene.trsDirty_.clear ();
+
+		if ( mergeMaterials )
+		{
+			scene.materialNames_ = QStringList ();
+			scene.materialNames_.reserve ( materialOffsets [ sceneCount ] );
+			for ( const Scene* s : scenes )
+				scene.materialNames_.append ( s->materialNames_ );
+		}
+		else
+		{
+			scene.materialNames_ = scenes.isEmpty () ? QStringList () : scenes [ 0 ]->materialNames_;
+		}
+
+		// Create the new root node
+		scene.hierarchy_ [ 0 ] = Hierarchy {
+			.parent_ = -1,
+			.firstChild_ = firstRoot,
+			.nextSibling_ = -1,
+			.lastSibling_ = -1,
+			.level_ = 0
+		};
 
 		QMatrix4x4 qidMat;
 		qidMat.setToIdentity ();
+		scene.localTransforms_ [ 0 ] = gpumat4 ( qidMat );
+		scene.globalTransforms_ [ 0 ] = gpumat4 ( qidMat );
+		scene.nameForNode_.insert ( 0, 0 );
+		scene.names_ [ 0 ] = "NewRoot";
 
-		scene.localTransforms_.push_back ( gpumat4(qidMat) );
-		scene.globalTransforms_.push_back ( gpumat4(qidMat) );
-
-		if ( scenes.empty () )
+		if ( splitTRS )
 		{
-			return;
+			scene.translations_ [ 0 ] = gpuvec3 ( 0.0f );
+			scene.rotations_ [ 0 ] = gpuvec4 ( 0.0f, 0.0f, 0.0f, 1.0f );
+			scene.scales_ [ 0 ] = gpuvec3 ( 1.0f );
 		}
 
-		qint32 offs = 1;
-		qint32 meshOffs = 0;
-		qint32 nameOffs = ( int ) scene.names_.size ();
-		qint32 materialOfs = 0;
-		auto meshCount = meshCounts.begin ();
-
-		if ( !mergeMaterials )
+		// 3) Copy and shift the blocks. Links move by the node offset, levels by one (the new root), component values by their offsets.
+		Hierarchy* hierarchy = scene.hierarchy_.data ();
+		gpumat4* local = scene.localTransforms_.data ();
+		gpumat4* global = scene.globalTransforms_.data ();
+		qint32* meshes = scene.meshes_.data ();
+		qint32* materials = scene.materialForNode_.data ();
+		qint32* nameForNode = scene.nameForNode_.data ();
+		QString* names = scene.names_.data ();
+		gpuvec3* translations = splitTRS ? scene.translations_.data () : nullptr;
+		gpuvec4* rotations = splitTRS ? scene.rotations_.data () : nullptr;
+		gpuvec3* scales = splitTRS ? scene.scales_.data () : nullptr;
+
+		auto copyScenes = [&] ( qsizetype begin, qsizetype end )
 		{
-			scene.materialNames_ = scenes [ 0 ]->materialNames_;
-		}
+			for ( qsizetype k = begin; k < end; k++ )
+			{
+				const Scene& s = *scenes [ k ];
+				const qint32 offs = nodeOffsets [ k ];
+				const qint32 count = nodeOffsets [ k + 1 ] - offs;
+				if ( count == 0 )
+					continue;
+
+				auto shift = [offs] ( qint32 index ) { return ( index != -1 ) ? index + offs : -1; };
+				const Hierarchy* src = s.hierarchy_.constData ();
+				Hierarchy* dst = hierarchy + offs;
+				for ( qint32 i = 0; i < count; i++ )
+				{
+					dst [ i ] = Hierarchy {
+						.parent_ = shift ( src [ i ].parent_ ),
+						.firstChild_ = shift ( src [ i ].firstChild_ ),
+						.nextSibling_ = shift ( src [ i ].nextSibling_ ),
+						.lastSibling_ = shift ( src [ i ].lastSibling_ ),
+						.level_ = src [ i ].level_ + 1
+					};
+				}
 
-		// FIXME: too much logic (for all the components in a scene, though mesh data and materials go separately - there are dedicated data lists)
-		for ( const Scene* s : scenes )
-		{
-			mergeLists ( scene.localTransforms_, s->localTransforms_ );
-			mergeLists ( scene.globalTransforms_, s->globalTransforms_ );
+				// attach the old root to the new one
+				dst [ 0 ].parent_ = 0;
+				dst [ 0 ].nextSibling_ = nextRoot [ k ];
+				dst [ 0 ].lastSibling_ = -1;
 
-			mergeLists ( scene.hierarchy_, s->hierarchy_ );
+				memcpy ( local + offs, s.localTransforms_.constData (), count * sizeof ( gpumat4 ) );
+				memcpy ( global + offs, s.globalTransforms_.constData (), count * sizeof ( gpumat4 ) );
 
-			mergeLists ( scene.names_, s->names_ );
-			if ( mergeMaterials )
-			{
-				mergeLists ( scene.materialNames_, s->materialNames_ );
+				// transform old root nodes, if the transforms are given
+				if ( k < rootTransforms.size () )
+				{
+					mat4Multiply ( rootTransforms [ k ], local [ offs ], local [ offs ] );
+				}
+
+				if ( splitTRS )
+				{
+					memcpy ( translations + offs, s.translations_.constData (), count * sizeof ( gpuvec3 ) );
+					memcpy ( rotations + offs, s.rotations_.constData (), count * sizeof ( gpuvec4 ) );
+					memcpy ( scales + offs, s.scales_.constData (), count * sizeof ( gpuvec3 ) );
+					if ( k < rootTransforms.size () )
+						decomposeTRS ( local [ offs ], translations [ offs ], rotations [ offs ], scales [ offs ] );
+				}
+
+				copyComponents ( s.meshes_, meshes + offs, count, meshOffsets [ k ] );
+				copyComponents ( s.materialForNode_, materials + offs, count, materialOffsets [ k ] );
+				copyComponents ( s.nameForNode_, nameForNode + offs, count, nameOffsets [ k ] );
+				std::copy ( s.names_.cbegin (), s.names_.cend (), names + nameOffsets [ k ] );
 			}
+		};
 
-			qint32 nodeCount = ( qint32 ) s->hierarchy_.size ();
+		if ( nodeCount >= PARALLEL_MERGE_THRESHOLD && sceneCount > 1 )
+			WorkStealingPool::globalInstance ().parallelFor ( sceneCount, 1, copyScenes );
+		else
+			copyScenes ( 0, sceneCount );
 
-			shiftNodes ( scene, offs, nodeCount, offs );
+		// as in addNode(), the first child caches the last one
+		if ( firstRoot != -1 )
+			hierarchy [ firstRoot ].lastSibling_ = lastRoot;
 
-			mergeMaps ( scene.meshes_, s->meshes_, offs, mergeMeshes ? meshOffs : 0 );
-			mergeMaps ( scene.materialForNode_, s->materialForNode_, offs, mergeMaterials ? materialOfs : 0 );
-			mergeMaps ( scene.nameForNode_, s->nameForNode_, offs, nameOffs );
+		// the parts may share names, intern them once
+		rebuildNameIndex ( scene );
+		JCQT_TRACE_COUNTS ( span, -1, nodeCount );
+	}
 
-			offs += nodeCount;
+	/** Bulk deletion of scene nodes: every step is a linear pass over the nodes, whatever the number or order of the nodes to delete */
 
-			materialOfs += ( qint32 ) s->materialNames_.size ();
-			nameOffs += ( qint32 ) s->names_.size ();
+	// Links the surviving nodes of an old sibling chain in the new hierarchy, returns the new { first, last } (-1 if none survive)
+	static QPair<qint32, qint32> relinkSiblings ( const Hierarchy* oldHierarchy, const QList<qint32>& newIndices, QList<Hierarchy>& hierarchy, qint32 first )
+	{
+		qint32 head = -1;
+		qint32 tail = -1;
+		for ( qint32 s = first; s != -1; s = oldHierarchy [ s ].nextSibling_ )
+		{
+			const qint32 n = newIndices [ s ];
+			if ( n == -1 )
+				continue;
 
-			if ( mergeMeshes )
-			{
-				meshOffs += *meshCount;
-				meshCount++;
-			}
+			if ( head == -1 )
+				head = n;
+			else
+				hierarchy [ tail ].nextSibling_ = n;
+			tail = n;
 		}
+		return { head, tail };
+	}
 
-		// fixing 'nextSibling' fields in the old roots (zero-index in all the scenes)
-		offs = 1;
-		qint32 idx = 0;
-		for ( const Scene* s : scenes )
+	// O(N) (N = scene size) deletion of a collection of nodes together with their subtrees
+	void deleteSceneNodes ( Scene& scene, const QList<quint32>& nodesToDelete )
+	{
+		JCQT_TRACE_SPAN ( span, "deleteSceneNodes" );
+		JCQT_TRACE_COUNTS ( span, -1, nodesToDelete.size () );
+		const qint32 nodeCount = ( qint32 ) scene.hierarchy_.size ();
+		const Hierarchy* oldHierarchy = scene.hierarchy_.constData ();
+
+		// nothing is left queued for composition, the TRS arrays below are compacted like the matrices
+		composeDirtyLocalTransforms ( scene );
+
+		// 1) Mark the nodes and everything below them; a node that is already marked brought its subtree along
+		QBitArray deleted ( nodeCount );
+		QList<qint32> stack;
+		for ( quint32 node : nodesToDelete )
 		{
-			qint32 nodeCount = ( qint32 ) s->hierarchy_.size ();
-			bool isLast = ( idx == scenes.size () - 1 );
-			// calculate new next sibling for the old scene roots
-			qint32 next = isLast ? -1 : offs + nodeCount;
-			scene.hierarchy_ [ offs ].nextSibling_ = next;
-			// attach to new root
-			scene.hierarchy_ [ offs ].parent_ = 0;
+			if ( node >= quint32 ( nodeCount ) || deleted.testBit ( node ) )
+				continue;
 
-			// transform old root nodes, if the transforms are given
-			if ( !rootTransforms.empty () )
+			deleted.setBit ( node );
+			stack.append ( ( qint32 ) node );
+			while ( !stack.isEmpty () )
 			{
-				// TODO: need to find a better way to multiply gpumat4
-				QMatrix4x4 qrtTrans = gpumat4ToQMatrix4x4 ( rootTransforms [ idx ] );
-				QMatrix4x4 qlocTrans = gpumat4ToQMatrix4x4 ( scene.localTransforms_ [ offs ] );
-//				scene.localTransforms_ [ offs ] = rootTransforms [ idx ] * scene.localTransforms_ [ offs ];
-				scene.localTransforms_ [ offs ] = gpumat4 ( qrtTrans * qlocTrans );
+				const qint32 n = stack.takeLast ();
+				for ( qint32 c = oldHierarchy [ n ].firstChild_; c != -1; c = oldHierarchy [ c ].nextSibling_ )
+				{
+					if ( !deleted.testBit ( c ) )
+					{
+						deleted.setBit ( c );
+						stack.append ( c );
+					}
+				}
 			}
-
-			offs += nodeCount;
-			idx++;
 		}
 
-		// now shift levels of all nodes below the root
-		for ( auto i = scene.hierarchy_.begin () + 1; i != scene.hierarchy_.end (); i++ )
+		// 2) The newIndices[oldIndex] table, survivors keep their relative order
+		QList<qint32> newIndices ( nodeCount );
+		qint32 kept = 0;
+		for ( qint32 i = 0; i < nodeCount; i++ )
 		{
-			i->level_++;
+			newIndices [ i ] = deleted.testBit ( i ) ? -1 : kept++;
 		}
-	}
 
-	/** A rather long algorithm (and the auxiliary routines) to delete a number of scene nodes from the hierarchy */
+		if ( kept == nodeCount )
+			return;
 
+		/*
+		*	3) Rebuild the links. Subtrees go as a whole, so the parent of a survivor survives too. Each child list is relinked from the old
+		*	sibling chain, skipping the deleted children, and its first child caches the last one as addNode() does. Levels do not change.
+		*/
+		QList<Hierarchy> hierarchy ( kept );
+		for ( qint32 i = 0; i < nodeCount; i++ )
+		{
+			if ( newIndices [ i ] == -1 )
+				continue;
 
-	// From https://stackoverflow.com/a/64152990/1182653
-	// Delete a list of items from std::vector with indices in 'selection'
-	template <class T, class Index = int> inline void eraseSelected ( QList<T>& v, const QList<Index>& selection )
-		// e.g., eraseSelected({1, 2, 3, 4, 5}, {1, 3})  ->   {1, 3, 5}
-		//                         ^     ^    2 and 4 get deleted
-	{
-		// cut off the elements moved to the end of the vector by std::stable_partition
-		v.resize ( std::distance (
-			v.begin (),
-			// the stable_partition moves any element whose index is in 'selection' to the end
-			std::stable_partition ( v.begin (), v.end (),
-				[&selection, &v] ( const T& item ) {
-					return !std::binary_search (
-						selection.begin (), selection.end (),
-						/* std::distance(std::find(v.begin(), v.end(), item), v.begin()) - if you don't like the pointer arithmetic below */
-						static_cast< Index >( static_cast< const T* >( &item ) - &v [ 0 ] ) );
-				} ) ) );
-	}
+			const Hierarchy& h = oldHierarchy [ i ];
+			hierarchy [ newIndices [ i ] ] = Hierarchy {
+				.parent_ = ( h.parent_ != -1 ) ? newIndices [ h.parent_ ] : -1,
+				.firstChild_ = -1,
+				.nextSibling_ = -1,
+				.lastSibling_ = -1,
+				.level_ = h.level_
+			};
+		}
 
-	// Add an index to a sorted index array
-	static void addUniqueIdx ( QList<quint32>& v, quint32 index )
-	{
-		if ( !std::binary_search ( v.begin (), v.end (), index ) )
+		// roots have no parent to own their sibling chain, so find the chain heads: roots no other root points to as its next sibling
+		QBitArray chainedRoot ( nodeCount );
+		for ( qint32 i = 0; i < nodeCount; i++ )
 		{
-			v.push_back ( index );
+			const Hierarchy& h = oldHierarchy [ i ];
+			if ( h.parent_ == -1 && h.nextSibling_ != -1 )
+				chainedRoot.setBit ( h.nextSibling_ );
 		}
-	}
 
-	// Recurse down from a node and collect all nodes which are already marked for deletion
-	static void collectNodesToDelete ( const Scene& scene, qint32 node, QList<quint32>& nodes )
-	{
-		for ( qint32 n = scene.hierarchy_ [ node ].firstChild_; n != -1; n = scene.hierarchy_ [ n ].nextSibling_ )
+		for ( qint32 i = 0; i < nodeCount; i++ )
 		{
-			addUniqueIdx ( nodes, n );
-			collectNodesToDelete ( scene, n, nodes );
+			const Hierarchy& h = oldHierarchy [ i ];
+			if ( newIndices [ i ] != -1 && h.firstChild_ != -1 )
+			{
+				const auto [ first, last ] = relinkSiblings ( oldHierarchy, newIndices, hierarchy, h.firstChild_ );
+				hierarchy [ newIndices [ i ] ].firstChild_ = first;
+				if ( first != -1 )
+					hierarchy [ first ].lastSibling_ = last;
+			}
+
+			if ( h.parent_ == -1 && !chainedRoot.testBit ( i ) )
+			{
+				relinkSiblings ( oldHierarchy, newIndices, hierarchy, i );
+			}
 		}
-	}
 
-	static qint32 findLastNonDeletedItem ( const Scene& scene, const QList<qint32>& newIndices, qint32 node )
-	{
-		// we have to be more subtle:
-		// if the (newIndices[firstChild_] == - 1), we should follow the link and extract the last non-removed item
-		if ( node == -1 )
+		/*
+		*	4) Compact the transforms and the component arrays in place in a single sweep. newIndices[i] <= i, so nothing is overwritten
+		*	before it is read. The component arrays are padded to the scene size first, they may be shorter.
+		*/
+		scene.meshes_.resize ( nodeCount );
+		scene.materialForNode_.resize ( nodeCount );
+		scene.nameForNode_.resize ( nodeCount );
+
+		gpumat4* local = scene.localTransforms_.data ();
+		gpumat4* global = scene.globalTransforms_.data ();
+		qint32* meshes = scene.meshes_.data ();
+		qint32* materials = scene.materialForNode_.data ();
+		qint32* names = scene.nameForNode_.data ();
+		gpuvec3* translations = scene.splitTRS_ ? scene.translations_.data () : nullptr;
+		gpuvec4* rotations = scene.splitTRS_ ? scene.rotations_.data () : nullptr;
+		gpuvec3* scales = scene.splitTRS_ ? scene.scales_.data () : nullptr;
+
+		for ( qint32 i = 0; i < nodeCount; i++ )
 		{
-			return -1;
+			const qint32 n = newIndices [ i ];
+			if ( n == -1 || n == i )
+				continue;
+
+			local [ n ] = local [ i ];
+			global [ n ] = global [ i ];
+			meshes [ n ] = meshes [ i ];
+			materials [ n ] = materials [ i ];
+			names [ n ] = names [ i ];
+			if ( translations )
+			{
+				translations [ n ] = translations [ i ];
+				rotations [ n ] = rotations [ i ];
+				scales [ n ] = scales [ i ];
+			}
 		}
 
-		return ( newIndices [ node ] == -1 ) ? findLastNonDeletedItem ( scene, newIndices, scene.hierarchy_ [ node ].nextSibling_ ) : newIndices [ node ];
-	}
+		scene.hierarchy_ = std::move ( hierarchy );
+		scene.localTransforms_.resize ( kept );
+		scene.globalTransforms_.resize ( kept );
+		scene.meshes_.resize ( kept );
+		scene.materialForNode_.resize ( kept );
+		scene.nameForNode_.resize ( kept );
+		if ( scene.splitTRS_ )
+		{
+			scene.translations_.resize ( kept );
+			scene.rotations_.resize ( kept );
+			scene.scales_.resize ( kept );
+			scene.trsDirty_.clear ();
+		}
 
-	static void shiftMapIndices ( QHash<quint32, quint32>& items, const QList<qint32>& newIndices )
-	{
-		QHash<quint32, quint32> newItems;
-		QHashIterator<quint32, quint32> m ( items );
-		while ( m.hasNext () )
+		// 5) scene node names list is not modified, but in principle it can be (remove all non-used items and adjust the nameForNode_ map);
+		//    the name index links nodes by index, so it is rebuilt
+		// 6) Material names list is not modified also, but if some materials fell out of use
+		rebuildNameIndex ( scene );
+
+		// 7) Pending changes follow their nodes, the deleted ones are dropped
+		scene.dirty_ = QBitArray ( scene.hierarchy_.size () );
+		for ( QList<qint32>& changed : scene.changedAtThisFrame_ )
 		{
-			m.next ();
-			qint32 newIndex = newIndices [ m.key () ];
-			if ( newIndex != -1 )
+			qsizetype queued = 0;
+			for ( qint32 c : changed )
 			{
-				newItems.insert ( newIndex, m.value () );
+				const qint32 n = newIndices [ c ];
+				if ( n != -1 )
+				{
+					changed [ queued++ ] = n;
+					scene.dirty_.setBit ( n );
+				}
 			}
+			changed.resize ( queued );
 		}
-
-		items = newItems;
 	}
 
-	// Approximately an O ( N * Log(N) * Log(M)) algorithm (N = scene.size, M = nodesToDelete.size) to delete a collection of nodes from scene graph
-	void deleteSceneNodes ( Scene& scene, const QList<quint32>& nodesToDelete )
+	QList<qint32> reorderSceneBreadthFirst ( Scene& scene )
 	{
-		// 0) Add all the nodes down below in the hierarchy
-		auto indicesToDelete = nodesToDelete;
-		for ( auto i : indicesToDelete )
+		const qint32 nodeCount = ( qint32 ) scene.hierarchy_.size ();
+		JCQT_TRACE_SPAN ( span, "reorderSceneBreadthFirst" );
+		JCQT_TRACE_COUNTS ( span, -1, nodeCount );
+
+		// the TRS queue holds old indices, drain it instead of remapping it
+		composeDirtyLocalTransforms ( scene );
+
+		// order doubles as the queue: roots first, then the children of order[head] in sibling order
+		QList<qint32> order;
+		order.reserve ( nodeCount );
+		for ( qint32 i = 0; i < nodeCount; i++ )
 		{
-			collectNodesToDelete ( scene, i, indicesToDelete );
+			if ( scene.hierarchy_ [ i ].parent_ == -1 )
+				order.append ( i );
 		}
 
-		// aux array with node indices to keep track of the moved ones [moved = [](node) { return (node != nodes[node]); ]
-		QList<qint32> nodes ( scene.hierarchy_.size () );
-		std::iota ( nodes.begin (), nodes.end (), 0 );
+		for ( qint32 head = 0; head < order.size (); head++ )
+		{
+			for ( qint32 s = scene.hierarchy_ [ order [ head ] ].firstChild_; s != -1; s = scene.hierarchy_ [ s ].nextSibling_ )
+				order.append ( s );
+		}
 
-		// 1.a) Move all the indicesToDelete to the end of 'nodes' array (and cut them off, a variation of swap'n'pop for multiple elements)
-		auto oldSize = nodes.size ();
-		eraseSelected ( nodes, indicesToDelete );
+		Q_ASSERT ( order.size () == nodeCount );
 
-		// 1.b) Make a newIndices[oldIndex] mapping table
-		QList<qint32> newIndices ( oldSize, -1 );
-		for ( int i = 0; i < nodes.size (); i++ )
+		QList<qint32> newIndices ( nodeCount );
+		for ( qint32 i = 0; i < nodeCount; i++ )
 		{
-			newIndices [ nodes [ i ] ] = i;
+			newIndices [ order [ i ] ] = i;
 		}
 
-		// 2) Replace all non-null parent/firstChild/nextSibling pointers in all the nodes by new positions
-		auto nodeMover = [&scene, &newIndices] ( Hierarchy& h ) {
-			return Hierarchy {
-				.parent_ = ( h.parent_ != -1 ) ? newIndices [ h.parent_ ] : -1,
-				.firstChild_ = findLastNonDeletedItem ( scene, newIndices, h.firstChild_ ),
-				.nextSibling_ = findLastNonDeletedItem ( scene, newIndices, h.nextSibling_ ),
-				.lastSibling_ = findLastNonDeletedItem ( scene, newIndices, h.lastSibling_ )
+		auto remap = [&newIndices] ( qint32 index ) { return index != -1 ? newIndices [ index ] : -1; };
+
+		QList<Hierarchy> hierarchy ( nodeCount );
+		QList<gpumat4> localTransforms ( nodeCount );
+		QList<gpumat4> globalTransforms ( nodeCount );
+		for ( qint32 i = 0; i < nodeCount; i++ )
+		{
+			const Hierarchy& h = scene.hierarchy_ [ order [ i ] ];
+			hierarchy [ i ] = Hierarchy {
+				.parent_ = remap ( h.parent_ ),
+				.firstChild_ = remap ( h.firstChild_ ),
+				.nextSibling_ = remap ( h.nextSibling_ ),
+				.lastSibling_ = remap ( h.lastSibling_ ),
+				.level_ = h.level_
 			};
-		};
+			localTransforms [ i ] = scene.localTransforms_ [ order [ i ] ];
+			globalTransforms [ i ] = scene.globalTransforms_ [ order [ i ] ];
+		}
 
-		std::transform ( scene.hierarchy_.begin (), scene.hierarchy_.end (), scene.hierarchy_.begin (), nodeMover );
+		scene.hierarchy_ = std::move ( hierarchy );
+		scene.localTransforms_ = std::move ( localTransforms );
+		scene.globalTransforms_ = std::move ( globalTransforms );
 
-		// 3) Finally throw away the hierarchy items
-		eraseSelected ( scene.hierarchy_, indicesToDelete );
+		if ( scene.splitTRS_ )
+		{
+			QList<gpuvec3> translations ( nodeCount );
+			QList<gpuvec4> rotations ( nodeCount );
+			QList<gpuvec3> scales ( nodeCount );
+			for ( qint32 i = 0; i < nodeCount; i++ )
+			{
+				translations [ i ] = scene.translations_ [ order [ i ] ];
+				rotations [ i ] = scene.rotations_ [ order [ i ] ];
+				scales [ i ] = scene.scales_ [ order [ i ] ];
+			}
+			scene.translations_ = std::move ( translations );
+			scene.rotations_ = std::move ( rotations );
+			scene.scales_ = std::move ( scales );
+		}
 
-		// 4) As in mergeScenes() routine we also have to adjust all the "components" (i.e., meshes, materials, names and transformations)
+		scene.meshes_.remap ( newIndices, nodeCount );
+		scene.materialForNode_.remap ( newIndices, nodeCount );
+		scene.nameForNode_.remap ( newIndices, nodeCount );
+		rebuildNameIndex ( scene );
 
-		// 4a) Transformations are stored in arrays, so we just erase the items as we did iwith the scene.hierarchy_
-		eraseSelected ( scene.localTransforms_, indicesToDelete );
-		eraseSelected ( scene.globalTransforms_, indicesToDelete );
+		// pending changes stay in their level buckets
+		scene.dirty_ = QBitArray ( nodeCount );
+		for ( QList<qint32>& changed : scene.changedAtThisFrame_ )
+		{
+			for ( qint32& c : changed )
+			{
+				c = newIndices [ c ];
+				scene.dirty_.setBit ( c );
+			}
+		}
+
+		return newIndices;
+	}
 
-		// 4b) All the maps should change the key values with the newIndices[] array
-		shiftMapIndices ( scene.meshes_, newIndices );
-		shiftMapIndices ( scene.materialForNode_, newIndices );
-		shiftMapIndices ( scene.nameForNode_, newIndices );
+	void recalculateAllGlobalTransforms ( Scene& scene )
+	{
+		composeDirtyLocalTransforms ( scene );
 
-		// 5) scene node names list is not modified, but in principle it can be (remove all non-used items and adjust the nameForNode_ map)
-		// 6) Material names list is not modified also, but if some materials fell out of use
+		const qsizetype nodeCount = scene.hierarchy_.size ();
+		JCQT_TRACE_SPAN ( span, "recalculateAllGlobalTransforms" );
+		JCQT_TRACE_COUNTS ( span, -1, nodeCount );
+		const Hierarchy* hierarchy = scene.hierarchy_.constData ();
+		const gpumat4* local = scene.localTransforms_.constData ();
+		gpumat4* global = scene.globalTransforms_.data ();
+
+		for ( qsizetype i = 0; i < nodeCount; i++ )
+		{
+			const qint32 p = hierarchy [ i ].parent_;
+			Q_ASSERT ( p < i );
+			if ( p == -1 )
+				global [ i ] = local [ i ];
+			else
+				mat4Multiply ( global [ p ], local [ i ], global [ i ] );
+		}
+
+		// everything is up to date now
+		for ( QList<qint32>& changed : scene.changedAtThisFrame_ )
+			changed.clear ();
+		scene.dirty_.fill ( false );
 	}
 }
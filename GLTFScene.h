@@ -31,12 +31,18 @@ SOFTWARE.
 
 #include <QList>
 #include <QString>
-#include <QHash>
+#include <QBitArray>
 #include "vec4.h"
+#include "ComponentArray.h"
 
 namespace jcqt
 {
+	// Number of level buckets a Scene starts with. Deeper hierarchies are fine, markAsChanged() adds buckets as it needs them.
 	constexpr const qint32 MAX_NODE_LEVEL = 16;
+	// Levels with fewer changed nodes than this are updated serially by recalculateGlobalTransformsParallel()
+	constexpr const qint32 PARALLEL_TRANSFORM_THRESHOLD = 4096;
+	// mergeScenes() copies the sub-scenes in parallel once the merged scene has this many nodes
+	constexpr const qint32 PARALLEL_MERGE_THRESHOLD = 65536;
 
 	struct Hierarchy
 	{
@@ -67,65 +73,156 @@ namespace jcqt
 		QList<gpumat4> localTransforms_;
 		QList<gpumat4> globalTransforms_;
 
-		// list of nodes whose global transform must be recalculated
-		QList<qint32> changedAtThisFrame_ [ MAX_NODE_LEVEL ];
+		// list of nodes whose global transform must be recalculated, one bucket per level
+		QList<QList<qint32>> changedAtThisFrame_ = QList<QList<qint32>> ( MAX_NODE_LEVEL );
+
+		// one bit per node, set while the node sits in changedAtThisFrame_ (may be shorter than hierarchy_, missing bits are clear)
+		QBitArray dirty_;
+
+		/*
+		*	Optional split TRS storage, switched on by enableSplitTRS(). While splitTRS_ is set, translations_, rotations_ and scales_ hold one
+		*	entry per node and are the source of localTransforms_: nodes edited through setNodeTRS() and friends are listed in trsChanged_
+		*	(and flagged in trsDirty_) until composeDirtyLocalTransforms() rebuilds their local matrices.
+		*/
+		bool splitTRS_ = false;
+		QList<gpuvec3> translations_;
+		// unit quaternions (x, y, z, w)
+		QList<gpuvec4> rotations_;
+		QList<gpuvec3> scales_;
+		QList<qint32> trsChanged_;
+		QBitArray trsDirty_;
 
 		// Hierarchy components
 		QList<Hierarchy> hierarchy_;
 
 		// Meshes for nodes (Node -> Mesh)
-		QHash<quint32, quint32> meshes_;
+		ComponentArray meshes_;
 
 		// Materials for nodes (Node -> Material) 
-		QHash<quint32, quint32> materialForNode_;
+		ComponentArray materialForNode_;
 
 		/* Useful for debugging */
 		// Node names: which name is assigned to the node
-		QHash<quint32, quint32> nameForNode_;
+		ComponentArray nameForNode_;
 
-		// Collection of scene node names
+		// Collection of scene node names, each distinct name stored once (see rebuildNameIndex())
 		QStringList names_;
 
+		/* Name index, kept in sync by setNodeName(), mergeScenes(), deleteSceneNodes() and reorderSceneBreadthFirst() */
+		// Open-addressing table (power-of-two size, linear probing) of hash64(name) -> index into names_, -1 for an empty slot
+		QList<qint32> nameLookup_;
+		// Nodes sharing a name are linked in ascending order: firstNodeForName_[nameId] -> nextNodeWithName_[node] -> ... -> -1
+		QList<qint32> firstNodeForName_;
+		QList<qint32> nextNodeWithName_;
+
 		// Collection of debug material names
 		QStringList materialNames_;
 	};
 
+	// Appends one node below parent (-1 for a root) with the identity as its local transform and returns its index
 	qint32 addNode ( Scene& scene, qint32 parent, qint32 level );
 
-	// markAsChanged() routine starts with a given node and recursively descends to each and every child node, adding it to the changedAtLevel_ arrays. 
+	// Half-open range of node indices [begin_, end_)
+	struct NodeRange
+	{
+		qint32 begin_;
+		qint32 end_;
+	};
+
+	/*
+	*	Adds parents.size() nodes in one go: node i gets parents[i] (-1 for a root, otherwise an existing node or an earlier node of the
+	*	batch), levels[i] and localTransforms[i] (the identity if localTransforms is empty, as addNode() gives). Storage grows once, and every
+	*	child is appended in O(1) through the tail cache on its parent's first child. Returns the indices of the new nodes.
+	*/
+	NodeRange addNodes ( Scene& scene, const QList<qint32>& parents, const QList<qint32>& levels, const QList<gpumat4>& localTransforms = {} );
+
+	/*
+	*	markAsChanged() starts with a given node and descends (iteratively) to each and every child node, adding it to the changedAtThisFrame_
+	*	bucket of its level. A node that is already dirty is skipped together with its subtree, which was marked along with it, so
+	*	overlapping edits within one frame never queue a node twice.
+	*/
 	void markAsChanged ( Scene& scene, qint32 node );
 
-	int findNodeByName ( const Scene& scene, const QString& name );
+	/*
+	*	Switches the scene to split TRS storage, decomposing every current local transform. Matrices with shear or projection do not survive
+	*	the round trip. addNode(), addNodes(), mergeScenes(), deleteSceneNodes() and reorderSceneBreadthFirst() keep the storage in sync.
+	*/
+	void enableSplitTRS ( Scene& scene );
+	// Drops the TRS arrays after composing pending edits, localTransforms_ become the only source again
+	void disableSplitTRS ( Scene& scene );
+
+	// Setters of the split TRS storage: the node is queued for composition and, like markAsChanged(), its subtree for the global update
+	void setNodeTRS ( Scene& scene, qint32 node, const gpuvec3& translation, const gpuvec4& rotation, const gpuvec3& scale );
+	void setNodeTranslation ( Scene& scene, qint32 node, const gpuvec3& translation );
+	void setNodeRotation ( Scene& scene, qint32 node, const gpuvec4& rotation );
+	void setNodeScale ( Scene& scene, qint32 node, const gpuvec3& scale );
+
+	// Rebuilds the local matrices of the nodes queued in trsChanged_ in SIMD batches; the recalculate functions run it first
+	void composeDirtyLocalTransforms ( Scene& scene );
+
+	// O(1) through the name index: the lowest node called name, or -1
+	qint32 findNodeByName ( const Scene& scene, const QString& name );
+	// Every node called name, in ascending order
+	QList<qint32> findNodesByName ( const Scene& scene, const QString& name );
 
 	inline QString getNodeName ( const Scene& scene, qint32 node )
 	{	
 		qint32 strID = scene.nameForNode_.value ( node, -1 );	
-		return ( strID > -1 ) ? scene.names_.at ( strID ) : QString ();
+		return ( strID > -1 && strID < scene.names_.size () ) ? scene.names_.at ( strID ) : QString ();
 	}
 
-	inline void setNodeName ( Scene& scene, int node, const QString& name )
-	{
-		quint32 stringID = ( quint32 ) scene.names_.size ();
-		scene.names_.append ( name );
-		scene.nameForNode_ [ node ] = stringID;
-	}
+	// Names the node, reusing the names_ entry if the name is already known, and moves the node to that name in the index
+	void setNodeName ( Scene& scene, qint32 node, const QString& name );
+
+	// Index of name in names_, appended (and added to the index) if it is not there yet. A stale index is rebuilt first.
+	qint32 internName ( Scene& scene, const QString& name );
+	// Index of name in names_, or -1. Falls back to a linear search while the index is stale.
+	qint32 findNameId ( const Scene& scene, const QString& name );
 
+	/*
+	*	Merges duplicate entries of names_ (remapping nameForNode_) and rebuilds the name index from nameForNode_. Needed after names_ or
+	*	nameForNode_ were filled directly instead of through setNodeName().
+	*/
+	void rebuildNameIndex ( Scene& scene );
+
+	// Depth of n walking the parent links (0 for a root); the cached Hierarchy::level_ should agree
 	qint32 getNodeLevel ( const Scene& scene, qint32 n );
 
 	void recalculateGlobalTransforms ( Scene& scene );
+	// Same result, but the changed nodes of every level holding at least minParallelNodes of them are split across the WorkStealingPool
+	void recalculateGlobalTransformsParallel ( Scene& scene, qint32 minParallelNodes = PARALLEL_TRANSFORM_THRESHOLD );
 
-	void loadScene ( const QString& filename, Scene& scene );
-	void saveScene ( const QString& filename, const Scene& scene );
+	/*
+	*	Reads both the versioned format of SceneFile.h and the older unversioned layout. verifyChecksums hashes every section of a versioned
+	*	file before loading it, a full extra pass over the file; without it load() still range checks everything it indexes with.
+	*/
+	void loadScene ( const QString& filename, Scene& scene, bool verifyChecksums = false );
+	// Writes the versioned format, see SceneFile
+	void saveScene ( const QString& filename, const Scene& scene, bool withChecksums = true );
 
 	void dumpTransformations ( const QString& filename, const Scene& scene );
 	void printChagedNodes ( const Scene& scene );
 
 	void dumpSceneToDot ( const QString& filename, const Scene& scene, qint32* visited = nullptr );
 
+	/*
+	*	Replaces scene with a new root ("NewRoot") that has the roots of scenes as its children, optionally transformed by rootTransforms.
+	*	Mesh and material indices are shifted past the earlier scenes' meshes (meshCounts) and materials when the respective flag is set.
+	*/
 	void mergeScenes ( Scene& scene, const QList<Scene*>& scenes, const QList<gpumat4>& rootTransforms, const QList<quint32>& meshCounts, bool mergeMeshes = true, bool mergeMaterials = true );
 
-	// Delete a collection of nodes from a scenegraph
+	// Delete a collection of nodes (in any order, duplicates allowed) and their subtrees from a scenegraph in O(scene size)
 	void deleteSceneNodes ( Scene& scene, const QList<quint32>& nodesToDelete );
+
+	/*
+	*	Physically reorders the nodes breadth-first: all roots, then every level in turn, with the children of one parent adjacent and in
+	*	sibling order. Transforms, hierarchy links, the node-keyed components and pending changes are all moved along. Returns the
+	*	old -> new index permutation so callers can remap node handles they keep elsewhere.
+	*/
+	QList<qint32> reorderSceneBreadthFirst ( Scene& scene );
+
+	// Recomputes every global transform in one linear sweep. Only valid if each parent precedes its children, as after reorderSceneBreadthFirst().
+	void recalculateAllGlobalTransforms ( Scene& scene );
 }
 
 
@@ -0,0 +1,208 @@
+/*****************************************************************//**
+ * \file   GLTFSceneBuilder.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  builds a flat jcqt::Scene from a parsed glTF document
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "GLTFSceneBuilder.h"
+#include "Trace.h"
+
+#include <QDebug>
+
+namespace jcqt
+{
+	// column major T * R * S of a glTF node, the rotation quaternion is (x, y, z, w)
+	static void composeTRS ( const gltf::Node& node, gpumat4& m )
+	{
+		const gpuvec3 t ( node.translation_ [ 0 ], node.translation_ [ 1 ], node.translation_ [ 2 ] );
+		const gpuvec4 r ( node.rotation_ [ 0 ], node.rotation_ [ 1 ], node.rotation_ [ 2 ], node.rotation_ [ 3 ] );
+		const gpuvec3 s ( node.scale_ [ 0 ], node.scale_ [ 1 ], node.scale_ [ 2 ] );
+		composeTRS ( t, r, s, m );
+	}
+
+	bool buildScene ( const gltf::Document& doc, Scene& scene, qint32 sceneIndex )
+	{
+		JCQT_TRACE_SPAN ( span, "buildScene" );
+		const qint32 gltfNodeCount = ( qint32 ) doc.nodes_.size ();
+		JCQT_TRACE_COUNTS ( span, -1, gltfNodeCount );
+
+		if ( sceneIndex < 0 )
+		{
+			sceneIndex = doc.scene_ >= 0 ? doc.scene_ : 0;
+		}
+
+		QList<qint32> roots;
+		QString rootName;
+		if ( sceneIndex < doc.scenes_.size () )
+		{
+			roots = doc.scenes_ [ sceneIndex ].nodes_;
+			rootName = doc.scenes_ [ sceneIndex ].name_;
+		}
+		else if ( !doc.scenes_.isEmpty () )
+		{
+			qWarning () << "glTF document has no scene " << sceneIndex << Qt::endl;
+			return false;
+		}
+		else
+		{
+			// without scenes every node that is nobody's child is a root
+			QList<bool> isChild ( gltfNodeCount, false );
+			for ( const gltf::Node& node : doc.nodes_ )
+			{
+				for ( qint32 c : node.children_ )
+				{
+					if ( c >= 0 && c < gltfNodeCount )
+						isChild [ c ] = true;
+				}
+			}
+
+			for ( qint32 i = 0; i < gltfNodeCount; i++ )
+			{
+				if ( !isChild [ i ] )
+					roots.append ( i );
+			}
+		}
+
+		if ( rootName.isEmpty () )
+		{
+			rootName = QStringLiteral ( "SceneRoot" );
+		}
+
+		/*
+		*	1) Breadth-first order. order doubles as the queue: the children of order[head] are appended together, so they end up adjacent.
+		*	glTF nodes must form a strict tree, a node reached a second time (or out of range) is skipped with a warning.
+		*/
+		QList<qint32> order;
+		QList<qint32> parents;
+		order.reserve ( gltfNodeCount + 1 );
+		parents.reserve ( gltfNodeCount + 1 );
+		QList<bool> visited ( gltfNodeCount, false );
+
+		auto enqueue = [&] ( qint32 gltfNode, qint32 parent )
+		{
+			if ( gltfNode < 0 || gltfNode >= gltfNodeCount || visited [ gltfNode ] )
+			{
+				qWarning () << "Skipping invalid or repeated glTF node " << gltfNode << Qt::endl;
+				return;
+			}
+			visited [ gltfNode ] = true;
+			order.append ( gltfNode );
+			parents.append ( parent );
+		};
+
+		// the synthetic root
+		order.append ( -1 );
+		parents.append ( -1 );
+		for ( qint32 r : roots )
+		{
+			enqueue ( r, 0 );
+		}
+
+		for ( qint32 head = 1; head < order.size (); head++ )
+		{
+			for ( qint32 c : doc.nodes_ [ order [ head ] ].children_ )
+			{
+				enqueue ( c, head );
+			}
+		}
+
+		// 2) Every array is allocated exactly once
+		const qint32 nodeCount = ( qint32 ) order.size ();
+
+		scene = Scene ();
+		scene.hierarchy_.resize ( nodeCount );
+		scene.localTransforms_.resize ( nodeCount );
+		scene.globalTransforms_.resize ( nodeCount );
+		scene.meshes_.resize ( nodeCount );
+		scene.materialForNode_.resize ( nodeCount );
+		scene.nameForNode_.resize ( nodeCount );
+		scene.names_.reserve ( nodeCount );
+		scene.materialNames_.reserve ( doc.materials_.size () );
+
+		for ( const gltf::Material& material : doc.materials_ )
+		{
+			scene.materialNames_.append ( material.name_ );
+		}
+
+		QMatrix4x4 identity;
+		scene.hierarchy_ [ 0 ] = Hierarchy { .parent_ = -1, .firstChild_ = -1, .nextSibling_ = -1, .lastSibling_ = -1, .level_ = 0 };
+		scene.localTransforms_ [ 0 ] = gpumat4 ( identity );
+		scene.globalTransforms_ [ 0 ] = scene.localTransforms_ [ 0 ];
+		scene.names_.append ( rootName );
+		scene.nameForNode_.insert ( 0, 0 );
+
+		/*
+		*	3) One linear sweep. Siblings are adjacent, so the previous node is the previous sibling unless this is the parent's first child;
+		*	as in addNode() the first child caches the last sibling. Parents come first, their level and global transform are already final.
+		*/
+		for ( qint32 i = 1; i < nodeCount; i++ )
+		{
+			const gltf::Node& node = doc.nodes_ [ order [ i ] ];
+			const qint32 p = parents [ i ];
+			Hierarchy& parent = scene.hierarchy_ [ p ];
+
+			scene.hierarchy_ [ i ] = Hierarchy { .parent_ = p, .firstChild_ = -1, .nextSibling_ = -1, .lastSibling_ = -1, .level_ = parent.level_ + 1 };
+
+			if ( parent.firstChild_ == -1 )
+			{
+				parent.firstChild_ = i;
+				scene.hierarchy_ [ i ].lastSibling_ = i;
+			}
+			else
+			{
+				scene.hierarchy_ [ i - 1 ].nextSibling_ = i;
+				scene.hierarchy_ [ parent.firstChild_ ].lastSibling_ = i;
+			}
+
+			gpumat4& local = scene.localTransforms_ [ i ];
+			if ( node.hasMatrix_ )
+				memcpy ( local.data_, node.matrix_, sizeof ( local.data_ ) );
+			else
+				composeTRS ( node, local );
+
+			mat4Multiply ( scene.globalTransforms_ [ p ], local, scene.globalTransforms_ [ i ] );
+
+			if ( node.mesh_ >= 0 && node.mesh_ < doc.meshes_.size () )
+			{
+				scene.meshes_.insert ( i, node.mesh_ );
+
+				const gltf::Mesh& mesh = doc.meshes_ [ node.mesh_ ];
+				if ( !mesh.primitives_.isEmpty () && mesh.primitives_ [ 0 ].material_ >= 0 )
+					scene.materialForNode_.insert ( i, mesh.primitives_ [ 0 ].material_ );
+			}
+
+			if ( !node.name_.isEmpty () )
+			{
+				scene.nameForNode_.insert ( i, ( qint32 ) scene.names_.size () );
+				scene.names_.append ( node.name_ );
+			}
+		}
+
+		// glTF names are often repeated (every instance of a mesh), intern them and index them in one pass
+		rebuildNameIndex ( scene );
+
+		return true;
+	}
+}
@@ -0,0 +1,48 @@
+/*****************************************************************//**
+ * \file   GLTFSceneBuilder.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  builds a flat jcqt::Scene from a parsed glTF document
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __GLTF_SCENE_BUILDER_H__
+#define __GLTF_SCENE_BUILDER_H__
+
+#include "GLTFDocument.h"
+#include "GLTFScene.h"
+
+namespace jcqt
+{
+	/*
+	*	Replaces scene with doc.scenes[sceneIndex] (doc.scene, or the first scene, for -1; every parentless node if the document has no scenes).
+	*	Node 0 is a new identity root standing for the glTF scene, since a glTF scene may list several root nodes. The glTF nodes follow in
+	*	breadth-first order, so children of one parent are adjacent and parents precede their children. All arrays are sized once up front,
+	*	local transforms are composed from the matrix or TRS properties, levels and global transforms are computed in the same sweep.
+	*	meshes_ gets the node's mesh, materialForNode_ the material of its first primitive and materialNames_ the document's material names.
+	*	Repeated node names are interned once and indexed for findNodeByName().
+	*/
+	bool buildScene ( const gltf::Document& doc, Scene& scene, qint32 sceneIndex = -1 );
+}
+
+#endif // !__GLTF_SCENE_BUILDER_H__
@@ -0,0 +1,140 @@
+/*****************************************************************//**
+ * \file   Hash.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  fast non-cryptographic 64-bit hashing (XXH64)
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "Hash.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+namespace jcqt
+{
+	static constexpr quint64 kPrime1 = 0x9E3779B185EBCA87ull;
+	static constexpr quint64 kPrime2 = 0xC2B2AE3D27D4EB4Full;
+	static constexpr quint64 kPrime3 = 0x165667B19E3779F9ull;
+	static constexpr quint64 kPrime4 = 0x85EBCA77C2B2AE63ull;
+	static constexpr quint64 kPrime5 = 0x27D4EB2F165667C5ull;
+
+	static inline quint64 rotl64 ( quint64 x, int r )
+	{
+		return ( x << r ) | ( x >> ( 64 - r ) );
+	}
+
+	// the input is read as little endian words, whatever the host is
+	static inline quint64 read64 ( const uchar* p )
+	{
+		quint64 v;
+		memcpy ( &v, p, sizeof ( v ) );
+		return qFromLittleEndian ( v );
+	}
+
+	static inline quint32 read32 ( const uchar* p )
+	{
+		quint32 v;
+		memcpy ( &v, p, sizeof ( v ) );
+		return qFromLittleEndian ( v );
+	}
+
+	static inline quint64 round ( quint64 acc, quint64 input )
+	{
+		acc += input * kPrime2;
+		acc = rotl64 ( acc, 31 );
+		return acc * kPrime1;
+	}
+
+	static inline quint64 mergeRound ( quint64 acc, quint64 val )
+	{
+		acc ^= round ( 0, val );
+		return acc * kPrime1 + kPrime4;
+	}
+
+	quint64 hash64 ( const void* data, qsizetype size, quint64 seed )
+	{
+		const uchar* p = static_cast<const uchar*>( data );
+		const uchar* const end = p + size;
+		quint64 h;
+
+		// four independent lanes over 32-byte stripes
+		if ( size >= 32 )
+		{
+			quint64 v1 = seed + kPrime1 + kPrime2;
+			quint64 v2 = seed + kPrime2;
+			quint64 v3 = seed;
+			quint64 v4 = seed - kPrime1;
+
+			const uchar* const limit = end - 32;
+			do
+			{
+				v1 = round ( v1, read64 ( p ) );
+				v2 = round ( v2, read64 ( p + 8 ) );
+				v3 = round ( v3, read64 ( p + 16 ) );
+				v4 = round ( v4, read64 ( p + 24 ) );
+				p += 32;
+			} while ( p <= limit );
+
+			h = rotl64 ( v1, 1 ) + rotl64 ( v2, 7 ) + rotl64 ( v3, 12 ) + rotl64 ( v4, 18 );
+			h = mergeRound ( h, v1 );
+			h = mergeRound ( h, v2 );
+			h = mergeRound ( h, v3 );
+			h = mergeRound ( h, v4 );
+		}
+		else
+		{
+			h = seed + kPrime5;
+		}
+
+		h += quint64 ( size );
+
+		for ( ; p + 8 <= end; p += 8 )
+		{
+			h ^= round ( 0, read64 ( p ) );
+			h = rotl64 ( h, 27 ) * kPrime1 + kPrime4;
+		}
+
+		if ( p + 4 <= end )
+		{
+			h ^= quint64 ( read32 ( p ) ) * kPrime1;
+			h = rotl64 ( h, 23 ) * kPrime2 + kPrime3;
+			p += 4;
+		}
+
+		for ( ; p < end; p++ )
+		{
+			h ^= quint64 ( *p ) * kPrime5;
+			h = rotl64 ( h, 11 ) * kPrime1;
+		}
+
+		// avalanche
+		h ^= h >> 33;
+		h *= kPrime2;
+		h ^= h >> 29;
+		h *= kPrime3;
+		h ^= h >> 32;
+		return h;
+	}
+}
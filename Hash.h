@@ -0,0 +1,46 @@
+/*****************************************************************//**
+ * \file   Hash.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  fast non-cryptographic 64-bit hashing (XXH64)
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __HASH_H__
+#define __HASH_H__
+
+#include <QtGlobal>
+#include <QByteArrayView>
+
+namespace jcqt
+{
+	// XXH64 of size bytes at data, bit-compatible with the reference implementation. Used for file checksums, not for security.
+	quint64 hash64 ( const void* data, qsizetype size, quint64 seed = 0 );
+
+	inline quint64 hash64 ( QByteArrayView bytes, quint64 seed = 0 )
+	{
+		return hash64 ( bytes.data (), bytes.size (), seed );
+	}
+}
+
+#endif // !__HASH_H__
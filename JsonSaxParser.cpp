@@ -0,0 +1,477 @@
+/*****************************************************************//**
+ * \file   JsonSaxParser.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "JsonSaxParser.h"
+
+#include <QVarLengthArray>
+
+#include <charconv>
+#include <cstring>
+
+namespace jcqt
+{
+	static inline bool isJsonWhitespace ( char c )
+	{
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	static inline qint32 hexDigit ( char c )
+	{
+		if ( c >= '0' && c <= '9' ) return c - '0';
+		if ( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+		if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+		return -1;
+	}
+
+	static void appendUtf8 ( QByteArray& out, quint32 cp )
+	{
+		if ( cp < 0x80 )
+		{
+			out.append ( char ( cp ) );
+		}
+		else if ( cp < 0x800 )
+		{
+			out.append ( char ( 0xC0 | ( cp >> 6 ) ) );
+			out.append ( char ( 0x80 | ( cp & 0x3F ) ) );
+		}
+		else if ( cp < 0x10000 )
+		{
+			out.append ( char ( 0xE0 | ( cp >> 12 ) ) );
+			out.append ( char ( 0x80 | ( ( cp >> 6 ) & 0x3F ) ) );
+			out.append ( char ( 0x80 | ( cp & 0x3F ) ) );
+		}
+		else
+		{
+			out.append ( char ( 0xF0 | ( cp >> 18 ) ) );
+			out.append ( char ( 0x80 | ( ( cp >> 12 ) & 0x3F ) ) );
+			out.append ( char ( 0x80 | ( ( cp >> 6 ) & 0x3F ) ) );
+			out.append ( char ( 0x80 | ( cp & 0x3F ) ) );
+		}
+	}
+
+	bool JsonSaxParser::fail ( const char* message )
+	{
+		m_error = QString::fromLatin1 ( message );
+		m_errorOffset = m_cur - m_begin;
+		return false;
+	}
+
+	void JsonSaxParser::skipWhitespace ()
+	{
+		while ( m_cur < m_end && isJsonWhitespace ( *m_cur ) )
+			m_cur++;
+	}
+
+	bool JsonSaxParser::parseString ( QByteArrayView& out )
+	{
+		// m_cur points at the opening quote
+		const char* start = ++m_cur;
+
+		// Fast path: no escape sequences, hand out a view into the input
+		while ( m_cur < m_end && *m_cur != '"' && *m_cur != '\\' )
+		{
+			if ( static_cast< uchar >( *m_cur ) < 0x20 )
+				return fail ( "control character in string" );
+			m_cur++;
+		}
+
+		if ( m_cur >= m_end )
+			return fail ( "unterminated string" );
+
+		if ( *m_cur == '"' )
+		{
+			out = QByteArrayView ( start, m_cur - start );
+			m_cur++;
+			return true;
+		}
+
+		// Slow path: unescape into the scratch buffer
+		m_scratch.clear ();
+		m_scratch.append ( start, m_cur - start );
+
+		while ( m_cur < m_end && *m_cur != '"' )
+		{
+			const char c = *m_cur++;
+			if ( static_cast< uchar >( c ) < 0x20 )
+				return fail ( "control character in string" );
+
+			if ( c != '\\' )
+			{
+				m_scratch.append ( c );
+				continue;
+			}
+
+			if ( m_cur >= m_end )
+				return fail ( "unterminated escape sequence" );
+
+			const char e = *m_cur++;
+			switch ( e )
+			{
+			case '"': m_scratch.append ( '"' ); break;
+			case '\\': m_scratch.append ( '\\' ); break;
+			case '/': m_scratch.append ( '/' ); break;
+			case 'b': m_scratch.append ( '\b' ); break;
+			case 'f': m_scratch.append ( '\f' ); break;
+			case 'n': m_scratch.append ( '\n' ); break;
+			case 'r': m_scratch.append ( '\r' ); break;
+			case 't': m_scratch.append ( '\t' ); break;
+			case 'u':
+			{
+				auto readHex4 = [this] ( quint32& value ) -> bool
+				{
+					if ( m_end - m_cur < 4 )
+						return false;
+					value = 0;
+					for ( qint32 i = 0; i < 4; i++ )
+					{
+						const qint32 d = hexDigit ( *m_cur++ );
+						if ( d < 0 )
+							return false;
+						value = ( value << 4 ) | quint32 ( d );
+					}
+					return true;
+				};
+
+				quint32 cp = 0;
+				if ( !readHex4 ( cp ) )
+					return fail ( "invalid \\u escape sequence" );
+
+				// combine UTF-16 surrogate pairs
+				if ( cp >= 0xD800 && cp <= 0xDBFF )
+				{
+					quint32 low = 0;
+					if ( m_end - m_cur < 6 || m_cur [ 0 ] != '\\' || m_cur [ 1 ] != 'u' )
+						return fail ( "unpaired UTF-16 surrogate" );
+					m_cur += 2;
+					if ( !readHex4 ( low ) || low < 0xDC00 || low > 0xDFFF )
+						return fail ( "unpaired UTF-16 surrogate" );
+					cp = 0x10000 + ( ( cp - 0xD800 ) << 10 ) + ( low - 0xDC00 );
+				}
+
+				appendUtf8 ( m_scratch, cp );
+				break;
+			}
+			default:
+				return fail ( "invalid escape sequence" );
+			}
+		}
+
+		if ( m_cur >= m_end )
+			return fail ( "unterminated string" );
+
+		m_cur++;
+		out = QByteArrayView ( m_scratch );
+		return true;
+	}
+
+	// Whether [p, end) follows the JSON number grammar -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?, which std::from_chars is more lenient than
+	static bool isJsonNumber ( const char* p, const char* end )
+	{
+		auto digits = [&p, end] ()
+		{
+			const char* first = p;
+			while ( p < end && *p >= '0' && *p <= '9' )
+				p++;
+			return p > first;
+		};
+
+		if ( p < end && *p == '-' )
+			p++;
+		if ( p < end && *p == '0' )
+			p++;
+		else if ( !digits () )
+			return false;
+
+		if ( p < end && *p == '.' )
+		{
+			p++;
+			if ( !digits () )
+				return false;
+		}
+
+		if ( p < end && ( *p == 'e' || *p == 'E' ) )
+		{
+			p++;
+			if ( p < end && ( *p == '+' || *p == '-' ) )
+				p++;
+			if ( !digits () )
+				return false;
+		}
+
+		return p == end;
+	}
+
+	bool JsonSaxParser::parseNumber ( double& out )
+	{
+		const char* start = m_cur;
+		bool isInteger = true;
+
+		if ( m_cur < m_end && *m_cur == '-' )
+			m_cur++;
+
+		while ( m_cur < m_end )
+		{
+			const char c = *m_cur;
+			if ( c >= '0' && c <= '9' )
+			{
+				m_cur++;
+			}
+			else if ( c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-' )
+			{
+				isInteger = false;
+				m_cur++;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		const qsizetype length = m_cur - start;
+		if ( !isJsonNumber ( start, m_cur ) )
+		{
+			m_cur = start;
+			return fail ( "invalid number" );
+		}
+
+		// Most glTF numbers are small integers (indices, counts, offsets), accumulate them directly
+		if ( isInteger && length > 0 && length < 16 )
+		{
+			const char* p = start;
+			const bool negative = ( *p == '-' );
+			if ( negative )
+				p++;
+
+			qint64 value = 0;
+			for ( ; p < m_cur; p++ )
+				value = value * 10 + ( *p - '0' );
+
+			out = double ( negative ? -value : value );
+			return true;
+		}
+
+		const std::from_chars_result result = std::from_chars ( start, m_cur, out );
+		if ( result.ec != std::errc () || result.ptr != m_cur )
+		{
+			m_cur = start;
+			return fail ( "invalid number" );
+		}
+
+		return true;
+	}
+
+	bool JsonSaxParser::parse ( QByteArrayView json, JsonSaxHandler& handler )
+	{
+		m_begin = json.data ();
+		m_cur = m_begin;
+		m_end = m_begin + json.size ();
+		m_error.clear ();
+		m_errorOffset = -1;
+
+		// open containers, true for objects and false for arrays
+		QVarLengthArray<bool, 64> stack;
+
+		enum class State
+		{
+			Value,				// a value is required
+			FirstKeyOrEnd,		// right after '{'
+			Key,				// after ',' inside an object
+			FirstValueOrEnd,	// right after '['
+			AfterValue			// a value was completed
+		};
+
+		State state = State::Value;
+		qsizetype nextProgress = kProgressInterval;
+
+		for ( ;; )
+		{
+			skipWhitespace ();
+
+			if ( m_cur - m_begin >= nextProgress )
+			{
+				if ( !handler.progress ( m_cur - m_begin ) )
+					return fail ( "parse aborted by handler" );
+				nextProgress = ( m_cur - m_begin ) + kProgressInterval;
+			}
+
+			if ( state == State::AfterValue )
+			{
+				if ( stack.isEmpty () )
+				{
+					// only whitespace (GLB pads the JSON chunk with spaces) may follow the top-level value
+					if ( m_cur != m_end )
+						return fail ( "garbage after the JSON value" );
+					return true;
+				}
+
+				if ( m_cur >= m_end )
+					return fail ( "unexpected end of input" );
+
+				const char c = *m_cur++;
+				if ( c == ',' )
+				{
+					state = stack.last () ? State::Key : State::Value;
+				}
+				else if ( c == '}' && stack.last () )
+				{
+					stack.removeLast ();
+					if ( !handler.endObject () )
+						return fail ( "parse aborted by handler" );
+				}
+				else if ( c == ']' && !stack.last () )
+				{
+					stack.removeLast ();
+					if ( !handler.endArray () )
+						return fail ( "parse aborted by handler" );
+				}
+				else
+				{
+					m_cur--;
+					return fail ( "expected ',' or the end of the container" );
+				}
+				continue;
+			}
+
+			if ( m_cur >= m_end )
+				return fail ( "unexpected end of input" );
+
+			if ( state == State::FirstKeyOrEnd || state == State::Key )
+			{
+				if ( state == State::FirstKeyOrEnd && *m_cur == '}' )
+				{
+					m_cur++;
+					stack.removeLast ();
+					if ( !handler.endObject () )
+						return fail ( "parse aborted by handler" );
+					state = State::AfterValue;
+					continue;
+				}
+
+				if ( *m_cur != '"' )
+					return fail ( "expected an object key" );
+
+				QByteArrayView name;
+				if ( !parseString ( name ) )
+					return false;
+
+				skipWhitespace ();
+				if ( m_cur >= m_end || *m_cur != ':' )
+					return fail ( "expected ':' after an object key" );
+				m_cur++;
+
+				if ( !handler.key ( name ) )
+					return fail ( "parse aborted by handler" );
+
+				state = State::Value;
+				continue;
+			}
+
+			if ( state == State::FirstValueOrEnd )
+			{
+				if ( *m_cur == ']' )
+				{
+					m_cur++;
+					stack.removeLast ();
+					if ( !handler.endArray () )
+						return fail ( "parse aborted by handler" );
+					state = State::AfterValue;
+					continue;
+				}
+				state = State::Value;
+			}
+
+			// State::Value
+			bool ok = true;
+			switch ( *m_cur )
+			{
+			case '{':
+				if ( stack.size () >= kMaxDepth )
+					return fail ( "maximum nesting depth exceeded" );
+				m_cur++;
+				stack.append ( true );
+				ok = handler.startObject ();
+				state = State::FirstKeyOrEnd;
+				break;
+			case '[':
+				if ( stack.size () >= kMaxDepth )
+					return fail ( "maximum nesting depth exceeded" );
+				m_cur++;
+				stack.append ( false );
+				ok = handler.startArray ();
+				state = State::FirstValueOrEnd;
+				break;
+			case '"':
+			{
+				QByteArrayView value;
+				if ( !parseString ( value ) )
+					return false;
+				ok = handler.string ( value );
+				state = State::AfterValue;
+				break;
+			}
+			case 't':
+				if ( m_end - m_cur < 4 || std::memcmp ( m_cur, "true", 4 ) != 0 )
+					return fail ( "invalid literal" );
+				m_cur += 4;
+				ok = handler.boolean ( true );
+				state = State::AfterValue;
+				break;
+			case 'f':
+				if ( m_end - m_cur < 5 || std::memcmp ( m_cur, "false", 5 ) != 0 )
+					return fail ( "invalid literal" );
+				m_cur += 5;
+				ok = handler.boolean ( false );
+				state = State::AfterValue;
+				break;
+			case 'n':
+				if ( m_end - m_cur < 4 || std::memcmp ( m_cur, "null", 4 ) != 0 )
+					return fail ( "invalid literal" );
+				m_cur += 4;
+				ok = handler.null ();
+				state = State::AfterValue;
+				break;
+			default:
+			{
+				const char c = *m_cur;
+				if ( c != '-' && ( c < '0' || c > '9' ) )
+					return fail ( "unexpected character" );
+
+				double value = 0.0;
+				if ( !parseNumber ( value ) )
+					return false;
+				ok = handler.number ( value );
+				state = State::AfterValue;
+				break;
+			}
+			}
+
+			if ( !ok )
+				return fail ( "parse aborted by handler" );
+		}
+	}
+}
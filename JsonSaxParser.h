@@ -0,0 +1,97 @@
+/*****************************************************************//**
+ * \file   JsonSaxParser.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  event driven (SAX-style) JSON reader that never builds a DOM
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __JSON_SAX_PARSER_H__
+#define __JSON_SAX_PARSER_H__
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+namespace jcqt
+{
+	/*
+	*	Receives the parse events in document order. Strings and keys are handed out as UTF-8 views that are only valid for the duration of the call:
+	*	they point straight into the input unless the string contained escape sequences. Returning false from any callback aborts the parse.
+	*/
+	class JsonSaxHandler
+	{
+	public:
+		virtual ~JsonSaxHandler () = default;
+
+		virtual bool startObject () = 0;
+		virtual bool key ( QByteArrayView name ) = 0;
+		virtual bool endObject () = 0;
+		virtual bool startArray () = 0;
+		virtual bool endArray () = 0;
+		virtual bool string ( QByteArrayView value ) = 0;
+		virtual bool number ( double value ) = 0;
+		virtual bool boolean ( bool value ) = 0;
+		virtual bool null () = 0;
+
+		// Called roughly every JsonSaxParser::kProgressInterval bytes with the current input offset, returning false aborts (e.g. to cancel a load)
+		virtual bool progress ( qsizetype offset )
+		{
+			Q_UNUSED ( offset );
+			return true;
+		}
+	};
+
+	class JsonSaxParser
+	{
+	public:
+		// Nesting deeper than this is rejected instead of growing the container stack without bound
+		static constexpr qint32 kMaxDepth = 512;
+		static constexpr qsizetype kProgressInterval = 1 << 20;
+
+		// Parses a single JSON value (usually the top-level object) from json, reporting every token to handler.
+		bool parse ( QByteArrayView json, JsonSaxHandler& handler );
+
+		QString errorString () const { return m_error; }
+		// byte offset into the input at which parsing stopped
+		qsizetype errorOffset () const { return m_errorOffset; }
+
+	private:
+		bool fail ( const char* message );
+		bool parseString ( QByteArrayView& out );
+		bool parseNumber ( double& out );
+		void skipWhitespace ();
+
+		const char* m_begin = nullptr;
+		const char* m_cur = nullptr;
+		const char* m_end = nullptr;
+
+		// scratch storage for strings that contain escape sequences
+		QByteArray m_scratch;
+
+		QString m_error;
+		qsizetype m_errorOffset = -1;
+	};
+}
+
+#endif // !__JSON_SAX_PARSER_H__
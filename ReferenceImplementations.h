@@ -0,0 +1,237 @@
+/*****************************************************************//**
+ * \file   ReferenceImplementations.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  the implementations optimized code replaced and the inputs they run on, shared by GLTFLoaderTest and SceneBenchmark
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __REFERENCE_IMPLEMENTATIONS_H__
+#define __REFERENCE_IMPLEMENTATIONS_H__
+
+#include <QByteArray>
+#include <QList>
+#include <QMatrix4x4>
+#include <QRandomGenerator>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "AccessorView.h"
+#include "GLTFDocument.h"
+#include "GLTFScene.h"
+#include "vec4.h"
+
+/*
+*	The straightforward versions of code that has since been optimized. GLTFLoaderTest checks the optimized code against them and
+*	SceneBenchmark measures it against them, so both use the same reference (and the same generated inputs).
+*/
+
+// Builds a syntactically rich glTF JSON text with nodeCount nodes, meshes, accessors and materials for parser benchmarks
+inline QByteArray makeLargeGLTFJson ( int nodeCount )
+{
+	QByteArray json;
+	json.reserve ( nodeCount * 512 );
+	json += "{\"asset\":{\"version\":\"2.0\",\"generator\":\"GLTFLoaderTest\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[";
+	for ( int i = 0; i < nodeCount; i++ )
+	{
+		if ( i > 0 ) json += ',';
+		json += "{\"name\":\"node_" + QByteArray::number ( i ) + "\",\"mesh\":" + QByteArray::number ( i ) +
+			",\"translation\":[" + QByteArray::number ( i * 0.5 ) + ",1.25,-3.0],\"rotation\":[0,0,0,1],\"scale\":[1,1,1]";
+		if ( 2 * i + 2 < nodeCount )
+			json += ",\"children\":[" + QByteArray::number ( 2 * i + 1 ) + "," + QByteArray::number ( 2 * i + 2 ) + "]";
+		json += ",\"extras\":{\"tags\":[\"a\",\"b\"],\"weight\":0.5}}";
+	}
+	json += "],\"meshes\":[";
+	for ( int i = 0; i < nodeCount; i++ )
+	{
+		if ( i > 0 ) json += ',';
+		json += "{\"primitives\":[{\"attributes\":{\"POSITION\":" + QByteArray::number ( 2 * i ) + ",\"NORMAL\":" + QByteArray::number ( 2 * i + 1 ) +
+			"},\"indices\":" + QByteArray::number ( 2 * i ) + ",\"material\":" + QByteArray::number ( i % 16 ) + "}]}";
+	}
+	json += "],\"accessors\":[";
+	for ( int i = 0; i < 2 * nodeCount; i++ )
+	{
+		if ( i > 0 ) json += ',';
+		json += "{\"bufferView\":0,\"byteOffset\":" + QByteArray::number ( i * 12 ) +
+			",\"componentType\":5126,\"count\":24,\"type\":\"VEC3\",\"min\":[-1.0,-1.0,-1.0],\"max\":[1.0,1.0,1.0]}";
+	}
+	json += "],\"materials\":[";
+	for ( int i = 0; i < 16; i++ )
+	{
+		if ( i > 0 ) json += ',';
+		json += "{\"name\":\"material_" + QByteArray::number ( i ) + "\",\"pbrMetallicRoughness\":{\"baseColorFactor\":[1,0.5,0.25,1],\"metallicFactor\":0.1,\"roughnessFactor\":0.9}}";
+	}
+	json += "],\"bufferViews\":[{\"buffer\":0,\"byteLength\":" + QByteArray::number ( nodeCount * 24 ) + "}],\"buffers\":[{\"byteLength\":" + QByteArray::number ( nodeCount * 24 ) + "}]}";
+	return json;
+}
+
+// Random accessor storage: count elements stride bytes apart, random finite floats for FLOAT components and random bytes otherwise
+inline QByteArray makeAccessorBytes ( quint32 componentType, qsizetype count, qsizetype stride, quint32 seed )
+{
+	QRandomGenerator rng ( seed );
+	QByteArray bytes ( count * stride, Qt::Uninitialized );
+	if ( componentType == jcqt::gltf::kFloat )
+	{
+		for ( qsizetype i = 0; i + 4 <= bytes.size (); i += 4 )
+		{
+			const float f = float ( rng.generateDouble () * 200.0 - 100.0 );
+			memcpy ( bytes.data () + i, &f, sizeof ( f ) );
+		}
+	}
+	else
+	{
+		for ( char& c : bytes )
+			c = char ( rng.bounded ( 256 ) );
+	}
+	return bytes;
+}
+
+// Straightforward per-component switch the specialized kernels are checked and benchmarked against
+inline void referenceConvertToFloat ( const jcqt::AccessorData& src, quint32 componentType, jcqt::gltf::AccessorType type, bool normalized, float* out )
+{
+	using jcqt::gltf::AccessorType;
+	const qsizetype size = jcqt::gltf::componentSize ( componentType );
+	const qsizetype cols = type == AccessorType::Mat2 ? 2 : type == AccessorType::Mat3 ? 3 : type == AccessorType::Mat4 ? 4 : 1;
+	const qsizetype rows = jcqt::gltf::componentCount ( type ) / cols;
+	const qsizetype columnBytes = cols > 1 ? ( rows * size + 3 ) & ~qsizetype ( 3 ) : rows * size;
+
+	for ( qsizetype i = 0; i < src.count_; i++ )
+	{
+		for ( qsizetype c = 0; c < cols; c++ )
+		{
+			for ( qsizetype r = 0; r < rows; r++ )
+			{
+				const uchar* p = src.data_ + i * src.stride_ + c * columnBytes + r * size;
+				float f = 0.f;
+				switch ( componentType )
+				{
+				case jcqt::gltf::kByte: { qint8 v; memcpy ( &v, p, 1 ); f = normalized ? qMax ( v * ( 1.f / 127.f ), -1.f ) : float ( v ); break; }
+				case jcqt::gltf::kUnsignedByte: { quint8 v; memcpy ( &v, p, 1 ); f = normalized ? v * ( 1.f / 255.f ) : float ( v ); break; }
+				case jcqt::gltf::kShort: { qint16 v; memcpy ( &v, p, 2 ); f = normalized ? qMax ( v * ( 1.f / 32767.f ), -1.f ) : float ( v ); break; }
+				case jcqt::gltf::kUnsignedShort: { quint16 v; memcpy ( &v, p, 2 ); f = normalized ? v * ( 1.f / 65535.f ) : float ( v ); break; }
+				case jcqt::gltf::kUnsignedInt: { quint32 v; memcpy ( &v, p, 4 ); f = float ( v ); break; }
+				case jcqt::gltf::kFloat: memcpy ( &f, p, 4 ); break;
+				}
+				*out++ = f;
+			}
+		}
+	}
+}
+
+inline const quint32 kComponentTypes [] = { jcqt::gltf::kByte, jcqt::gltf::kUnsignedByte, jcqt::gltf::kShort, jcqt::gltf::kUnsignedShort, jcqt::gltf::kUnsignedInt, jcqt::gltf::kFloat };
+inline const char* const kTypeNames [] = { "UNKNOWN", "SCALAR", "VEC2", "VEC3", "VEC4", "MAT2", "MAT3", "MAT4" };
+
+// Random column major matrices for the gpumat4 kernels
+inline QList<jcqt::gpumat4> makeRandomMatrices ( qsizetype count, quint32 seed )
+{
+	QRandomGenerator rng ( seed );
+	QList<jcqt::gpumat4> matrices ( count );
+	for ( jcqt::gpumat4& m : matrices )
+	{
+		for ( float& f : m.data_ )
+			f = float ( rng.generateDouble () * 4.0 - 2.0 );
+	}
+	return matrices;
+}
+
+// The QMatrix4x4 round trip recalculateGlobalTransforms() used before the gpumat4 kernels
+inline jcqt::gpumat4 multiplyQMatrix4x4 ( const jcqt::gpumat4& a, const jcqt::gpumat4& b )
+{
+	return jcqt::gpumat4 ( QMatrix4x4 ( a.data_ ).transposed () * QMatrix4x4 ( b.data_ ).transposed () );
+}
+
+// Delete a list of items with sorted indices from a list (the eraseSelected() deleteSceneNodes() used before the linear rewrite)
+template <class T>
+inline void referenceEraseSelected ( QList<T>& v, const QList<quint32>& selection )
+{
+	v.detach ();
+	const T* base = v.constData ();
+	v.resize ( std::distance ( v.begin (), std::stable_partition ( v.begin (), v.end (), [&selection, base] ( const T& item ) {
+		return !std::binary_search ( selection.begin (), selection.end (), quint32 ( &item - base ) );
+		} ) ) );
+}
+
+/*
+*	The deleteSceneNodes() algorithm before the linear rewrite, as a reference for it. It only handled indicesToDelete that were sorted
+*	and already contained every subtree, and it read sibling links it had already rewritten; here the links are read from a copy.
+*/
+inline void referenceDeleteSceneNodes ( jcqt::Scene& scene, const QList<quint32>& indicesToDelete )
+{
+	QList<qint32> nodes ( scene.hierarchy_.size () );
+	std::iota ( nodes.begin (), nodes.end (), 0 );
+	const qsizetype oldSize = nodes.size ();
+	referenceEraseSelected ( nodes, indicesToDelete );
+
+	QList<qint32> newIndices ( oldSize, -1 );
+	for ( qint32 i = 0; i < nodes.size (); i++ )
+		newIndices [ nodes [ i ] ] = i;
+
+	const QList<jcqt::Hierarchy> old = scene.hierarchy_;
+	auto findLastNonDeletedItem = [&old, &newIndices] ( qint32 node )
+	{
+		while ( node != -1 && newIndices [ node ] == -1 )
+			node = old [ node ].nextSibling_;
+		return ( node != -1 ) ? newIndices [ node ] : -1;
+	};
+
+	for ( qint32 i = 0; i < old.size (); i++ )
+	{
+		const jcqt::Hierarchy& h = old [ i ];
+		scene.hierarchy_ [ i ] = jcqt::Hierarchy {
+			.parent_ = ( h.parent_ != -1 ) ? newIndices [ h.parent_ ] : -1,
+			.firstChild_ = findLastNonDeletedItem ( h.firstChild_ ),
+			.nextSibling_ = findLastNonDeletedItem ( h.nextSibling_ ),
+			.lastSibling_ = findLastNonDeletedItem ( h.lastSibling_ ),
+			.level_ = h.level_
+		};
+	}
+
+	referenceEraseSelected ( scene.hierarchy_, indicesToDelete );
+	referenceEraseSelected ( scene.localTransforms_, indicesToDelete );
+	referenceEraseSelected ( scene.globalTransforms_, indicesToDelete );
+	scene.meshes_.remap ( newIndices, scene.hierarchy_.size () );
+	scene.materialForNode_.remap ( newIndices, scene.hierarchy_.size () );
+	scene.nameForNode_.remap ( newIndices, scene.hierarchy_.size () );
+}
+
+// Sorted list of the given nodes and everything below them
+inline QList<quint32> closeUnderSubtrees ( const jcqt::Scene& scene, const QList<quint32>& nodes )
+{
+	QList<quint32> closed;
+	for ( qint32 i = 0; i < scene.hierarchy_.size (); i++ )
+	{
+		for ( qint32 p = i; p != -1; p = scene.hierarchy_ [ p ].parent_ )
+		{
+			if ( nodes.contains ( quint32 ( p ) ) )
+			{
+				closed.append ( quint32 ( i ) );
+				break;
+			}
+		}
+	}
+	return closed;
+}
+
+#endif // !__REFERENCE_IMPLEMENTATIONS_H__
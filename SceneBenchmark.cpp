@@ -0,0 +1,1166 @@
+/*****************************************************************//**
+ * \file   SceneBenchmark.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  QBENCHMARK suite for the scene hot paths at 1k, 100k and 1M nodes, with baseline comparison
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include <QTest>
+#include <QCoreApplication>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QFile>
+#include <QMap>
+#include <QJsonDocument>
+#include <QVector4D>
+#include <QQuaternion>
+#include <QHash>
+#include <QElapsedTimer>
+#include "AccessorConvert.h"
+#include "AssetCache.h"
+#include "Base64.h"
+#include "GLTFLoader.h"
+#include "GLTFScene.h"
+#include "GLTFSceneBuilder.h"
+#include "SceneFile.h"
+#include "SceneGenerator.h"
+#include "SceneTraversal.h"
+#include "TransformSnapshots.h"
+#include "Trace.h"
+#include "ReferenceImplementations.h"
+
+#include <initializer_list>
+#include <numeric>
+
+/*
+*	Benchmarks of the loader and scene code, most of them at three scene sizes, meant to be run on every upstream change:
+*
+*		jcqtGLTFLoaderBenchmark -o results.csv,csv
+*		jcqtGLTFLoaderBenchmark --save-baseline baseline.csv
+*		jcqtGLTFLoaderBenchmark --baseline baseline.csv --tolerance 10
+*
+*	Every other argument goes to QTest, e.g. a function name, "function:100k" for a single size, or -o file,xml for another format. With
+*	--baseline the run ends with a table of the changes and exits with 1 if a case got slower by more than the tolerance (percent).
+*/
+
+// Random tree of count nodes below a single root, no deeper than maxLevel, with translated local transforms and every tenth node named
+static void makeBenchmarkScene ( jcqt::Scene& scene, qint32 count, quint32 seed, qint32 maxLevel = 12 )
+{
+	QRandomGenerator rng ( seed );
+	scene = jcqt::Scene ();
+
+	QList<qint32> parents ( count );
+	QList<qint32> levels ( count );
+	QList<jcqt::gpumat4> locals ( count );
+	parents [ 0 ] = -1;
+	levels [ 0 ] = 0;
+	for ( qint32 i = 1; i < count; i++ )
+	{
+		qint32 parent = qint32 ( rng.bounded ( i ) );
+		while ( levels [ parent ] >= maxLevel )
+			parent = parents [ parent ];
+		parents [ i ] = parent;
+		levels [ i ] = levels [ parent ] + 1;
+	}
+	for ( jcqt::gpumat4& m : locals )
+	{
+		QMatrix4x4 t;
+		t.translate ( float ( rng.generateDouble () ), float ( rng.generateDouble () ), float ( rng.generateDouble () ) );
+		m = jcqt::gpumat4 ( t );
+	}
+
+	jcqt::addNodes ( scene, parents, levels, locals );
+	for ( qint32 i = 0; i < count; i += 10 )
+	{
+		scene.meshes_.insert ( i, i % 64 );
+		jcqt::setNodeName ( scene, i, QStringLiteral ( "node_%1" ).arg ( i ) );
+	}
+
+	jcqt::markAsChanged ( scene, 0 );
+	jcqt::recalculateGlobalTransforms ( scene );
+}
+
+// Random unit quaternion (x, y, z, w)
+static jcqt::gpuvec4 randomRotation ( QRandomGenerator& rng )
+{
+	QVector4D q ( float ( rng.generateDouble () * 2.0 - 1.0 ), float ( rng.generateDouble () * 2.0 - 1.0 ),
+		float ( rng.generateDouble () * 2.0 - 1.0 ), float ( rng.generateDouble () * 2.0 - 1.0 ) );
+	return jcqt::gpuvec4 ( q.normalized () );
+}
+
+// A glTF file (and its .bin) in dir with nodeCount nodes forming a tree of fan-out four, all sharing one triangle mesh
+static QString writeBenchmarkGLTF ( const QString& dir, qint32 nodeCount )
+{
+	jcqt::SyntheticSceneOptions options;
+	options.nodeCount_ = nodeCount;
+	options.maxDepth_ = 64;
+	options.minFanOut_ = 4;
+	options.maxFanOut_ = 4;
+	options.meshCount_ = 1;
+	options.verticesPerMesh_ = 3;
+	options.indicesPerMesh_ = 3;
+	options.materialCount_ = 0;
+
+	const QString path = dir + QStringLiteral ( "/scene.gltf" );
+	return jcqt::writeSyntheticGLTF ( path, options ) ? path : QString ();
+}
+
+class SceneBenchmark : public QObject
+{
+	Q_OBJECT
+
+	struct Size
+	{
+		const char* tag_;
+		qint32 nodes_;
+	};
+	static constexpr Size kSizes [] = { { "1k", 1000 }, { "100k", 100000 }, { "1M", 1000000 } };
+
+	// the three sizes every case runs at
+	static void addSizeRows ()
+	{
+		QTest::addColumn<qint32> ( "nodes" );
+		for ( const Size& size : kSizes )
+			QTest::newRow ( size.tag_ ) << size.nodes_;
+	}
+
+	// the three sizes for each of two implementations, tagged e.g. "QHash 1M"; the bool column tells whether the row is the second one
+	static void addVariantRows ( const char* column, const char* first, const char* second )
+	{
+		QTest::addColumn<qint32> ( "nodes" );
+		QTest::addColumn<bool> ( column );
+		for ( bool isSecond : { false, true } )
+			for ( const Size& size : kSizes )
+				QTest::addRow ( "%s %s", isSecond ? second : first, size.tag_ ) << size.nodes_ << isSecond;
+	}
+
+	// the same for more than two implementations, the int column holds the index of the row's one
+	static void addVariantRows ( const char* column, std::initializer_list<const char*> variants )
+	{
+		QTest::addColumn<qint32> ( "nodes" );
+		QTest::addColumn<int> ( column );
+		int index = 0;
+		for ( const char* variant : variants )
+		{
+			for ( const Size& size : kSizes )
+				QTest::addRow ( "%s %s", variant, size.tag_ ) << size.nodes_ << index;
+			index++;
+		}
+	}
+
+private slots:
+	void benchmarkLoadGLTF_data ()
+	{
+		addSizeRows ();
+	}
+
+	void benchmarkLoadGLTF ()
+	{
+		QFETCH ( qint32, nodes );
+
+		QTemporaryDir dir;
+		QVERIFY ( dir.isValid () );
+		const QString path = writeBenchmarkGLTF ( dir.path (), nodes );
+		QVERIFY ( !path.isEmpty () );
+
+		QBENCHMARK
+		{
+			GLTFLoader loader;
+			QVERIFY ( loader.loadGLTF ( path ) );
+		}
+	}
+
+	void benchmarkAccessorConvert_data ()
+	{
+		QTest::addColumn<quint32> ( "componentType" );
+		QTest::addColumn<int> ( "type" );
+		QTest::addColumn<bool> ( "normalized" );
+		QTest::addColumn<bool> ( "reference" );
+
+		for ( quint32 componentType : kComponentTypes )
+		{
+			for ( int t = int ( jcqt::gltf::AccessorType::Scalar ); t <= int ( jcqt::gltf::AccessorType::Mat4 ); t++ )
+			{
+				for ( bool normalized : { false, true } )
+				{
+					// only byte and short components can be normalized
+					if ( normalized && jcqt::gltf::componentSize ( componentType ) == 4 )
+						continue;
+
+					const QByteArray name = QByteArray::number ( componentType ) + ' ' + kTypeNames [ t ] + ( normalized ? " normalized" : "" );
+					QTest::newRow ( ( name + " kernel" ).constData () ) << componentType << t << normalized << false;
+					QTest::newRow ( ( name + " reference" ).constData () ) << componentType << t << normalized << true;
+				}
+			}
+		}
+	}
+
+	// converting 256k elements of every accessor layout to floats, with the dispatched kernel and with the per-element reference
+	void benchmarkAccessorConvert ()
+	{
+		QFETCH ( quint32, componentType );
+		QFETCH ( int, type );
+		QFETCH ( bool, normalized );
+		QFETCH ( bool, reference );
+
+		const jcqt::gltf::AccessorType accessorType = jcqt::gltf::AccessorType ( type );
+		const qsizetype count = 1 << 18;
+		const qsizetype elementSize = jcqt::gltf::elementSize ( accessorType, componentType );
+		const QByteArray bytes = makeAccessorBytes ( componentType, count, elementSize, 7 );
+		const jcqt::AccessorData src { reinterpret_cast<const uchar*>( bytes.constData () ), count, elementSize, elementSize };
+		QList<float> out ( count * jcqt::gltf::componentCount ( accessorType ) );
+
+		if ( reference )
+		{
+			QBENCHMARK
+			{
+				referenceConvertToFloat ( src, componentType, accessorType, normalized, out.data () );
+			}
+		}
+		else
+		{
+			const jcqt::FloatConverter convert = jcqt::floatConverter ( componentType, accessorType, normalized );
+			QVERIFY ( convert );
+			QBENCHMARK
+			{
+				convert ( src, out.data () );
+			}
+		}
+	}
+
+	void benchmarkBase64Decode_data ()
+	{
+		QTest::addColumn<bool> ( "vectorized" );
+		QTest::newRow ( "QByteArray::fromBase64 64MB" ) << false;
+		QTest::newRow ( "base64Decode 64MB" ) << true;
+	}
+
+	// decoding 64 MB of random bytes, reported as base64 text per second over every iteration QBENCHMARK ran
+	void benchmarkBase64Decode ()
+	{
+		QFETCH ( bool, vectorized );
+
+		QByteArray raw ( 64 * 1024 * 1024, Qt::Uninitialized );
+		QRandomGenerator rng ( 42 );
+		rng.fillRange ( reinterpret_cast<quint32*>( raw.data () ), raw.size () / qsizetype ( sizeof ( quint32 ) ) );
+		const QByteArray encoded = raw.toBase64 ();
+		QByteArray decoded ( raw.size (), Qt::Uninitialized );
+
+		qint64 iterations = 0;
+		QElapsedTimer timer;
+		timer.start ();
+		QBENCHMARK
+		{
+			if ( vectorized )
+				jcqt::base64Decode ( encoded, reinterpret_cast<uchar*>( decoded.data () ) );
+			else
+				decoded = QByteArray::fromBase64 ( encoded );
+			iterations++;
+		}
+		const qint64 elapsed = qMax ( timer.nsecsElapsed (), qint64 ( 1 ) );
+		QCOMPARE ( decoded, raw );
+
+		QTest::setBenchmarkResult ( double ( encoded.size () ) * double ( iterations ) * 1e9 / double ( elapsed ), QTest::BytesPerSecond );
+	}
+
+	void benchmarkParseDocument_data ()
+	{
+		QTest::addColumn<bool> ( "streaming" );
+		QTest::newRow ( "QJsonDocument" ) << false;
+		QTest::newRow ( "parseDocument" ) << true;
+	}
+
+	// 20k nodes of rich glTF JSON, parsed into a QJsonDocument DOM or by the streaming parser into a gltf::Document
+	void benchmarkParseDocument ()
+	{
+		QFETCH ( bool, streaming );
+
+		const QByteArray json = makeLargeGLTFJson ( 20000 );
+		QBENCHMARK
+		{
+			if ( streaming )
+			{
+				jcqt::gltf::Document doc;
+				QVERIFY ( jcqt::gltf::parseDocument ( json, doc ) );
+			}
+			else
+			{
+				QJsonDocument doc = QJsonDocument::fromJson ( json );
+				QVERIFY ( doc.isObject () );
+			}
+		}
+	}
+
+	void benchmarkBuildScene_data ()
+	{
+		addSizeRows ();
+	}
+
+	// the scene of an already parsed city document, every node with a mesh
+	void benchmarkBuildScene ()
+	{
+		QFETCH ( qint32, nodes );
+
+		jcqt::gltf::Document doc;
+		QVERIFY ( jcqt::gltf::parseDocument ( jcqt::generateSyntheticGLTF ( jcqt::SyntheticSceneOptions::wideCity ( nodes ) ).json_, doc ) );
+
+		QBENCHMARK
+		{
+			jcqt::Scene scene;
+			QVERIFY ( jcqt::buildScene ( doc, scene ) );
+		}
+	}
+
+	void benchmarkMat4Multiply_data ()
+	{
+		addVariantRows ( "kernel", { "QMatrix4x4", "mat4Multiply", "mat4MultiplyBatch" } );
+	}
+
+	void benchmarkMat4Multiply ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( int, kernel );
+
+		// one product per node, as a full transform update does
+		const qsizetype n = nodes;
+		const QList<jcqt::gpumat4> a = makeRandomMatrices ( n, 21 );
+		const QList<jcqt::gpumat4> b = makeRandomMatrices ( n, 22 );
+		QList<jcqt::gpumat4> out ( n );
+
+		QBENCHMARK
+		{
+			if ( kernel == 0 )
+			{
+				for ( qsizetype i = 0; i < n; i++ )
+					out [ i ] = multiplyQMatrix4x4 ( a [ i ], b [ i ] );
+			}
+			else if ( kernel == 1 )
+			{
+				for ( qsizetype i = 0; i < n; i++ )
+					jcqt::mat4Multiply ( a [ i ], b [ i ], out [ i ] );
+			}
+			else
+			{
+				jcqt::mat4MultiplyBatch ( a.constData (), b.constData (), out.data (), n );
+			}
+		}
+	}
+
+	void benchmarkRecalculateFull_data ()
+	{
+		addSizeRows ();
+	}
+
+	// every node dirty
+	void benchmarkRecalculateFull ()
+	{
+		QFETCH ( qint32, nodes );
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 1 );
+
+		QBENCHMARK
+		{
+			jcqt::markAsChanged ( scene, 0 );
+			jcqt::recalculateGlobalTransforms ( scene );
+		}
+	}
+
+	void benchmarkRecalculateSparse_data ()
+	{
+		addSizeRows ();
+	}
+
+	// a hundredth of the nodes edited, with whatever lies below them
+	void benchmarkRecalculateSparse ()
+	{
+		QFETCH ( qint32, nodes );
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 2 );
+
+		QRandomGenerator rng ( 3 );
+		QList<qint32> edited ( qMax ( nodes / 100, 1 ) );
+		for ( qint32& node : edited )
+			node = qint32 ( rng.bounded ( nodes ) );
+
+		QBENCHMARK
+		{
+			for ( qint32 node : edited )
+				jcqt::markAsChanged ( scene, node );
+			jcqt::recalculateGlobalTransforms ( scene );
+		}
+	}
+
+	void benchmarkRecalculateParallel_data ()
+	{
+		addSizeRows ();
+	}
+
+	// every node dirty, the levels split across the pool
+	void benchmarkRecalculateParallel ()
+	{
+		QFETCH ( qint32, nodes );
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 1 );
+
+		QBENCHMARK
+		{
+			jcqt::markAsChanged ( scene, 0 );
+			jcqt::recalculateGlobalTransformsParallel ( scene );
+		}
+	}
+
+	void benchmarkReorderedTransforms_data ()
+	{
+		addVariantRows ( "layout", { "insertion order, per level", "breadth-first, per level", "breadth-first, linear sweep" } );
+	}
+
+	void benchmarkReorderedTransforms ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( int, layout );
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 52 );
+		if ( layout > 0 )
+			jcqt::reorderSceneBreadthFirst ( scene );
+
+		QBENCHMARK
+		{
+			if ( layout == 2 )
+			{
+				jcqt::recalculateAllGlobalTransforms ( scene );
+			}
+			else
+			{
+				jcqt::markAsChanged ( scene, 0 );
+				jcqt::recalculateGlobalTransforms ( scene );
+			}
+		}
+	}
+
+	void benchmarkAnimatedTransforms_data ()
+	{
+		addVariantRows ( "splitTRS", "QMatrix4x4 per channel", "split TRS" );
+	}
+
+	void benchmarkAnimatedTransforms ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, splitTRS );
+
+		// a tenth of the scene is animated every frame
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 604, 8 );
+		if ( splitTRS )
+			jcqt::enableSplitTRS ( scene );
+
+		QRandomGenerator rng ( 605 );
+		QList<qint32> animated ( nodes / 10 );
+		QList<jcqt::gpuvec4> rotations ( animated.size () );
+		for ( qsizetype i = 0; i < animated.size (); i++ )
+		{
+			animated [ i ] = qint32 ( rng.bounded ( nodes ) );
+			rotations [ i ] = randomRotation ( rng );
+		}
+
+		float frame = 0.0f;
+		QBENCHMARK
+		{
+			frame += 1.0f;
+			for ( qsizetype i = 0; i < animated.size (); i++ )
+			{
+				const jcqt::gpuvec3 t ( frame, float ( i ), 0.0f );
+				const jcqt::gpuvec3 s ( 1.0f + frame * 0.001f );
+				if ( splitTRS )
+				{
+					jcqt::setNodeTRS ( scene, animated [ i ], t, rotations [ i ], s );
+				}
+				else
+				{
+					const jcqt::gpuvec4& r = rotations [ i ];
+					QMatrix4x4 m;
+					m.translate ( t.x, t.y, t.z );
+					m.rotate ( QQuaternion ( r.w, r.x, r.y, r.z ) );
+					m.scale ( s.x, s.y, s.z );
+					scene.localTransforms_ [ animated [ i ] ] = jcqt::gpumat4 ( m );
+					jcqt::markAsChanged ( scene, animated [ i ] );
+				}
+			}
+			jcqt::recalculateGlobalTransforms ( scene );
+		}
+	}
+
+	void benchmarkMarkAsChanged_data ()
+	{
+		QTest::addColumn<qint32> ( "nodes" );
+		QTest::addColumn<bool> ( "deepRig" );
+		for ( const Size& size : kSizes )
+			QTest::newRow ( size.tag_ ) << size.nodes_ << false;
+		for ( const Size& size : kSizes )
+			QTest::addRow ( "deep rig %s", size.tag_ ) << size.nodes_ << true;
+	}
+
+	void benchmarkMarkAsChanged ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, deepRig );
+
+		if ( deepRig )
+		{
+			// rigs down to level 40 with a twentieth of the nodes edited per frame, most edits overlap a subtree marked before them
+			jcqt::Scene scene;
+			makeBenchmarkScene ( scene, nodes, 43, 40 );
+			QRandomGenerator rng ( 44 );
+			QList<qint32> edits ( nodes / 20 );
+			for ( qint32& e : edits )
+				e = qint32 ( rng.bounded ( nodes ) );
+
+			QBENCHMARK
+			{
+				for ( qint32 e : edits )
+					jcqt::markAsChanged ( scene, e );
+				jcqt::recalculateGlobalTransforms ( scene );
+			}
+			return;
+		}
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 4 );
+
+		// marking the root queues the whole scene; resetting the queue (keeping its capacity) is a small part of the measurement
+		QBENCHMARK
+		{
+			jcqt::markAsChanged ( scene, 0 );
+			for ( QList<qint32>& changed : scene.changedAtThisFrame_ )
+				changed.resize ( 0 );
+			scene.dirty_.fill ( false );
+		}
+	}
+
+	void benchmarkMergeScenes_data ()
+	{
+		QTest::addColumn<qint32> ( "nodes" );
+		QTest::addColumn<bool> ( "instanced" );
+		for ( const Size& size : kSizes )
+			QTest::newRow ( size.tag_ ) << size.nodes_ << false;
+		QTest::newRow ( "1000 instances 1M" ) << 1000000 << true;
+	}
+
+	/*
+	*	Ten parts of a tenth of the size each, both the parts and the merged scene include names. The instanced row merges a thousand
+	*	copies of one thousand-node prefab, each below its own root transform with its own mesh range.
+	*/
+	void benchmarkMergeScenes ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, instanced );
+
+		QList<jcqt::Scene> parts ( instanced ? 1 : 10 );
+		QList<jcqt::Scene*> pointers;
+		QList<jcqt::gpumat4> rootTransforms;
+		QList<quint32> meshCounts;
+		if ( instanced )
+		{
+			constexpr qint32 kInstances = 1000;
+			makeBenchmarkScene ( parts [ 0 ], nodes / kInstances, 311 );
+			pointers = QList<jcqt::Scene*> ( kInstances, &parts [ 0 ] );
+			for ( qint32 k = 0; k < kInstances; k++ )
+			{
+				QMatrix4x4 t;
+				t.translate ( float ( k % 32 ), 0.f, float ( k / 32 ) );
+				rootTransforms.append ( jcqt::gpumat4 ( t ) );
+			}
+			meshCounts = QList<quint32> ( kInstances, 64 );
+		}
+		else
+		{
+			for ( qint32 k = 0; k < parts.size (); k++ )
+			{
+				makeBenchmarkScene ( parts [ k ], nodes / 10, 10 + k );
+				pointers.append ( &parts [ k ] );
+			}
+		}
+
+		QBENCHMARK
+		{
+			jcqt::Scene merged;
+			jcqt::mergeScenes ( merged, pointers, rootTransforms, meshCounts );
+		}
+	}
+
+	void benchmarkDeleteSceneNodes_data ()
+	{
+		QTest::addColumn<qint32> ( "nodes" );
+		QTest::addColumn<bool> ( "reference" );
+		for ( const Size& size : kSizes )
+			QTest::newRow ( size.tag_ ) << size.nodes_ << false;
+		// the reference rows stop at 100k, closing the request under its subtrees walks the ancestors of every node
+		QTest::newRow ( "reference 1k" ) << 1000 << true;
+		QTest::newRow ( "reference 100k" ) << 100000 << true;
+	}
+
+	// a hundred random subtrees, the same ones for deleteSceneNodes() and the algorithm it replaced; copying the scene is part of the measurement
+	void benchmarkDeleteSceneNodes ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, reference );
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 20 );
+
+		QRandomGenerator rng ( 21 );
+		QList<quint32> request ( 100 );
+		for ( quint32& node : request )
+			node = 1 + rng.bounded ( quint32 ( nodes - 1 ) );
+		// the reference only handles a sorted request that already holds every subtree
+		const QList<quint32> closed = reference ? closeUnderSubtrees ( scene, request ) : QList<quint32> ();
+
+		QBENCHMARK
+		{
+			jcqt::Scene copy = scene;
+			if ( reference )
+				referenceDeleteSceneNodes ( copy, closed );
+			else
+				jcqt::deleteSceneNodes ( copy, request );
+		}
+	}
+
+	void benchmarkFindNodeByName_data ()
+	{
+		addSizeRows ();
+	}
+
+	// a thousand lookups, a tenth of them for names that do not exist
+	void benchmarkFindNodeByName ()
+	{
+		QFETCH ( qint32, nodes );
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 30 );
+
+		QRandomGenerator rng ( 31 );
+		QStringList queries;
+		for ( qint32 i = 0; i < 1000; i++ )
+		{
+			const qint32 node = qint32 ( rng.bounded ( nodes / 10 ) ) * 10;
+			queries.append ( i % 10 == 0 ? QStringLiteral ( "missing_%1" ).arg ( i ) : QStringLiteral ( "node_%1" ).arg ( node ) );
+		}
+
+		qint64 found = 0;
+		QBENCHMARK
+		{
+			for ( const QString& name : queries )
+				found += jcqt::findNodeByName ( scene, name ) != -1;
+		}
+		QVERIFY ( found > 0 );
+	}
+
+	void benchmarkComponentLookup_data ()
+	{
+		addVariantRows ( "dense", "QHash", "ComponentArray" );
+	}
+
+	// a value for nine nodes out of ten, looked up in traversal order, which after reorderSceneBreadthFirst() is close to index order with some jumps
+	void benchmarkComponentLookup ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, dense );
+
+		QRandomGenerator rng ( 81 );
+		QHash<quint32, quint32> hash;
+		jcqt::ComponentArray components;
+		for ( qint32 i = 0; i < nodes; i++ )
+		{
+			if ( rng.bounded ( 10 ) == 0 )
+				continue;
+			if ( dense )
+				components.insert ( i, i & 0xffff );
+			else
+				hash.insert ( i, i & 0xffff );
+		}
+
+		QList<qint32> order ( nodes );
+		std::iota ( order.begin (), order.end (), 0 );
+		for ( qint32 i = 0; i < nodes; i += 64 )
+			std::swap ( order [ i ], order [ rng.bounded ( nodes ) ] );
+
+		if ( dense )
+			qDebug () << "ComponentArray bytes:" << components.memoryUsage ();
+		else
+			qDebug () << "QHash bytes (approximate):" << hash.capacity () * qsizetype ( 1 + 2 * sizeof ( quint32 ) );
+
+		qint64 sum = 0;
+		QBENCHMARK
+		{
+			sum = 0;
+			if ( dense )
+			{
+				for ( qint32 n : order )
+					sum += components.value ( n, 0 );
+			}
+			else
+			{
+				for ( qint32 n : order )
+					sum += hash.value ( n, 0 );
+			}
+		}
+		QVERIFY ( sum > 0 );
+	}
+
+	void benchmarkAddNodes_data ()
+	{
+		addVariantRows ( "batched", "addNode", "addNodes" );
+	}
+
+	// a procedural city: one block per thousand nodes, a thousand buildings each, one wide fan-out per block
+	void benchmarkAddNodes ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, batched );
+
+		const qint32 blocks = qMax ( nodes / 1000, 1 );
+		QList<qint32> parents;
+		QList<qint32> levels;
+		parents.reserve ( 1 + blocks * 1001 );
+		levels.reserve ( 1 + blocks * 1001 );
+		parents.append ( -1 );
+		levels.append ( 0 );
+		for ( qint32 b = 0; b < blocks; b++ )
+		{
+			parents.append ( 0 );
+			levels.append ( 1 );
+		}
+		for ( qint32 b = 0; b < blocks; b++ )
+		{
+			for ( qint32 k = 0; k < 1000; k++ )
+			{
+				parents.append ( 1 + b );
+				levels.append ( 2 );
+			}
+		}
+
+		QBENCHMARK
+		{
+			jcqt::Scene city;
+			if ( batched )
+			{
+				jcqt::addNodes ( city, parents, levels );
+			}
+			else
+			{
+				for ( qsizetype i = 0; i < parents.size (); i++ )
+					jcqt::addNode ( city, parents [ i ], levels [ i ] );
+			}
+			QCOMPARE ( city.hierarchy_.size (), parents.size () );
+		}
+	}
+
+	void benchmarkSubtreeQueries_data ()
+	{
+		addVariantRows ( "indexed", "parent walk", "pre-order index" );
+	}
+
+	void benchmarkSubtreeQueries ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, indexed );
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 503 );
+		const jcqt::SceneTraversal traversal ( scene );
+
+		QRandomGenerator rng ( 504 );
+		QList<qint32> queries ( 200000 );
+		for ( qint32& q : queries )
+			q = qint32 ( rng.bounded ( nodes ) );
+
+		// how many query pairs are ancestor and descendant, then how many nodes a selection of ten subtrees covers
+		qint64 hits = 0;
+		QBENCHMARK
+		{
+			hits = 0;
+			for ( qsizetype i = 0; i + 1 < queries.size (); i += 2 )
+			{
+				const qint32 a = queries [ i ] % 1000;
+				const qint32 b = queries [ i + 1 ];
+				if ( indexed )
+				{
+					hits += traversal.isAncestor ( a, b );
+				}
+				else
+				{
+					for ( qint32 p = scene.hierarchy_ [ b ].parent_; p != -1; p = scene.hierarchy_ [ p ].parent_ )
+					{
+						if ( p == a )
+						{
+							hits++;
+							break;
+						}
+					}
+				}
+			}
+
+			for ( qint32 k = 0; k < 10; k++ )
+			{
+				const qint32 root = queries [ k ] % 100;
+				if ( indexed )
+				{
+					hits += traversal.subtreeSize ( root );
+				}
+				else
+				{
+					QList<qint32> stack { root };
+					while ( !stack.isEmpty () )
+					{
+						const qint32 n = stack.takeLast ();
+						hits++;
+						for ( qint32 c = scene.hierarchy_ [ n ].firstChild_; c != -1; c = scene.hierarchy_ [ c ].nextSibling_ )
+							stack.append ( c );
+					}
+				}
+			}
+		}
+		QVERIFY ( hits > 0 );
+	}
+
+	void benchmarkTransformPublish_data ()
+	{
+		addVariantRows ( "dirtyPages", "full copy", "dirty pages" );
+	}
+
+	void benchmarkTransformPublish ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, dirtyPages );
+
+		// a thousand transforms move per frame, the recalculation itself is left out
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 703 );
+		jcqt::TransformSnapshots snapshots;
+		snapshots.publish ( scene );
+
+		QRandomGenerator rng ( 704 );
+		QList<qint32> moving ( 1000 );
+		for ( qint32& node : moving )
+			node = qint32 ( rng.bounded ( nodes ) );
+
+		QBENCHMARK
+		{
+			for ( qint32 node : moving )
+			{
+				scene.globalTransforms_ [ node ].data_ [ 12 ] += 1.0f;
+				if ( dirtyPages )
+					snapshots.markChanged ( node );
+			}
+			if ( !dirtyPages )
+				snapshots.markAllChanged ();
+			snapshots.publish ( scene );
+			snapshots.acquire ();
+		}
+	}
+
+	void benchmarkSyntheticScene_data ()
+	{
+		addVariantRows ( "throughJson", "generateSyntheticScene", "JSON + parse + build" );
+	}
+
+	void benchmarkSyntheticScene ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, throughJson );
+
+		const jcqt::SyntheticSceneOptions options = jcqt::SyntheticSceneOptions::wideCity ( nodes );
+		QBENCHMARK
+		{
+			jcqt::Scene scene;
+			if ( throughJson )
+			{
+				jcqt::gltf::Document doc;
+				QVERIFY ( jcqt::gltf::parseDocument ( jcqt::generateSyntheticGLTF ( options ).json_, doc ) );
+				QVERIFY ( jcqt::buildScene ( doc, scene ) );
+			}
+			else
+			{
+				jcqt::generateSyntheticScene ( scene, options );
+			}
+		}
+	}
+
+	void benchmarkTraceOverhead_data ()
+	{
+		addVariantRows ( "recording", "not recording", "recording" );
+	}
+
+	// a full update of a deep rig, one level span per level when recording
+	void benchmarkTraceOverhead ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, recording );
+
+		jcqt::Scene rig;
+		jcqt::generateSyntheticScene ( rig, jcqt::SyntheticSceneOptions::deepRig ( nodes ) );
+		if ( recording )
+			jcqt::trace::start ();
+
+		QBENCHMARK
+		{
+			jcqt::markAsChanged ( rig, 1 );
+			jcqt::recalculateGlobalTransforms ( rig );
+		}
+
+		jcqt::trace::stop ();
+		jcqt::trace::clear ();
+	}
+
+	void benchmarkWarmStart_data ()
+	{
+		addVariantRows ( "cached", "parse + build", "cache hit" );
+	}
+
+	// load, build the scene and read every primitive's positions and indices
+	void benchmarkWarmStart ()
+	{
+		QFETCH ( qint32, nodes );
+		QFETCH ( bool, cached );
+
+		QTemporaryDir dir;
+		QVERIFY ( dir.isValid () );
+		const QString filename = dir.filePath ( QStringLiteral ( "city.gltf" ) );
+		QVERIFY ( jcqt::writeSyntheticGLTF ( filename, jcqt::SyntheticSceneOptions::wideCity ( nodes ) ) );
+
+		jcqt::AssetCache cache ( dir.filePath ( QStringLiteral ( "cache" ) ) );
+		if ( cached )
+		{
+			GLTFLoader warmup;
+			warmup.setAssetCache ( &cache );
+			QVERIFY ( warmup.loadGLTF ( filename ) );
+		}
+
+		QBENCHMARK
+		{
+			GLTFLoader loader;
+			if ( cached )
+				loader.setAssetCache ( &cache );
+			QVERIFY ( loader.loadGLTF ( filename ) );
+			QCOMPARE ( loader.isFromCache (), cached );
+
+			jcqt::Scene scene;
+			QVERIFY ( loader.buildScene ( scene ) );
+			QList<float> positions;
+			QList<quint32> indices;
+			for ( const jcqt::gltf::Mesh& mesh : loader.document ().meshes_ )
+			{
+				for ( const jcqt::gltf::Primitive& primitive : mesh.primitives_ )
+				{
+					QVERIFY ( loader.readAccessor ( primitive.attribute ( QStringLiteral ( "POSITION" ) ), positions ) );
+					QVERIFY ( loader.readIndices ( primitive.indices_, indices ) );
+				}
+			}
+		}
+	}
+
+	void benchmarkSaveScene_data ()
+	{
+		addSizeRows ();
+	}
+
+	void benchmarkSaveScene ()
+	{
+		QFETCH ( qint32, nodes );
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 40 );
+		QTemporaryDir dir;
+		QVERIFY ( dir.isValid () );
+		const QString path = dir.filePath ( QStringLiteral ( "scene.bin" ) );
+
+		QBENCHMARK
+		{
+			jcqt::saveScene ( path, scene );
+		}
+	}
+
+	void benchmarkOpenSceneFile_data ()
+	{
+		addSizeRows ();
+	}
+
+	// the file is mapped and used in place instead of copied into a Scene
+	void benchmarkOpenSceneFile ()
+	{
+		QFETCH ( qint32, nodes );
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 60 );
+		QTemporaryDir dir;
+		QVERIFY ( dir.isValid () );
+		const QString path = dir.filePath ( QStringLiteral ( "scene.bin" ) );
+		jcqt::saveScene ( path, scene );
+
+		QBENCHMARK
+		{
+			jcqt::SceneFile file;
+			QVERIFY ( file.open ( path ) );
+			QCOMPARE ( file.hierarchy () [ nodes - 1 ].level_, scene.hierarchy_ [ nodes - 1 ].level_ );
+		}
+	}
+
+	void benchmarkLoadScene_data ()
+	{
+		addSizeRows ();
+	}
+
+	void benchmarkLoadScene ()
+	{
+		QFETCH ( qint32, nodes );
+
+		jcqt::Scene scene;
+		makeBenchmarkScene ( scene, nodes, 50 );
+		QTemporaryDir dir;
+		QVERIFY ( dir.isValid () );
+		const QString path = dir.filePath ( QStringLiteral ( "scene.bin" ) );
+		jcqt::saveScene ( path, scene );
+
+		QBENCHMARK
+		{
+			jcqt::Scene loaded;
+			jcqt::loadScene ( path, loaded );
+		}
+	}
+};
+
+// Benchmark results of a QTest csv log: "function","tag","metric",value per iteration,total,iterations
+struct BenchmarkResult
+{
+	QString metric_;
+	double value_;
+};
+
+static QMap<QString, BenchmarkResult> readBenchmarkCsv ( const QString& filename )
+{
+	QMap<QString, BenchmarkResult> results;
+	QFile f ( filename );
+	if ( !f.open ( QIODeviceBase::ReadOnly | QIODeviceBase::Text ) )
+	{
+		qWarning () << "Cannot open benchmark results " << filename << Qt::endl;
+		return results;
+	}
+
+	while ( !f.atEnd () )
+	{
+		const QList<QByteArray> fields = f.readLine ().trimmed ().split ( ',' );
+		if ( fields.size () < 4 )
+			continue;
+
+		auto unquote = [] ( const QByteArray& field ) { return QString::fromUtf8 ( field.mid ( 1, field.size () - 2 ) ); };
+		bool ok = false;
+		const double value = fields [ 3 ].toDouble ( &ok );
+		if ( ok )
+			results.insert ( unquote ( fields [ 0 ] ) + ':' + unquote ( fields [ 1 ] ), BenchmarkResult { .metric_ = unquote ( fields [ 2 ] ), .value_ = value } );
+	}
+	return results;
+}
+
+// Prints every case of current next to baseline and returns the number of cases slower than the tolerance allows
+static qint32 compareWithBaseline ( const QMap<QString, BenchmarkResult>& baseline, const QMap<QString, BenchmarkResult>& current, double tolerance )
+{
+	QTextStream out ( stdout );
+	qint32 regressions = 0;
+	out << Qt::endl << "case,metric,baseline,current,slowdown %,status" << Qt::endl;
+	for ( auto it = current.cbegin (); it != current.cend (); ++it )
+	{
+		const auto base = baseline.constFind ( it.key () );
+		if ( base == baseline.cend () || base->metric_ != it->metric_ || base->value_ <= 0.0 )
+		{
+			out << it.key () << ',' << it->metric_ << ",," << it->value_ << ",,new" << Qt::endl;
+			continue;
+		}
+
+		// positive is slower: time and counts grow, throughputs (e.g. BytesPerSecond) shrink
+		const double sign = it->metric_.endsWith ( QStringLiteral ( "PerSecond" ) ) ? -1.0 : 1.0;
+		const double change = sign * ( it->value_ - base->value_ ) / base->value_ * 100.0;
+		const bool regressed = change > tolerance;
+		regressions += regressed;
+		out << it.key () << ',' << it->metric_ << ',' << base->value_ << ',' << it->value_ << ',' << QString::number ( change, 'f', 1 ) << ','
+			<< ( regressed ? "REGRESSION" : ( change < -tolerance ? "faster" : "ok" ) ) << Qt::endl;
+	}
+	out << regressions << " regression(s) beyond " << tolerance << "%" << Qt::endl;
+	return regressions;
+}
+
+int main ( int argc, char* argv [] )
+{
+	QCoreApplication app ( argc, argv );
+
+	// pick out our options, everything else is for QTest
+	QString baselineFile;
+	QString saveBaselineFile;
+	double tolerance = 10.0;
+	const QStringList args = app.arguments ();
+	QStringList testArgs { args.value ( 0 ) };
+	for ( qsizetype i = 1; i < args.size (); i++ )
+	{
+		if ( args [ i ] == QStringLiteral ( "--baseline" ) && i + 1 < args.size () )
+			baselineFile = args [ ++i ];
+		else if ( args [ i ] == QStringLiteral ( "--save-baseline" ) && i + 1 < args.size () )
+			saveBaselineFile = args [ ++i ];
+		else if ( args [ i ] == QStringLiteral ( "--tolerance" ) && i + 1 < args.size () )
+			tolerance = args [ ++i ].toDouble ();
+		else
+			testArgs.append ( args [ i ] );
+	}
+
+	// the csv logger is the machine-readable record both options work from, the plain text log still goes to the console
+	QTemporaryDir resultsDir;
+	const QString resultsFile = resultsDir.filePath ( QStringLiteral ( "results.csv" ) );
+	const bool withBaseline = !baselineFile.isEmpty () || !saveBaselineFile.isEmpty ();
+	if ( withBaseline )
+		testArgs << QStringLiteral ( "-o" ) << resultsFile + QStringLiteral ( ",csv" ) << QStringLiteral ( "-o" ) << QStringLiteral ( "-,txt" );
+
+	SceneBenchmark benchmark;
+	int result = QTest::qExec ( &benchmark, testArgs );
+	if ( !withBaseline )
+		return result;
+
+	if ( !saveBaselineFile.isEmpty () )
+	{
+		QFile::remove ( saveBaselineFile );
+		if ( !QFile::copy ( resultsFile, saveBaselineFile ) )
+		{
+			qWarning () << "Cannot write baseline " << saveBaselineFile << Qt::endl;
+			result = 1;
+		}
+	}
+
+	if ( !baselineFile.isEmpty () && compareWithBaseline ( readBenchmarkCsv ( baselineFile ), readBenchmarkCsv ( resultsFile ), tolerance ) > 0 )
+		result = 1;
+
+	return result;
+}
+
+#include "SceneBenchmark.moc"
@@ -0,0 +1,529 @@
+/*****************************************************************//**
+ * \file   SceneFile.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  versioned, memory-mappable binary scene file
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "SceneFile.h"
+#include "Hash.h"
+#include "Trace.h"
+
+#include <QDebug>
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <iterator>
+
+namespace jcqt
+{
+	static_assert ( sizeof ( SceneFileHeader ) == 32, "SceneFileHeader is part of the file format" );
+	static_assert ( sizeof ( SceneFileSection ) == 32, "SceneFileSection is part of the file format" );
+	static_assert ( sizeof ( gpumat4 ) == 64 && sizeof ( Hierarchy ) == 20, "transforms and hierarchy are stored as raw arrays" );
+
+	static qint64 alignUp ( qint64 offset )
+	{
+		return ( offset + SCENE_FILE_ALIGNMENT - 1 ) & ~( SCENE_FILE_ALIGNMENT - 1 );
+	}
+
+	// version 3: one qint32 per node, padded with -1 if the array is shorter than the scene
+	static QByteArrayView encodeNodeArray ( const qint32* values, qsizetype size, qsizetype nodeCount, QByteArray& storage )
+	{
+		if ( size == nodeCount )
+			return QByteArrayView ( reinterpret_cast<const char*>( values ), nodeCount * qsizetype ( sizeof ( qint32 ) ) );
+
+		QList<qint32> padded ( nodeCount, -1 );
+		if ( size > 0 )
+			memcpy ( padded.data (), values, qMin ( size, nodeCount ) * sizeof ( qint32 ) );
+		storage = QByteArray ( reinterpret_cast<const char*>( padded.constData () ), nodeCount * qsizetype ( sizeof ( qint32 ) ) );
+		return storage;
+	}
+
+	static QByteArrayView encodeComponents ( const ComponentArray& components, qsizetype nodeCount, QByteArray& storage )
+	{
+		return encodeNodeArray ( components.constData (), components.size (), nodeCount, storage );
+	}
+
+	static QByteArrayView listBytes ( const QList<qint32>& values )
+	{
+		return QByteArrayView ( reinterpret_cast<const char*>( values.constData () ), values.size () * qsizetype ( sizeof ( qint32 ) ) );
+	}
+
+	// Whether each of the count ids is -1 or a valid index below size
+	static bool idsInRange ( const qint32* ids, qsizetype count, qsizetype size )
+	{
+		return std::all_of ( ids, ids + count, [size] ( qint32 id ) { return id >= -1 && id < size; } );
+	}
+
+	static bool idsInRange ( const QList<qint32>& ids, qsizetype size )
+	{
+		return idsInRange ( ids.constData (), ids.size (), size );
+	}
+
+	// Whether every hierarchy link is -1 or a node of the scene, they are used as indices without further checks
+	static bool hierarchyInRange ( const QList<Hierarchy>& hierarchy )
+	{
+		const qint32 nodes = qint32 ( hierarchy.size () );
+		auto inRange = [nodes] ( qint32 link ) { return link >= -1 && link < nodes; };
+		return std::all_of ( hierarchy.cbegin (), hierarchy.cend (), [&inRange] ( const Hierarchy& h ) {
+			return inRange ( h.parent_ ) && inRange ( h.firstChild_ ) && inRange ( h.nextSibling_ ) && inRange ( h.lastSibling_ ) && h.level_ >= 0;
+			} );
+	}
+
+	/*
+	*	Copies a stored name index, false if it is missing or does not fit the names and nodes loaded. Without checksums nothing vouches
+	*	for the stored values, so every id and node is range checked, the lookup table must have an empty slot to end its probes and the
+	*	per-name lists must be ascending (hence acyclic) and agree with nameForNode_.
+	*/
+	static bool loadNameIndex ( const SceneFile& file, Scene& scene )
+	{
+		const QByteArrayView lookup = file.section ( SceneSectionId::NameLookup );
+		const QByteArrayView first = file.section ( SceneSectionId::FirstNodeForName );
+		const QByteArrayView next = file.section ( SceneSectionId::NextNodeWithName );
+
+		const qsizetype slots = lookup.size () / qsizetype ( sizeof ( qint32 ) );
+		if ( lookup.size () % sizeof ( qint32 ) != 0 || slots < 2 * scene.names_.size () || ( slots & ( slots - 1 ) ) != 0 ||
+			first.size () != scene.names_.size () * qsizetype ( sizeof ( qint32 ) ) ||
+			next.size () != scene.hierarchy_.size () * qsizetype ( sizeof ( qint32 ) ) )
+			return false;
+
+		scene.nameLookup_.resize ( slots );
+		scene.firstNodeForName_.resize ( scene.names_.size () );
+		scene.nextNodeWithName_.resize ( scene.hierarchy_.size () );
+		memcpy ( scene.nameLookup_.data (), lookup.data (), lookup.size () );
+		memcpy ( scene.firstNodeForName_.data (), first.data (), first.size () );
+		memcpy ( scene.nextNodeWithName_.data (), next.data (), next.size () );
+
+		const qsizetype names = scene.names_.size ();
+		const qsizetype nodes = scene.hierarchy_.size ();
+		if ( !idsInRange ( scene.nameLookup_, names ) || !scene.nameLookup_.contains ( -1 ) ||
+			!idsInRange ( scene.firstNodeForName_, nodes ) || !idsInRange ( scene.nextNodeWithName_, nodes ) )
+			return false;
+
+		for ( qsizetype id = 0; id < names; id++ )
+		{
+			const qint32 head = scene.firstNodeForName_ [ id ];
+			if ( head != -1 && scene.nameForNode_.value ( head ) != id )
+				return false;
+		}
+		for ( qint32 n = 0; n < nodes; n++ )
+		{
+			const qint32 following = scene.nextNodeWithName_ [ n ];
+			if ( following != -1 && ( following <= n || scene.nameForNode_.value ( following ) != scene.nameForNode_.value ( n ) ) )
+				return false;
+		}
+		return true;
+	}
+
+	static bool decodeComponents ( QByteArrayView bytes, qsizetype nodeCount, ComponentArray& components )
+	{
+		components.clear ();
+		if ( bytes.isEmpty () )
+			return true;
+		if ( bytes.size () != nodeCount * qsizetype ( sizeof ( qint32 ) ) )
+			return false;
+
+		components.resize ( nodeCount );
+		memcpy ( components.data (), bytes.data (), bytes.size () );
+		return true;
+	}
+
+	// version 2: { node, value } pairs sorted by node
+	static bool decodePairs ( QByteArrayView bytes, qsizetype nodeCount, ComponentArray& components )
+	{
+		if ( bytes.size () % ( 2 * sizeof ( quint32 ) ) != 0 )
+			return false;
+
+		const qsizetype count = bytes.size () / ( 2 * sizeof ( quint32 ) );
+		const uchar* p = reinterpret_cast<const uchar*>( bytes.data () );
+		components = ComponentArray ( nodeCount );
+		for ( qsizetype i = 0; i < count; i++ )
+		{
+			quint32 pair [ 2 ];
+			memcpy ( pair, p + i * sizeof ( pair ), sizeof ( pair ) );
+			if ( pair [ 0 ] >= quint32 ( nodeCount ) )
+				return false;
+			components.insert ( qint32 ( pair [ 0 ] ), qint32 ( pair [ 1 ] ) );
+		}
+		return true;
+	}
+
+	static QByteArray encodeStrings ( const QStringList& strings )
+	{
+		QList<quint32> offsets;
+		offsets.reserve ( strings.size () + 2 );
+		offsets.append ( quint32 ( strings.size () ) );
+
+		QByteArray text;
+		for ( const QString& s : strings )
+		{
+			offsets.append ( quint32 ( text.size () ) );
+			text += s.toUtf8 ();
+		}
+		offsets.append ( quint32 ( text.size () ) );
+
+		return QByteArray ( reinterpret_cast<const char*>( offsets.constData () ), offsets.size () * sizeof ( quint32 ) ) + text;
+	}
+
+	static bool decodeStrings ( QByteArrayView bytes, QStringList& strings )
+	{
+		strings.clear ();
+		if ( bytes.isEmpty () )
+			return true;
+
+		quint32 count = 0;
+		if ( bytes.size () < qsizetype ( sizeof ( count ) ) )
+			return false;
+		memcpy ( &count, bytes.data (), sizeof ( count ) );
+
+		const qint64 tableSize = ( qint64 ( count ) + 2 ) * qint64 ( sizeof ( quint32 ) );
+		if ( tableSize > bytes.size () )
+			return false;
+
+		QList<quint32> offsets ( count + 1 );
+		memcpy ( offsets.data (), bytes.data () + sizeof ( quint32 ), ( count + 1 ) * sizeof ( quint32 ) );
+		const QByteArrayView text = bytes.sliced ( tableSize );
+
+		strings.reserve ( count );
+		for ( quint32 i = 0; i < count; i++ )
+		{
+			if ( offsets [ i ] > offsets [ i + 1 ] || offsets [ i + 1 ] > quint32 ( text.size () ) )
+				return false;
+			strings.append ( QString::fromUtf8 ( text.sliced ( offsets [ i ], offsets [ i + 1 ] - offsets [ i ] ) ) );
+		}
+		return true;
+	}
+
+	SceneFile::~SceneFile ()
+	{
+		close ();
+	}
+
+	bool SceneFile::open ( const QString& filename, bool verifyChecksums )
+	{
+		JCQT_TRACE_SPAN ( span, "SceneFile::open" );
+		close ();
+
+		m_file.setFileName ( filename );
+		if ( !m_file.open ( QIODevice::ReadOnly ) )
+		{
+			qWarning () << "Cannot open scene file " << filename << Qt::endl;
+			return false;
+		}
+
+		const qint64 fileSize = m_file.size ();
+		if ( fileSize > 0 )
+		{
+			m_mappedData = m_file.map ( 0, fileSize );
+		}
+
+		if ( m_mappedData )
+		{
+			m_view = QByteArrayView ( m_mappedData, fileSize );
+		}
+		else
+		{
+			// Not every file engine can map (e.g. compressed Qt resources), fall back to reading the whole file.
+			m_fileData = m_file.readAll ();
+			m_view = QByteArrayView ( m_fileData );
+		}
+
+		// the mapping stays valid after the file handle is closed
+		m_file.close ();
+
+		auto fail = [this, &filename] ( const char* reason )
+		{
+			qWarning () << "Invalid scene file " << filename << ": " << reason << Qt::endl;
+			close ();
+			return false;
+		};
+
+		if ( m_view.size () < qsizetype ( sizeof ( SceneFileHeader ) ) )
+			return fail ( "file too short" );
+
+		memcpy ( &m_header, m_view.data (), sizeof ( m_header ) );
+		if ( m_header.magic_ != SCENE_FILE_MAGIC )
+			return fail ( "bad magic" );
+		if ( m_header.byteOrder_ != SCENE_FILE_BYTE_ORDER )
+			return fail ( "saved on a machine with a different byte order" );
+		if ( m_header.version_ < SCENE_FILE_MIN_VERSION || m_header.version_ > SCENE_FILE_VERSION )
+			return fail ( "unsupported version" );
+
+		const qint64 tableEnd = qint64 ( sizeof ( SceneFileHeader ) ) + qint64 ( m_header.sectionCount_ ) * qint64 ( sizeof ( SceneFileSection ) );
+		if ( tableEnd > m_view.size () )
+			return fail ( "truncated section table" );
+
+		m_sections.resize ( m_header.sectionCount_ );
+		memcpy ( m_sections.data (), m_view.data () + sizeof ( SceneFileHeader ), m_header.sectionCount_ * sizeof ( SceneFileSection ) );
+
+		for ( const SceneFileSection& s : m_sections )
+		{
+			if ( s.offset_ < quint64 ( tableEnd ) || s.offset_ % SCENE_FILE_ALIGNMENT != 0 || s.offset_ > quint64 ( m_view.size () ) || s.size_ > quint64 ( m_view.size () ) - s.offset_ )
+				return fail ( "section out of range" );
+
+			if ( verifyChecksums && ( m_header.flags_ & kSceneFileChecksums ) && hash64 ( m_view.data () + s.offset_, qsizetype ( s.size_ ) ) != s.checksum_ )
+				return fail ( "checksum mismatch" );
+		}
+
+		// the arrays used in place must have exactly nodeCount elements
+		const qsizetype nodes = m_header.nodeCount_;
+		if ( section ( SceneSectionId::LocalTransforms ).size () != nodes * qsizetype ( sizeof ( gpumat4 ) ) ||
+			section ( SceneSectionId::GlobalTransforms ).size () != nodes * qsizetype ( sizeof ( gpumat4 ) ) ||
+			section ( SceneSectionId::Hierarchy ).size () != nodes * qsizetype ( sizeof ( Hierarchy ) ) )
+			return fail ( "transform or hierarchy section does not match the node count" );
+
+		JCQT_TRACE_COUNTS ( span, m_view.size (), nodes );
+		return true;
+	}
+
+	void SceneFile::close ()
+	{
+		if ( m_mappedData )
+		{
+			m_file.unmap ( m_mappedData );
+			m_mappedData = nullptr;
+		}
+
+		m_fileData.clear ();
+		m_view = QByteArrayView ();
+		m_header = SceneFileHeader {};
+		m_sections.clear ();
+	}
+
+	bool SceneFile::isOpen () const
+	{
+		return !m_view.isEmpty ();
+	}
+
+	qint32 SceneFile::nodeCount () const
+	{
+		return qint32 ( m_header.nodeCount_ );
+	}
+
+	bool SceneFile::hasChecksums () const
+	{
+		return ( m_header.flags_ & kSceneFileChecksums ) != 0;
+	}
+
+	const gpumat4* SceneFile::localTransforms () const
+	{
+		return reinterpret_cast<const gpumat4*>( section ( SceneSectionId::LocalTransforms ).data () );
+	}
+
+	const gpumat4* SceneFile::globalTransforms () const
+	{
+		return reinterpret_cast<const gpumat4*>( section ( SceneSectionId::GlobalTransforms ).data () );
+	}
+
+	const Hierarchy* SceneFile::hierarchy () const
+	{
+		return reinterpret_cast<const Hierarchy*>( section ( SceneSectionId::Hierarchy ).data () );
+	}
+
+	const qint32* SceneFile::components ( SceneSectionId id ) const
+	{
+		const QByteArrayView bytes = section ( id );
+		if ( m_header.version_ < 3 || bytes.size () != qsizetype ( nodeCount () ) * qsizetype ( sizeof ( qint32 ) ) )
+			return nullptr;
+		return reinterpret_cast<const qint32*>( bytes.data () );
+	}
+
+	QByteArrayView SceneFile::section ( SceneSectionId id ) const
+	{
+		for ( const SceneFileSection& s : m_sections )
+		{
+			if ( s.id_ == quint32 ( id ) )
+				return m_view.sliced ( qsizetype ( s.offset_ ), qsizetype ( s.size_ ) );
+		}
+		return QByteArrayView ();
+	}
+
+	bool SceneFile::load ( Scene& scene ) const
+	{
+		if ( !isOpen () )
+			return false;
+
+		const qsizetype nodes = nodeCount ();
+		JCQT_TRACE_SPAN ( span, "SceneFile::load" );
+		JCQT_TRACE_COUNTS ( span, m_view.size (), nodes );
+		scene = Scene ();
+		scene.localTransforms_.resize ( nodes );
+		scene.globalTransforms_.resize ( nodes );
+		scene.hierarchy_.resize ( nodes );
+
+		// one memcpy per array straight out of the mapping
+		memcpy ( scene.localTransforms_.data (), localTransforms (), nodes * sizeof ( gpumat4 ) );
+		memcpy ( scene.globalTransforms_.data (), globalTransforms (), nodes * sizeof ( gpumat4 ) );
+		memcpy ( scene.hierarchy_.data (), hierarchy (), nodes * sizeof ( Hierarchy ) );
+		if ( !hierarchyInRange ( scene.hierarchy_ ) )
+		{
+			qWarning () << "Hierarchy links out of range in scene file" << Qt::endl;
+			scene = Scene ();
+			return false;
+		}
+
+		auto decode = ( m_header.version_ < 3 ) ? decodePairs : decodeComponents;
+		if ( !decode ( section ( SceneSectionId::Meshes ), nodes, scene.meshes_ ) ||
+			!decode ( section ( SceneSectionId::MaterialForNode ), nodes, scene.materialForNode_ ) ||
+			!decode ( section ( SceneSectionId::NameForNode ), nodes, scene.nameForNode_ ) ||
+			!decodeStrings ( section ( SceneSectionId::Names ), scene.names_ ) ||
+			!decodeStrings ( section ( SceneSectionId::MaterialNames ), scene.materialNames_ ) )
+		{
+			qWarning () << "Malformed component or name section in scene file" << Qt::endl;
+			return false;
+		}
+
+		// version 2 names may repeat and come without an index; rebuildNameIndex() also drops name ids past the end of names_
+		if ( m_header.version_ < 3 || !idsInRange ( scene.nameForNode_.constData (), scene.nameForNode_.size (), scene.names_.size () ) || !loadNameIndex ( *this, scene ) )
+			rebuildNameIndex ( scene );
+
+		return true;
+	}
+
+	bool SceneFile::save ( const QString& filename, const Scene& scene, bool withChecksums, const QList<SceneFileExtraSection>& extraSections )
+	{
+		JCQT_TRACE_SPAN ( span, "SceneFile::save" );
+		QFile f ( filename );
+		if ( !f.open ( QIODeviceBase::WriteOnly ) )
+		{
+			qDebug () << "Failed to open " << filename << "! Cannot save scene." << Qt::endl;
+			return false;
+		}
+
+		const qsizetype nodes = scene.hierarchy_.size ();
+		QByteArray padded [ 3 ];
+		const QByteArrayView meshes = encodeComponents ( scene.meshes_, nodes, padded [ 0 ] );
+		const QByteArrayView materials = encodeComponents ( scene.materialForNode_, nodes, padded [ 1 ] );
+		const QByteArrayView nameForNode = encodeComponents ( scene.nameForNode_, nodes, padded [ 2 ] );
+		const QByteArray names = encodeStrings ( scene.names_ );
+		const QByteArray materialNames = encodeStrings ( scene.materialNames_ );
+
+		// only an index that covers names_ is worth saving, otherwise the reader rebuilds it
+		const bool nameIndex = scene.firstNodeForName_.size () == scene.names_.size () && scene.nameLookup_.size () >= 2 * scene.names_.size () &&
+			scene.nextNodeWithName_.size () >= scene.nameForNode_.size ();
+		QByteArray paddedNext;
+		const QByteArrayView nextNodeWithName = encodeNodeArray ( scene.nextNodeWithName_.constData (), scene.nextNodeWithName_.size (), nodes, paddedNext );
+
+		// the file stores matrices only, pending split TRS edits are composed into a copy rather than saved stale
+		QList<gpumat4> composedLocal;
+		const gpumat4* local = scene.localTransforms_.constData ();
+		if ( !scene.trsChanged_.isEmpty () )
+		{
+			composedLocal = scene.localTransforms_;
+			composeTRSBatch ( scene.translations_.constData (), scene.rotations_.constData (), scene.scales_.constData (),
+				scene.trsChanged_.constData (), composedLocal.data (), scene.trsChanged_.size () );
+			local = composedLocal.constData ();
+		}
+
+		QVarLengthArray<QByteArrayView, 16> data {
+			QByteArrayView ( reinterpret_cast<const char*>( local ), nodes * sizeof ( gpumat4 ) ),
+			QByteArrayView ( reinterpret_cast<const char*>( scene.globalTransforms_.constData () ), nodes * sizeof ( gpumat4 ) ),
+			QByteArrayView ( reinterpret_cast<const char*>( scene.hierarchy_.constData () ), nodes * sizeof ( Hierarchy ) ),
+			meshes,
+			materials,
+			nameForNode,
+			names,
+			materialNames,
+			listBytes ( scene.nameLookup_ ),
+			listBytes ( scene.firstNodeForName_ ),
+			nextNodeWithName
+		};
+		QVarLengthArray<quint32, 16> ids {
+			quint32 ( SceneSectionId::LocalTransforms ),
+			quint32 ( SceneSectionId::GlobalTransforms ),
+			quint32 ( SceneSectionId::Hierarchy ),
+			quint32 ( SceneSectionId::Meshes ),
+			quint32 ( SceneSectionId::MaterialForNode ),
+			quint32 ( SceneSectionId::NameForNode ),
+			quint32 ( SceneSectionId::Names ),
+			quint32 ( SceneSectionId::MaterialNames ),
+			quint32 ( SceneSectionId::NameLookup ),
+			quint32 ( SceneSectionId::FirstNodeForName ),
+			quint32 ( SceneSectionId::NextNodeWithName )
+		};
+		if ( !nameIndex )
+		{
+			data.resize ( data.size () - 3 );
+			ids.resize ( ids.size () - 3 );
+		}
+		for ( const SceneFileExtraSection& extra : extraSections )
+		{
+			data.append ( extra.bytes_ );
+			ids.append ( extra.id_ );
+		}
+		const quint32 sectionCount = quint32 ( ids.size () );
+
+		SceneFileHeader header {
+			.magic_ = SCENE_FILE_MAGIC,
+			.version_ = SCENE_FILE_VERSION,
+			.byteOrder_ = SCENE_FILE_BYTE_ORDER,
+			.flags_ = withChecksums ? quint32 ( kSceneFileChecksums ) : 0u,
+			.nodeCount_ = quint32 ( nodes ),
+			.sectionCount_ = sectionCount,
+			.reserved_ = 0
+		};
+
+		QVarLengthArray<SceneFileSection, 16> sections ( sectionCount );
+		const qint64 tableBytes = qint64 ( sectionCount * sizeof ( SceneFileSection ) );
+		qint64 offset = alignUp ( sizeof ( SceneFileHeader ) + tableBytes );
+		for ( quint32 i = 0; i < sectionCount; i++ )
+		{
+			sections [ i ] = SceneFileSection {
+				.id_ = ids [ i ],
+				.reserved_ = 0,
+				.offset_ = quint64 ( offset ),
+				.size_ = quint64 ( data [ i ].size () ),
+				.checksum_ = withChecksums ? hash64 ( data [ i ] ) : 0
+			};
+			offset = alignUp ( offset + data [ i ].size () );
+		}
+
+		static const char padding [ SCENE_FILE_ALIGNMENT ] = {};
+		bool ok = f.write ( reinterpret_cast<const char*>( &header ), sizeof ( header ) ) == sizeof ( header );
+		ok = ok && f.write ( reinterpret_cast<const char*>( sections.constData () ), tableBytes ) == tableBytes;
+		for ( quint32 i = 0; ok && i < sectionCount; i++ )
+		{
+			const qint64 pad = qint64 ( sections [ i ].offset_ ) - f.pos ();
+			ok = f.write ( padding, pad ) == pad;
+			ok = ok && f.write ( data [ i ].data (), data [ i ].size () ) == data [ i ].size ();
+		}
+
+		if ( !ok )
+		{
+			qDebug () << "WRITE operation failed. Failed to save Scene to file." << Qt::endl;
+			return false;
+		}
+
+		JCQT_TRACE_COUNTS ( span, f.pos (), scene.hierarchy_.size () );
+		f.close ();
+		return true;
+	}
+
+	bool SceneFile::isSceneFile ( const QString& filename )
+	{
+		QFile f ( filename );
+		quint32 magic = 0;
+		return f.open ( QIODevice::ReadOnly ) && f.read ( reinterpret_cast<char*>( &magic ), sizeof ( magic ) ) == sizeof ( magic ) && magic == SCENE_FILE_MAGIC;
+	}
+}
@@ -0,0 +1,171 @@
+/*****************************************************************//**
+ * \file   SceneFile.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  versioned, memory-mappable binary scene file
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __SCENE_FILE_H__
+#define __SCENE_FILE_H__
+
+#include <QFile>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+
+#include "GLTFScene.h"
+
+namespace jcqt
+{
+	/*
+	*	Scene file layout (version 3). Version 2 stored the node components as { node, value } pairs and is still read; version 1 is the
+	*	unversioned layout older saveScene() calls wrote, loadScene() still reads it.
+	*
+	*	SceneFileHeader
+	*	SceneFileSection [ sectionCount ]
+	*	section data, every section starts on a 16-byte boundary
+	*
+	*	Everything is stored in the byte order of the machine that saved the file; byteOrder_ tells a reader whether that was its own.
+	*	Readers skip sections with ids they do not know, so sections can be added without a new version.
+	*/
+	constexpr const quint32 SCENE_FILE_MAGIC = 0x4353434A;	// "JCSC" read as little endian
+	constexpr const quint32 SCENE_FILE_VERSION = 3;
+	// oldest version SceneFile::open() accepts
+	constexpr const quint32 SCENE_FILE_MIN_VERSION = 2;
+	constexpr const quint32 SCENE_FILE_BYTE_ORDER = 0x01020304;
+	constexpr const qint64 SCENE_FILE_ALIGNMENT = 16;
+
+	enum class SceneSectionId : quint32
+	{
+		// gpumat4 [ nodeCount ]
+		LocalTransforms = 1,
+		GlobalTransforms = 2,
+		// Hierarchy [ nodeCount ]
+		Hierarchy = 3,
+		// qint32 [ nodeCount ], -1 for nodes without the component (version 2: { node, value } quint32 pairs sorted by node)
+		Meshes = 4,
+		MaterialForNode = 5,
+		NameForNode = 6,
+		// quint32 count, quint32 offsets [ count + 1 ], UTF-8 text
+		Names = 7,
+		MaterialNames = 8,
+		// qint32 arrays of the name index, see Scene; optional, the index is rebuilt if they are missing
+		NameLookup = 9,
+		FirstNodeForName = 10,
+		NextNodeWithName = 11,
+		// entries of the asset cache, see AssetCache.h
+		CacheDependencies = 12,
+		CacheDocument = 13,
+		CacheAccessors = 14,
+		CacheAccessorData = 15,
+		CacheImages = 16,
+		CacheImageData = 17
+	};
+
+	enum SceneFileFlags : quint32
+	{
+		// every section carries a hash64() of its bytes
+		kSceneFileChecksums = 1
+	};
+
+	struct SceneFileHeader
+	{
+		quint32 magic_;
+		quint32 version_;
+		quint32 byteOrder_;
+		quint32 flags_;
+		quint32 nodeCount_;
+		quint32 sectionCount_;
+		quint64 reserved_;
+	};
+
+	struct SceneFileSection
+	{
+		quint32 id_;
+		quint32 reserved_;
+		// from the start of the file
+		quint64 offset_;
+		quint64 size_;
+		quint64 checksum_;
+	};
+
+	// A section SceneFile::save() appends after the scene's own, e.g. the mesh data of an asset cache entry
+	struct SceneFileExtraSection
+	{
+		quint32 id_;
+		QByteArrayView bytes_;
+	};
+
+	/*
+	*	Read access to a version 2 or 3 scene file through a memory mapping. open() only validates the header and the section table (and the
+	*	checksums if asked to); transforms and hierarchy can then be used in place without copying them. load() copies everything into
+	*	a Scene.
+	*/
+	class SceneFile
+	{
+	public:
+		SceneFile () = default;
+		~SceneFile ();
+
+		SceneFile ( const SceneFile& ) = delete;
+		SceneFile& operator= ( const SceneFile& ) = delete;
+
+		bool open ( const QString& filename, bool verifyChecksums = false );
+		void close ();
+		bool isOpen () const;
+
+		qint32 nodeCount () const;
+		bool hasChecksums () const;
+
+		// These point straight into the mapping and stay valid until close(). The hierarchy links are as stored, only load() range checks them.
+		const gpumat4* localTransforms () const;
+		const gpumat4* globalTransforms () const;
+		const Hierarchy* hierarchy () const;
+		// nodeCount() values in place (-1 = none), or nullptr if the section is missing or the file predates dense components
+		const qint32* components ( SceneSectionId id ) const;
+		// Raw bytes of a section, empty if the file does not have it
+		QByteArrayView section ( SceneSectionId id ) const;
+
+		/*
+		*	Copies the file into scene. Hierarchy links must lie inside the scene or the load fails; a name index with ids or nodes out of
+		*	range is rebuilt from nameForNode_ instead, so files without (verified) checksums cannot make later lookups read out of bounds.
+		*/
+		bool load ( Scene& scene ) const;
+
+		static bool save ( const QString& filename, const Scene& scene, bool withChecksums = true, const QList<SceneFileExtraSection>& extraSections = {} );
+		// Whether filename starts with SCENE_FILE_MAGIC
+		static bool isSceneFile ( const QString& filename );
+
+	private:
+		QFile m_file;
+		uchar* m_mappedData = nullptr;
+		// fallback for files that cannot be mapped
+		QByteArray m_fileData;
+		QByteArrayView m_view;
+		SceneFileHeader m_header {};
+		QList<SceneFileSection> m_sections;
+	};
+}
+
+#endif // !__SCENE_FILE_H__
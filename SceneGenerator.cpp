@@ -0,0 +1,639 @@
+/*****************************************************************//**
+ * \file   SceneGenerator.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  seeded synthetic glTF documents and scenes for benchmarks and stress tests
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "SceneGenerator.h"
+#include "GLTFDocument.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+
+namespace jcqt
+{
+	// the random streams, see SyntheticSceneOptions
+	static constexpr quint32 kLayoutStream = 0;
+	static constexpr quint32 kVertexStream = 0x9E3779B9;
+	static constexpr quint32 kAnimationStream = 0x85EBCA6B;
+
+	// bufferView.target values
+	static constexpr qint32 kArrayBuffer = 34962;
+	static constexpr qint32 kElementArrayBuffer = 34963;
+
+	// GLB container, see GLTFLoader::loadGLB()
+	static constexpr quint32 kGLBMagic = 0x46546C67;
+	static constexpr quint32 kGLBVersion = 2;
+	static constexpr quint32 kGLBChunkJSON = 0x4E4F534A;
+	static constexpr quint32 kGLBChunkBIN = 0x004E4942;
+
+	// The glTF nodes in the order they are generated: breadth-first within a tree, so the children of a node are consecutive
+	struct SyntheticLayout
+	{
+		QList<qint32> parents_;
+		QList<qint32> levels_;
+		QList<qint32> firstChild_;
+		QList<qint32> childCount_;
+		QList<qint32> roots_;
+		QList<qint32> meshes_;
+		QList<gpuvec3> translations_;
+		QList<gpuvec4> rotations_;
+		QList<gpuvec3> scales_;
+	};
+
+	static float randomFloat ( QRandomGenerator& rng, float lo, float hi )
+	{
+		return lo + float ( rng.generateDouble () ) * ( hi - lo );
+	}
+
+	static gpuvec4 randomRotation ( QRandomGenerator& rng )
+	{
+		const float x = randomFloat ( rng, -1.0f, 1.0f ), y = randomFloat ( rng, -1.0f, 1.0f );
+		const float z = randomFloat ( rng, -1.0f, 1.0f ), w = randomFloat ( rng, -1.0f, 1.0f );
+		const float len = std::sqrt ( x * x + y * y + z * z + w * w );
+		return ( len > 1e-3f ) ? gpuvec4 ( x / len, y / len, z / len, w / len ) : gpuvec4 ( 0.0f, 0.0f, 0.0f, 1.0f );
+	}
+
+	static SyntheticLayout makeLayout ( const SyntheticSceneOptions& options )
+	{
+		QRandomGenerator rng ( options.seed_ ^ kLayoutStream );
+		const qint32 count = qMax ( options.nodeCount_, 0 );
+		const qint32 minFanOut = qMax ( options.minFanOut_, 0 );
+		const qint32 maxFanOut = qMax ( options.maxFanOut_, minFanOut );
+
+		SyntheticLayout layout;
+		layout.parents_.resize ( count );
+		layout.levels_.resize ( count );
+		layout.firstChild_ = QList<qint32> ( count, -1 );
+		layout.childCount_ = QList<qint32> ( count, 0 );
+
+		auto addRoot = [&layout] ( qint32 node )
+		{
+			layout.parents_ [ node ] = -1;
+			layout.levels_ [ node ] = 0;
+			layout.roots_.append ( node );
+		};
+
+		qint32 next = 0;
+		for ( ; next < qMin ( qMax ( options.rootCount_, 1 ), count ); next++ )
+			addRoot ( next );
+
+		// nodes are expanded in the order they were created, which hands the nodes out breadth-first
+		for ( qint32 head = 0; next < count; )
+		{
+			if ( head == next )
+			{
+				// every node is at maxDepth_ or has its children, start another tree
+				addRoot ( next++ );
+				continue;
+			}
+
+			const qint32 p = head++;
+			if ( layout.levels_ [ p ] >= options.maxDepth_ )
+				continue;
+
+			const qint32 fanOut = minFanOut + qint32 ( rng.bounded ( quint32 ( maxFanOut - minFanOut + 1 ) ) );
+			for ( qint32 c = 0; c < fanOut && next < count; c++, next++ )
+			{
+				if ( c == 0 )
+					layout.firstChild_ [ p ] = next;
+				layout.childCount_ [ p ]++;
+				layout.parents_ [ next ] = p;
+				layout.levels_ [ next ] = layout.levels_ [ p ] + 1;
+			}
+		}
+
+		// per node properties, drawn after the tree so that they do not shift it
+		layout.meshes_.resize ( count );
+		layout.translations_.resize ( count );
+		layout.rotations_.resize ( count );
+		layout.scales_.resize ( count );
+		for ( qint32 i = 0; i < count; i++ )
+		{
+			layout.translations_ [ i ] = gpuvec3 ( randomFloat ( rng, -10.0f, 10.0f ), randomFloat ( rng, -10.0f, 10.0f ), randomFloat ( rng, -10.0f, 10.0f ) );
+			layout.rotations_ [ i ] = randomRotation ( rng );
+			layout.scales_ [ i ] = gpuvec3 ( randomFloat ( rng, options.minScale_, options.maxScale_ ) );
+			const bool hasMesh = options.meshCount_ > 0 && rng.generateDouble () < options.meshNodeFraction_;
+			layout.meshes_ [ i ] = hasMesh ? qint32 ( rng.bounded ( quint32 ( options.meshCount_ ) ) ) : -1;
+		}
+
+		return layout;
+	}
+
+	// shortest text that reads back as the same float
+	static QByteArray number ( float f )
+	{
+		return QByteArray::number ( double ( f ), 'g', 9 );
+	}
+
+	// Buffer 0 and the bufferViews and accessors describing it
+	struct SyntheticBuffer
+	{
+		QByteArray data_;
+		QByteArray bufferViews_;
+		QByteArray accessors_;
+		qint32 bufferViewCount_ = 0;
+		qint32 accessorCount_ = 0;
+
+		// appends size bytes as a new bufferView and returns its index
+		qint32 addView ( const void* bytes, qsizetype size, qint32 target, qint32 byteStride = 0 )
+		{
+			// every bufferView starts 4-byte aligned
+			while ( data_.size () % 4 )
+				data_.append ( '\0' );
+
+			const qsizetype offset = data_.size ();
+			data_.resize ( offset + size );
+			memcpy ( data_.data () + offset, bytes, size );
+
+			if ( bufferViewCount_ > 0 )
+				bufferViews_ += ',';
+			bufferViews_ += "{\"buffer\":0,\"byteOffset\":" + QByteArray::number ( offset ) + ",\"byteLength\":" + QByteArray::number ( size );
+			if ( byteStride > 0 )
+				bufferViews_ += ",\"byteStride\":" + QByteArray::number ( byteStride );
+			if ( target > 0 )
+				bufferViews_ += ",\"target\":" + QByteArray::number ( target );
+			bufferViews_ += '}';
+			return bufferViewCount_++;
+		}
+
+		qint32 addAccessor ( qint32 view, qint32 byteOffset, quint32 componentType, qint32 count, const char* type, const QByteArray& minMax = QByteArray () )
+		{
+			if ( accessorCount_ > 0 )
+				accessors_ += ',';
+			accessors_ += "{\"bufferView\":" + QByteArray::number ( view ) + ",\"byteOffset\":" + QByteArray::number ( byteOffset ) +
+				",\"componentType\":" + QByteArray::number ( componentType ) + ",\"count\":" + QByteArray::number ( count ) + ",\"type\":\"" + type + "\"" + minMax + '}';
+			return accessorCount_++;
+		}
+	};
+
+	// floats in glTF (little endian) byte order
+	static QByteArray floatBytes ( const QList<float>& values )
+	{
+		QByteArray bytes ( values.size () * qsizetype ( sizeof ( float ) ), Qt::Uninitialized );
+		qToLittleEndian<float> ( values.constData (), values.size (), bytes.data () );
+		return bytes;
+	}
+
+	static QByteArray minMaxVec3 ( const float* lo, const float* hi )
+	{
+		return ",\"min\":[" + number ( lo [ 0 ] ) + ',' + number ( lo [ 1 ] ) + ',' + number ( lo [ 2 ] ) + "],\"max\":[" + number ( hi [ 0 ] ) + ',' +
+			number ( hi [ 1 ] ) + ',' + number ( hi [ 2 ] ) + ']';
+	}
+
+	// the mesh JSON of options.meshCount_ meshes with their vertex and index data appended to buffer
+	static QByteArray generateMeshes ( const SyntheticSceneOptions& options, SyntheticBuffer& buffer )
+	{
+		QRandomGenerator rng ( options.seed_ ^ kVertexStream );
+		const qint32 vertexCount = qMax ( options.verticesPerMesh_, 1 );
+		const qint32 indexCount = qMax ( options.indicesPerMesh_, 0 );
+		const bool shortIndices = vertexCount <= 65536;
+
+		QByteArray meshes;
+		for ( qint32 m = 0; m < options.meshCount_; m++ )
+		{
+			// position, normal, uv per vertex
+			QList<float> vertices ( qsizetype ( vertexCount ) * 8 );
+			float lo [ 3 ] = { 1.0f, 1.0f, 1.0f };
+			float hi [ 3 ] = { -1.0f, -1.0f, -1.0f };
+			for ( qint32 v = 0; v < vertexCount; v++ )
+			{
+				float* p = vertices.data () + qsizetype ( v ) * 8;
+				for ( int k = 0; k < 3; k++ )
+				{
+					p [ k ] = randomFloat ( rng, -1.0f, 1.0f );
+					lo [ k ] = qMin ( lo [ k ], p [ k ] );
+					hi [ k ] = qMax ( hi [ k ], p [ k ] );
+				}
+				const gpuvec4 n = randomRotation ( rng );
+				const float len = std::sqrt ( n.x * n.x + n.y * n.y + n.z * n.z );
+				p [ 3 ] = ( len > 1e-3f ) ? n.x / len : 0.0f;
+				p [ 4 ] = ( len > 1e-3f ) ? n.y / len : 1.0f;
+				p [ 5 ] = ( len > 1e-3f ) ? n.z / len : 0.0f;
+				p [ 6 ] = randomFloat ( rng, 0.0f, 1.0f );
+				p [ 7 ] = randomFloat ( rng, 0.0f, 1.0f );
+			}
+
+			qint32 position, normal, uv;
+			if ( options.interleaved_ )
+			{
+				const QByteArray bytes = floatBytes ( vertices );
+				const qint32 view = buffer.addView ( bytes.constData (), bytes.size (), kArrayBuffer, 8 * ( qint32 ) sizeof ( float ) );
+				position = buffer.addAccessor ( view, 0, gltf::kFloat, vertexCount, "VEC3", minMaxVec3 ( lo, hi ) );
+				normal = buffer.addAccessor ( view, 3 * ( qint32 ) sizeof ( float ), gltf::kFloat, vertexCount, "VEC3" );
+				uv = buffer.addAccessor ( view, 6 * ( qint32 ) sizeof ( float ), gltf::kFloat, vertexCount, "VEC2" );
+			}
+			else
+			{
+				// one tightly packed bufferView per attribute
+				QList<float> attribute [ 3 ];
+				const int widths [ 3 ] = { 3, 3, 2 };
+				const int offsets [ 3 ] = { 0, 3, 6 };
+				qint32 views [ 3 ];
+				for ( int a = 0; a < 3; a++ )
+				{
+					attribute [ a ].reserve ( qsizetype ( vertexCount ) * widths [ a ] );
+					for ( qint32 v = 0; v < vertexCount; v++ )
+					{
+						for ( int k = 0; k < widths [ a ]; k++ )
+							attribute [ a ].append ( vertices [ qsizetype ( v ) * 8 + offsets [ a ] + k ] );
+					}
+					const QByteArray bytes = floatBytes ( attribute [ a ] );
+					views [ a ] = buffer.addView ( bytes.constData (), bytes.size (), kArrayBuffer );
+				}
+				position = buffer.addAccessor ( views [ 0 ], 0, gltf::kFloat, vertexCount, "VEC3", minMaxVec3 ( lo, hi ) );
+				normal = buffer.addAccessor ( views [ 1 ], 0, gltf::kFloat, vertexCount, "VEC3" );
+				uv = buffer.addAccessor ( views [ 2 ], 0, gltf::kFloat, vertexCount, "VEC2" );
+			}
+
+			meshes += ( m > 0 ? ",{\"name\":\"mesh_" : "{\"name\":\"mesh_" ) + QByteArray::number ( m ) + "\",\"primitives\":[{\"attributes\":{\"POSITION\":" +
+				QByteArray::number ( position ) + ",\"NORMAL\":" + QByteArray::number ( normal ) + ",\"TEXCOORD_0\":" + QByteArray::number ( uv ) + '}';
+
+			if ( indexCount > 0 )
+			{
+				QByteArray bytes;
+				if ( shortIndices )
+				{
+					QList<quint16> indices ( indexCount );
+					for ( quint16& i : indices )
+						i = quint16 ( rng.bounded ( quint32 ( vertexCount ) ) );
+					bytes.resize ( indices.size () * qsizetype ( sizeof ( quint16 ) ) );
+					qToLittleEndian<quint16> ( indices.constData (), indices.size (), bytes.data () );
+				}
+				else
+				{
+					QList<quint32> indices ( indexCount );
+					for ( quint32& i : indices )
+						i = rng.bounded ( quint32 ( vertexCount ) );
+					bytes.resize ( indices.size () * qsizetype ( sizeof ( quint32 ) ) );
+					qToLittleEndian<quint32> ( indices.constData (), indices.size (), bytes.data () );
+				}
+				const qint32 view = buffer.addView ( bytes.constData (), bytes.size (), kElementArrayBuffer );
+				const qint32 indices = buffer.addAccessor ( view, 0, shortIndices ? gltf::kUnsignedShort : gltf::kUnsignedInt, indexCount, "SCALAR" );
+				meshes += ",\"indices\":" + QByteArray::number ( indices );
+			}
+
+			if ( options.materialCount_ > 0 )
+				meshes += ",\"material\":" + QByteArray::number ( m % options.materialCount_ );
+			meshes += "}]}";
+		}
+		return meshes;
+	}
+
+	// one animation with options.animationChannels_ channels sharing a single time accessor
+	static QByteArray generateAnimation ( const SyntheticSceneOptions& options, qint32 nodeCount, SyntheticBuffer& buffer )
+	{
+		if ( options.animationChannels_ <= 0 || nodeCount <= 0 )
+			return QByteArray ();
+
+		QRandomGenerator rng ( options.seed_ ^ kAnimationStream );
+		const qint32 keyframes = qMax ( options.keyframes_, 2 );
+
+		QList<float> times ( keyframes );
+		for ( qint32 k = 0; k < keyframes; k++ )
+			times [ k ] = float ( k ) / 30.0f;
+		const QByteArray timeBytes = floatBytes ( times );
+		const qint32 timeView = buffer.addView ( timeBytes.constData (), timeBytes.size (), 0 );
+		const qint32 input = buffer.addAccessor ( timeView, 0, gltf::kFloat, keyframes, "SCALAR",
+			",\"min\":[0],\"max\":[" + number ( times.last () ) + ']' );
+
+		static const char* const paths [] = { "translation", "rotation", "scale" };
+		QByteArray channels;
+		QByteArray samplers;
+		for ( qint32 c = 0; c < options.animationChannels_; c++ )
+		{
+			const qint32 path = c % 3;
+			const qint32 width = ( path == 1 ) ? 4 : 3;
+			QList<float> values;
+			values.reserve ( qsizetype ( keyframes ) * width );
+			for ( qint32 k = 0; k < keyframes; k++ )
+			{
+				if ( path == 1 )
+				{
+					const gpuvec4 q = randomRotation ( rng );
+					values << q.x << q.y << q.z << q.w;
+				}
+				else
+				{
+					const float lo = ( path == 0 ) ? -10.0f : 0.5f;
+					const float hi = ( path == 0 ) ? 10.0f : 2.0f;
+					values << randomFloat ( rng, lo, hi ) << randomFloat ( rng, lo, hi ) << randomFloat ( rng, lo, hi );
+				}
+			}
+			const QByteArray bytes = floatBytes ( values );
+			const qint32 view = buffer.addView ( bytes.constData (), bytes.size (), 0 );
+			const qint32 output = buffer.addAccessor ( view, 0, gltf::kFloat, keyframes, path == 1 ? "VEC4" : "VEC3" );
+			const qint32 node = qint32 ( rng.bounded ( quint32 ( nodeCount ) ) );
+
+			if ( c > 0 )
+			{
+				channels += ',';
+				samplers += ',';
+			}
+			channels += "{\"sampler\":" + QByteArray::number ( c ) + ",\"target\":{\"node\":" + QByteArray::number ( node ) + ",\"path\":\"" + paths [ path ] + "\"}}";
+			samplers += "{\"input\":" + QByteArray::number ( input ) + ",\"output\":" + QByteArray::number ( output ) + ",\"interpolation\":\"LINEAR\"}";
+		}
+
+		return "{\"name\":\"synthetic\",\"channels\":[" + channels + "],\"samplers\":[" + samplers + "]}";
+	}
+
+	SyntheticSceneOptions SyntheticSceneOptions::deepRig ( qint32 nodeCount, quint32 seed )
+	{
+		SyntheticSceneOptions options;
+		options.seed_ = seed;
+		options.nodeCount_ = nodeCount;
+		options.maxDepth_ = 255;
+		options.minFanOut_ = 1;
+		options.maxFanOut_ = 1;
+		options.minScale_ = 1.0f;
+		options.maxScale_ = 1.0f;
+		options.meshNodeFraction_ = 0.02;
+		options.meshCount_ = 4;
+		options.animationChannels_ = 3 * qMin ( nodeCount, 128 );
+		options.keyframes_ = 60;
+		return options;
+	}
+
+	SyntheticSceneOptions SyntheticSceneOptions::wideCity ( qint32 nodeCount, quint32 seed )
+	{
+		SyntheticSceneOptions options;
+		options.seed_ = seed;
+		options.nodeCount_ = nodeCount;
+		options.maxDepth_ = 2;
+		options.minFanOut_ = 1000;
+		options.maxFanOut_ = 1000;
+		options.meshCount_ = 32;
+		options.materialCount_ = 16;
+		return options;
+	}
+
+	SyntheticSceneOptions SyntheticSceneOptions::hugeEmbeddedBuffers ( qint32 verticesPerMesh, quint32 seed )
+	{
+		SyntheticSceneOptions options;
+		options.seed_ = seed;
+		options.nodeCount_ = 64;
+		options.maxDepth_ = 2;
+		options.minFanOut_ = 1;
+		options.maxFanOut_ = 8;
+		options.meshCount_ = 16;
+		options.verticesPerMesh_ = verticesPerMesh;
+		options.indicesPerMesh_ = 3 * verticesPerMesh;
+		options.interleaved_ = true;
+		options.storage_ = SyntheticBufferStorage::Embedded;
+		return options;
+	}
+
+	SyntheticGLTF generateSyntheticGLTF ( const SyntheticSceneOptions& options, const QString& binaryUri )
+	{
+		const SyntheticLayout layout = makeLayout ( options );
+		const qint32 nodeCount = ( qint32 ) layout.parents_.size ();
+
+		SyntheticBuffer buffer;
+		const QByteArray meshes = generateMeshes ( options, buffer );
+		const QByteArray animation = generateAnimation ( options, nodeCount, buffer );
+
+		SyntheticGLTF gltf;
+		gltf.binary_ = buffer.data_;
+
+		QByteArray& json = gltf.json_;
+		json.reserve ( qsizetype ( nodeCount ) * 160 + buffer.bufferViews_.size () + buffer.accessors_.size () + meshes.size () + animation.size () +
+			( options.storage_ == SyntheticBufferStorage::Embedded ? buffer.data_.size () * 4 / 3 + 64 : 0 ) );
+
+		json += "{\"asset\":{\"version\":\"2.0\",\"generator\":\"jcqt SceneGenerator\"},\"scene\":0,\"scenes\":[{\"name\":\"SyntheticScene\",\"nodes\":[";
+		for ( qsizetype r = 0; r < layout.roots_.size (); r++ )
+		{
+			if ( r > 0 )
+				json += ',';
+			json += QByteArray::number ( layout.roots_ [ r ] );
+		}
+		json += "]}]";
+
+		if ( nodeCount > 0 )
+		{
+			json += ",\"nodes\":[";
+			for ( qint32 i = 0; i < nodeCount; i++ )
+			{
+				const gpuvec3& t = layout.translations_ [ i ];
+				const gpuvec4& r = layout.rotations_ [ i ];
+				const gpuvec3& s = layout.scales_ [ i ];
+
+				json += ( i > 0 ) ? ",{" : "{";
+				if ( options.names_ )
+					json += "\"name\":\"node_" + QByteArray::number ( i ) + "\",";
+				if ( layout.meshes_ [ i ] >= 0 )
+					json += "\"mesh\":" + QByteArray::number ( layout.meshes_ [ i ] ) + ',';
+				json += "\"translation\":[" + number ( t.x ) + ',' + number ( t.y ) + ',' + number ( t.z ) + "],\"rotation\":[" + number ( r.x ) + ',' +
+					number ( r.y ) + ',' + number ( r.z ) + ',' + number ( r.w ) + "],\"scale\":[" + number ( s.x ) + ',' + number ( s.y ) + ',' + number ( s.z ) + ']';
+
+				if ( layout.childCount_ [ i ] > 0 )
+				{
+					json += ",\"children\":[";
+					for ( qint32 c = 0; c < layout.childCount_ [ i ]; c++ )
+					{
+						if ( c > 0 )
+							json += ',';
+						json += QByteArray::number ( layout.firstChild_ [ i ] + c );
+					}
+					json += ']';
+				}
+				json += '}';
+			}
+			json += ']';
+		}
+
+		if ( !meshes.isEmpty () )
+			json += ",\"meshes\":[" + meshes + ']';
+
+		if ( options.materialCount_ > 0 )
+		{
+			json += ",\"materials\":[";
+			// a stream of their own, so the mesh data does not depend on materialCount_
+			QRandomGenerator rng ( options.seed_ ^ kVertexStream ^ 1 );
+			for ( qint32 m = 0; m < options.materialCount_; m++ )
+			{
+				json += ( m > 0 ) ? ",{" : "{";
+				json += "\"name\":\"material_" + QByteArray::number ( m ) + "\",\"pbrMetallicRoughness\":{\"baseColorFactor\":[" +
+					number ( randomFloat ( rng, 0.0f, 1.0f ) ) + ',' + number ( randomFloat ( rng, 0.0f, 1.0f ) ) + ',' + number ( randomFloat ( rng, 0.0f, 1.0f ) ) +
+					",1],\"metallicFactor\":" + number ( randomFloat ( rng, 0.0f, 1.0f ) ) + ",\"roughnessFactor\":" + number ( randomFloat ( rng, 0.0f, 1.0f ) ) + "}}";
+			}
+			json += ']';
+		}
+
+		if ( !animation.isEmpty () )
+			json += ",\"animations\":[" + animation + ']';
+
+		if ( !buffer.data_.isEmpty () )
+		{
+			json += ",\"accessors\":[" + buffer.accessors_ + "],\"bufferViews\":[" + buffer.bufferViews_ + "],\"buffers\":[{\"byteLength\":" +
+				QByteArray::number ( buffer.data_.size () );
+			if ( options.storage_ == SyntheticBufferStorage::External )
+				json += ",\"uri\":\"" + binaryUri.toUtf8 () + '"';
+			else if ( options.storage_ == SyntheticBufferStorage::Embedded )
+				json += ",\"uri\":\"data:application/octet-stream;base64," + buffer.data_.toBase64 () + '"';
+			json += "}]";
+		}
+
+		json += '}';
+		return gltf;
+	}
+
+	static void appendU32 ( QByteArray& bytes, quint32 value )
+	{
+		const quint32 le = qToLittleEndian ( value );
+		bytes.append ( reinterpret_cast<const char*>( &le ), sizeof ( le ) );
+	}
+
+	QByteArray packGLB ( const QByteArray& json, const QByteArray& binary )
+	{
+		// chunks are 4-byte aligned: the JSON is padded with spaces, the binary with zeros
+		const qsizetype jsonLength = ( json.size () + 3 ) & ~qsizetype ( 3 );
+		const qsizetype binaryLength = ( binary.size () + 3 ) & ~qsizetype ( 3 );
+		const qsizetype total = 12 + 8 + jsonLength + ( binary.isEmpty () ? 0 : 8 + binaryLength );
+
+		QByteArray glb;
+		glb.reserve ( total );
+		appendU32 ( glb, kGLBMagic );
+		appendU32 ( glb, kGLBVersion );
+		appendU32 ( glb, quint32 ( total ) );
+
+		appendU32 ( glb, quint32 ( jsonLength ) );
+		appendU32 ( glb, kGLBChunkJSON );
+		glb += json;
+		glb.append ( jsonLength - json.size (), ' ' );
+
+		if ( !binary.isEmpty () )
+		{
+			appendU32 ( glb, quint32 ( binaryLength ) );
+			appendU32 ( glb, kGLBChunkBIN );
+			glb += binary;
+			glb.append ( binaryLength - binary.size (), '\0' );
+		}
+		return glb;
+	}
+
+	static bool writeFile ( const QString& filename, const QByteArray& bytes )
+	{
+		QFile f ( filename );
+		if ( !f.open ( QIODeviceBase::WriteOnly ) || f.write ( bytes ) != bytes.size () )
+		{
+			qWarning () << "Cannot write " << filename << Qt::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool writeSyntheticGLTF ( const QString& filename, const SyntheticSceneOptions& options )
+	{
+		const QFileInfo info ( filename );
+		const QString binaryName = info.completeBaseName () + QStringLiteral ( ".bin" );
+		const SyntheticGLTF gltf = generateSyntheticGLTF ( options, binaryName );
+
+		if ( options.storage_ == SyntheticBufferStorage::GLB )
+			return writeFile ( filename, packGLB ( gltf.json_, gltf.binary_ ) );
+
+		if ( options.storage_ == SyntheticBufferStorage::External && !gltf.binary_.isEmpty () &&
+			!writeFile ( info.absolutePath () + '/' + binaryName, gltf.binary_ ) )
+			return false;
+
+		return writeFile ( filename, gltf.json_ );
+	}
+
+	void generateSyntheticScene ( Scene& scene, const SyntheticSceneOptions& options )
+	{
+		const SyntheticLayout layout = makeLayout ( options );
+		const qint32 gltfCount = ( qint32 ) layout.parents_.size ();
+
+		// breadth-first as buildScene() orders them: the identity root, the glTF roots, then the children of each node in turn
+		QList<qint32> order { -1 };
+		QList<qint32> parents { -1 };
+		QList<qint32> levels { 0 };
+		order.reserve ( gltfCount + 1 );
+		parents.reserve ( gltfCount + 1 );
+		levels.reserve ( gltfCount + 1 );
+		for ( qint32 r : layout.roots_ )
+		{
+			order.append ( r );
+			parents.append ( 0 );
+			levels.append ( 1 );
+		}
+		for ( qint32 head = 1; head < order.size (); head++ )
+		{
+			const qint32 g = order [ head ];
+			for ( qint32 c = layout.firstChild_ [ g ]; c < layout.firstChild_ [ g ] + layout.childCount_ [ g ]; c++ )
+			{
+				order.append ( c );
+				parents.append ( head );
+				levels.append ( levels [ head ] + 1 );
+			}
+		}
+
+		const qint32 nodeCount = ( qint32 ) order.size ();
+		QList<gpumat4> locals ( nodeCount );
+		locals [ 0 ] = gpumat4 ( QMatrix4x4 () );
+		for ( qint32 i = 1; i < nodeCount; i++ )
+		{
+			const qint32 g = order [ i ];
+			composeTRS ( layout.translations_ [ g ], layout.rotations_ [ g ], layout.scales_ [ g ], locals [ i ] );
+		}
+
+		scene = Scene ();
+		addNodes ( scene, parents, levels, locals );
+		scene.meshes_.resize ( nodeCount );
+		scene.materialForNode_.resize ( nodeCount );
+		scene.nameForNode_.resize ( nodeCount );
+
+		scene.names_.reserve ( options.names_ ? nodeCount : 1 );
+		scene.names_.append ( QStringLiteral ( "SyntheticScene" ) );
+		scene.nameForNode_.insert ( 0, 0 );
+		for ( qint32 m = 0; m < options.materialCount_; m++ )
+			scene.materialNames_.append ( QStringLiteral ( "material_%1" ).arg ( m ) );
+
+		for ( qint32 i = 1; i < nodeCount; i++ )
+		{
+			const qint32 g = order [ i ];
+			const qint32 mesh = layout.meshes_ [ g ];
+			if ( mesh >= 0 )
+			{
+				scene.meshes_.insert ( i, mesh );
+				if ( options.materialCount_ > 0 )
+					scene.materialForNode_.insert ( i, mesh % options.materialCount_ );
+			}
+
+			if ( options.names_ )
+			{
+				scene.nameForNode_.insert ( i, ( qint32 ) scene.names_.size () );
+				scene.names_.append ( QStringLiteral ( "node_%1" ).arg ( g ) );
+			}
+		}
+
+		rebuildNameIndex ( scene );
+		recalculateAllGlobalTransforms ( scene );
+	}
+}
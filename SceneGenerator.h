@@ -0,0 +1,116 @@
+/*****************************************************************//**
+ * \file   SceneGenerator.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  seeded synthetic glTF documents and scenes for benchmarks and stress tests
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __SCENE_GENERATOR_H__
+#define __SCENE_GENERATOR_H__
+
+#include <QByteArray>
+#include <QString>
+
+#include "GLTFScene.h"
+
+namespace jcqt
+{
+	// where the generated buffer goes
+	enum class SyntheticBufferStorage
+	{
+		// a .bin file next to the .gltf
+		External,
+		// a base64 data: URI inside the JSON
+		Embedded,
+		// the BIN chunk of a .glb
+		GLB
+	};
+
+	/*
+	*	Shape of a synthetic scene. The same options and seed always produce the same bytes. The node layout, the vertex data and the
+	*	animation data come from separate random streams, so changing e.g. verticesPerMesh_ keeps the node tree as it was.
+	*/
+	struct SyntheticSceneOptions
+	{
+		quint32 seed_ = 1;
+
+		qint32 nodeCount_ = 1000;
+		qint32 rootCount_ = 1;
+		// deepest level, roots are level 0. May exceed MAX_NODE_LEVEL. Once every node is at this depth or has its children, the
+		// remaining nodes start further trees.
+		qint32 maxDepth_ = 8;
+		// children per node, drawn uniformly from [minFanOut_, maxFanOut_]; nodes are handed out breadth-first
+		qint32 minFanOut_ = 1;
+		qint32 maxFanOut_ = 4;
+		// uniform scale per node, drawn from [minScale_, maxScale_]
+		float minScale_ = 0.5f;
+		float maxScale_ = 2.0f;
+
+		// share of the nodes that get one of the meshes
+		double meshNodeFraction_ = 1.0;
+		qint32 meshCount_ = 16;
+		qint32 verticesPerMesh_ = 24;
+		qint32 indicesPerMesh_ = 36;
+		// POSITION, NORMAL and TEXCOORD_0 share one bufferView with a 32 byte stride per mesh instead of a bufferView each
+		bool interleaved_ = false;
+		qint32 materialCount_ = 8;
+		SyntheticBufferStorage storage_ = SyntheticBufferStorage::External;
+
+		// channels of a single animation, cycling through translation, rotation and scale of random nodes
+		qint32 animationChannels_ = 0;
+		qint32 keyframes_ = 30;
+
+		// "node_<index>" names
+		bool names_ = true;
+
+		// chains far deeper than MAX_NODE_LEVEL, unscaled joints with few meshes, animated
+		static SyntheticSceneOptions deepRig ( qint32 nodeCount, quint32 seed = 1 );
+		// a thousand districts of a thousand buildings each, a few meshes shared by everything
+		static SyntheticSceneOptions wideCity ( qint32 nodeCount, quint32 seed = 1 );
+		// few nodes, interleaved meshes of verticesPerMesh vertices in a data: URI
+		static SyntheticSceneOptions hugeEmbeddedBuffers ( qint32 verticesPerMesh, quint32 seed = 1 );
+	};
+
+	struct SyntheticGLTF
+	{
+		QByteArray json_;
+		// contents of buffer 0: the .bin file or the BIN chunk; with embedded storage it is already inside json_ as well
+		QByteArray binary_;
+	};
+
+	// The glTF JSON and buffer; an external buffer is referenced as binaryUri
+	SyntheticGLTF generateSyntheticGLTF ( const SyntheticSceneOptions& options, const QString& binaryUri = QStringLiteral ( "synthetic.bin" ) );
+	// A GLB container holding json and binary
+	QByteArray packGLB ( const QByteArray& json, const QByteArray& binary );
+	// Writes filename (a .glb for GLB storage) and, for external storage, <complete base name>.bin next to it
+	bool writeSyntheticGLTF ( const QString& filename, const SyntheticSceneOptions& options );
+
+	/*
+	*	Replaces scene with what buildScene() makes of the generated document: the identity root, then the glTF nodes breadth-first, with
+	*	meshes, materials and names. No JSON is written or parsed, so this also scales to sizes where the text would not fit in memory.
+	*/
+	void generateSyntheticScene ( Scene& scene, const SyntheticSceneOptions& options );
+}
+
+#endif // !__SCENE_GENERATOR_H__
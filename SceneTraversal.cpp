@@ -0,0 +1,172 @@
+/*****************************************************************//**
+ * \file   SceneTraversal.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  pre-order traversal index with O(1) subtree queries
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "SceneTraversal.h"
+
+#include <algorithm>
+
+namespace jcqt
+{
+	SceneTraversal::SceneTraversal ( const Scene& scene )
+	{
+		build ( scene );
+	}
+
+	void SceneTraversal::build ( const Scene& scene )
+	{
+		const qint32 nodeCount = ( qint32 ) scene.hierarchy_.size ();
+		const Hierarchy* h = scene.hierarchy_.constData ();
+
+		m_order.clear ();
+		m_order.reserve ( nodeCount );
+		m_position = QList<qint32> ( nodeCount, -1 );
+		m_subtreeSize = QList<qint32> ( nodeCount, 1 );
+
+		// explicit stack, the children are pushed in reverse so the first child comes off first
+		QList<qint32> stack;
+		for ( qint32 root = 0; root < nodeCount; root++ )
+		{
+			if ( h [ root ].parent_ != -1 )
+				continue;
+
+			stack.append ( root );
+			while ( !stack.isEmpty () )
+			{
+				const qint32 node = stack.takeLast ();
+				m_position [ node ] = ( qint32 ) m_order.size ();
+				m_order.append ( node );
+
+				const qsizetype first = stack.size ();
+				for ( qint32 c = h [ node ].firstChild_; c != -1; c = h [ c ].nextSibling_ )
+					stack.append ( c );
+				std::reverse ( stack.begin () + first, stack.end () );
+			}
+		}
+
+		Q_ASSERT ( m_order.size () == nodeCount );
+
+		// in reverse pre-order every node comes after all of its descendants
+		for ( qsizetype i = m_order.size () - 1; i >= 0; i-- )
+		{
+			const qint32 parent = h [ m_order [ i ] ].parent_;
+			if ( parent != -1 )
+				m_subtreeSize [ parent ] += m_subtreeSize [ m_order [ i ] ];
+		}
+	}
+
+	void SceneTraversal::nodeAdded ( const Scene& scene, qint32 node )
+	{
+		Q_ASSERT ( node == m_position.size () && node < scene.hierarchy_.size () );
+
+		// the last child goes right after its parent's current subtree, a new root (the highest index) at the very end
+		const qint32 parent = scene.hierarchy_ [ node ].parent_;
+		const qint32 pos = ( parent == -1 ) ? ( qint32 ) m_order.size () : m_position [ parent ] + m_subtreeSize [ parent ];
+
+		m_order.insert ( pos, node );
+		m_position.append ( pos );
+		m_subtreeSize.append ( 1 );
+
+		for ( qint32 i = pos + 1; i < m_order.size (); i++ )
+			m_position [ m_order [ i ] ] = i;
+
+		for ( qint32 p = parent; p != -1; p = scene.hierarchy_ [ p ].parent_ )
+			m_subtreeSize [ p ]++;
+	}
+
+	bool SceneTraversal::isValid ( const Scene& scene ) const
+	{
+		return m_position.size () == scene.hierarchy_.size ();
+	}
+
+	qsizetype SceneTraversal::size () const
+	{
+		return m_order.size ();
+	}
+
+	std::span<const qint32> SceneTraversal::order () const
+	{
+		return std::span<const qint32> ( m_order.constData (), m_order.size () );
+	}
+
+	qint32 SceneTraversal::position ( qint32 node ) const
+	{
+		return m_position [ node ];
+	}
+
+	qint32 SceneTraversal::subtreeSize ( qint32 node ) const
+	{
+		return m_subtreeSize [ node ];
+	}
+
+	std::span<const qint32> SceneTraversal::subtree ( qint32 node ) const
+	{
+		return std::span<const qint32> ( m_order.constData () + m_position [ node ], m_subtreeSize [ node ] );
+	}
+
+	std::span<const qint32> SceneTraversal::descendants ( qint32 node ) const
+	{
+		return subtree ( node ).subspan ( 1 );
+	}
+
+	bool SceneTraversal::isAncestor ( qint32 a, qint32 b ) const
+	{
+		const qint32 pa = m_position [ a ];
+		const qint32 pb = m_position [ b ];
+		return pa < pb && pb < pa + m_subtreeSize [ a ];
+	}
+
+	QList<qint32> SceneTraversal::breadthFirst ( const Scene& scene, qint32 node ) const
+	{
+		const std::span<const qint32> range = ( node == -1 ) ? order () : subtree ( node );
+		const qint32 baseLevel = ( node == -1 ) ? 0 : scene.hierarchy_ [ node ].level_;
+
+		// within one level pre-order is left-to-right order, which is what a breadth-first walk visits; a counting sort by level keeps it
+		QList<qint32> offsets;
+		for ( qint32 n : range )
+		{
+			const qint32 level = scene.hierarchy_ [ n ].level_ - baseLevel;
+			if ( level >= offsets.size () )
+				offsets.resize ( level + 1, 0 );
+			offsets [ level ]++;
+		}
+
+		qint32 start = 0;
+		for ( qint32& offset : offsets )
+		{
+			const qint32 count = offset;
+			offset = start;
+			start += count;
+		}
+
+		QList<qint32> result ( range.size () );
+		for ( qint32 n : range )
+			result [ offsets [ scene.hierarchy_ [ n ].level_ - baseLevel ]++ ] = n;
+
+		return result;
+	}
+}
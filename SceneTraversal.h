@@ -0,0 +1,87 @@
+/*****************************************************************//**
+ * \file   SceneTraversal.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  pre-order traversal index with O(1) subtree queries
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __SCENE_TRAVERSAL_H__
+#define __SCENE_TRAVERSAL_H__
+
+#include <QList>
+
+#include <span>
+
+#include "GLTFScene.h"
+
+namespace jcqt
+{
+	/*
+	*	Pre-order (depth-first) index over Scene::hierarchy_, the Euler tour of the scene graph flattened to one array. Every subtree is a
+	*	contiguous range of order(): a node followed by all of its descendants. "Is A an ancestor of B" and "subtree size" are O(1), "all
+	*	descendants" is a range, and neither a depth-first nor a breadth-first walk needs recursion or a stack. Roots are visited in index
+	*	order, children in sibling order.
+	*
+	*	build() is O(N). nodeAdded() keeps the index current after addNode() without a rebuild, but it shifts the position of every node after
+	*	the new one, O(N) per call: k additions cost O(kN), so after more than a handful of addNode() calls rebuild instead. Edits that add or
+	*	renumber many nodes (addNodes(), mergeScenes(), deleteSceneNodes(), reorderSceneBreadthFirst()) are followed by build().
+	*/
+	class SceneTraversal
+	{
+	public:
+		SceneTraversal () = default;
+		explicit SceneTraversal ( const Scene& scene );
+
+		void build ( const Scene& scene );
+		// node was just added by addNode(): the last child of its parent, or a new root. O(nodes after it in pre-order + its depth).
+		void nodeAdded ( const Scene& scene, qint32 node );
+		// whether the index covers as many nodes as scene has; it cannot tell about links edited behind its back
+		bool isValid ( const Scene& scene ) const;
+
+		qsizetype size () const;
+
+		// all nodes in pre-order
+		std::span<const qint32> order () const;
+		// index of node in order()
+		qint32 position ( qint32 node ) const;
+		// node and its descendants
+		qint32 subtreeSize ( qint32 node ) const;
+		// node followed by all of its descendants, in pre-order
+		std::span<const qint32> subtree ( qint32 node ) const;
+		// all descendants of node, in pre-order
+		std::span<const qint32> descendants ( qint32 node ) const;
+		// whether a is a proper ancestor of b
+		bool isAncestor ( qint32 a, qint32 b ) const;
+
+		// The subtree of node (every node for -1) in breadth-first order: its pre-order range stably bucketed by the cached level_, O(range)
+		QList<qint32> breadthFirst ( const Scene& scene, qint32 node = -1 ) const;
+
+	private:
+		QList<qint32> m_order;
+		QList<qint32> m_position;
+		QList<qint32> m_subtreeSize;
+	};
+}
+
+#endif // !__SCENE_TRAVERSAL_H__
@@ -0,0 +1,204 @@
+/*****************************************************************//**
+ * \file   Trace.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  scoped trace spans of the load pipeline and scene updates, exported as Chrome trace-event JSON
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "Trace.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace jcqt
+{
+	namespace trace
+	{
+		// Spans of one thread. Only that thread appends; the mutex is contended only while spans() or clear() run.
+		struct ThreadSpans
+		{
+			QMutex mutex_;
+			QList<SpanRecord> spans_;
+			QString name_;
+			qint32 thread_ = 0;
+		};
+
+		/*
+		*	Threads are never unregistered, their thread_local pointer has to stay valid; clear() only empties the lists. The registry itself
+		*	is never destroyed either, workers of the global pool may still finish a span while static objects are torn down at exit.
+		*/
+		struct Registry
+		{
+			QMutex mutex_;
+			std::vector<std::unique_ptr<ThreadSpans>> threads_;
+		};
+
+		static Registry& registry ()
+		{
+			static Registry* r = new Registry;
+			return *r;
+		}
+
+		static std::atomic<qint64> s_origin { 0 };
+
+		namespace detail
+		{
+			std::atomic<bool> g_recording { false };
+
+			qint64 now ()
+			{
+				const auto t = std::chrono::steady_clock::now ().time_since_epoch ();
+				return qint64 ( std::chrono::duration_cast<std::chrono::nanoseconds> ( t ).count () ) - s_origin.load ( std::memory_order_relaxed );
+			}
+
+			void record ( const SpanRecord& span )
+			{
+				static thread_local ThreadSpans* t_spans = nullptr;
+				if ( !t_spans )
+				{
+					Registry& r = registry ();
+					QMutexLocker locker ( &r.mutex_ );
+					r.threads_.push_back ( std::make_unique<ThreadSpans> () );
+					t_spans = r.threads_.back ().get ();
+					t_spans->thread_ = qint32 ( r.threads_.size () ) - 1;
+					t_spans->name_ = QThread::currentThread ()->objectName ();
+					if ( t_spans->name_.isEmpty () )
+						t_spans->name_ = QStringLiteral ( "thread %1" ).arg ( t_spans->thread_ );
+				}
+
+				QMutexLocker locker ( &t_spans->mutex_ );
+				t_spans->spans_.append ( span );
+				t_spans->spans_.last ().thread_ = t_spans->thread_;
+			}
+		}
+
+		void start ()
+		{
+			clear ();
+			// timestamps start near zero, a trace viewer's time axis then reads as "since start()"
+			s_origin = 0;
+			s_origin = detail::now ();
+			detail::g_recording = true;
+		}
+
+		void stop ()
+		{
+			detail::g_recording = false;
+		}
+
+		void clear ()
+		{
+			Registry& r = registry ();
+			QMutexLocker locker ( &r.mutex_ );
+			for ( std::unique_ptr<ThreadSpans>& thread : r.threads_ )
+			{
+				QMutexLocker threadLocker ( &thread->mutex_ );
+				thread->spans_.clear ();
+			}
+		}
+
+		QList<SpanRecord> spans ()
+		{
+			QList<SpanRecord> all;
+			Registry& r = registry ();
+			QMutexLocker locker ( &r.mutex_ );
+			for ( std::unique_ptr<ThreadSpans>& thread : r.threads_ )
+			{
+				QMutexLocker threadLocker ( &thread->mutex_ );
+				all.append ( thread->spans_ );
+			}
+			return all;
+		}
+
+		// microseconds with nanosecond precision, the unit of "ts" and "dur"
+		static QByteArray microseconds ( qint64 ns )
+		{
+			return QByteArray::number ( double ( ns ) / 1000.0, 'f', 3 );
+		}
+
+		QByteArray chromeTraceJson ()
+		{
+			QByteArray json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+			bool first = true;
+			auto separate = [&json, &first] ()
+			{
+				if ( !first )
+					json += ",\n";
+				first = false;
+			};
+
+			Registry& r = registry ();
+			QMutexLocker locker ( &r.mutex_ );
+			for ( std::unique_ptr<ThreadSpans>& thread : r.threads_ )
+			{
+				QMutexLocker threadLocker ( &thread->mutex_ );
+				if ( thread->spans_.isEmpty () )
+					continue;
+
+				const QByteArray tid = QByteArray::number ( thread->thread_ );
+				separate ();
+				json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":\"" +
+					thread->name_.toUtf8 ().replace ( '\\', "\\\\" ).replace ( '"', "\\\"" ) + "\"}}";
+
+				for ( const SpanRecord& span : thread->spans_ )
+				{
+					separate ();
+					json += "{\"name\":\"" + QByteArray ( span.name_ ) + "\",\"cat\":\"jcqt\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid +
+						",\"ts\":" + microseconds ( span.start_ ) + ",\"dur\":" + microseconds ( span.duration_ ) + ",\"args\":{";
+
+					QByteArray args;
+					if ( span.index_ >= 0 )
+						args += "\"index\":" + QByteArray::number ( span.index_ );
+					if ( span.bytes_ >= 0 )
+						args += ( args.isEmpty () ? "" : "," ) + QByteArray ( "\"bytes\":" ) + QByteArray::number ( span.bytes_ );
+					if ( span.items_ >= 0 )
+						args += ( args.isEmpty () ? "" : "," ) + QByteArray ( "\"items\":" ) + QByteArray::number ( span.items_ );
+					json += args + "}}";
+				}
+			}
+
+			json += "]}\n";
+			return json;
+		}
+
+		bool writeChromeTrace ( const QString& filename )
+		{
+			QFile f ( filename );
+			const QByteArray json = chromeTraceJson ();
+			if ( !f.open ( QIODeviceBase::WriteOnly ) || f.write ( json ) != json.size () )
+			{
+				qWarning () << "Cannot write trace " << filename << Qt::endl;
+				return false;
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,140 @@
+/*****************************************************************//**
+ * \file   Trace.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  scoped trace spans of the load pipeline and scene updates, exported as Chrome trace-event JSON
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include <atomic>
+
+/*
+*	Trace spans are compiled in only with JCQT_TRACE defined (CONFIG += jcqt_trace for qmake). Without it the JCQT_TRACE_* macros expand to
+*	nothing and their arguments are not evaluated. With it a span costs one relaxed atomic load until start() is called, and two clock
+*	reads plus an append to the calling thread's own list while recording.
+*
+*		JCQT_TRACE_SPAN ( span, "parseDocument" );
+*		...
+*		JCQT_TRACE_COUNTS ( span, json.size (), doc.nodes_.size () );
+*
+*	Span names must be string literals (or otherwise outlive the trace), only the pointer is stored.
+*/
+#if defined(JCQT_TRACE)
+#define JCQT_TRACE_SPAN(var, name) jcqt::trace::Span var ( name )
+#define JCQT_TRACE_SPAN_INDEX(var, name, index) jcqt::trace::Span var ( name, index )
+#define JCQT_TRACE_COUNTS(var, bytes, items) var.setCounts ( bytes, items )
+#else
+#define JCQT_TRACE_SPAN(var, name)
+#define JCQT_TRACE_SPAN_INDEX(var, name, index)
+#define JCQT_TRACE_COUNTS(var, bytes, items)
+#endif
+
+namespace jcqt
+{
+	namespace trace
+	{
+		// A finished span. Times are nanoseconds since start(), bytes_, items_ and index_ are -1 where they do not apply.
+		struct SpanRecord
+		{
+			const char* name_ = nullptr;
+			qint64 start_ = 0;
+			qint64 duration_ = 0;
+			qint64 bytes_ = -1;
+			qint64 items_ = -1;
+			// buffer, image, accessor or level the span worked on
+			qint32 index_ = -1;
+			// order in which the threads recorded their first span
+			qint32 thread_ = 0;
+		};
+
+		namespace detail
+		{
+			extern std::atomic<bool> g_recording;
+			qint64 now ();
+			void record ( const SpanRecord& span );
+		}
+
+		inline bool isRecording ()
+		{
+			return detail::g_recording.load ( std::memory_order_relaxed );
+		}
+
+		// Discards the spans recorded so far and starts recording
+		void start ();
+		// Stops recording. Spans that are open at this point still end up in the trace.
+		void stop ();
+		void clear ();
+
+		// Every recorded span, grouped by thread in the order each thread finished them
+		QList<SpanRecord> spans ();
+		// Trace-event JSON of the recorded spans ("X" events, one tid per thread), opens in chrome://tracing and ui.perfetto.dev
+		QByteArray chromeTraceJson ();
+		bool writeChromeTrace ( const QString& filename );
+
+		// Records the time from construction to destruction if recording was on at construction
+		class Span
+		{
+		public:
+			explicit Span ( const char* name, qint32 index = -1 )
+			{
+				if ( isRecording () )
+				{
+					m_record.name_ = name;
+					m_record.index_ = index;
+					m_record.start_ = detail::now ();
+				}
+			}
+
+			~Span ()
+			{
+				if ( m_record.name_ )
+				{
+					m_record.duration_ = detail::now () - m_record.start_;
+					detail::record ( m_record );
+				}
+			}
+
+			Span ( const Span& ) = delete;
+			Span& operator= ( const Span& ) = delete;
+
+			void setCounts ( qint64 bytes, qint64 items )
+			{
+				m_record.bytes_ = bytes;
+				m_record.items_ = items;
+			}
+
+		private:
+			SpanRecord m_record;
+		};
+	}
+}
+
+#endif // !__TRACE_H__
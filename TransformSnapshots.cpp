@@ -0,0 +1,137 @@
+/*****************************************************************//**
+ * \file   TransformSnapshots.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  triple-buffered global transforms handed from an update thread to a render thread
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "TransformSnapshots.h"
+
+namespace jcqt
+{
+	void TransformSnapshots::markChanged ( const Scene& scene )
+	{
+		const quint64 next = m_frame + 1;
+		const qsizetype pageCount = ( scene.hierarchy_.size () + PAGE_SIZE - 1 ) / PAGE_SIZE;
+		if ( m_pageFrame.size () < pageCount )
+			m_pageFrame.resize ( pageCount, next );
+
+		quint64* pageFrame = m_pageFrame.data ();
+		for ( const QList<qint32>& changed : scene.changedAtThisFrame_ )
+		{
+			for ( qint32 node : changed )
+				pageFrame [ node / PAGE_SIZE ] = next;
+		}
+	}
+
+	void TransformSnapshots::markChanged ( qint32 node )
+	{
+		const qsizetype page = node / PAGE_SIZE;
+		if ( page >= m_pageFrame.size () )
+			m_pageFrame.resize ( page + 1, m_frame + 1 );
+		m_pageFrame [ page ] = m_frame + 1;
+	}
+
+	void TransformSnapshots::markAllChanged ()
+	{
+		m_allChanged = true;
+	}
+
+	quint64 TransformSnapshots::publish ( const Scene& scene )
+	{
+		const quint64 frame = m_frame + 1;
+		const qsizetype nodeCount = scene.globalTransforms_.size ();
+		const qsizetype pageCount = ( nodeCount + PAGE_SIZE - 1 ) / PAGE_SIZE;
+
+		// pages no buffer has seen yet count as changed
+		if ( m_pageFrame.size () < pageCount )
+			m_pageFrame.resize ( pageCount, frame );
+		if ( m_allChanged )
+		{
+			m_pageFrame.fill ( frame );
+			m_allChanged = false;
+		}
+
+		Buffer& back = m_buffers [ m_back ];
+		const quint64 held = back.frame_;
+		// if the scene was resized, the buffer is copied from the page holding the old end on, whatever the page frames say
+		const qsizetype grownFrom = ( back.transforms_.size () == nodeCount ) ? pageCount : qMin ( back.transforms_.size (), nodeCount ) / PAGE_SIZE;
+		back.transforms_.resize ( nodeCount );
+
+		const quint64* pageFrame = m_pageFrame.constData ();
+		auto stale = [=] ( qsizetype page ) { return page >= grownFrom || pageFrame [ page ] > held; };
+
+		// runs of stale pages are copied with one memcpy each
+		const gpumat4* src = scene.globalTransforms_.constData ();
+		gpumat4* dst = back.transforms_.data ();
+		for ( qsizetype page = 0; page < pageCount; )
+		{
+			if ( !stale ( page ) )
+			{
+				page++;
+				continue;
+			}
+
+			qsizetype end = page + 1;
+			while ( end < pageCount && stale ( end ) )
+				end++;
+
+			const qsizetype begin = page * PAGE_SIZE;
+			const qsizetype stop = qMin ( end * PAGE_SIZE, nodeCount );
+			memcpy ( dst + begin, src + begin, ( stop - begin ) * sizeof ( gpumat4 ) );
+			page = end;
+		}
+
+		back.frame_ = frame;
+		m_frame = frame;
+
+		// the release half publishes the copies above, the acquire half makes the buffer we get back safe to overwrite
+		m_back = qint32 ( m_middle.exchange ( quint32 ( m_back ) | FRESH, std::memory_order_acq_rel ) & INDEX_MASK );
+		return frame;
+	}
+
+	quint64 TransformSnapshots::update ( Scene& scene, bool parallel )
+	{
+		markChanged ( scene );
+		if ( parallel )
+			recalculateGlobalTransformsParallel ( scene );
+		else
+			recalculateGlobalTransforms ( scene );
+		return publish ( scene );
+	}
+
+	TransformSnapshot TransformSnapshots::acquire ()
+	{
+		// the writer may publish again between the check and the exchange, the exchange then simply takes the newer frame
+		if ( m_middle.load ( std::memory_order_relaxed ) & FRESH )
+			m_front = qint32 ( m_middle.exchange ( quint32 ( m_front ), std::memory_order_acq_rel ) & INDEX_MASK );
+
+		const Buffer& front = m_buffers [ m_front ];
+		return TransformSnapshot {
+			.transforms_ = front.transforms_.constData (),
+			.count_ = front.transforms_.size (),
+			.frame_ = front.frame_
+		};
+	}
+}
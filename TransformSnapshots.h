@@ -0,0 +1,110 @@
+/*****************************************************************//**
+ * \file   TransformSnapshots.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  triple-buffered global transforms handed from an update thread to a render thread
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __TRANSFORM_SNAPSHOTS_H__
+#define __TRANSFORM_SNAPSHOTS_H__
+
+#include <QList>
+
+#include <atomic>
+
+#include "GLTFScene.h"
+
+namespace jcqt
+{
+	// One published frame of global transforms, see TransformSnapshots::acquire()
+	struct TransformSnapshot
+	{
+		const gpumat4* transforms_;
+		qsizetype count_;
+		// 0 until the first publish()
+		quint64 frame_;
+	};
+
+	/*
+	*	Triple-buffered copies of Scene::globalTransforms_ for one updating thread and one reading (render) thread. The writer fills frame
+	*	N+1 in its back buffer while the reader holds frame N. publish() and acquire() hand buffers over with one atomic exchange each, so
+	*	neither side waits or locks. Because of the third buffer the writer never stalls on a slow reader: frames the reader skipped are
+	*	simply overwritten.
+	*
+	*	A buffer is brought up to date by copying only the pages (PAGE_SIZE matrices) that changed since the frame it last held. The writer
+	*	reports changes with markChanged() before recalculateGlobalTransforms() empties the change queue, or lets update() do all three steps.
+	*	Edits that move nodes around (mergeScenes(), deleteSceneNodes(), reorderSceneBreadthFirst()) need markAllChanged(), while nodes
+	*	appended since the last publish() are picked up on their own.
+	*/
+	class TransformSnapshots
+	{
+	public:
+		// matrices per page, 16 KiB
+		static constexpr qint32 PAGE_SIZE = 256;
+
+		TransformSnapshots () = default;
+		TransformSnapshots ( const TransformSnapshots& ) = delete;
+		TransformSnapshots& operator=( const TransformSnapshots& ) = delete;
+
+		/* writer thread */
+		// the pages of every node queued in scene.changedAtThisFrame_
+		void markChanged ( const Scene& scene );
+		void markChanged ( qint32 node );
+		void markAllChanged ();
+		// copies the stale pages of scene.globalTransforms_ into the back buffer and publishes it, returns the new frame number
+		quint64 publish ( const Scene& scene );
+		// markChanged(), recalculateGlobalTransforms() (or its parallel version) and publish() in one go
+		quint64 update ( Scene& scene, bool parallel = false );
+
+		/* reader thread */
+		// the latest published frame, which the writer leaves alone until the next acquire()
+		TransformSnapshot acquire ();
+
+	private:
+		static constexpr quint32 INDEX_MASK = 3;
+		static constexpr quint32 FRESH = 4;
+
+		struct Buffer
+		{
+			QList<gpumat4> transforms_;
+			quint64 frame_ = 0;
+		};
+
+		Buffer m_buffers [ 3 ];
+		// index of the buffer between writer and reader, with FRESH set from publish() until the reader takes it
+		std::atomic<quint32> m_middle { 1 };
+		// owned by the writer
+		qint32 m_back = 2;
+		// owned by the reader
+		qint32 m_front = 0;
+
+		/* writer state */
+		quint64 m_frame = 0;
+		// frame in which each page last changed, a buffer holding an older frame needs a fresh copy of it
+		QList<quint64> m_pageFrame;
+		bool m_allChanged = false;
+	};
+}
+
+#endif // !__TRANSFORM_SNAPSHOTS_H__
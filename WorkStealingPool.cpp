@@ -0,0 +1,240 @@
+/*****************************************************************//**
+ * \file   WorkStealingPool.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  thread pool with one task deque per worker and stealing between them
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "WorkStealingPool.h"
+
+#include <QMutexLocker>
+
+namespace jcqt
+{
+	// pool and deque index of the worker running on this thread, -1 on every other thread
+	static thread_local const WorkStealingPool* t_pool = nullptr;
+	static thread_local int t_workerIndex = -1;
+
+	WorkStealingPool::WorkStealingPool ( int threadCount )
+	{
+		threadCount = qMax ( threadCount, 1 );
+		m_workers.reserve ( threadCount );
+		for ( int i = 0; i < threadCount; i++ )
+		{
+			m_workers.push_back ( std::make_unique<Worker> () );
+		}
+
+		// start the threads only once every deque exists, workers steal from each other right away
+		for ( int i = 0; i < threadCount; i++ )
+		{
+			m_workers [ i ]->thread_ = QThread::create ( [this, i] () { workerLoop ( i ); } );
+			m_workers [ i ]->thread_->setObjectName ( QStringLiteral ( "WorkStealingPool %1" ).arg ( i ) );
+			m_workers [ i ]->thread_->start ();
+		}
+	}
+
+	WorkStealingPool::~WorkStealingPool ()
+	{
+		waitForDone ();
+
+		{
+			QMutexLocker locker ( &m_sleepMutex );
+			m_stop = true;
+			m_wake.wakeAll ();
+		}
+
+		for ( std::unique_ptr<Worker>& worker : m_workers )
+		{
+			worker->thread_->wait ();
+			delete worker->thread_;
+		}
+	}
+
+	int WorkStealingPool::threadCount () const
+	{
+		return int ( m_workers.size () );
+	}
+
+	void WorkStealingPool::submit ( Task task )
+	{
+		const int count = int ( m_workers.size () );
+		const int index = t_pool == this ? t_workerIndex : int ( m_nextQueue.fetch_add ( 1, std::memory_order_relaxed ) % quint32 ( count ) );
+
+		m_pending.fetch_add ( 1 );
+		{
+			QMutexLocker locker ( &m_workers [ index ]->mutex_ );
+			m_workers [ index ]->tasks_.push_back ( std::move ( task ) );
+		}
+		m_queued.fetch_add ( 1 );
+
+		// a worker checks m_queued under m_sleepMutex before it sleeps, taking the mutex here makes sure the wake-up cannot get lost
+		QMutexLocker locker ( &m_sleepMutex );
+		m_wake.wakeOne ();
+	}
+
+	bool WorkStealingPool::findTask ( int index, Task& task )
+	{
+		if ( m_queued.load () == 0 )
+			return false;
+
+		const int count = int ( m_workers.size () );
+
+		// own deque first (newest task), then steal the oldest task of the others
+		if ( index >= 0 )
+		{
+			Worker& own = *m_workers [ index ];
+			QMutexLocker locker ( &own.mutex_ );
+			if ( !own.tasks_.empty () )
+			{
+				task = std::move ( own.tasks_.back () );
+				own.tasks_.pop_back ();
+				m_queued.fetch_sub ( 1 );
+				return true;
+			}
+		}
+
+		const int start = index >= 0 ? index + 1 : int ( m_nextQueue.load ( std::memory_order_relaxed ) % quint32 ( count ) );
+		for ( int i = 0; i < count; i++ )
+		{
+			const int victim = ( start + i ) % count;
+			if ( victim == index )
+				continue;
+
+			Worker& other = *m_workers [ victim ];
+			QMutexLocker locker ( &other.mutex_ );
+			if ( !other.tasks_.empty () )
+			{
+				task = std::move ( other.tasks_.front () );
+				other.tasks_.pop_front ();
+				m_queued.fetch_sub ( 1 );
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void WorkStealingPool::runTask ( Task& task )
+	{
+		task ();
+		task = nullptr;
+		m_pending.fetch_sub ( 1 );
+
+		// only take the mutex when somebody is waiting for a task to finish
+		if ( m_waiters.load () > 0 )
+		{
+			QMutexLocker locker ( &m_sleepMutex );
+			m_finished.wakeAll ();
+		}
+	}
+
+	void WorkStealingPool::workerLoop ( int index )
+	{
+		t_pool = this;
+		t_workerIndex = index;
+
+		Task task;
+		for ( ;; )
+		{
+			if ( findTask ( index, task ) )
+			{
+				runTask ( task );
+				continue;
+			}
+
+			QMutexLocker locker ( &m_sleepMutex );
+			if ( m_stop )
+				break;
+			if ( m_queued.load () == 0 )
+				m_wake.wait ( &m_sleepMutex );
+		}
+	}
+
+	void WorkStealingPool::waitForDone ()
+	{
+		waitUntil ( [this] () { return m_pending.load () == 0; } );
+	}
+
+	void WorkStealingPool::waitUntil ( const std::function<bool ()>& done )
+	{
+		const int index = t_pool == this ? t_workerIndex : -1;
+
+		Task task;
+		for ( ;; )
+		{
+			if ( done () )
+				return;
+
+			if ( findTask ( index, task ) )
+			{
+				runTask ( task );
+				continue;
+			}
+
+			// nothing to help with, sleep until some task finishes or new work shows up
+			QMutexLocker locker ( &m_sleepMutex );
+			m_waiters.fetch_add ( 1 );
+			if ( !done () && m_queued.load () == 0 )
+				m_finished.wait ( &m_sleepMutex );
+			m_waiters.fetch_sub ( 1 );
+		}
+	}
+
+	void WorkStealingPool::parallelFor ( qsizetype count, qsizetype minChunk, const std::function<void ( qsizetype begin, qsizetype end )>& body )
+	{
+		if ( count <= 0 )
+			return;
+
+		const qsizetype maxChunks = ( count + qMax ( minChunk, qsizetype ( 1 ) ) - 1 ) / qMax ( minChunk, qsizetype ( 1 ) );
+		const qsizetype chunks = qMin ( maxChunks, qsizetype ( threadCount () ) * 4 );
+		if ( chunks <= 1 )
+		{
+			body ( 0, count );
+			return;
+		}
+
+		// body and remaining live on this stack frame, which is safe because we do not return before every range has run
+		std::atomic<qsizetype> remaining { chunks - 1 };
+		const qsizetype chunkSize = count / chunks;
+		const qsizetype extra = count % chunks;
+		auto rangeBegin = [chunkSize, extra] ( qsizetype chunk ) { return chunk * chunkSize + qMin ( chunk, extra ); };
+
+		for ( qsizetype c = 1; c < chunks; c++ )
+		{
+			submit ( [&body, &remaining, begin = rangeBegin ( c ), end = rangeBegin ( c + 1 )] () {
+				body ( begin, end );
+				remaining.fetch_sub ( 1 );
+			} );
+		}
+
+		body ( 0, rangeBegin ( 1 ) );
+		waitUntil ( [&remaining] () { return remaining.load () == 0; } );
+	}
+
+	WorkStealingPool& WorkStealingPool::globalInstance ()
+	{
+		static WorkStealingPool pool;
+		return pool;
+	}
+}
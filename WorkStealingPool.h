@@ -0,0 +1,109 @@
+/*****************************************************************//**
+ * \file   WorkStealingPool.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  thread pool with one task deque per worker and stealing between them
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __WORK_STEALING_POOL_H__
+#define __WORK_STEALING_POOL_H__
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace jcqt
+{
+	/*
+	*	Every worker owns a deque of tasks. Tasks submitted from a worker go to the back of its own deque and are taken back LIFO, which keeps
+	*	follow-up work (e.g. decoding an image once its buffer is read) on the same thread. Idle workers steal from the front of the other
+	*	deques. Tasks submitted from outside the pool are spread round-robin. Threads waiting on the pool run queued tasks instead of blocking,
+	*	so waiting from inside a task cannot deadlock.
+	*/
+	class WorkStealingPool
+	{
+	public:
+		using Task = std::function<void ()>;
+
+		explicit WorkStealingPool ( int threadCount = QThread::idealThreadCount () );
+		// Finishes every queued task before the workers are stopped
+		~WorkStealingPool ();
+
+		WorkStealingPool ( const WorkStealingPool& ) = delete;
+		WorkStealingPool& operator= ( const WorkStealingPool& ) = delete;
+
+		int threadCount () const;
+
+		void submit ( Task task );
+
+		// Runs queued tasks on the calling thread until every submitted task has finished
+		void waitForDone ();
+		// Runs queued tasks on the calling thread until done() returns true. done() is re-checked whenever a task finishes.
+		void waitUntil ( const std::function<bool ()>& done );
+
+		/*
+		*	Splits [0, count) into contiguous ranges of at least minChunk items (about four per thread) and calls body(begin, end) for each
+		*	of them. The calling thread runs the first range itself and helps with the rest; returns once all of them are done.
+		*/
+		void parallelFor ( qsizetype count, qsizetype minChunk, const std::function<void ( qsizetype begin, qsizetype end )>& body );
+
+		// Shared pool sized to QThread::idealThreadCount()
+		static WorkStealingPool& globalInstance ();
+
+	private:
+		struct Worker
+		{
+			QMutex mutex_;
+			std::deque<Task> tasks_;
+			QThread* thread_ = nullptr;
+		};
+
+		void workerLoop ( int index );
+		bool findTask ( int index, Task& task );
+		void runTask ( Task& task );
+
+		std::vector<std::unique_ptr<Worker>> m_workers;
+
+		// m_sleepMutex guards the sleeping workers (m_wake) and the threads inside waitUntil (m_finished)
+		QMutex m_sleepMutex;
+		QWaitCondition m_wake;
+		QWaitCondition m_finished;
+
+		// tasks sitting in the deques, tasks submitted but not finished yet and threads blocked in waitUntil
+		std::atomic<qint64> m_queued { 0 };
+		std::atomic<qint64> m_pending { 0 };
+		std::atomic<int> m_waiters { 0 };
+		std::atomic<quint32> m_nextQueue { 0 };
+		std::atomic<bool> m_stop { false };
+	};
+}
+
+#endif // !__WORK_STEALING_POOL_H__
@@ -7,7 +7,43 @@
 message("You are running qmake on a generated .pro file. This may not work!")
 
 
-HEADERS += ./GLTFLoader.h 
+HEADERS += ./GLTFLoader.h \
+    ./GLTFDocument.h \
+    ./JsonSaxParser.h \
+    ./Base64.h \
+    ./simd.h \
+    ./AccessorView.h \
+    ./AccessorConvert.h \
+    ./WorkStealingPool.h \
+    ./vec4.h \
+    ./GLTFScene.h \
+    ./GLTFSceneBuilder.h \
+    ./Hash.h \
+    ./SceneFile.h \
+    ./ComponentArray.h \
+    ./SceneTraversal.h \
+    ./TransformSnapshots.h \
+    ./SceneGenerator.h \
+    ./Trace.h \
+    ./AssetCache.h \
+    ./ReferenceImplementations.h
 SOURCES += ./GLTFLoader.cpp \
-    ./GLTFLoaderTest.cpp
+    ./GLTFDocument.cpp \
+    ./JsonSaxParser.cpp \
+    ./Base64.cpp \
+    ./AccessorConvert.cpp \
+    ./WorkStealingPool.cpp \
+    ./GLTFScene.cpp \
+    ./GLTFSceneBuilder.cpp \
+    ./vec4.cpp \
+    ./Hash.cpp \
+    ./SceneFile.cpp \
+    ./SceneTraversal.cpp \
+    ./TransformSnapshots.cpp \
+    ./SceneGenerator.cpp \
+    ./Trace.cpp \
+    ./AssetCache.cpp
 RESOURCES += jcqtGLTFLoader.qrc
+
+# CONFIG += jcqt_trace compiles the trace spans of Trace.h in
+jcqt_trace: DEFINES += JCQT_TRACE
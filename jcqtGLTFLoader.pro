@@ -5,7 +5,7 @@
 TEMPLATE = app
 TARGET = jcqtGLTFLoader
 DESTDIR = ./x64/Debug
-QT += core testlib
+QT += core gui testlib
 CONFIG += debug
 LIBS += -L"."
 DEPENDPATH += .
@@ -14,3 +14,4 @@ OBJECTS_DIR += debug
 UI_DIR += .
 RCC_DIR += .
 include(jcqtGLTFLoader.pri)
+SOURCES += ./GLTFLoaderTest.cpp
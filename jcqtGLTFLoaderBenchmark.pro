@@ -0,0 +1,19 @@
+# ----------------------------------------------------
+# Scene benchmark suite (SceneBenchmark.cpp), built from the same
+# sources as jcqtGLTFLoader. Release build, benchmarks of a debug
+# build say little.
+# ------------------------------------------------------
+
+TEMPLATE = app
+TARGET = jcqtGLTFLoaderBenchmark
+DESTDIR = ./x64/Release
+QT += core gui testlib
+CONFIG += release console
+LIBS += -L"."
+DEPENDPATH += .
+MOC_DIR += .
+OBJECTS_DIR += benchmark
+UI_DIR += .
+RCC_DIR += .
+include(jcqtGLTFLoader.pri)
+SOURCES += ./SceneBenchmark.cpp
@@ -0,0 +1,116 @@
+/*****************************************************************//**
+ * \file   simd.h
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  helpers for x86 SIMD code paths selected at runtime
+ *
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include <QtGlobal>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define JCQT_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+// SSE is part of the baseline on x86-64, 32-bit builds only have it when the compiler was told so
+#if defined(__SSE__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 1 )
+#define JCQT_SIMD_SSE 1
+#endif
+#endif
+
+/*
+*	GCC and Clang only allow intrinsics of instruction sets enabled for the function being compiled, so the SIMD kernels are tagged with
+*	a target attribute instead of building the whole project with -mavx2. MSVC accepts all intrinsics unconditionally.
+*/
+#if defined(JCQT_SIMD_X86) && ( defined(__GNUC__) || defined(__clang__) )
+#define JCQT_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define JCQT_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define JCQT_TARGET_AVX __attribute__((target("avx")))
+#define JCQT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define JCQT_TARGET_SSSE3
+#define JCQT_TARGET_SSE41
+#define JCQT_TARGET_AVX
+#define JCQT_TARGET_AVX2
+#endif
+
+namespace jcqt
+{
+	namespace simd
+	{
+		struct CpuFeatures
+		{
+			bool ssse3_ = false;
+			bool sse41_ = false;
+			bool avx_ = false;
+			bool avx2_ = false;
+		};
+
+		inline CpuFeatures detectCpuFeatures ()
+		{
+			CpuFeatures f;
+#if defined(JCQT_SIMD_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+			int info [ 4 ] = {};
+			__cpuid ( info, 0 );
+			const int maxLeaf = info [ 0 ];
+
+			__cpuid ( info, 1 );
+			f.ssse3_ = ( info [ 2 ] & ( 1 << 9 ) ) != 0;
+			f.sse41_ = ( info [ 2 ] & ( 1 << 19 ) ) != 0;
+
+			// AVX and AVX2 also need the OS to save the YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+			const bool osxsave = ( info [ 2 ] & ( 1 << 27 ) ) != 0;
+			const bool ymm = osxsave && ( _xgetbv ( 0 ) & 6 ) == 6;
+			f.avx_ = ymm && ( info [ 2 ] & ( 1 << 28 ) ) != 0;
+			if ( maxLeaf >= 7 && ymm )
+			{
+				__cpuidex ( info, 7, 0 );
+				f.avx2_ = ( info [ 1 ] & ( 1 << 5 ) ) != 0;
+			}
+#else
+			__builtin_cpu_init ();
+			f.ssse3_ = __builtin_cpu_supports ( "ssse3" );
+			f.sse41_ = __builtin_cpu_supports ( "sse4.1" );
+			f.avx_ = __builtin_cpu_supports ( "avx" );
+			f.avx2_ = __builtin_cpu_supports ( "avx2" );
+#endif
+#endif
+			return f;
+		}
+
+		// detected once, the first time any SIMD dispatcher asks
+		inline const CpuFeatures& cpuFeatures ()
+		{
+			static const CpuFeatures features = detectCpuFeatures ();
+			return features;
+		}
+	}
+}
+
+#endif // !__SIMD_H__
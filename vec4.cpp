@@ -0,0 +1,255 @@
+/*****************************************************************//**
+ * \file   vec4.cpp
+ * \licence MIT License
+
+Copyright (c) 2022 Joseph Cunningham
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ * \brief  batched gpumat4 kernels
+ * 
+ * \author joechamm
+ * \date   September 2022
+ *********************************************************************/
+#include "vec4.h"
+
+#include <cmath>
+
+namespace jcqt
+{
+#if defined(JCQT_SIMD_X86)
+	// both 128-bit lanes hold column k of a
+	JCQT_TARGET_AVX static inline __m256 loadColumnTwiceAVX ( const float* column )
+	{
+		const __m128 c = _mm_loadu_ps ( column );
+		return _mm256_insertf128_ps ( _mm256_castps128_ps256 ( c ), c, 1 );
+	}
+
+	// two result columns per 256-bit register, all of b is loaded before out is written
+	JCQT_TARGET_AVX static inline void multiplyAVX ( const float* a, const float* b, float* out )
+	{
+		const __m256 a0 = loadColumnTwiceAVX ( a );
+		const __m256 a1 = loadColumnTwiceAVX ( a + 4 );
+		const __m256 a2 = loadColumnTwiceAVX ( a + 8 );
+		const __m256 a3 = loadColumnTwiceAVX ( a + 12 );
+		const __m256 b01 = _mm256_loadu_ps ( b );
+		const __m256 b23 = _mm256_loadu_ps ( b + 8 );
+
+		__m256 r01 = _mm256_mul_ps ( a0, _mm256_permute_ps ( b01, 0x00 ) );
+		__m256 r23 = _mm256_mul_ps ( a0, _mm256_permute_ps ( b23, 0x00 ) );
+		r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( a1, _mm256_permute_ps ( b01, 0x55 ) ) );
+		r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( a1, _mm256_permute_ps ( b23, 0x55 ) ) );
+		r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( a2, _mm256_permute_ps ( b01, 0xAA ) ) );
+		r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( a2, _mm256_permute_ps ( b23, 0xAA ) ) );
+		r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( a3, _mm256_permute_ps ( b01, 0xFF ) ) );
+		r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( a3, _mm256_permute_ps ( b23, 0xFF ) ) );
+
+		_mm256_storeu_ps ( out, r01 );
+		_mm256_storeu_ps ( out + 8, r23 );
+	}
+
+	JCQT_TARGET_AVX static void multiplyBatchAVX ( const gpumat4* a, const gpumat4* b, gpumat4* out, qsizetype n )
+	{
+		for ( qsizetype i = 0; i < n; i++ )
+			multiplyAVX ( a [ i ].data_, b [ i ].data_, out [ i ].data_ );
+	}
+
+	JCQT_TARGET_AVX static void multiplyIndexedAVX ( const gpumat4* a, const qint32* parents, const gpumat4* b, gpumat4* out, qsizetype n )
+	{
+		for ( qsizetype i = 0; i < n; i++ )
+			multiplyAVX ( a [ parents [ i ] ].data_, b [ i ].data_, out [ i ].data_ );
+	}
+#endif
+
+	void mat4MultiplyBatch ( const gpumat4* a, const gpumat4* b, gpumat4* out, qsizetype n )
+	{
+#if defined(JCQT_SIMD_X86)
+		if ( simd::cpuFeatures ().avx_ )
+		{
+			multiplyBatchAVX ( a, b, out, n );
+			return;
+		}
+#endif
+		for ( qsizetype i = 0; i < n; i++ )
+			mat4Multiply ( a [ i ], b [ i ], out [ i ] );
+	}
+
+	void mat4MultiplyIndexed ( const gpumat4* a, const qint32* parents, const gpumat4* b, gpumat4* out, qsizetype n )
+	{
+#if defined(JCQT_SIMD_X86)
+		if ( simd::cpuFeatures ().avx_ )
+		{
+			multiplyIndexedAVX ( a, parents, b, out, n );
+			return;
+		}
+#endif
+		for ( qsizetype i = 0; i < n; i++ )
+			mat4Multiply ( a [ parents [ i ] ], b [ i ], out [ i ] );
+	}
+
+	void decomposeTRS ( const gpumat4& m, gpuvec3& t, gpuvec4& r, gpuvec3& s )
+	{
+		t = gpuvec3 ( m ( 3, 0 ), m ( 3, 1 ), m ( 3, 2 ) );
+
+		float sx = std::sqrt ( m ( 0, 0 ) * m ( 0, 0 ) + m ( 0, 1 ) * m ( 0, 1 ) + m ( 0, 2 ) * m ( 0, 2 ) );
+		const float sy = std::sqrt ( m ( 1, 0 ) * m ( 1, 0 ) + m ( 1, 1 ) * m ( 1, 1 ) + m ( 1, 2 ) * m ( 1, 2 ) );
+		const float sz = std::sqrt ( m ( 2, 0 ) * m ( 2, 0 ) + m ( 2, 1 ) * m ( 2, 1 ) + m ( 2, 2 ) * m ( 2, 2 ) );
+
+		const float det = m ( 0, 0 ) * ( m ( 1, 1 ) * m ( 2, 2 ) - m ( 2, 1 ) * m ( 1, 2 ) )
+			- m ( 1, 0 ) * ( m ( 0, 1 ) * m ( 2, 2 ) - m ( 2, 1 ) * m ( 0, 2 ) )
+			+ m ( 2, 0 ) * ( m ( 0, 1 ) * m ( 1, 2 ) - m ( 1, 1 ) * m ( 0, 2 ) );
+		if ( det < 0.0f )
+			sx = -sx;
+
+		s = gpuvec3 ( sx, sy, sz );
+
+		if ( sx == 0.0f || sy == 0.0f || sz == 0.0f )
+		{
+			r = gpuvec4 ( 0.0f, 0.0f, 0.0f, 1.0f );
+			return;
+		}
+
+		// rotation part R(col, row) with the scale divided out
+		float R [ 3 ][ 3 ];
+		for ( int row = 0; row < 3; row++ )
+		{
+			R [ 0 ][ row ] = m ( 0, row ) / sx;
+			R [ 1 ][ row ] = m ( 1, row ) / sy;
+			R [ 2 ][ row ] = m ( 2, row ) / sz;
+		}
+
+		// Shepperd: pivot on the largest of w, x, y, z to keep the square root away from zero
+		const float trace = R [ 0 ][ 0 ] + R [ 1 ][ 1 ] + R [ 2 ][ 2 ];
+		float x, y, z, w;
+		if ( trace > 0.0f )
+		{
+			const float k = 0.5f / std::sqrt ( trace + 1.0f );
+			w = 0.25f / k;
+			x = ( R [ 1 ][ 2 ] - R [ 2 ][ 1 ] ) * k;
+			y = ( R [ 2 ][ 0 ] - R [ 0 ][ 2 ] ) * k;
+			z = ( R [ 0 ][ 1 ] - R [ 1 ][ 0 ] ) * k;
+		}
+		else if ( R [ 0 ][ 0 ] > R [ 1 ][ 1 ] && R [ 0 ][ 0 ] > R [ 2 ][ 2 ] )
+		{
+			const float k = 0.5f / std::sqrt ( 1.0f + R [ 0 ][ 0 ] - R [ 1 ][ 1 ] - R [ 2 ][ 2 ] );
+			x = 0.25f / k;
+			w = ( R [ 1 ][ 2 ] - R [ 2 ][ 1 ] ) * k;
+			y = ( R [ 1 ][ 0 ] + R [ 0 ][ 1 ] ) * k;
+			z = ( R [ 2 ][ 0 ] + R [ 0 ][ 2 ] ) * k;
+		}
+		else if ( R [ 1 ][ 1 ] > R [ 2 ][ 2 ] )
+		{
+			const float k = 0.5f / std::sqrt ( 1.0f + R [ 1 ][ 1 ] - R [ 0 ][ 0 ] - R [ 2 ][ 2 ] );
+			y = 0.25f / k;
+			w = ( R [ 2 ][ 0 ] - R [ 0 ][ 2 ] ) * k;
+			x = ( R [ 1 ][ 0 ] + R [ 0 ][ 1 ] ) * k;
+			z = ( R [ 2 ][ 1 ] + R [ 1 ][ 2 ] ) * k;
+		}
+		else
+		{
+			const float k = 0.5f / std::sqrt ( 1.0f + R [ 2 ][ 2 ] - R [ 0 ][ 0 ] - R [ 1 ][ 1 ] );
+			z = 0.25f / k;
+			w = ( R [ 0 ][ 1 ] - R [ 1 ][ 0 ] ) * k;
+			x = ( R [ 2 ][ 0 ] + R [ 0 ][ 2 ] ) * k;
+			y = ( R [ 2 ][ 1 ] + R [ 1 ][ 2 ] ) * k;
+		}
+
+		const float len = std::sqrt ( x * x + y * y + z * z + w * w );
+		r = gpuvec4 ( x / len, y / len, z / len, w / len );
+	}
+
+	void composeTRSBatch ( const gpuvec3* translations, const gpuvec4* rotations, const gpuvec3* scales, const qint32* nodes, gpumat4* out, qsizetype n )
+	{
+		qsizetype i = 0;
+#if defined(JCQT_SIMD_SSE)
+		// one node per lane: the inputs are gathered into x, y, z, w registers, the matrix entries are computed for four nodes at once and
+		// a 4x4 transpose per column turns the lanes back into one column per matrix
+		const __m128 one = _mm_set1_ps ( 1.0f );
+		const __m128 two = _mm_set1_ps ( 2.0f );
+		const __m128 zero = _mm_setzero_ps ();
+
+		for ( ; i + 4 <= n; i += 4 )
+		{
+			const qint32 n0 = nodes [ i ], n1 = nodes [ i + 1 ], n2 = nodes [ i + 2 ], n3 = nodes [ i + 3 ];
+			const gpuvec4& r0 = rotations [ n0 ], & r1 = rotations [ n1 ], & r2 = rotations [ n2 ], & r3 = rotations [ n3 ];
+			const gpuvec3& s0 = scales [ n0 ], & s1 = scales [ n1 ], & s2 = scales [ n2 ], & s3 = scales [ n3 ];
+			const gpuvec3& t0 = translations [ n0 ], & t1 = translations [ n1 ], & t2 = translations [ n2 ], & t3 = translations [ n3 ];
+
+			const __m128 x = _mm_setr_ps ( r0.x, r1.x, r2.x, r3.x );
+			const __m128 y = _mm_setr_ps ( r0.y, r1.y, r2.y, r3.y );
+			const __m128 z = _mm_setr_ps ( r0.z, r1.z, r2.z, r3.z );
+			const __m128 w = _mm_setr_ps ( r0.w, r1.w, r2.w, r3.w );
+			const __m128 sx = _mm_setr_ps ( s0.x, s1.x, s2.x, s3.x );
+			const __m128 sy = _mm_setr_ps ( s0.y, s1.y, s2.y, s3.y );
+			const __m128 sz = _mm_setr_ps ( s0.z, s1.z, s2.z, s3.z );
+
+			const __m128 xx = _mm_mul_ps ( x, x ), yy = _mm_mul_ps ( y, y ), zz = _mm_mul_ps ( z, z );
+			const __m128 xy = _mm_mul_ps ( x, y ), xz = _mm_mul_ps ( x, z ), yz = _mm_mul_ps ( y, z );
+			const __m128 wx = _mm_mul_ps ( w, x ), wy = _mm_mul_ps ( w, y ), wz = _mm_mul_ps ( w, z );
+
+			__m128 c00 = _mm_mul_ps ( _mm_sub_ps ( one, _mm_mul_ps ( two, _mm_add_ps ( yy, zz ) ) ), sx );
+			__m128 c01 = _mm_mul_ps ( _mm_mul_ps ( two, _mm_add_ps ( xy, wz ) ), sx );
+			__m128 c02 = _mm_mul_ps ( _mm_mul_ps ( two, _mm_sub_ps ( xz, wy ) ), sx );
+			__m128 c03 = zero;
+
+			__m128 c10 = _mm_mul_ps ( _mm_mul_ps ( two, _mm_sub_ps ( xy, wz ) ), sy );
+			__m128 c11 = _mm_mul_ps ( _mm_sub_ps ( one, _mm_mul_ps ( two, _mm_add_ps ( xx, zz ) ) ), sy );
+			__m128 c12 = _mm_mul_ps ( _mm_mul_ps ( two, _mm_add_ps ( yz, wx ) ), sy );
+			__m128 c13 = zero;
+
+			__m128 c20 = _mm_mul_ps ( _mm_mul_ps ( two, _mm_add_ps ( xz, wy ) ), sz );
+			__m128 c21 = _mm_mul_ps ( _mm_mul_ps ( two, _mm_sub_ps ( yz, wx ) ), sz );
+			__m128 c22 = _mm_mul_ps ( _mm_sub_ps ( one, _mm_mul_ps ( two, _mm_add_ps ( xx, yy ) ) ), sz );
+			__m128 c23 = zero;
+
+			__m128 c30 = _mm_setr_ps ( t0.x, t1.x, t2.x, t3.x );
+			__m128 c31 = _mm_setr_ps ( t0.y, t1.y, t2.y, t3.y );
+			__m128 c32 = _mm_setr_ps ( t0.z, t1.z, t2.z, t3.z );
+			__m128 c33 = one;
+
+			_MM_TRANSPOSE4_PS ( c00, c01, c02, c03 );
+			_MM_TRANSPOSE4_PS ( c10, c11, c12, c13 );
+			_MM_TRANSPOSE4_PS ( c20, c21, c22, c23 );
+			_MM_TRANSPOSE4_PS ( c30, c31, c32, c33 );
+
+			// after the transposes cXk holds column X of the matrix of lane k
+			_mm_storeu_ps ( out [ n0 ].data_, c00 );
+			_mm_storeu_ps ( out [ n0 ].data_ + 4, c10 );
+			_mm_storeu_ps ( out [ n0 ].data_ + 8, c20 );
+			_mm_storeu_ps ( out [ n0 ].data_ + 12, c30 );
+			_mm_storeu_ps ( out [ n1 ].data_, c01 );
+			_mm_storeu_ps ( out [ n1 ].data_ + 4, c11 );
+			_mm_storeu_ps ( out [ n1 ].data_ + 8, c21 );
+			_mm_storeu_ps ( out [ n1 ].data_ + 12, c31 );
+			_mm_storeu_ps ( out [ n2 ].data_, c02 );
+			_mm_storeu_ps ( out [ n2 ].data_ + 4, c12 );
+			_mm_storeu_ps ( out [ n2 ].data_ + 8, c22 );
+			_mm_storeu_ps ( out [ n2 ].data_ + 12, c32 );
+			_mm_storeu_ps ( out [ n3 ].data_, c03 );
+			_mm_storeu_ps ( out [ n3 ].data_ + 4, c13 );
+			_mm_storeu_ps ( out [ n3 ].data_ + 8, c23 );
+			_mm_storeu_ps ( out [ n3 ].data_ + 12, c33 );
+		}
+#endif
+		for ( ; i < n; i++ )
+		{
+			const qint32 node = nodes [ i ];
+			composeTRS ( translations [ node ], rotations [ node ], scales [ node ], out [ node ] );
+		}
+	}
+}
@@ -37,6 +37,8 @@ SOFTWARE.
 
 #include <QMatrix4x4>
 
+#include "simd.h"
+
 namespace jcqt
 {
 	struct PACKED_STRUCT gpuvec4
@@ -49,7 +51,18 @@ namespace jcqt
 		explicit gpuvec4 ( const QVector4D& v ) : x ( v.x () ), y ( v.y () ), z ( v.z () ), w ( v.w () ) {}
 	};
 
-	struct PACKED_STRUCT gpumat4
+	struct PACKED_STRUCT gpuvec3
+	{
+		float x, y, z;
+
+		gpuvec3 () = default;
+		explicit gpuvec3 ( float v ) : x ( v ), y ( v ), z ( v ) {}
+		gpuvec3 ( float a, float b, float c ) : x ( a ), y ( b ), z ( c ) {}
+		explicit gpuvec3 ( const QVector3D& v ) : x ( v.x () ), y ( v.y () ), z ( v.z () ) {}
+	};
+
+	// 16 floats have no padding to remove, and GCC refuses to bind the references returned by operator() to members of a packed struct
+	struct gpumat4
 	{
 		float data_ [ 16 ];
 
@@ -78,6 +91,116 @@ namespace jcqt
 			return data_ [ col * 4 + row ];
 		}
 	};
+
+	/*
+	*	Column major gpumat4 products without the QMatrix4x4 round trip. gpumat4 is only float aligned (and gpuvec4 is packed), so every
+	*	load and store is unaligned. out may alias a or b.
+	*/
+
+	// out = a * b
+	inline void mat4Multiply ( const gpumat4& a, const gpumat4& b, gpumat4& out )
+	{
+#if defined(JCQT_SIMD_SSE)
+		// a is kept in registers and column j of b is read before column j of out is written, which makes the aliasing safe
+		const __m128 a0 = _mm_loadu_ps ( a.data_ );
+		const __m128 a1 = _mm_loadu_ps ( a.data_ + 4 );
+		const __m128 a2 = _mm_loadu_ps ( a.data_ + 8 );
+		const __m128 a3 = _mm_loadu_ps ( a.data_ + 12 );
+
+		for ( int col = 0; col < 4; col++ )
+		{
+			const __m128 bc = _mm_loadu_ps ( b.data_ + col * 4 );
+			__m128 r = _mm_mul_ps ( a0, _mm_shuffle_ps ( bc, bc, _MM_SHUFFLE ( 0, 0, 0, 0 ) ) );
+			r = _mm_add_ps ( r, _mm_mul_ps ( a1, _mm_shuffle_ps ( bc, bc, _MM_SHUFFLE ( 1, 1, 1, 1 ) ) ) );
+			r = _mm_add_ps ( r, _mm_mul_ps ( a2, _mm_shuffle_ps ( bc, bc, _MM_SHUFFLE ( 2, 2, 2, 2 ) ) ) );
+			r = _mm_add_ps ( r, _mm_mul_ps ( a3, _mm_shuffle_ps ( bc, bc, _MM_SHUFFLE ( 3, 3, 3, 3 ) ) ) );
+			_mm_storeu_ps ( out.data_ + col * 4, r );
+		}
+#else
+		float r [ 16 ];
+		for ( int col = 0; col < 4; col++ )
+		{
+			for ( int row = 0; row < 4; row++ )
+			{
+				r [ col * 4 + row ] = a ( 0, row ) * b ( col, 0 ) + a ( 1, row ) * b ( col, 1 ) + a ( 2, row ) * b ( col, 2 ) + a ( 3, row ) * b ( col, 3 );
+			}
+		}
+		memcpy ( out.data_, r, sizeof ( r ) );
+#endif
+	}
+
+	inline gpumat4 operator*( const gpumat4& a, const gpumat4& b )
+	{
+		gpumat4 r;
+		mat4Multiply ( a, b, r );
+		return r;
+	}
+
+	// m * v
+	inline gpuvec4 mat4Transform ( const gpumat4& m, const gpuvec4& v )
+	{
+#if defined(JCQT_SIMD_SSE)
+		__m128 acc = _mm_mul_ps ( _mm_loadu_ps ( m.data_ ), _mm_set1_ps ( v.x ) );
+		acc = _mm_add_ps ( acc, _mm_mul_ps ( _mm_loadu_ps ( m.data_ + 4 ), _mm_set1_ps ( v.y ) ) );
+		acc = _mm_add_ps ( acc, _mm_mul_ps ( _mm_loadu_ps ( m.data_ + 8 ), _mm_set1_ps ( v.z ) ) );
+		acc = _mm_add_ps ( acc, _mm_mul_ps ( _mm_loadu_ps ( m.data_ + 12 ), _mm_set1_ps ( v.w ) ) );
+		// the members of the packed gpuvec4 cannot be addressed directly
+		float r [ 4 ];
+		_mm_storeu_ps ( r, acc );
+		return gpuvec4 ( r [ 0 ], r [ 1 ], r [ 2 ], r [ 3 ] );
+#else
+		gpuvec4 r;
+		r.x = m ( 0, 0 ) * v.x + m ( 1, 0 ) * v.y + m ( 2, 0 ) * v.z + m ( 3, 0 ) * v.w;
+		r.y = m ( 0, 1 ) * v.x + m ( 1, 1 ) * v.y + m ( 2, 1 ) * v.z + m ( 3, 1 ) * v.w;
+		r.z = m ( 0, 2 ) * v.x + m ( 1, 2 ) * v.y + m ( 2, 2 ) * v.z + m ( 3, 2 ) * v.w;
+		r.w = m ( 0, 3 ) * v.x + m ( 1, 3 ) * v.y + m ( 2, 3 ) * v.z + m ( 3, 3 ) * v.w;
+		return r;
+#endif
+	}
+
+	// out[i] = a[i] * b[i] for n pairs, two columns at a time with AVX when the CPU has it. out may alias a or b element-wise.
+	void mat4MultiplyBatch ( const gpumat4* a, const gpumat4* b, gpumat4* out, qsizetype n );
+	// out[i] = a[parents[i]] * b[i], e.g. global transforms of n children from their parents' global and their own local transforms
+	void mat4MultiplyIndexed ( const gpumat4* a, const qint32* parents, const gpumat4* b, gpumat4* out, qsizetype n );
+
+	/*
+	*	Translation, rotation and scale in the form glTF nodes and animation channels use. The rotation is a unit quaternion stored as
+	*	(x, y, z, w) and the composed matrix is T * R * S.
+	*/
+
+	// out = T * R * S
+	inline void composeTRS ( const gpuvec3& t, const gpuvec4& r, const gpuvec3& s, gpumat4& out )
+	{
+		const float xx = r.x * r.x, yy = r.y * r.y, zz = r.z * r.z;
+		const float xy = r.x * r.y, xz = r.x * r.z, yz = r.y * r.z;
+		const float wx = r.w * r.x, wy = r.w * r.y, wz = r.w * r.z;
+
+		out ( 0, 0 ) = ( 1.0f - 2.0f * ( yy + zz ) ) * s.x;
+		out ( 0, 1 ) = 2.0f * ( xy + wz ) * s.x;
+		out ( 0, 2 ) = 2.0f * ( xz - wy ) * s.x;
+		out ( 0, 3 ) = 0.0f;
+
+		out ( 1, 0 ) = 2.0f * ( xy - wz ) * s.y;
+		out ( 1, 1 ) = ( 1.0f - 2.0f * ( xx + zz ) ) * s.y;
+		out ( 1, 2 ) = 2.0f * ( yz + wx ) * s.y;
+		out ( 1, 3 ) = 0.0f;
+
+		out ( 2, 0 ) = 2.0f * ( xz + wy ) * s.z;
+		out ( 2, 1 ) = 2.0f * ( yz - wx ) * s.z;
+		out ( 2, 2 ) = ( 1.0f - 2.0f * ( xx + yy ) ) * s.z;
+		out ( 2, 3 ) = 0.0f;
+
+		out ( 3, 0 ) = t.x;
+		out ( 3, 1 ) = t.y;
+		out ( 3, 2 ) = t.z;
+		out ( 3, 3 ) = 1.0f;
+	}
+
+	// inverse of composeTRS for affine matrices without shear, a negative determinant is folded into the x scale
+	void decomposeTRS ( const gpumat4& m, gpuvec3& t, gpuvec4& r, gpuvec3& s );
+
+	// out[nodes[i]] = T[nodes[i]] * R[nodes[i]] * S[nodes[i]] for n nodes, four at a time with SSE
+	void composeTRSBatch ( const gpuvec3* translations, const gpuvec4* rotations, const gpuvec3* scales, const qint32* nodes, gpumat4* out, qsizetype n );
 }
 
 #endif // !__VEC_4_H__